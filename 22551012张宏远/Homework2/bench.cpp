@@ -0,0 +1,294 @@
+//22551012
+//张宏远
+
+//基准测试：用固定的种子渲染几个典型场景，报告各阶段耗时、每秒采样数和射线数，
+//并把结果与 bench_refs/ 里的参考图比较（显示空间的 RMSE），用来在不同提交之间对比性能和正确性
+//
+//用法：Bench [--scene 名字] [--threads N] [--repeat N] [--seed N] [--update] [--denoise N] [--refs 目录] [--out 目录]
+//  --repeat  每个场景渲染 N 次，取最快的一次
+//  --seed    换一组采样随机数，用来估计噪声水平；参考图用的是 0
+//  --update  以 reference_spp 个采样重新渲染参考图（近似无噪声的真值）
+//  --denoise 改为每像素 N 个采样渲染并去噪，报告去噪前后与参考图的 RMSE，
+//            以及达到去噪后误差大约需要多少采样（误差按 1/sqrt(spp) 下降估算）
+
+#define FAST_OBJ_LOADER_IMPLEMENTATION
+#include "rtweekend.h"
+#include "camera.h"
+#include "scenes.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef BENCH_REF_DIR
+#define BENCH_REF_DIR "bench_refs"
+#endif
+
+//包在场景外面统计射线数：射线包里的是相机射线，逐条求交的是弹射和阴影射线
+//计数按线程分散到不同的槽里，避免所有线程抢同一个原子变量
+class ray_counter : public hittable {
+  public:
+    ray_counter(shared_ptr<hittable> inner) : inner(inner) { reset(); }
+
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        slot().secondary.fetch_add(1, std::memory_order_relaxed);
+        return inner->hit(r, ray_t, rec);
+    }
+
+    void hit_packet(ray_packet& packet, interval ray_t) const override {
+        slot().primary.fetch_add(uint64_t(packet.size), std::memory_order_relaxed);
+        inner->hit_packet(packet, ray_t);
+    }
+
+    aabb bounding_box() const override { return inner->bounding_box(); }
+
+    void reset() {
+        for (auto& s : slots) {
+            s.primary.store(0);
+            s.secondary.store(0);
+        }
+    }
+
+    uint64_t primary() const {
+        uint64_t n = 0;
+        for (const auto& s : slots)
+            n += s.primary.load();
+        return n;
+    }
+
+    uint64_t secondary() const {
+        uint64_t n = 0;
+        for (const auto& s : slots)
+            n += s.secondary.load();
+        return n;
+    }
+
+  private:
+    struct counters {
+        std::atomic<uint64_t> primary;
+        std::atomic<uint64_t> secondary;
+        char pad[48];   // 每个槽占一条缓存行
+    };
+    static const int slot_count = 64;
+
+    shared_ptr<hittable> inner;
+    mutable counters slots[slot_count];
+
+    counters& slot() const {
+        return slots[std::hash<std::thread::id>()(std::this_thread::get_id()) % slot_count];
+    }
+};
+
+//一个基准场景：场景函数、生成场景的随机数种子、渲染参数和允许的误差
+struct bench_scene {
+    const char* name;
+    void (*build)(hittable_list& world, hittable_list& lights, camera& cam);
+    pcg32  rng;
+    int    samples_per_pixel;
+    int    max_depth;
+    double tolerance;   // 与参考图的 RMSE 上限（0~1），约为 samples_per_pixel 个采样实际误差的 1.3 倍
+};
+
+static const int bench_width = 256;
+static const int reference_spp = 1024;
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+//两张 8 位图在显示空间的 RMSE（0~1），尺寸不一致时返回负数
+static double image_rmse(const std::string& a, const std::string& b) {
+    int wa, ha, wb, hb;
+    std::vector<unsigned char> pa, pb;
+    if (!image_io::read_ppm(a, wa, ha, pa) || !image_io::read_ppm(b, wb, hb, pb) || wa != wb || ha != hb)
+        return -1;
+    double sum = 0;
+    for (size_t i = 0; i < pa.size(); i++) {
+        double d = (double(pa[i]) - double(pb[i])) / 255.0;
+        sum += d * d;
+    }
+    return std::sqrt(sum / pa.size());
+}
+
+static bool copy_file(const std::string& from, const std::string& to) {
+    std::ifstream in(from.c_str(), std::ios::binary);
+    std::ofstream out(to.c_str(), std::ios::binary);
+    out << in.rdbuf();
+    return bool(in) && bool(out);
+}
+
+//低采样渲染到 EXR（带 AOV），读回后单独计时去噪，去噪前后的结果都写成 PPM 与参考图比较
+static bool run_denoise(const bench_scene& s, camera& cam, const hittable& world, const hittable_list& lights,
+                        int spp, int threads, const std::string& out_dir, const std::string& ref) {
+    std::string base = out_dir + "/bench_" + s.name;
+    cam.samples_per_pixel = spp;
+    cam.output_file = base + ".exr";
+
+    auto t0 = std::chrono::steady_clock::now();
+    cam.render(world, lights);
+    double render_s = seconds_since(t0);
+
+    hdr_image raw;
+    if (!image_io::read_exr(cam.output_file, raw)) {
+        std::printf("%-8s cannot read %s\n", s.name, cam.output_file.c_str());
+        return false;
+    }
+    denoise_options options;
+    options.thread_count = threads;
+    auto t1 = std::chrono::steady_clock::now();
+    hdr_image clean = denoiser::denoise(raw, options);
+    double denoise_s = seconds_since(t1);
+
+    if (!image_io::write_image(raw, base + ".ppm") || !image_io::write_image(clean, base + "_denoised.ppm")) {
+        std::printf("%-8s cannot write to %s\n", s.name, out_dir.c_str());
+        return false;
+    }
+    double raw_rmse = image_rmse(base + ".ppm", ref);
+    double clean_rmse = image_rmse(base + "_denoised.ppm", ref);
+    if (raw_rmse < 0 || clean_rmse < 0) {
+        std::printf("%-8s no reference\n", s.name);
+        return false;
+    }
+
+    double like_spp = clean_rmse > 0 ? spp * (raw_rmse / clean_rmse) * (raw_rmse / clean_rmse) : infinity;
+    std::printf("%-8s %5d %9.3f %10.1f %9.4f %10.4f %8.0f\n",
+                s.name, spp, render_s, denoise_s * 1e3, raw_rmse, clean_rmse, like_spp);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<bench_scene> all = {
+        { "spheres", scenes::random_spheres, pcg32(),     32, 50, 0.035 },
+        { "tori",    scenes::torus_field,    pcg32(2, 0), 32, 50, 0.036 },
+        { "glass",   scenes::glass,          pcg32(3, 0), 32, 50, 0.042 },
+    };
+
+    std::string only, ref_dir = BENCH_REF_DIR, out_dir = ".";
+    int threads = 0, repeat = 1, denoise_spp = 0;
+    uint64_t seed = 0;
+    bool update = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--scene" && has_value)        only = argv[++i];
+        else if (arg == "--threads" && has_value) threads = std::atoi(argv[++i]);
+        else if (arg == "--repeat" && has_value)  repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seed" && has_value)    seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--refs" && has_value)    ref_dir = argv[++i];
+        else if (arg == "--out" && has_value)     out_dir = argv[++i];
+        else if (arg == "--denoise" && has_value) denoise_spp = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--update")               update = true;
+        else {
+            std::cerr << "usage: " << argv[0] << " [--scene NAME] [--threads N] [--repeat N] [--seed N]"
+                      << " [--update] [--denoise N] [--refs DIR] [--out DIR]\n";
+            return 2;
+        }
+    }
+
+    int thread_total = threads > 0 ? threads : int(std::thread::hardware_concurrency());
+#if defined(__AVX2__)
+    const char* simd = "AVX2";
+#else
+    const char* simd = "scalar";
+#endif
+#if defined(RT_PRECISION_FLOAT)
+    const char* precision = "float";
+#elif defined(RT_PRECISION_MIXED)
+    const char* precision = "mixed";
+#else
+    const char* precision = "double";
+#endif
+    std::printf("threads %d, packets %s, precision %s, %d px wide, best of %d, sample seed %llu\n\n",
+                thread_total, simd, precision, bench_width, repeat, (unsigned long long)seed);
+    if (update && denoise_spp > 0) {
+        std::cerr << "--update and --denoise cannot be combined\n";
+        return 2;
+    }
+    if (denoise_spp > 0)
+        std::printf("%-8s %5s %9s %10s %9s %10s %8s\n",
+                    "scene", "spp", "render s", "denoise ms", "raw rmse", "denoised", "like spp");
+    else
+        std::printf("%-8s %9s %9s %9s %11s %9s %9s %9s %8s  %s\n",
+                    "scene", "scene ms", "bvh ms", "render s", "Msamples/s", "Mrays/s",
+                    "primary", "bounce", "rmse", "result");
+
+    int failures = 0, ran = 0;
+    for (auto& s : all) {
+        if (!only.empty() && only != s.name)
+            continue;
+        ran++;
+
+        // 场景阶段：生成物体，包括网格和它们的 BLAS
+        thread_rng() = s.rng;
+        auto t0 = std::chrono::steady_clock::now();
+        hittable_list world, lights;
+        camera cam;
+        s.build(world, lights, cam);
+        double scene_s = seconds_since(t0);
+
+        // BVH 阶段：顶层 BVH
+        auto t1 = std::chrono::steady_clock::now();
+        auto top = make_shared<bvh>(world);
+        double bvh_s = seconds_since(t1);
+
+        auto counter = make_shared<ray_counter>(top);
+        cam.image_width       = bench_width;
+        cam.samples_per_pixel = update ? reference_spp : s.samples_per_pixel;
+        cam.max_depth         = s.max_depth;
+        cam.thread_count      = threads;
+        cam.seed              = seed;
+        cam.show_progress     = false;
+        cam.output_file       = out_dir + "/bench_" + s.name + ".ppm";
+        std::string ref = ref_dir + "/" + s.name + ".ppm";
+
+        if (denoise_spp > 0) {
+            failures += !run_denoise(s, cam, *top, lights, denoise_spp, threads, out_dir, ref);
+            continue;
+        }
+
+        // 渲染阶段：取最快的一次，射线数每次都一样
+        double render_s = infinity;
+        for (int r = 0; r < repeat; r++) {
+            counter->reset();
+            auto t2 = std::chrono::steady_clock::now();
+            cam.render(*counter, lights);
+            render_s = std::fmin(render_s, seconds_since(t2));
+        }
+
+        int height = std::max(1, int(bench_width / cam.aspect_ratio));
+        double samples = double(bench_width) * height * cam.samples_per_pixel;
+        double primary = double(counter->primary()), bounce = double(counter->secondary());
+
+        std::string result;
+        double rmse = -1;
+        if (update) {
+            result = copy_file(cam.output_file, ref) ? "updated" : "cannot write " + ref;
+            failures += result != "updated";
+        } else {
+            rmse = image_rmse(cam.output_file, ref);
+            if (rmse < 0)
+                result = "no reference";
+            else
+                result = rmse <= s.tolerance ? "ok" : "FAIL";
+            failures += result != "ok";
+        }
+
+        std::printf("%-8s %9.1f %9.1f %9.3f %11.3f %9.3f %9.0f %9.0f %8.4f  %s\n",
+                    s.name, scene_s * 1e3, bvh_s * 1e3, render_s, samples / render_s * 1e-6,
+                    (primary + bounce) / render_s * 1e-6, primary, bounce, rmse, result.c_str());
+    }
+
+    if (ran == 0) {
+        std::cerr << "unknown scene " << only << "\n";
+        return 2;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,545 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "hittable.h"
+#include "hittable_list.h"
+#include "simd.h"
+#include "sphere.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//real 为 float 时，逐条射线的包围盒测试用 SSE 把三个轴放在一起算（vec3 按 16 字节对齐，可以直接装入）
+#if defined(__AVX2__) && (defined(RT_PRECISION_FLOAT) || defined(RT_PRECISION_MIXED))
+#define BVH_SSE_SLABS 1
+#else
+#define BVH_SSE_SLABS 0
+#endif
+
+//压平后的 BVH 结构本身：只关心每个图元的包围盒，不关心图元是什么
+//bvh（物体）和 triangle_mesh（三角形）都用它，叶子里存的是图元排序后的下标区间
+class bvh_tree {
+  public:
+    // 32 字节的节点：包围盒用 float 存（向外取整，保证不会漏掉交点）
+    // 内部节点的左孩子紧跟在自己后面，offset 指向右孩子；叶子节点 offset 指向第一个物体
+    struct node {
+        float    bmin[3];
+        float    bmax[3];
+        uint32_t offset;
+        uint16_t count;   // 叶子中的物体数，0 表示内部节点
+        uint8_t  axis;    // 内部节点的划分轴
+        uint8_t  pad;
+    };
+    static_assert(sizeof(node) == 32, "bvh node should be 32 bytes");
+
+    static const int max_depth = 64;    // 超过这个深度改用中位数划分，保证栈够用
+
+    //按包围盒建树；order 返回图元在叶子中的排列顺序（原始下标），
+    //调用者按这个顺序重排图元后，叶子的 offset/count 就是连续的一段
+    void build(const std::vector<aabb>& boxes, int build_threads, std::vector<uint32_t>& order) {
+        nodes.clear();
+        order.resize(boxes.size());
+        if (boxes.empty()) {
+            bbox = aabb();
+            return;
+        }
+
+        // 预先算好每个图元的中心点，构建时只操作下标
+        std::vector<prim_info> info(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++) {
+            info[i].box = boxes[i];
+            info[i].centroid = boxes[i].centroid();
+            order[i] = uint32_t(i);
+        }
+
+        int threads = build_threads > 0 ? build_threads : int(std::thread::hardware_concurrency());
+        int spawn_depth = 0;
+        while ((1 << spawn_depth) < threads)
+            spawn_depth++;
+
+        std::unique_ptr<build_node> root = build(info, order, 0, uint32_t(order.size()), 0, spawn_depth);
+
+        nodes.resize(root->subtree_nodes);
+        uint32_t next = 0;
+        flatten(root.get(), next);
+        bbox = root->box;
+    }
+
+    //逐条射线遍历。hit_prim(i, ray_t) 对排序后的第 i 个图元求交，命中时把 ray_t.max 缩短到交点并返回 true
+    template <typename HitPrim>
+    bool traverse(const ray& r, interval& ray_t, const HitPrim& hit_prim) const {
+        if (nodes.empty())
+            return false;
+
+        slab_ray slab(r);
+        const bool* dir_neg = slab.dir_neg;
+        bool hit_anything = false;
+
+        uint32_t stack[max_depth + 32];
+        int stack_size = 0;
+        uint32_t current = 0;
+
+        for (;;) {
+            const node& n = nodes[current];
+            if (slab.hit(n, ray_t)) {
+                if (n.count > 0) {
+                    for (uint32_t i = n.offset; i < n.offset + n.count; i++) {
+                        if (hit_prim(i, ray_t))
+                            hit_anything = true;
+                    }
+                    if (stack_size == 0)
+                        break;
+                    current = stack[--stack_size];
+                } else {
+                    // 沿射线方向先访问靠前的孩子，先找到的交点能剪掉后面的节点
+                    if (dir_neg[n.axis]) {
+                        stack[stack_size++] = current + 1;
+                        current = n.offset;
+                    } else {
+                        stack[stack_size++] = n.offset;
+                        current = current + 1;
+                    }
+                }
+            } else {
+                if (stack_size == 0)
+                    break;
+                current = stack[--stack_size];
+            }
+        }
+
+        return hit_anything;
+    }
+
+    bool empty() const { return nodes.empty(); }
+    const std::vector<node>& node_list() const { return nodes; }
+    aabb bounds() const { return bbox; }
+    size_t memory_bytes() const { return nodes.capacity() * sizeof(node); }
+
+    //逐条射线的包围盒（slab）测试，构造时算好方向的倒数和符号。
+    //射线恰好擦过包围盒的角或棱时，舍入误差可能让 t_far 略小于 t_near，把共享顶点的三角形全部剪掉；
+    //按 PBRT 的做法把 t_far 放大 1 + 2*gamma(3)，保证不会漏掉盒子里的交点；gamma 按 real 的精度计算
+    struct slab_ray {
+        real inv_dir[3];
+        bool dir_neg[3];
+
+        slab_ray(const ray& r) : orig(r.origin()) {
+            for (int a = 0; a < 3; a++) {
+                inv_dir[a] = 1 / r.direction()[a];
+                dir_neg[a] = inv_dir[a] < 0;
+            }
+#if BVH_SSE_SLABS
+            // 三个轴放进一个 SSE 寄存器同时算；第 4 个通道读到的是 vec3 的填充和节点的 offset，最后换成区间端点
+            o4 = _mm_load_ps(&orig.e[0]);
+            inv4 = _mm_set_ps(0, inv_dir[2], inv_dir[1], inv_dir[0]);
+            neg4 = _mm_castsi128_ps(_mm_set_epi32(0, -int(dir_neg[2]), -int(dir_neg[1]), -int(dir_neg[0])));
+#endif
+        }
+
+        bool hit(const node& n, const interval& ray_t) const {
+            static const real eps = std::numeric_limits<real>::epsilon() * real(0.5);
+            static const real far_scale = 1 + 2 * (3*eps / (1 - 3*eps));
+#if BVH_SSE_SLABS
+            __m128 lo = _mm_loadu_ps(n.bmin);   // bmin[0..2], bmax[0]
+            __m128 hi = _mm_loadu_ps(n.bmax);   // bmax[0..2], offset
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_blendv_ps(lo, hi, neg4), o4), inv4);
+            __m128 t1 = _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_blendv_ps(hi, lo, neg4), o4), inv4),
+                                   _mm_set1_ps(far_scale));
+            __m128 tmin = _mm_set1_ps(ray_t.min), tmax = _mm_set1_ps(ray_t.max);
+            // 与标量版本相同，方向分量为 0 时得到的 NaN 被忽略：max/min 遇到 NaN 返回第二个参数
+            __m128 t_near = _mm_max_ps(_mm_blend_ps(t0, tmin, 8), tmin);
+            __m128 t_far  = _mm_min_ps(_mm_blend_ps(t1, tmax, 8), tmax);
+            t_near = _mm_max_ps(t_near, _mm_shuffle_ps(t_near, t_near, _MM_SHUFFLE(1, 0, 3, 2)));
+            t_near = _mm_max_ps(t_near, _mm_shuffle_ps(t_near, t_near, _MM_SHUFFLE(2, 3, 0, 1)));
+            t_far  = _mm_min_ps(t_far,  _mm_shuffle_ps(t_far,  t_far,  _MM_SHUFFLE(1, 0, 3, 2)));
+            t_far  = _mm_min_ps(t_far,  _mm_shuffle_ps(t_far,  t_far,  _MM_SHUFFLE(2, 3, 0, 1)));
+            return _mm_comile_ss(t_near, t_far) != 0;
+#else
+            real tmin = ray_t.min, tmax = ray_t.max;
+            for (int a = 0; a < 3; a++) {
+                real t0 = (real(n.bmin[a]) - orig[a]) * inv_dir[a];
+                real t1 = (real(n.bmax[a]) - orig[a]) * inv_dir[a];
+                real t_near = dir_neg[a] ? t1 : t0;
+                real t_far  = (dir_neg[a] ? t0 : t1) * far_scale;
+                if (t_near > tmin) tmin = t_near;
+                if (t_far  < tmax) tmax = t_far;
+                if (tmax < tmin)
+                    return false;
+            }
+            return true;
+#endif
+        }
+
+      private:
+        const point3& orig;
+#if BVH_SSE_SLABS
+        __m128 o4, inv4, neg4;
+#endif
+    };
+
+  private:
+    struct prim_info {
+        aabb   box;
+        point3 centroid;
+    };
+
+    struct build_node {
+        aabb     box;
+        int      axis = 0;
+        uint32_t start = 0, count = 0;   // 叶子节点在 index 中的范围
+        size_t   subtree_nodes = 1;
+        std::unique_ptr<build_node> left, right;
+    };
+
+    static const int bin_count     = 16;
+    static const int max_leaf_size = 4;
+    static const int parallel_min  = 4096;  // 物体数少于这个的子树不再开新线程
+
+    std::vector<node> nodes;
+    aabb bbox;
+
+    static float round_down(double v) {
+        float f = float(v);
+        return double(f) > v ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+    }
+
+    static float round_up(double v) {
+        float f = float(v);
+        return double(f) < v ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+    }
+
+    static std::unique_ptr<build_node> build(const std::vector<prim_info>& info, std::vector<uint32_t>& index,
+                                             uint32_t start, uint32_t end, int depth, int spawn_depth) {
+        std::unique_ptr<build_node> result(new build_node);
+        uint32_t count = end - start;
+
+        aabb centroid_box;
+        for (uint32_t i = start; i < end; i++) {
+            const prim_info& p = info[index[i]];
+            result->box = aabb(result->box, p.box);
+            centroid_box = aabb(centroid_box, aabb(p.centroid, p.centroid));
+        }
+
+        result->start = start;
+        result->count = count;
+        if (count == 1)
+            return result;
+
+        // 在每个轴上把中心点分到 bin_count 个桶里，扫描桶边界求 SAH 代价最小的划分
+        int best_axis = -1, best_split = 0;
+        double best_cost = infinity;
+        if (depth < max_depth) {
+            for (int axis = 0; axis < 3; axis++) {
+                const interval& extent = centroid_box.axis_interval(axis);
+                if (extent.size() <= 0)
+                    continue;
+
+                int bin_prims[bin_count] = {};
+                aabb bin_box[bin_count];
+                double scale = bin_count / extent.size();
+                for (uint32_t i = start; i < end; i++) {
+                    const prim_info& p = info[index[i]];
+                    int b = std::min(bin_count - 1, int((p.centroid[axis] - extent.min) * scale));
+                    bin_prims[b]++;
+                    bin_box[b] = aabb(bin_box[b], p.box);
+                }
+
+                // 从右往左累计，得到每个划分位置右侧的面积和数量
+                double right_area[bin_count];
+                int right_prims[bin_count];
+                aabb acc;
+                int acc_prims = 0;
+                for (int b = bin_count - 1; b > 0; b--) {
+                    acc = aabb(acc, bin_box[b]);
+                    acc_prims += bin_prims[b];
+                    right_area[b] = acc.surface_area();
+                    right_prims[b] = acc_prims;
+                }
+
+                acc = aabb();
+                acc_prims = 0;
+                for (int b = 1; b < bin_count; b++) {
+                    acc = aabb(acc, bin_box[b - 1]);
+                    acc_prims += bin_prims[b - 1];
+                    if (acc_prims == 0 || right_prims[b] == 0)
+                        continue;
+                    double cost = acc.surface_area() * acc_prims + right_area[b] * right_prims[b];
+                    if (cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = b;
+                    }
+                }
+            }
+        }
+
+        // 代价按“遍历一次 = 相交一次”估计，与直接做叶子的代价比较
+        double parent_area = result->box.surface_area();
+        double split_cost = 1.0 + (parent_area > 0 ? best_cost / parent_area : double(count));
+        if (count <= max_leaf_size && (best_axis < 0 || split_cost >= count))
+            return result;
+
+        uint32_t mid;
+        if (best_axis >= 0) {
+            const interval& extent = centroid_box.axis_interval(best_axis);
+            double scale = bin_count / extent.size();
+            auto first = index.begin() + start;
+            auto split = std::partition(first, index.begin() + end, [&](uint32_t id) {
+                int b = std::min(bin_count - 1, int((info[id].centroid[best_axis] - extent.min) * scale));
+                return b < best_split;
+            });
+            mid = uint32_t(split - index.begin());
+            result->axis = best_axis;
+        } else {
+            // 中心点重合或者树太深时按最长轴的中位数划分
+            int axis = centroid_box.longest_axis();
+            mid = start + count / 2;
+            std::nth_element(index.begin() + start, index.begin() + mid, index.begin() + end,
+                             [&](uint32_t a, uint32_t b) { return info[a].centroid[axis] < info[b].centroid[axis]; });
+            result->axis = axis;
+        }
+
+        // 上面几层的左子树交给新线程构建，各线程处理互不重叠的 index 区间
+        if (spawn_depth > 0 && count >= uint32_t(parallel_min)) {
+            std::thread left_thread([&]() {
+                result->left = build(info, index, start, mid, depth + 1, spawn_depth - 1);
+            });
+            result->right = build(info, index, mid, end, depth + 1, spawn_depth - 1);
+            left_thread.join();
+        } else {
+            result->left  = build(info, index, start, mid, depth + 1, 0);
+            result->right = build(info, index, mid, end, depth + 1, 0);
+        }
+
+        result->count = 0;
+        result->subtree_nodes = 1 + result->left->subtree_nodes + result->right->subtree_nodes;
+        return result;
+    }
+
+    uint32_t flatten(const build_node* b, uint32_t& next) {
+        uint32_t id = next++;
+        const interval* axes[3] = { &b->box.x, &b->box.y, &b->box.z };
+        for (int a = 0; a < 3; a++) {
+            nodes[id].bmin[a] = round_down(axes[a]->min);
+            nodes[id].bmax[a] = round_up(axes[a]->max);
+        }
+        nodes[id].axis = uint8_t(b->axis);
+        nodes[id].pad = 0;
+
+        if (!b->left) {
+            nodes[id].offset = b->start;
+            nodes[id].count = uint16_t(b->count);
+        } else {
+            nodes[id].count = 0;
+            flatten(b->left.get(), next);
+            nodes[id].offset = flatten(b->right.get(), next);
+        }
+        return id;
+    }
+};
+
+//层次包围盒：用分箱 SAH 构建，构建完成后压平成连续的 32 字节节点数组
+//可以直接替代 hittable_list 作为 world 传给 camera::render；
+//物体是 instance 时它就是两级 BVH 的顶层（TLAS）
+class bvh : public hittable {
+  public:
+    bvh(const hittable_list& list, int build_threads = 0) : bvh(list.objects, build_threads) {}
+
+    bvh(const std::vector<shared_ptr<hittable>>& src_objects, int build_threads = 0) {
+        std::vector<aabb> boxes(src_objects.size());
+        for (size_t i = 0; i < src_objects.size(); i++)
+            boxes[i] = src_objects[i]->bounding_box();
+
+        std::vector<uint32_t> order;
+        tree.build(boxes, build_threads, order);
+
+        // 叶子里的物体按构建后的顺序连续存放
+        objects.reserve(order.size());
+        prims.reserve(order.size());
+        for (auto i : order) {
+            objects.push_back(src_objects[i]);
+            prims.push_back(src_objects[i].get());
+        }
+
+        // 球的参数另外按 SoA 存一份 float，射线包求交用；其他物体半径记为 -1，走逐条求交
+        sphere_cx.resize(prims.size());
+        sphere_cy.resize(prims.size());
+        sphere_cz.resize(prims.size());
+        sphere_r.resize(prims.size());
+        for (size_t i = 0; i < prims.size(); i++) {
+            const sphere* s = dynamic_cast<const sphere*>(prims[i]);
+            point3 c = s ? s->get_center() : point3(0,0,0);
+            sphere_cx[i] = float(c.x());
+            sphere_cy[i] = float(c.y());
+            sphere_cz[i] = float(c.z());
+            sphere_r[i]  = s ? float(s->get_radius()) : -1.0f;
+        }
+    }
+
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        hit_record temp_rec;
+        return tree.traverse(r, ray_t, [&](uint32_t i, interval& t) {
+            if (!prims[i]->hit(r, t, temp_rec))
+                return false;
+            t.max = temp_rec.t;
+            rec = temp_rec;
+            return true;
+        });
+    }
+
+    //8 条射线一起遍历：节点和球的求交用 float8 计算，只记录每条射线最近的物体；
+    //最后用该物体自己的 hit 重新求交，hit_record 的精度与逐条求交相同
+    void hit_packet(ray_packet& packet, interval ray_t) const override {
+        if (tree.empty()) {
+            for (int l = 0; l < packet.size; l++)
+                packet.hit[l] = false;
+            return;
+        }
+
+        // 方向归一化后再转 float，t 按单位方向计；空位的 tmin > tmax，永远不会命中
+        float ox[8], oy[8], oz[8], dx[8], dy[8], dz[8], tmin[8], tbest[8];
+        int32_t prim[8];
+        double len[8];
+        for (int l = 0; l < 8; l++) {
+            if (l < packet.size) {
+                const ray& r = packet.rays[l];
+                len[l] = r.direction().length();
+                vec3 d = r.direction() / len[l];
+                ox[l] = float(r.origin().x());
+                oy[l] = float(r.origin().y());
+                oz[l] = float(r.origin().z());
+                dx[l] = float(d.x());
+                dy[l] = float(d.y());
+                dz[l] = float(d.z());
+                tmin[l]  = float(ray_t.min * len[l]);
+                tbest[l] = float(std::fmin(ray_t.max * len[l], std::numeric_limits<float>::max()));
+            } else {
+                len[l] = 1;
+                ox[l] = oy[l] = oz[l] = 0;
+                dx[l] = dy[l] = dz[l] = 1;
+                tmin[l] = 1;
+                tbest[l] = 0;
+            }
+        }
+
+        float8 o[3] = { float8::load(ox), float8::load(oy), float8::load(oz) };
+        float8 d[3] = { float8::load(dx), float8::load(dy), float8::load(dz) };
+        float8 inv_d[3] = { float8(1.0f) / d[0], float8(1.0f) / d[1], float8(1.0f) / d[2] };
+        float8 t_min = float8::load(tmin);
+        float8 t_best = float8::load(tbest);
+        float8 best_prim = float8::from_int_bits(-1);
+
+        // 相机射线包方向相近，用第一条射线的方向决定子节点的访问顺序
+        bool dir_neg[3] = { dx[0] < 0, dy[0] < 0, dz[0] < 0 };
+
+        const std::vector<node>& nodes = tree.node_list();
+        uint32_t stack[bvh_tree::max_depth + 32];
+        int stack_size = 0;
+        uint32_t current = 0;
+
+        for (;;) {
+            const node& n = nodes[current];
+            if (hit_node8(n, o, inv_d, t_min, t_best)) {
+                if (n.count > 0) {
+                    for (uint32_t i = n.offset; i < n.offset + n.count; i++) {
+                        if (sphere_r[i] >= 0) {
+                            hit_sphere8(i, o, d, t_min, t_best, best_prim);
+                            continue;
+                        }
+
+                        // 不是球：逐条射线调用它自己的 hit
+                        t_best.store(tbest);
+                        best_prim.store_int_bits(prim);
+                        hit_record temp_rec;
+                        for (int l = 0; l < packet.size; l++) {
+                            if (prims[i]->hit(packet.rays[l], interval(ray_t.min, tbest[l] / len[l]), temp_rec)) {
+                                tbest[l] = float(temp_rec.t * len[l]);
+                                prim[l] = int32_t(i);
+                            }
+                        }
+                        t_best = float8::load(tbest);
+                        best_prim = float8::load_int_bits(prim);
+                    }
+                    if (stack_size == 0)
+                        break;
+                    current = stack[--stack_size];
+                } else {
+                    if (dir_neg[n.axis]) {
+                        stack[stack_size++] = current + 1;
+                        current = n.offset;
+                    } else {
+                        stack[stack_size++] = n.offset;
+                        current = current + 1;
+                    }
+                }
+            } else {
+                if (stack_size == 0)
+                    break;
+                current = stack[--stack_size];
+            }
+        }
+
+        best_prim.store_int_bits(prim);
+        for (int l = 0; l < packet.size; l++) {
+            packet.hit[l] = false;
+            if (prim[l] < 0)
+                continue;
+            packet.hit[l] = prims[prim[l]]->hit(packet.rays[l], ray_t, packet.rec[l]);
+            // float8 判为命中但标量求交擦边而过时，退回逐条求交
+            if (!packet.hit[l])
+                packet.hit[l] = hit(packet.rays[l], ray_t, packet.rec[l]);
+        }
+    }
+
+    aabb bounding_box() const override { return tree.bounds(); }
+
+    size_t node_count() const { return tree.node_list().size(); }
+
+  private:
+    typedef bvh_tree::node node;
+
+    bvh_tree tree;
+    std::vector<const hittable*> prims;
+    std::vector<shared_ptr<hittable>> objects;   // 持有物体，保证 prims 有效
+    std::vector<float> sphere_cx, sphere_cy, sphere_cz, sphere_r;
+
+    static bool hit_node8(const node& n, const float8* o, const float8* inv_d,
+                          const float8& t_min, const float8& t_max) {
+        float8 t_near = t_min, t_far = t_max;
+        for (int a = 0; a < 3; a++) {
+            float8 t0 = (float8(n.bmin[a]) - o[a]) * inv_d[a];
+            float8 t1 = (float8(n.bmax[a]) - o[a]) * inv_d[a];
+            // 方向分量为 0 时可能得到 NaN，放在第一个参数里让 min8/max8 忽略它
+            t_near = max8(min8(t0, t1), t_near);
+            t_far  = min8(max8(t0, t1), t_far);
+        }
+        // float 下起点和方向本身就有舍入误差，t_far 放宽得比 double 版本多一些
+        return movemask(t_near <= t_far * float8(1 + 1e-6f)) != 0;
+    }
+
+    // 单位方向下的射线-球求交；先求球心到射线的垂足，减少大球在 float 下的抵消误差
+    void hit_sphere8(uint32_t i, const float8* o, const float8* d, const float8& t_min,
+                     float8& t_best, float8& best_prim) const {
+        float8 ocx = float8(sphere_cx[i]) - o[0];
+        float8 ocy = float8(sphere_cy[i]) - o[1];
+        float8 ocz = float8(sphere_cz[i]) - o[2];
+        float8 b = ocx*d[0] + ocy*d[1] + ocz*d[2];
+        float8 qx = ocx - b*d[0];
+        float8 qy = ocy - b*d[1];
+        float8 qz = ocz - b*d[2];
+        float8 r(sphere_r[i]);
+        float8 disc = r*r - (qx*qx + qy*qy + qz*qz);
+        float8 s = sqrt8(max8(disc, float8(0.0f)));
+        float8 t0 = b - s;
+        float8 t = select(t0 > t_min, t0, b + s);
+        float8 valid = (disc >= float8(0.0f)) & (t > t_min) & (t < t_best);
+        t_best = select(valid, t, t_best);
+        best_prim = select(valid, float8::from_int_bits(int32_t(i)), best_prim);
+    }
+};
+
+#endif
@@ -1,9 +1,18 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
+#include "denoiser.h"
 #include "hittable.h"
+#include "image_io.h"
 #include "material.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
 
 class camera {
   public:
@@ -21,37 +30,161 @@ class camera {
     double focus_dist = 10;    // 从相机观察点到完美聚焦平面的距离
 
 
+    int    thread_count = 0;   // 渲染线程数，0 表示使用硬件线程数
+    int    tile_size    = 16;  // 瓦片边长（像素）
+
+    int    rr_depth     = 3;   // 从第几次弹射开始做俄罗斯轮盘赌
+
+    uint64_t seed       = 0;      // 采样随机数的种子，换一个值得到一组独立的采样
+    bool   show_progress = true;  // 为 false 时不向 std::clog 打印进度
+
+    // 渐进式渲染：以下任意一项打开时按轮渲染，每轮给未收敛的像素加 pass_samples 个采样，
+    // samples_per_pixel 变为每个像素的采样上限；全部关闭时一次采满 samples_per_pixel
+    double noise_threshold = 0;    // 像素在显示空间（gamma 后）的标准误差低于该值即停止采样，0 表示不做自适应
+    int    min_samples     = 16;   // 判断收敛前每个像素至少的采样数
+    int    pass_samples    = 8;    // 每轮给每个像素增加的采样数
+    double time_budget     = 0;    // 渲染时间上限（秒），到时后在当前轮结束时停止，0 表示不限
+    std::string progress_file;     // 非空时每轮结束都把当前结果写到该文件（格式同 output_file）
+
+    // 输出：为空时与原来一样把 ASCII PPM 写到标准输出；否则按扩展名写
+    // .ppm（二进制 P6）、.png、.pfm（float HDR）或 .exr（float HDR，带采样统计，可用于续渲）
+    std::string output_file;
+    std::string resume_file;       // 之前写出的 .exr，从其中的累计结果继续采样
+
+    // 辅助缓冲（AOV）：相机射线第一次命中处的反照率、法线、距离，以及每个像素的采样数。
+    // .exr 输出总是带着它们；aov_prefix 非空时另外写成 <aov_prefix>albedo.pfm、normal.pfm、depth.pfm、samples.pfm
+    std::string aov_prefix;
+    // 非空时用 AOV 引导的 à-trous 滤波去噪，结果写到该文件（格式按扩展名）；output_file 仍是未去噪的结果，可以续渲
+    std::string denoised_file;
+    denoise_options denoise_settings;
+
     void render(const hittable& world) {
+        render(world, hittable_list());
+    }
+
+    // lights 中的发光物体会在每个漫反射点被直接采样（NEE），
+    // 场景里的每个发光物体都应该放进 lights，否则漫反射之后再也不会计入它的发光
+    void render(const hittable& world, const hittable_list& lights) {
         initialize();
+        light_list = &lights;
 
-        std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+        bool progressive = noise_threshold > 0 || time_budget > 0 || !progress_file.empty();
+        int pass_spp = progressive ? std::max(1, pass_samples) : samples_per_pixel;
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(time_budget));
 
-        for (int j = 0; j < image_height; j++) {
-            std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
-            for (int i = 0; i < image_width; i++) {
-                color pixel_color(0,0,0);
-                for(int sample = 0;sample < samples_per_pixel;sample++)
-                {
-                    ray r = get_ray(i,j);
-                    pixel_color += ray_color(r,max_depth,world);
-                }
+        // 按瓦片划分图像，线程从共享的原子计数器领取下一个瓦片，
+        // 先做完的线程自动去拿剩下的瓦片，负载不会卡在某一行上
+        int tiles_x = (image_width  + tile_size - 1) / tile_size;
+        int tiles_y = (image_height + tile_size - 1) / tile_size;
+        int tile_total = tiles_x * tiles_y;
+
+        std::vector<pixel_state> pixels(size_t(image_width) * image_height);
+        if (!resume_file.empty())
+            load_pixels(resume_file, pixels);
+
+        // 编码和写文件都交给写图线程，渲染线程只负责拷贝一份 float 帧缓冲
+        image_writer writer;
+
+        int threads = thread_count > 0 ? thread_count : int(std::thread::hardware_concurrency());
+        threads = std::max(1, std::min(threads, tile_total));
 
-                write_color(std::cout, pixel_samples_scale * pixel_color);
+        for (int pass = 0; ; pass++) {
+            std::atomic<int> next_tile(0);
+            std::atomic<int> tiles_done(0);
+
+            auto worker = [&](bool report) {
+                for (;;) {
+                    // 第一轮之后超时就不再领取新瓦片，保证每个像素至少有一轮采样
+                    if (pass > 0 && time_budget > 0 && std::chrono::steady_clock::now() >= deadline)
+                        break;
+
+                    int tile = next_tile.fetch_add(1);
+                    if (tile >= tile_total)
+                        break;
+
+                    render_tile(world, tile % tiles_x, tile / tiles_x, pixels, pass_spp);
+
+                    int done = tiles_done.fetch_add(1) + 1;
+                    if (report && show_progress && !progressive)
+                        std::clog << "\rTiles remaining: " << (tile_total - done) << "    " << std::flush;
+                }
+            };
+
+            std::vector<std::thread> pool;
+            for (int t = 1; t < threads; t++)
+                pool.emplace_back(worker, false);
+            worker(true);   // 调用线程也参与渲染，并负责打印进度
+            for (auto& th : pool)
+                th.join();
+
+            update_convergence(pixels);
+
+            size_t active = 0;
+            for (const auto& px : pixels)
+                active += !px.done;
+
+            if (progressive) {
+                if (show_progress)
+                    std::clog << "\rPass " << (pass + 1) << ": " << active << " pixels still sampling    " << std::flush;
+                if (!progress_file.empty())
+                    writer.submit(snapshot(pixels), progress_file);
             }
+
+            if (active == 0 || (time_budget > 0 && std::chrono::steady_clock::now() >= deadline))
+                break;
         }
 
-        std::clog << "\rDone.                 \n";
+        // 按扫描线顺序写出，输出与线程数无关
+        hdr_image final_image = snapshot(pixels);
+        writer.submit(final_image, output_file.empty() ? std::string("-") : output_file);
+        if (!aov_prefix.empty())
+            submit_aovs(writer, final_image);
+        if (!denoised_file.empty()) {
+            denoise_options options = denoise_settings;
+            if (options.thread_count <= 0)
+                options.thread_count = threads;
+            writer.submit(denoiser::denoise(final_image, options), denoised_file);
+        }
+        writer.finish();
+
+        if (show_progress && progressive) {
+            double total = 0;
+            for (const auto& px : pixels)
+                total += px.samples;
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::clog << "\rDone: " << total / pixels.size() << " samples per pixel on average, "
+                      << seconds << " s\n";
+        } else if (show_progress) {
+            std::clog << "\rDone.                 \n";
+        }
+        light_list = nullptr;
     }
 
   private:
     int    image_height;   // Rendered image height
-    double pixel_samples_scale; // Color scale factor for a sum of pixel samples
     point3 center;         // Camera center
     point3 pixel00_loc;    // Location of pixel 0, 0
     vec3   pixel_delta_u;  // Offset to pixel to the right
     vec3   pixel_delta_v;  // Offset to pixel below
     vec3   u, v, w;
 
+    const hittable_list* light_list = nullptr;
+
+    //每个像素的累计结果：颜色之和与平方和（估计均值的误差用）、已采样数
+    struct pixel_state {
+        color  sum;
+        color  sq_sum;
+        int    samples = 0;
+        bool   done = false;
+
+        // AOV 之和，除以 samples 得到像素内的平均
+        color  albedo_sum;
+        vec3   normal_sum;
+        double depth_sum = 0;
+    };
+
     vec3   defocus_disk_u;       // 水平半径
     vec3   defocus_disk_v;       // 垂直半径
 
@@ -60,8 +193,6 @@ class camera {
         image_height = int(image_width / aspect_ratio);
         image_height = (image_height < 1) ? 1 : image_height;
 
-        pixel_samples_scale = 1.0 / samples_per_pixel;
-
         center = lookfrom;
 
         // Determine viewport dimensions.
@@ -102,6 +233,216 @@ class camera {
         defocus_disk_v = v * defocus_radius;
     }
 
+    //渲染一个瓦片：每个未完成的像素再采 pass_spp 次，每次采样都用 (像素, 采样序号) 重新播种随机数，
+    //所以分几轮采样、由哪个线程采样都不影响结果
+    //瓦片内每 4x2 个像素组成一个射线包：同一次采样的相机射线一起求交，之后各自逐条继续弹射
+    void render_tile(const hittable& world, int tx, int ty, std::vector<pixel_state>& pixels, int pass_spp) const {
+        int x0 = tx * tile_size, x1 = std::min(x0 + tile_size, image_width);
+        int y0 = ty * tile_size, y1 = std::min(y0 + tile_size, image_height);
+
+        for (int by = y0; by < y1; by += 2) {
+            for (int bx = x0; bx < x1; bx += 4) {
+                ray_packet packet;
+                int lane_i[ray_packet::max_size], lane_j[ray_packet::max_size];
+                int lane_count = 0;
+                for (int j = by; j < std::min(by + 2, y1); j++) {
+                    for (int i = bx; i < std::min(bx + 4, x1); i++) {
+                        if (pixels[size_t(j) * image_width + i].done)
+                            continue;
+                        lane_i[lane_count] = i;
+                        lane_j[lane_count] = j;
+                        lane_count++;
+                    }
+                }
+                if (lane_count == 0)
+                    continue;
+
+                color pixel_color[ray_packet::max_size];
+                pcg32 lane_rng[ray_packet::max_size];
+                for (int k = 0; k < pass_spp; k++) {
+                    // 采样已达上限的像素不再进入射线包
+                    packet.size = 0;
+                    int lane_of[ray_packet::max_size];
+                    for (int l = 0; l < lane_count; l++) {
+                        size_t pixel_index = size_t(lane_j[l]) * image_width + lane_i[l];
+                        int sample = pixels[pixel_index].samples + k;
+                        if (sample >= samples_per_pixel)
+                            continue;
+
+                        // 生成相机射线后保存各像素的随机数状态，求交后再恢复，
+                        // 这样每个像素消耗的随机数序列和逐条渲染时相同
+                        seed_sample_rng(pixel_index, sample, seed);
+                        lane_of[packet.size] = l;
+                        packet.rays[packet.size] = get_ray(lane_i[l], lane_j[l]);
+                        lane_rng[packet.size] = thread_rng();
+                        packet.size++;
+                    }
+                    if (packet.size == 0)
+                        break;
+
+                    if (max_depth > 0)
+                        world.hit_packet(packet, interval(0.001, infinity));
+
+                    for (int p = 0; p < packet.size; p++) {
+                        thread_rng() = lane_rng[p];
+                        color c = max_depth > 0 ? trace_path(packet.rays[p], packet.hit[p], packet.rec[p], world)
+                                                : color(0,0,0);
+                        pixel_color[lane_of[p]] += c;
+
+                        size_t pixel_index = size_t(lane_j[lane_of[p]]) * image_width + lane_i[lane_of[p]];
+                        pixel_state& px = pixels[pixel_index];
+                        px.sq_sum += c * c;
+
+                        // AOV 直接取射线包求交的结果，不消耗随机数，不影响颜色
+                        if (max_depth > 0 && packet.hit[p]) {
+                            const hit_record& rec = packet.rec[p];
+                            px.albedo_sum += rec.mat->aov_albedo();
+                            px.normal_sum += rec.normal;
+                            px.depth_sum += rec.t * packet.rays[p].direction().length();
+                        } else if (max_depth > 0) {
+                            color sky = background(packet.rays[p]);
+                            px.albedo_sum += color(std::fmin(sky.x(), 1.0), std::fmin(sky.y(), 1.0), std::fmin(sky.z(), 1.0));
+                        }
+                    }
+                }
+
+                for (int l = 0; l < lane_count; l++) {
+                    pixel_state& px = pixels[size_t(lane_j[l]) * image_width + lane_i[l]];
+                    px.sum += pixel_color[l];
+                    px.samples = std::min(samples_per_pixel, px.samples + pass_spp);
+                    px.done = px.samples >= samples_per_pixel;
+                }
+            }
+        }
+    }
+
+    //像素均值在显示空间的标准误差（取三个通道中最大的）；输出是 gamma 2 编码（开平方），
+    //误差按 d(sqrt(x))/dx 换算。采样数不足 min_samples 时返回无穷大
+    double pixel_error(const pixel_state& px) const {
+        if (px.samples < std::max(2, min_samples))
+            return infinity;
+
+        double n = px.samples;
+        double error = 0;
+        for (int c = 0; c < 3; c++) {
+            double mean = px.sum[c] / n;
+            double variance = std::max(0.0, (px.sq_sum[c] - n*mean*mean) / (n - 1));
+            double std_error = std::sqrt(variance / n);
+
+            // 均值确定大于 1 时显示值会被截断为白色，这个通道不需要再采样
+            if (mean - 3*std_error > 1.0)
+                continue;
+
+            error = std::max(error, std_error / (2 * std::sqrt(std::max(mean, 1e-4))));
+        }
+        return error;
+    }
+
+    //一轮结束后更新收敛状态。单个像素的方差估计本身有噪声（少数几条路径碰巧没打到焦散），
+    //所以取 3x3 邻域内的最大误差，邻居还没收敛的像素继续采样
+    void update_convergence(std::vector<pixel_state>& pixels) const {
+        if (noise_threshold <= 0)
+            return;
+
+        std::vector<double> error(pixels.size());
+        for (size_t k = 0; k < pixels.size(); k++)
+            error[k] = pixel_error(pixels[k]);
+
+        for (int j = 0; j < image_height; j++) {
+            for (int i = 0; i < image_width; i++) {
+                pixel_state& px = pixels[size_t(j) * image_width + i];
+                if (px.done)
+                    continue;
+
+                double e = 0;
+                for (int dj = -1; dj <= 1; dj++) {
+                    for (int di = -1; di <= 1; di++) {
+                        int x = std::min(std::max(i + di, 0), image_width - 1);
+                        int y = std::min(std::max(j + dj, 0), image_height - 1);
+                        e = std::max(e, error[size_t(y) * image_width + x]);
+                    }
+                }
+                px.done = e < noise_threshold;
+            }
+        }
+    }
+
+    //把累计结果换算成 float 的 HDR 图像（均值、平方均值和采样数），不做色调映射
+    hdr_image snapshot(const std::vector<pixel_state>& pixels) const {
+        hdr_image img;
+        img.width = image_width;
+        img.height = image_height;
+        img.rgb.resize(pixels.size() * 3);
+        img.rgb_sq.resize(pixels.size() * 3);
+        img.samples.resize(pixels.size());
+        img.albedo.resize(pixels.size() * 3);
+        img.normal.resize(pixels.size() * 3);
+        img.depth.resize(pixels.size());
+        for (size_t k = 0; k < pixels.size(); k++) {
+            const pixel_state& px = pixels[k];
+            double scale = px.samples > 0 ? 1.0 / px.samples : 0.0;
+            for (int c = 0; c < 3; c++) {
+                img.rgb[3*k + c] = float(scale * px.sum[c]);
+                img.rgb_sq[3*k + c] = float(scale * px.sq_sum[c]);
+                img.albedo[3*k + c] = float(scale * px.albedo_sum[c]);
+                img.normal[3*k + c] = float(scale * px.normal_sum[c]);
+            }
+            img.samples[k] = float(px.samples);
+            img.depth[k] = float(scale * px.depth_sum);
+        }
+        return img;
+    }
+
+    //把各个 AOV 拆成单独的三通道 PFM 交给写图线程；depth 和 samples 复制到三个通道
+    void submit_aovs(image_writer& writer, const hdr_image& img) const {
+        const std::vector<float>* scalar[2] = { &img.depth, &img.samples };
+        const char* scalar_name[2] = { "depth.pfm", "samples.pfm" };
+
+        hdr_image aov;
+        aov.width = img.width;
+        aov.height = img.height;
+        aov.rgb = img.albedo;
+        writer.submit(aov, aov_prefix + "albedo.pfm");
+        aov.rgb = img.normal;
+        writer.submit(aov, aov_prefix + "normal.pfm");
+        for (int a = 0; a < 2; a++) {
+            aov.rgb.resize(scalar[a]->size() * 3);
+            for (size_t k = 0; k < scalar[a]->size(); k++)
+                aov.rgb[3*k] = aov.rgb[3*k + 1] = aov.rgb[3*k + 2] = (*scalar[a])[k];
+            writer.submit(aov, aov_prefix + scalar_name[a]);
+        }
+    }
+
+    //从 EXR 恢复累计结果；采样序号从文件中的采样数继续，续渲和一次渲完得到的结果相同
+    void load_pixels(const std::string& path, std::vector<pixel_state>& pixels) const {
+        hdr_image img;
+        if (!image_io::read_exr(path, img) || img.width != image_width || img.height != image_height
+            || img.samples.size() != pixels.size()) {
+            std::clog << "Cannot resume from " << path << ", starting from scratch\n";
+            return;
+        }
+
+        bool moments = img.rgb_sq.size() == img.rgb.size();
+        bool aovs = img.albedo.size() == img.rgb.size() && img.normal.size() == img.rgb.size()
+                 && img.depth.size() == pixels.size();
+        for (size_t k = 0; k < pixels.size(); k++) {
+            pixel_state& px = pixels[k];
+            px.samples = int(img.samples[k]);
+            double n = px.samples;
+            for (int c = 0; c < 3; c++) {
+                px.sum[c] = n * img.rgb[3*k + c];
+                px.sq_sum[c] = moments ? n * img.rgb_sq[3*k + c] : n * img.rgb[3*k + c] * img.rgb[3*k + c];
+                if (aovs) {
+                    px.albedo_sum[c] = n * img.albedo[3*k + c];
+                    px.normal_sum[c] = n * img.normal[3*k + c];
+                }
+            }
+            if (aovs)
+                px.depth_sum = n * img.depth[k];
+            px.done = px.samples >= samples_per_pixel;
+        }
+    }
+
     //获取在视口i j处的射线
     ray get_ray(int i,int j) const {
         // Construct a camera ray originating from the defocus disk and directed at a randomly
@@ -120,7 +461,7 @@ class camera {
     }
 
     vec3 sample_square() const {
-        return vec3(random_double() - 0.5, random_double() - 0.5, 0);
+        return vec3(random_real() - real(0.5), random_real() - real(0.5), 0);
     }
 
     point3 defocus_disk_sample() const {
@@ -131,24 +472,83 @@ class camera {
 
     
 
-    color ray_color(const ray& r, int depth,const hittable& world) {
-        if(depth <= 0)
-        {
-            return color(0,0,0);
-        }
+    //迭代的路径追踪：r 和它的求交结果已经算好，之后每次弹射把衰减乘进 throughput，
+    //最多追踪 max_depth 条射线（与原来递归版本的深度一致），不递归也不分配内存
+    color trace_path(ray r, bool hit, hit_record rec, const hittable& world) const {
+        color radiance(0,0,0);
+        color throughput(1,1,1);
+        bool count_emission = true;   // 相机射线和镜面弹射命中光源时计入其发光
+
+        for (int bounce = 0; ; bounce++) {
+            if (!hit) {
+                radiance += throughput * background(r);
+                break;
+            }
 
-        hit_record rec;
+            const material& mat = *rec.mat;
+            if (mat.is_emissive()) {
+                if (count_emission)
+                    radiance += throughput * mat.emitted();
+                break;
+            }
 
-        if (world.hit(r, interval(0.001,infinity), rec)) {
             //知道碰撞点的信息 保存至rec中 根据材质的不同 定义不同的反射信息 比如是漫反射或者是全反射
             ray scattered;
             color attenuation;
-            if (rec.mat->scatter(r, rec, attenuation, scattered))
-                return attenuation * ray_color(scattered, depth-1, world);
+            if (bounce + 1 >= max_depth || !mat.scatter(r, rec, attenuation, scattered))
+                break;
+
+            // 漫反射点直接向光源采样一次；之后这条路径再撞到光源时就不再重复计入
+            bool sample_lights = mat.is_diffuse() && !light_list->objects.empty();
+            if (sample_lights)
+                radiance += throughput * attenuation * direct_light(rec, world);
+            count_emission = !sample_lights;
+
+            throughput = throughput * attenuation;
+
+            // 俄罗斯轮盘赌：贡献越小的路径越容易被终止，存活的路径按概率放大，结果无偏
+            if (bounce + 1 >= rr_depth) {
+                real p = std::fmin(real(0.95), std::fmax(throughput.x(), std::fmax(throughput.y(), throughput.z())));
+                if (random_real() >= p)
+                    break;
+                throughput /= p;
+            }
 
-            return color(0,0,0);
+            r = scattered;
+            hit = world.hit(r, interval(0.001,infinity), rec);
         }
 
+        return radiance;
+    }
+
+    //从 rec 处均匀选一个光源、在它张成的立体角内采样方向，返回除掉 albedo 的直接光照
+    //（朗伯 BRDF 为 albedo/π，调用处再乘 albedo）
+    color direct_light(const hit_record& rec, const hittable& world) const {
+        const auto& objects = light_list->objects;
+        size_t count = objects.size();
+        size_t k = std::min(count - 1, size_t(random_real() * count));
+        const hittable& light = *objects[k];
+
+        vec3 direction = light.random(rec.p);
+        real cosine = dot(rec.normal, direction) / direction.length();
+        if (cosine <= 0)
+            return color(0,0,0);
+
+        ray shadow(rec.p, direction);
+        real pdf = light.pdf_value(rec.p, direction);
+        hit_record light_rec;
+        if (pdf <= 0 || !light.hit(shadow, interval(0.001,infinity), light_rec))
+            return color(0,0,0);
+
+        // 光源之前有遮挡就没有贡献；光源本身也在 world 里，求交区间不包含它的交点
+        hit_record blocker;
+        if (world.hit(shadow, interval(0.001, light_rec.t * (1 - 1e-6)), blocker))
+            return color(0,0,0);
+
+        return light_rec.mat->emitted() * (cosine * real(count) / (real(pi) * pdf));
+    }
+
+    color background(const ray& r) const {
         vec3 unit_direction = unit_vector(r.direction());
         auto a = 0.5*(unit_direction.y() + 1.0);
         return (1.0-a)*color(1.0, 1.0, 1.0) + a*color(0.5, 0.7, 1.0);
@@ -0,0 +1,235 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include "image_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+//边缘保持的 à-trous 小波滤波（Dammertz et al. 2010），权重按 SVGF（Schied et al. 2017）的做法：
+//法线、深度、反照率差别大的邻居不参与平均，亮度差按该像素的噪声水平（方差）归一化。
+//滤波前先除以反照率，只对光照部分滤波，最后再乘回去，颜色边界和纹理不会被抹掉
+struct denoise_options {
+    int    iterations   = 4;      // 第 k 轮的采样间隔为 2^k，4 轮覆盖 61x61 像素
+    double sigma_luminance = 4;   // 亮度权重：差值除以 sigma * 标准差
+    double sigma_normal = 8;      // 法线权重：max(0, n_p·n_q)^sigma；像素内平均过的法线不如 SVGF 的 G-buffer 锐利，取得小一些
+    double sigma_depth  = 3;      // 深度权重：差值除以 sigma * 深度梯度 * 距离
+    double sigma_albedo = 0.3;    // 反照率权重：差值除以 sigma
+    int    thread_count = 0;      // 0 表示使用硬件线程数
+    int    tile_size    = 32;
+};
+
+namespace denoiser {
+
+    inline float luminance(const float* c) {
+        return 0.2126f*c[0] + 0.7152f*c[1] + 0.0722f*c[2];
+    }
+
+    //把图像切成瓦片，多个线程从原子计数器领取，每个瓦片调用 body(x0, y0, x1, y1)
+    template <typename Body>
+    void parallel_tiles(int width, int height, const denoise_options& opt, const Body& body) {
+        int tile = std::max(8, opt.tile_size);
+        int tiles_x = (width + tile - 1) / tile;
+        int tiles_y = (height + tile - 1) / tile;
+        int total = tiles_x * tiles_y;
+        std::atomic<int> next(0);
+
+        auto worker = [&]() {
+            for (int t = next.fetch_add(1); t < total; t = next.fetch_add(1)) {
+                int x0 = (t % tiles_x) * tile, y0 = (t / tiles_x) * tile;
+                body(x0, y0, std::min(x0 + tile, width), std::min(y0 + tile, height));
+            }
+        };
+
+        int threads = opt.thread_count > 0 ? opt.thread_count : int(std::thread::hardware_concurrency());
+        threads = std::max(1, std::min(threads, total));
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads; i++)
+            pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool)
+            th.join();
+    }
+
+    //对 img 去噪，返回只含 rgb 的新图。需要 albedo、normal、depth 三个 AOV，缺少时原样返回；
+    //有 samples 和 rgb_sq 时用它们估计每个像素的方差，否则从 3x3 邻域估计
+    inline hdr_image denoise(const hdr_image& img, const denoise_options& opt = denoise_options()) {
+        const int w = img.width, h = img.height;
+        const size_t n = size_t(w) * h;
+        hdr_image out;
+        out.width = w;
+        out.height = h;
+        out.rgb = img.rgb;
+        if (img.albedo.size() != 3*n || img.normal.size() != 3*n || img.depth.size() != n)
+            return out;
+
+        // 除以反照率得到光照；反照率太暗的通道不除，避免放大噪声
+        std::vector<float> modulate(3*n), light(3*n), variance(n);
+        bool moments = img.rgb_sq.size() == 3*n && img.samples.size() == n;
+        for (size_t k = 0; k < n; k++) {
+            float var[3];
+            for (int c = 0; c < 3; c++) {
+                float a = img.albedo[3*k + c];
+                modulate[3*k + c] = a > 0.01f ? a : 1.0f;
+                light[3*k + c] = img.rgb[3*k + c] / modulate[3*k + c];
+
+                // 均值的方差 = 样本方差 / 采样数；只有一个采样时方差未知，当作很大
+                float m = img.rgb[3*k + c], spp = moments ? img.samples[k] : 0;
+                var[c] = spp > 1 ? std::max(0.0f, img.rgb_sq[3*k + c] - m*m) / (spp - 1) : 1e6f;
+                var[c] /= modulate[3*k + c] * modulate[3*k + c];
+            }
+            variance[k] = 0.2126f*0.2126f*var[0] + 0.7152f*0.7152f*var[1] + 0.0722f*0.0722f*var[2];
+        }
+
+        if (!moments) {
+            // 没有采样统计时用 3x3 邻域内亮度的方差代替
+            for (int j = 0; j < h; j++) {
+                for (int i = 0; i < w; i++) {
+                    double s = 0, s2 = 0;
+                    int count = 0;
+                    for (int dj = -1; dj <= 1; dj++) {
+                        for (int di = -1; di <= 1; di++) {
+                            int x = i + di, y = j + dj;
+                            if (x < 0 || y < 0 || x >= w || y >= h)
+                                continue;
+                            double l = luminance(&light[3*(size_t(y) * w + x)]);
+                            s += l; s2 += l*l; count++;
+                        }
+                    }
+                    variance[size_t(j) * w + i] = float(std::max(0.0, s2/count - (s/count)*(s/count)));
+                }
+            }
+        }
+
+        // 像素内多个采样的法线平均后长度小于 1，重新归一化，保证中心像素自己的权重为 1
+        std::vector<float> normal(img.normal);
+        for (size_t k = 0; k < n; k++) {
+            float* v = &normal[3*k];
+            float len = std::sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+            if (len > 0)
+                for (int c = 0; c < 3; c++)
+                    v[c] /= len;
+        }
+
+        // 深度梯度：每个方向取两侧差值中较小的一个，得到表面本身的坡度；
+        // 取较大的会把轮廓处的深度跳变当成坡度，深度权重就拦不住背后的物体了。没有命中的像素深度为 0，不参与
+        std::vector<float> depth_grad(n, 0.0f);
+        for (int j = 0; j < h; j++) {
+            for (int i = 0; i < w; i++) {
+                size_t k = size_t(j) * w + i;
+                float z = img.depth[k];
+                if (z <= 0)
+                    continue;
+                float g[2] = { -1, -1 };
+                size_t stride[2] = { 1, size_t(w) };
+                bool before[2] = { i > 0, j > 0 }, after[2] = { i + 1 < w, j + 1 < h };
+                for (int axis = 0; axis < 2; axis++) {
+                    if (before[axis] && img.depth[k - stride[axis]] > 0)
+                        g[axis] = std::fabs(z - img.depth[k - stride[axis]]);
+                    if (after[axis] && img.depth[k + stride[axis]] > 0) {
+                        float d = std::fabs(z - img.depth[k + stride[axis]]);
+                        g[axis] = g[axis] < 0 ? d : std::min(g[axis], d);
+                    }
+                }
+                depth_grad[k] = std::max(0.0f, std::max(g[0], g[1]));
+            }
+        }
+
+        static const float kernel[5] = { 1.0f/16, 1.0f/4, 3.0f/8, 1.0f/4, 1.0f/16 };
+        static const float gauss3[3] = { 0.25f, 0.5f, 0.25f };
+
+        std::vector<float> next_light(3*n), next_variance(n), blurred_variance(n);
+        for (int iter = 0; iter < opt.iterations; iter++) {
+            int step = 1 << iter;
+
+            // 方差本身也有噪声，先做一次 3x3 高斯模糊再用来归一化亮度差
+            parallel_tiles(w, h, opt, [&](int x0, int y0, int x1, int y1) {
+                for (int j = y0; j < y1; j++) {
+                    for (int i = x0; i < x1; i++) {
+                        float s = 0, ws = 0;
+                        for (int dj = -1; dj <= 1; dj++) {
+                            for (int di = -1; di <= 1; di++) {
+                                int x = i + di, y = j + dj;
+                                if (x < 0 || y < 0 || x >= w || y >= h)
+                                    continue;
+                                float k = gauss3[di + 1] * gauss3[dj + 1];
+                                s += k * variance[size_t(y) * w + x];
+                                ws += k;
+                            }
+                        }
+                        blurred_variance[size_t(j) * w + i] = s / ws;
+                    }
+                }
+            });
+
+            parallel_tiles(w, h, opt, [&](int x0, int y0, int x1, int y1) {
+                for (int j = y0; j < y1; j++) {
+                    for (int i = x0; i < x1; i++) {
+                        size_t p = size_t(j) * w + i;
+                        const float* np = &normal[3*p];
+                        const float* ap = &img.albedo[3*p];
+                        float zp = img.depth[p];
+                        float lp = luminance(&light[3*p]);
+                        float sigma_l = float(opt.sigma_luminance) * std::sqrt(blurred_variance[p]) + 1e-4f;
+                        float sigma_z = float(opt.sigma_depth) * depth_grad[p] * step;
+
+                        // 没有命中物体（背景）的像素不滤波
+                        if (zp <= 0) {
+                            for (int c = 0; c < 3; c++)
+                                next_light[3*p + c] = light[3*p + c];
+                            next_variance[p] = variance[p];
+                            continue;
+                        }
+
+                        float sum[3] = { 0, 0, 0 }, wsum = 0, vsum = 0;
+                        for (int dj = -2; dj <= 2; dj++) {
+                            for (int di = -2; di <= 2; di++) {
+                                int x = i + di * step, y = j + dj * step;
+                                if (x < 0 || y < 0 || x >= w || y >= h)
+                                    continue;
+                                size_t q = size_t(y) * w + x;
+                                float zq = img.depth[q];
+                                if (zq <= 0)
+                                    continue;
+
+                                const float* nq = &normal[3*q];
+                                const float* aq = &img.albedo[3*q];
+                                float dot_n = np[0]*nq[0] + np[1]*nq[1] + np[2]*nq[2];
+                                float w_n = std::pow(std::max(0.0f, dot_n), float(opt.sigma_normal));
+                                float dist = std::sqrt(float(di*di + dj*dj));
+                                float w_z = std::exp(-std::fabs(zp - zq) / (sigma_z * dist + 1e-4f));
+                                float da = std::fabs(ap[0] - aq[0]) + std::fabs(ap[1] - aq[1]) + std::fabs(ap[2] - aq[2]);
+                                float w_a = std::exp(-da / float(opt.sigma_albedo));
+                                float w_l = std::exp(-std::fabs(lp - luminance(&light[3*q])) / sigma_l);
+
+                                float weight = kernel[di + 2] * kernel[dj + 2] * w_n * w_z * w_a * w_l;
+                                for (int c = 0; c < 3; c++)
+                                    sum[c] += weight * light[3*q + c];
+                                wsum += weight;
+                                vsum += weight * weight * variance[q];
+                            }
+                        }
+
+                        // 中心像素自己的权重就是 kernel 中心值，wsum 不会为 0
+                        for (int c = 0; c < 3; c++)
+                            next_light[3*p + c] = sum[c] / wsum;
+                        next_variance[p] = vsum / (wsum * wsum);
+                    }
+                }
+            });
+
+            light.swap(next_light);
+            variance.swap(next_variance);
+        }
+
+        for (size_t k = 0; k < 3*n; k++)
+            out.rgb[k] = light[k] * modulate[k];
+        return out;
+    }
+
+} // namespace denoiser
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef HITTABLE_H
 #define HITTABLE_H
 
+#include "aabb.h"
 #include "ray.h"
 
 
@@ -11,8 +12,8 @@ class hit_record {
   public:
     point3 p; //该点的坐标
     vec3 normal; //碰撞点的法线信息
-    shared_ptr<material> mat; //碰撞点的材质信息
-    double t; //射线在碰撞点的t值  at(t)
+    const material* mat; //碰撞点的材质信息（由物体持有，这里不增加引用计数）
+    real t; //射线在碰撞点的t值  at(t)
     bool front_face; //是否是碰撞的正面
 
     void set_face_normal(const ray& r,const vec3& outward_normal)
@@ -23,10 +24,39 @@ class hit_record {
 
 };
 
+//一组相邻像素的相机射线（最多 8 条），一起求交
+class ray_packet {
+  public:
+    static const int max_size = 8;
+
+    int size = 0;
+    ray rays[max_size];
+    hit_record rec[max_size];
+    bool hit[max_size];
+};
+
 class hittable {
   public:
     virtual ~hittable() = default;
     virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const = 0;
+
+    //射线包求交，默认逐条调用 hit；bvh 重写为 SIMD 版本
+    virtual void hit_packet(ray_packet& packet, interval ray_t) const {
+        for (int i = 0; i < packet.size; i++)
+            packet.hit[i] = hit(packet.rays[i], ray_t, packet.rec[i]);
+    }
+
+    virtual aabb bounding_box() const = 0;
+
+    //作为光源被采样时使用：从 origin 朝 direction 方向命中该物体的立体角概率密度，
+    //以及按该密度生成的一个方向。不支持光源采样的物体保持默认值
+    virtual double pdf_value(const point3& /*origin*/, const vec3& /*direction*/) const {
+        return 0.0;
+    }
+
+    virtual vec3 random(const point3& /*origin*/) const {
+        return vec3(1,0,0);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -13,10 +13,11 @@ class hittable_list : public hittable {
     hittable_list() {}
     hittable_list(shared_ptr<hittable> object) { add(object); }
 
-    void clear() { objects.clear(); }
+    void clear() { objects.clear(); bbox = aabb(); }
 
     void add(shared_ptr<hittable> object) {
         objects.push_back(object);
+        bbox = aabb(bbox, object->bounding_box());
     }
 
     bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
@@ -34,6 +35,19 @@ class hittable_list : public hittable {
 
         return hit_anything;
     }
+
+    void hit_packet(ray_packet& packet, interval ray_t) const override {
+        // 只包着一个物体（通常是 bvh）时直接转交，保留它的 SIMD 实现
+        if (objects.size() == 1)
+            objects[0]->hit_packet(packet, ray_t);
+        else
+            hittable::hit_packet(packet, ray_t);
+    }
+
+    aabb bounding_box() const override { return bbox; }
+
+  private:
+    aabb bbox;
 };
 
 #endif
\ No newline at end of file
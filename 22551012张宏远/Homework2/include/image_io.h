@@ -0,0 +1,534 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include "color.h"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//float32 的 HDR 帧缓冲：保存每个像素的线性辐亮度均值，不做截断
+//samples 和 rgb_sq 可选，写成 EXR 时一并保存，用于从文件继续累计采样
+struct hdr_image {
+    int width = 0, height = 0;
+    std::vector<float> rgb;       // 行优先，每个像素 3 个 float
+    std::vector<float> samples;   // 每个像素的采样数
+    std::vector<float> rgb_sq;    // 每个像素样本平方的均值，估计误差用
+
+    // 可选的辅助缓冲（AOV），都是相机射线第一次命中处的值在像素内的平均，去噪时用
+    std::vector<float> albedo;    // 反照率，每个像素 3 个 float
+    std::vector<float> normal;    // 世界空间法线（朝向射线一侧），没有命中为 0
+    std::vector<float> depth;     // 到相机的距离，没有命中为 0
+};
+
+namespace image_io {
+
+    //色调映射只在写出时做一次：gamma 2，再截断到 [0, 255]，与 write_color 相同
+    inline unsigned char to_byte(float linear) {
+        static const interval intensity(0.000, 0.999);
+        return (unsigned char)(int(256 * intensity.clamp(linear_to_gamma(linear))));
+    }
+
+    inline void put_u32(std::string& out, uint32_t v) {
+        for (int i = 0; i < 4; i++) out.push_back(char((v >> (8*i)) & 0xff));
+    }
+
+    inline void put_f32(std::string& out, float f) {
+        uint32_t v;
+        std::memcpy(&v, &f, sizeof(v));
+        put_u32(out, v);
+    }
+
+    inline void put_u64(std::string& out, uint64_t v) {
+        for (int i = 0; i < 8; i++) out.push_back(char((v >> (8*i)) & 0xff));
+    }
+
+    inline void put_u32_be(std::string& out, uint32_t v) {
+        for (int i = 3; i >= 0; i--) out.push_back(char((v >> (8*i)) & 0xff));
+    }
+
+    inline void append_int(std::string& out, int v) {
+        char buf[16];
+        int n = std::snprintf(buf, sizeof(buf), "%d", v);
+        out.append(buf, size_t(n));
+    }
+
+    //原来的 ASCII PPM（P3），一次性格式化成字符串再整体写出
+    inline std::string encode_ppm_ascii(const hdr_image& img) {
+        std::string out;
+        out.reserve(size_t(img.width) * img.height * 12 + 32);
+        out += "P3\n";
+        append_int(out, img.width);
+        out += ' ';
+        append_int(out, img.height);
+        out += "\n255\n";
+        for (size_t k = 0; k < img.rgb.size(); k += 3) {
+            append_int(out, to_byte(img.rgb[k]));
+            out += ' ';
+            append_int(out, to_byte(img.rgb[k + 1]));
+            out += ' ';
+            append_int(out, to_byte(img.rgb[k + 2]));
+            out += '\n';
+        }
+        return out;
+    }
+
+    //二进制 PPM（P6）
+    inline std::string encode_ppm(const hdr_image& img) {
+        std::string out = "P6\n";
+        append_int(out, img.width);
+        out += ' ';
+        append_int(out, img.height);
+        out += "\n255\n";
+        out.reserve(out.size() + img.rgb.size());
+        for (float v : img.rgb)
+            out.push_back(char(to_byte(v)));
+        return out;
+    }
+
+    //PFM：未经色调映射的 float，比例因子为负表示小端，行从下往上存
+    inline std::string encode_pfm(const hdr_image& img) {
+        std::string out = "PF\n";
+        append_int(out, img.width);
+        out += ' ';
+        append_int(out, img.height);
+        out += "\n-1.0\n";
+        for (int j = img.height - 1; j >= 0; j--)
+            for (int k = 0; k < img.width * 3; k++)
+                put_f32(out, img.rgb[size_t(j) * img.width * 3 + k]);
+        return out;
+    }
+
+    inline std::vector<uint32_t> crc32_table() {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }
+
+    inline uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0) {
+        static const std::vector<uint32_t> table = crc32_table();
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    inline void png_chunk(std::string& out, const char* type, const std::string& data) {
+        put_u32_be(out, uint32_t(data.size()));
+        std::string body = std::string(type, 4) + data;
+        out += body;
+        put_u32_be(out, crc32((const unsigned char*)body.data(), body.size()));
+    }
+
+    //8 位 RGB 的 PNG；zlib 数据流只用不压缩的 stored 块，不依赖额外的库
+    inline std::string encode_png(const hdr_image& img) {
+        std::string raw;
+        raw.reserve(size_t(img.width * 3 + 1) * img.height);
+        for (int j = 0; j < img.height; j++) {
+            raw.push_back(0);   // 每行的过滤类型：None
+            for (int k = 0; k < img.width * 3; k++)
+                raw.push_back(char(to_byte(img.rgb[size_t(j) * img.width * 3 + k])));
+        }
+
+        std::string z = "\x78\x01";
+        uint32_t a = 1, b = 0;
+        for (unsigned char c : raw) {
+            a = (a + c) % 65521;
+            b = (b + a) % 65521;
+        }
+        for (size_t pos = 0; pos < raw.size() || pos == 0; ) {
+            size_t len = std::min<size_t>(65535, raw.size() - pos);
+            bool last = pos + len >= raw.size();
+            z.push_back(char(last ? 1 : 0));
+            z.push_back(char(len & 0xff));
+            z.push_back(char(len >> 8));
+            z.push_back(char(~len & 0xff));
+            z.push_back(char((~len >> 8) & 0xff));
+            z.append(raw, pos, len);
+            pos += len;
+            if (last)
+                break;
+        }
+        put_u32_be(z, (b << 16) | a);
+
+        std::string ihdr;
+        put_u32_be(ihdr, uint32_t(img.width));
+        put_u32_be(ihdr, uint32_t(img.height));
+        ihdr += std::string("\x08\x02\x00\x00\x00", 5);   // 8 位、RGB、不隔行
+
+        std::string out = "\x89PNG\r\n\x1a\n";
+        png_chunk(out, "IHDR", ihdr);
+        png_chunk(out, "IDAT", z);
+        png_chunk(out, "IEND", std::string());
+        return out;
+    }
+
+    //EXR 通道：名字按字母顺序排列，数据来自 hdr_image 中的某个数组
+    //AOV 放在 albedo、depth、normal 层里，采样统计放在 samples、sq 两个层里，只认 R/G/B 的查看器会忽略它们
+    struct exr_channel {
+        const char* name;
+        const std::vector<float>* data;
+        int stride, offset;
+    };
+
+    inline std::vector<exr_channel> exr_channels(const hdr_image& img) {
+        std::vector<exr_channel> ch;
+        bool moments = img.rgb_sq.size() == img.rgb.size();
+        ch.push_back({"B", &img.rgb, 3, 2});
+        ch.push_back({"G", &img.rgb, 3, 1});
+        ch.push_back({"R", &img.rgb, 3, 0});
+        if (img.albedo.size() == img.rgb.size()) {
+            ch.push_back({"albedo.B", &img.albedo, 3, 2});
+            ch.push_back({"albedo.G", &img.albedo, 3, 1});
+            ch.push_back({"albedo.R", &img.albedo, 3, 0});
+        }
+        if (img.depth.size() * 3 == img.rgb.size()) ch.push_back({"depth.Z", &img.depth, 1, 0});
+        if (img.normal.size() == img.rgb.size()) {
+            ch.push_back({"normal.X", &img.normal, 3, 0});
+            ch.push_back({"normal.Y", &img.normal, 3, 1});
+            ch.push_back({"normal.Z", &img.normal, 3, 2});
+        }
+        if (img.samples.size() * 3 == img.rgb.size()) ch.push_back({"samples.N", &img.samples, 1, 0});
+        if (moments) {
+            ch.push_back({"sq.B", &img.rgb_sq, 3, 2});
+            ch.push_back({"sq.G", &img.rgb_sq, 3, 1});
+            ch.push_back({"sq.R", &img.rgb_sq, 3, 0});
+        }
+        return ch;
+    }
+
+    inline void exr_attribute(std::string& out, const char* name, const char* type, const std::string& value) {
+        out += name;
+        out += '\0';
+        out += type;
+        out += '\0';
+        put_u32(out, uint32_t(value.size()));
+        out += value;
+    }
+
+    //单层、不压缩、每块一行的 OpenEXR（通道全部为 FLOAT）
+    //R/G/B 为辐亮度均值；有采样统计时另存 samples.N（采样数）和 sq.R/G/B（平方均值），可用于续渲
+    inline std::string encode_exr(const hdr_image& img) {
+        std::vector<exr_channel> ch = exr_channels(img);
+
+        std::string out;
+        put_u32(out, 20000630);   // 魔数
+        put_u32(out, 2);          // 版本 2，单层扫描线文件
+
+        std::string chlist;
+        for (const auto& c : ch) {
+            chlist += c.name;
+            chlist += '\0';
+            put_u32(chlist, 2);   // FLOAT
+            put_u32(chlist, 0);   // pLinear + 保留字节
+            put_u32(chlist, 1);   // xSampling
+            put_u32(chlist, 1);   // ySampling
+        }
+        chlist += '\0';
+
+        std::string window;
+        put_u32(window, 0);
+        put_u32(window, 0);
+        put_u32(window, uint32_t(img.width - 1));
+        put_u32(window, uint32_t(img.height - 1));
+
+        std::string aspect, center, width;
+        put_f32(aspect, 1.0f);
+        put_f32(center, 0.0f);
+        put_f32(center, 0.0f);
+        put_f32(width, 1.0f);
+
+        exr_attribute(out, "channels", "chlist", chlist);
+        exr_attribute(out, "compression", "compression", std::string(1, '\0'));
+        exr_attribute(out, "dataWindow", "box2i", window);
+        exr_attribute(out, "displayWindow", "box2i", window);
+        exr_attribute(out, "lineOrder", "lineOrder", std::string(1, '\0'));
+        exr_attribute(out, "pixelAspectRatio", "float", aspect);
+        exr_attribute(out, "screenWindowCenter", "v2f", center);
+        exr_attribute(out, "screenWindowWidth", "float", width);
+        out += '\0';
+
+        // 偏移表之后每行一块：行号、数据字节数、按通道顺序排列的整行数据
+        uint32_t line_bytes = uint32_t(ch.size() * img.width * 4);
+        uint64_t offset = out.size() + uint64_t(img.height) * 8;
+        for (int j = 0; j < img.height; j++) {
+            put_u64(out, offset);
+            offset += 8 + line_bytes;
+        }
+        for (int j = 0; j < img.height; j++) {
+            put_u32(out, uint32_t(j));
+            put_u32(out, line_bytes);
+            for (const auto& c : ch)
+                for (int i = 0; i < img.width; i++)
+                    put_f32(out, (*c.data)[(size_t(j) * img.width + i) * c.stride + c.offset]);
+        }
+        return out;
+    }
+
+    inline bool ends_with(const std::string& s, const char* suffix) {
+        size_t n = std::strlen(suffix);
+        if (s.size() < n)
+            return false;
+        for (size_t i = 0; i < n; i++)
+            if (std::tolower((unsigned char)s[s.size() - n + i]) != suffix[i])
+                return false;
+        return true;
+    }
+
+    //按扩展名选择格式写出；path 为 "-" 时把 ASCII PPM 写到标准输出
+    inline bool write_image(const hdr_image& img, const std::string& path) {
+        if (path == "-") {
+            std::string data = encode_ppm_ascii(img);
+            std::cout.write(data.data(), std::streamsize(data.size()));
+            std::cout.flush();
+            return bool(std::cout);
+        }
+
+        std::string data;
+        if (ends_with(path, ".pfm"))
+            data = encode_pfm(img);
+        else if (ends_with(path, ".png"))
+            data = encode_png(img);
+        else if (ends_with(path, ".exr"))
+            data = encode_exr(img);
+        else
+            data = encode_ppm(img);
+
+        // 先写临时文件再改名，查看进度图时不会读到写了一半的文件
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp.c_str(), std::ios::binary);
+            out.write(data.data(), std::streamsize(data.size()));
+            if (!out)
+                return false;
+        }
+        std::remove(path.c_str());
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    inline bool get_u32(std::istream& in, uint32_t& v) {
+        unsigned char b[4];
+        if (!in.read((char*)b, 4))
+            return false;
+        v = uint32_t(b[0]) | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+        return true;
+    }
+
+    inline bool get_string(std::istream& in, std::string& s) {
+        s.clear();
+        char c;
+        while (in.get(c)) {
+            if (c == '\0')
+                return true;
+            s += c;
+        }
+        return false;
+    }
+
+    //读取 encode_exr 写出的文件（不压缩、FLOAT 通道、每块一行），用于续渲
+    inline bool read_exr(const std::string& path, hdr_image& img) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        uint32_t magic, version;
+        if (!get_u32(in, magic) || !get_u32(in, version) || magic != 20000630 || (version & 0xff) != 2)
+            return false;
+
+        std::vector<std::string> channels;
+        int xmin = 0, ymin = 0, xmax = -1, ymax = -1;
+        for (;;) {
+            std::string name, type;
+            uint32_t size;
+            if (!get_string(in, name))
+                return false;
+            if (name.empty())
+                break;
+            if (!get_string(in, type) || !get_u32(in, size))
+                return false;
+            std::string value(size, '\0');
+            if (!in.read(&value[0], size))
+                return false;
+
+            if (name == "channels") {
+                size_t pos = 0;
+                while (pos < value.size() && value[pos] != '\0') {
+                    size_t end = value.find('\0', pos);
+                    channels.push_back(value.substr(pos, end - pos));
+                    if (value[end + 1] != 2)   // 只支持 FLOAT 通道
+                        return false;
+                    pos = end + 1 + 16;
+                }
+            } else if (name == "compression") {
+                if (value.empty() || value[0] != 0)
+                    return false;
+            } else if (name == "dataWindow" && size == 16) {
+                int32_t box[4];
+                std::memcpy(box, value.data(), 16);
+                xmin = box[0]; ymin = box[1]; xmax = box[2]; ymax = box[3];
+            }
+        }
+
+        img.width = xmax - xmin + 1;
+        img.height = ymax - ymin + 1;
+        if (img.width <= 0 || img.height <= 0)
+            return false;
+
+        size_t pixel_count = size_t(img.width) * img.height;
+        img.rgb.assign(pixel_count * 3, 0.0f);
+        img.samples.clear();
+        img.rgb_sq.clear();
+        img.albedo.clear();
+        img.normal.clear();
+        img.depth.clear();
+        for (const auto& c : channels) {
+            if (c == "samples.N") img.samples.assign(pixel_count, 0.0f);
+            if (c == "sq.R") img.rgb_sq.assign(pixel_count * 3, 0.0f);
+            if (c == "albedo.R") img.albedo.assign(pixel_count * 3, 0.0f);
+            if (c == "normal.X") img.normal.assign(pixel_count * 3, 0.0f);
+            if (c == "depth.Z") img.depth.assign(pixel_count, 0.0f);
+        }
+
+        in.seekg(std::streamoff(img.height) * 8, std::ios::cur);
+        std::vector<float> line(size_t(img.width));
+        for (int j = 0; j < img.height; j++) {
+            uint32_t y, bytes;
+            if (!get_u32(in, y) || !get_u32(in, bytes))
+                return false;
+            int row = int(int32_t(y)) - ymin;
+            if (row < 0 || row >= img.height || bytes != channels.size() * img.width * 4)
+                return false;
+            for (const auto& c : channels) {
+                for (int i = 0; i < img.width; i++) {
+                    uint32_t bits;
+                    if (!get_u32(in, bits))
+                        return false;
+                    std::memcpy(&line[i], &bits, sizeof(float));
+                }
+
+                std::vector<float>* dst = nullptr;
+                int stride = 3, offset = 0;
+                if      (c == "R")  { dst = &img.rgb; offset = 0; }
+                else if (c == "G")  { dst = &img.rgb; offset = 1; }
+                else if (c == "B")  { dst = &img.rgb; offset = 2; }
+                else if (c == "sq.R") { dst = &img.rgb_sq; offset = 0; }
+                else if (c == "sq.G") { dst = &img.rgb_sq; offset = 1; }
+                else if (c == "sq.B") { dst = &img.rgb_sq; offset = 2; }
+                else if (c == "samples.N") { dst = &img.samples; stride = 1; }
+                else if (c == "albedo.R") { dst = &img.albedo; offset = 0; }
+                else if (c == "albedo.G") { dst = &img.albedo; offset = 1; }
+                else if (c == "albedo.B") { dst = &img.albedo; offset = 2; }
+                else if (c == "normal.X") { dst = &img.normal; offset = 0; }
+                else if (c == "normal.Y") { dst = &img.normal; offset = 1; }
+                else if (c == "normal.Z") { dst = &img.normal; offset = 2; }
+                else if (c == "depth.Z")  { dst = &img.depth; stride = 1; }
+                if (!dst || dst->empty())   // 只有一个层的部分通道时忽略这一层
+                    continue;
+                for (int i = 0; i < img.width; i++)
+                    (*dst)[(size_t(row) * img.width + i) * stride + offset] = line[i];
+            }
+        }
+        return true;
+    }
+
+    //读取 encode_ppm 写出的二进制 P6，得到 gamma 后的 8 位值，基准测试比较参考图用
+    inline bool read_ppm(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgb) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        std::string magic;
+        int max_value = 0;
+        if (!(in >> magic >> width >> height >> max_value) || magic != "P6" || max_value != 255)
+            return false;
+        if (width <= 0 || height <= 0)
+            return false;
+        in.get();   // 头部后面的一个空白字符
+        rgb.resize(size_t(width) * height * 3);
+        return bool(in.read((char*)rgb.data(), std::streamsize(rgb.size())));
+    }
+
+} // namespace image_io
+
+//后台写图线程：submit 把图像放进队列后立即返回，编码和文件 I/O 都在写图线程里完成
+class image_writer {
+  public:
+    image_writer() : stopping(false), busy(false) {
+        worker = std::thread([this]() { run(); });
+    }
+
+    ~image_writer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+    }
+
+    // 同一路径还有没写出的旧图时直接替换，进度图跟不上渲染时只保留最新的一张
+    void submit(hdr_image image, const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& job : jobs) {
+                if (job.path == path) {
+                    job.image = std::move(image);
+                    return;
+                }
+            }
+            jobs.push_back(job_t{std::move(image), path});
+        }
+        wake.notify_all();
+    }
+
+    // 等待队列中的图像全部写完
+    void finish() {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this]() { return jobs.empty() && !busy; });
+    }
+
+  private:
+    struct job_t {
+        hdr_image image;
+        std::string path;
+    };
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    std::deque<job_t> jobs;
+    bool stopping, busy;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;   // stopping 且队列已空
+
+            job_t job = std::move(jobs.front());
+            jobs.pop_front();
+            busy = true;
+            lock.unlock();
+
+            if (!image_io::write_image(job.image, job.path))
+                std::cerr << "Failed to write image " << job.path << '\n';
+
+            lock.lock();
+            busy = false;
+            if (jobs.empty())
+                idle.notify_all();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "hittable.h"
+#include "triangle_mesh.h"
+
+#include <cmath>
+
+//仿射变换：3x3 线性部分加平移，p' = m * p + t
+class transform {
+  public:
+    transform() : m{{1,0,0}, {0,1,0}, {0,0,1}}, t(0,0,0) {}
+
+    static transform translate(const vec3& offset) {
+        transform x;
+        x.t = offset;
+        return x;
+    }
+
+    static transform scale(double s) { return scale(vec3(s, s, s)); }
+
+    static transform scale(const vec3& s) {
+        transform x;
+        for (int i = 0; i < 3; i++)
+            x.m[i][i] = s[i];
+        return x;
+    }
+
+    // 绕 axis 旋转 degrees 度（Rodrigues 公式）
+    static transform rotate(const vec3& axis, double degrees) {
+        vec3 k = unit_vector(axis);
+        double c = std::cos(degrees_to_radians(degrees));
+        double s = std::sin(degrees_to_radians(degrees));
+        transform x;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++)
+                x.m[i][j] = (1 - c) * k[i] * k[j] + (i == j ? c : 0);
+        }
+        x.m[0][1] -= s*k[2]; x.m[1][0] += s*k[2];
+        x.m[0][2] += s*k[1]; x.m[2][0] -= s*k[1];
+        x.m[1][2] -= s*k[0]; x.m[2][1] += s*k[0];
+        return x;
+    }
+
+    // a * b：先做 b 再做 a
+    friend transform operator*(const transform& a, const transform& b) {
+        transform x;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++)
+                x.m[i][j] = a.m[i][0]*b.m[0][j] + a.m[i][1]*b.m[1][j] + a.m[i][2]*b.m[2][j];
+        }
+        x.t = a.apply_point(b.t);
+        return x;
+    }
+
+    point3 apply_point(const point3& p) const { return apply_vector(p) + t; }
+
+    vec3 apply_vector(const vec3& v) const {
+        return vec3(m[0][0]*v[0] + m[0][1]*v[1] + m[0][2]*v[2],
+                    m[1][0]*v[0] + m[1][1]*v[1] + m[1][2]*v[2],
+                    m[2][0]*v[0] + m[2][1]*v[1] + m[2][2]*v[2]);
+    }
+
+    // 乘线性部分的转置；对逆变换调用即得到法线的变换
+    vec3 apply_transpose(const vec3& v) const {
+        return vec3(m[0][0]*v[0] + m[1][0]*v[1] + m[2][0]*v[2],
+                    m[0][1]*v[0] + m[1][1]*v[1] + m[2][1]*v[2],
+                    m[0][2]*v[0] + m[1][2]*v[1] + m[2][2]*v[2]);
+    }
+
+    // 变换后包围盒的 8 个角重新取包围盒
+    aabb apply_box(const aabb& box) const {
+        aabb result;
+        for (int corner = 0; corner < 8; corner++) {
+            point3 p((corner & 1) ? box.x.max : box.x.min,
+                     (corner & 2) ? box.y.max : box.y.min,
+                     (corner & 4) ? box.z.max : box.z.min);
+            point3 q = apply_point(p);
+            result = aabb(result, aabb(q, q));
+        }
+        return result;
+    }
+
+    // 线性部分用伴随矩阵求逆，调用者保证矩阵可逆
+    transform inverse() const {
+        transform x;
+        x.m[0][0] = m[1][1]*m[2][2] - m[1][2]*m[2][1];
+        x.m[0][1] = m[0][2]*m[2][1] - m[0][1]*m[2][2];
+        x.m[0][2] = m[0][1]*m[1][2] - m[0][2]*m[1][1];
+        x.m[1][0] = m[1][2]*m[2][0] - m[1][0]*m[2][2];
+        x.m[1][1] = m[0][0]*m[2][2] - m[0][2]*m[2][0];
+        x.m[1][2] = m[0][2]*m[1][0] - m[0][0]*m[1][2];
+        x.m[2][0] = m[1][0]*m[2][1] - m[1][1]*m[2][0];
+        x.m[2][1] = m[0][1]*m[2][0] - m[0][0]*m[2][1];
+        x.m[2][2] = m[0][0]*m[1][1] - m[0][1]*m[1][0];
+        double det = m[0][0]*x.m[0][0] + m[0][1]*x.m[1][0] + m[0][2]*x.m[2][0];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++)
+                x.m[i][j] /= det;
+        }
+        x.t = -x.apply_vector(t);
+        return x;
+    }
+
+  private:
+    double m[3][3];
+    vec3 t;
+};
+
+//网格的一个实例：共享 triangle_mesh（连同它的 BLAS），自己只存变换和材质
+//把很多 instance 放进 bvh 就得到两级 BVH：顶层按实例的包围盒划分，命中实例后在网格自己的坐标系里遍历 BLAS
+class instance : public hittable {
+  public:
+    instance(shared_ptr<triangle_mesh> mesh, const transform& to_world, shared_ptr<material> mat)
+      : mesh(mesh), to_world(to_world), to_object(to_world.inverse()), mat(mat)
+    {
+        bbox = to_world.apply_box(mesh->bounding_box());
+    }
+
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        // 方向不归一化，物体空间里的 t 与世界空间相同
+        ray local(to_object.apply_point(r.origin()), to_object.apply_vector(r.direction()));
+        if (!mesh->hit(local, ray_t, rec))
+            return false;
+
+        // 法线按逆转置变换；朝向在变换前后保持不变，front_face 不用重新计算
+        rec.p = to_world.apply_point(rec.p);
+        rec.normal = unit_vector(to_object.apply_transpose(rec.normal));
+        rec.mat = mat.get();
+        return true;
+    }
+
+    aabb bounding_box() const override { return bbox; }
+
+  private:
+    shared_ptr<triangle_mesh> mesh;
+    transform to_world;
+    transform to_object;
+    shared_ptr<material> mat;
+    aabb bbox;
+};
+
+#endif
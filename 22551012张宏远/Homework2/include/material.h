@@ -3,98 +3,125 @@
 
 #include "hittable.h"
 
+//材质用类型标签区分，scatter 里按标签分支，不再经过虚函数；
+//hit_record 里只保存裸指针，求交和着色时没有引用计数和堆分配
 class material {
   public:
-    virtual ~material() = default;
+    enum material_type { LAMBERTIAN, METAL, DIELECTRIC, DIFFUSE_LIGHT };
+
+    material_type type() const { return kind; }
+
+    //漫反射表面才做光源采样（NEE），镜面、折射的方向是确定的
+    bool is_diffuse() const { return kind == LAMBERTIAN; }
+    bool is_emissive() const { return kind == DIFFUSE_LIGHT; }
+
+    color emitted() const { return kind == DIFFUSE_LIGHT ? albedo : color(0,0,0); }
+
+    //写进反照率 AOV 的颜色：漫反射和金属取反照率，玻璃取白色，光源取截断到 1 的发光
+    color aov_albedo() const {
+        switch (kind) {
+            case LAMBERTIAN:
+            case METAL:
+                return albedo;
+            case DIELECTRIC:
+                return color(1, 1, 1);
+            default:
+                return color(std::fmin(albedo.x(), 1.0), std::fmin(albedo.y(), 1.0), std::fmin(albedo.z(), 1.0));
+        }
+    }
+
+    bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered) const {
+        switch (kind) {
+            case LAMBERTIAN: {
+                //获取漫反射的方向
+                auto scatter_direction = rec.normal + random_unit_vector();
+                //如果这个方向正好和向量方向相反 则定义反射为
+                if (scatter_direction.near_zero())
+                    scatter_direction = rec.normal;
+
+                //生成散射的射线
+                scattered = ray(rec.p, scatter_direction);
+                attenuation = albedo;
+                return true;
+            }
+            case METAL: {
+                vec3 reflected = reflect(r_in.direction(), rec.normal);
+                reflected = unit_vector(reflected) + (fuzz * random_unit_vector());
+                scattered = ray(rec.p, reflected);
+                attenuation = albedo;
+                return (dot(scattered.direction(), rec.normal) > 0);
+            }
+            case DIELECTRIC: {
+                attenuation = color(1.0, 1.0, 1.0);
+                real ri = rec.front_face ? real(1.0/refraction_index) : real(refraction_index);
+
+                vec3 unit_direction = unit_vector(r_in.direction());
+                real cos_theta = std::fmin(dot(-unit_direction, rec.normal), real(1));
+                real sin_theta = std::sqrt(1 - cos_theta*cos_theta);
+
+                bool cannot_refract = ri * sin_theta > 1;
+                vec3 direction;
+
+                if (cannot_refract || reflectance(cos_theta, ri) > random_real())
+                    direction = reflect(unit_direction, rec.normal);
+                else
+                    direction = refract(unit_direction, rec.normal, ri);
+
+                scattered = ray(rec.p, direction);
+                return true;
+            }
+            default:
+                return false;   // 光源只发光，不散射
+        }
+    }
 
-    virtual bool scatter(
-        const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
-    ) const {
-        return false;
+  protected:
+    material(material_type kind) : kind(kind) {}
+
+    material_type kind;
+    color  albedo;                   // 漫反射/金属的反照率，光源的发光强度
+    double fuzz = 0;                 // 金属反射的模糊程度
+    // Refractive index in vacuum or air, or the ratio of the material's refractive index over
+    // the refractive index of the enclosing media
+    double refraction_index = 1;
+
+  private:
+    static real reflectance(real cosine, real refraction_index) {
+        // Use Schlick's approximation for reflectance.
+        auto r0 = (1 - refraction_index) / (1 + refraction_index);
+        r0 = r0*r0;
+        return r0 + (1-r0)*std::pow((1 - cosine),5);
     }
 };
 
+//下面几个类只负责设置标签和参数，main.cpp 里的 make_shared<lambertian>(...) 等写法不变
+
 //漫反射模型
 class lambertian : public material {
   public:
-    lambertian(const color& albedo) : albedo(albedo) {}
-
-    bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
-    const override {
-        //获取漫反射的方向
-        auto scatter_direction = rec.normal + random_unit_vector();
-        //如果这个方向正好和向量方向相反 则定义反射为
-        if (scatter_direction.near_zero())
-            scatter_direction = rec.normal;
-
-        //生成散射的射线
-        scattered = ray(rec.p, scatter_direction);
-        attenuation = albedo;
-        return true;
-    }
-
-  private:
-    color albedo;
+    lambertian(const color& albedo) : material(LAMBERTIAN) { this->albedo = albedo; }
 };
 
 //金属反射模型
 class metal : public material {
   public:
-    metal(const color& albedo, double fuzz) : albedo(albedo), fuzz(fuzz < 1 ? fuzz : 1) {}
-
-    bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
-    const override {
-        vec3 reflected = reflect(r_in.direction(), rec.normal);
-        reflected = unit_vector(reflected) + (fuzz * random_unit_vector());
-        scattered = ray(rec.p, reflected);
-        attenuation = albedo;
-        return (dot(scattered.direction(), rec.normal) > 0);
+    metal(const color& albedo, double fuzz) : material(METAL) {
+        this->albedo = albedo;
+        this->fuzz = fuzz < 1 ? fuzz : 1;
     }
-
-  private:
-    color albedo;
-    double fuzz;
 };
 
-
 // 折射模型
 class dielectric : public material {
   public:
-    dielectric(double refraction_index) : refraction_index(refraction_index) {}
-
-    bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
-    const override {
-        attenuation = color(1.0, 1.0, 1.0);
-        double ri = rec.front_face ? (1.0/refraction_index) : refraction_index;
-
-        vec3 unit_direction = unit_vector(r_in.direction());
-        double cos_theta = std::fmin(dot(-unit_direction, rec.normal), 1.0);
-        double sin_theta = std::sqrt(1.0 - cos_theta*cos_theta);
-
-        bool cannot_refract = ri * sin_theta > 1.0;
-        vec3 direction;
-
-        if (cannot_refract || reflectance(cos_theta, ri) > random_double())
-            direction = reflect(unit_direction, rec.normal);
-        else
-            direction = refract(unit_direction, rec.normal, ri);
-
-        scattered = ray(rec.p, direction);
-        return true;
-    }
-
-  private:
-    // Refractive index in vacuum or air, or the ratio of the material's refractive index over
-    // the refractive index of the enclosing media
-    double refraction_index;
+    dielectric(double refraction_index) : material(DIELECTRIC) { this->refraction_index = refraction_index; }
+};
 
-        static double reflectance(double cosine, double refraction_index) {
-        // Use Schlick's approximation for reflectance.
-        auto r0 = (1 - refraction_index) / (1 + refraction_index);
-        r0 = r0*r0;
-        return r0 + (1-r0)*std::pow((1 - cosine),5);
-    }
+//发光材质，emit 为发出的辐亮度
+class diffuse_light : public material {
+  public:
+    diffuse_light(const color& emit) : material(DIFFUSE_LIGHT) { albedo = emit; }
 };
 
 
-#endif
\ No newline at end of file
+#endif
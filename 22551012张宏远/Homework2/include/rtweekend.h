@@ -2,16 +2,33 @@
 #define RTWEEKEND_H
 
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <limits>
 #include <memory>
-#include <random>
 
 // C++ Std Usings
 
 using std::make_shared;
 using std::shared_ptr;
 
+// 精度策略，编译时定义其中一个宏选择（CMake 选项 RT_PRECISION）：
+//   默认                 全部用 double
+//   RT_PRECISION_FLOAT   全部用 float：向量、颜色、射线参数、包围盒和求交
+//   RT_PRECISION_MIXED   向量、颜色、射线参数用 float，球和三角形的求交在 double 下进行，
+//                        避免大半径球（地面）的二次方程在 float 下相消出错
+// real 是 vec3、interval 和 t 的类型，hit_real 是求交内部计算用的类型
+#if defined(RT_PRECISION_FLOAT)
+typedef float  real;
+typedef float  hit_real;
+#elif defined(RT_PRECISION_MIXED)
+typedef float  real;
+typedef double hit_real;
+#else
+typedef double real;
+typedef double hit_real;
+#endif
+
 // Constants
 
 const double infinity = std::numeric_limits<double>::infinity();
@@ -23,12 +40,73 @@ inline double degrees_to_radians(double degrees) {
     return degrees * pi / 180.0;
 }
 
+// PCG32 随机数生成器（XSH-RR 输出）
+// 状态只有两个 64 位整数，可以按 (像素, 采样) 直接构造，不依赖之前生成过多少个数
+class pcg32 {
+  public:
+    pcg32() { seed(0x853c49e6748fea9bULL, 0xda3e39cb94b95bdbULL); }
+    pcg32(uint64_t init_state, uint64_t init_seq) { seed(init_state, init_seq); }
+
+    void seed(uint64_t init_state, uint64_t init_seq) {
+        state = 0;
+        inc = (init_seq << 1u) | 1u;
+        next_uint();
+        state += init_state;
+        next_uint();
+    }
+
+    uint32_t next_uint() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + inc;
+        uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = uint32_t(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+    }
+
+    // [0,1) 之间的 double，用 53 位尾数
+    double next_double() {
+        uint64_t hi = next_uint() >> 5;    // 27 位
+        uint64_t lo = next_uint() >> 6;    // 26 位
+        return double((hi << 26) | lo) * (1.0 / 9007199254740992.0);
+    }
+
+    // [0,1) 之间的 float，用 24 位尾数，只消耗一个 32 位数
+    float next_float() {
+        return float(next_uint() >> 8) * (1.0f / 16777216.0f);
+    }
+
+  private:
+    uint64_t state;
+    uint64_t inc;
+};
+
+// 每个线程一个生成器，渲染时由 camera 按 (像素, 采样) 重新播种，
+// 所以结果和线程数、瓦片的执行顺序都无关
+inline pcg32& thread_rng()
+{
+    static thread_local pcg32 rng;
+    return rng;
+}
+
+inline uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// 用像素下标和采样序号播种当前线程的生成器；image_seed 换一个值得到另一组独立的采样，为 0 时与不加种子相同
+inline void seed_sample_rng(uint64_t pixel_index, uint64_t sample_index, uint64_t image_seed = 0)
+{
+    uint64_t key = (pixel_index << 32) ^ sample_index ^ (image_seed * 0xd1b54a32d192ed03ULL);
+    thread_rng().seed(splitmix64(key), pixel_index);
+}
+
 inline double random_double()
 {
     // 返回一个值在范围[0,1)的随机值
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-    static std::mt19937 generator;
-    return distribution(generator);
+    return thread_rng().next_double();
 }
 
 inline double random_double(double min,double max)
@@ -37,6 +115,17 @@ inline double random_double(double min,double max)
     return min + (max-min)*random_double();
 }
 
+// 按精度策略取 [0,1) 的随机数：float 时只用一个 32 位数，double 时与 random_double 相同
+inline real random_real()
+{
+    return sizeof(real) == sizeof(float) ? real(thread_rng().next_float()) : real(thread_rng().next_double());
+}
+
+inline real random_real(real min, real max)
+{
+    return min + (max-min)*random_real();
+}
+
 
 // Common Headers
 
@@ -48,6 +137,8 @@ inline double random_double(double min,double max)
 
 #include "hittable_list.h"
 #include "sphere.h"
+#include "bvh.h"
+#include "instance.h"
 
 #include "material.h"
 
@@ -0,0 +1,166 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include "camera.h"
+#include "instance.h"
+#include "triangle_mesh.h"
+
+#include <vector>
+
+//main.cpp 和基准测试共用的场景
+//每个函数往 world 里添加物体（还没有建 BVH）、往 lights 里添加要做直接光照采样的光源，并设置相机的视角；
+//分辨率和采样数由调用者决定。物体的随机参数来自当前线程的生成器，调用前用同一个种子播种就能得到同一个场景
+namespace scenes {
+
+    //《一周末》封面：地面上随机分布的小球和三个大球
+    inline void random_spheres(hittable_list& world, hittable_list& lights, camera& cam) {
+        (void)lights;
+
+        auto ground_material = make_shared<lambertian>(color(0.5, 0.5, 0.5));
+        world.add(make_shared<sphere>(point3(0,-1000,0), 1000, ground_material));
+
+        for (int a = -11; a < 11; a++) {
+            for (int b = -11; b < 11; b++) {
+                auto choose_mat = random_double();
+                point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
+
+                if ((center - point3(4, 0.2, 0)).length() > 0.9) {
+                    shared_ptr<material> sphere_material;
+
+                    if (choose_mat < 0.8) {
+                        // diffuse
+                        auto albedo = color::random() * color::random();
+                        sphere_material = make_shared<lambertian>(albedo);
+                        world.add(make_shared<sphere>(center, 0.2, sphere_material));
+                    } else if (choose_mat < 0.95) {
+                        // metal
+                        auto albedo = color::random(0.5, 1);
+                        auto fuzz = random_double(0, 0.5);
+                        sphere_material = make_shared<metal>(albedo, fuzz);
+                        world.add(make_shared<sphere>(center, 0.2, sphere_material));
+                    } else {
+                        // glass
+                        sphere_material = make_shared<dielectric>(1.5);
+                        world.add(make_shared<sphere>(center, 0.2, sphere_material));
+                    }
+                }
+            }
+        }
+
+        auto material1 = make_shared<dielectric>(1.5);
+        world.add(make_shared<sphere>(point3(0, 1, 0), 1.0, material1));
+
+        auto material2 = make_shared<lambertian>(color(0.4, 0.2, 0.1));
+        world.add(make_shared<sphere>(point3(-4, 1, 0), 1.0, material2));
+
+        auto material3 = make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
+        world.add(make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
+
+        cam.aspect_ratio = 16.0 / 9.0;
+        cam.vfov     = 20;
+        cam.lookfrom = point3(13,2,3);
+        cam.lookat   = point3(0,0,0);
+        cam.vup      = vec3(0,1,0);
+
+        cam.defocus_angle = 0.6;
+        cam.focus_dist    = 10.0;
+    }
+
+    //程序生成的圆环：主半径 major、管半径 minor，nu x nv 个四边形，每个拆成两个三角形，带顶点法线
+    //三角形按外法线逆时针排列，玻璃材质据此判断射线在里面还是外面
+    inline shared_ptr<triangle_mesh> torus(double major, double minor, int nu, int nv) {
+        std::vector<float> positions, normals;
+        std::vector<uint32_t> indices;
+        for (int i = 0; i < nu; i++) {
+            double u = 2*pi * i / nu;
+            for (int j = 0; j < nv; j++) {
+                double v = 2*pi * j / nv;
+                vec3 n(std::cos(v) * std::cos(u), std::sin(v), std::cos(v) * std::sin(u));
+                point3 p = point3(major * std::cos(u), 0, major * std::sin(u)) + minor * n;
+                for (int k = 0; k < 3; k++) {
+                    positions.push_back(float(p[k]));
+                    normals.push_back(float(n[k]));
+                }
+            }
+        }
+        for (int i = 0; i < nu; i++) {
+            for (int j = 0; j < nv; j++) {
+                uint32_t a = uint32_t(i * nv + j);
+                uint32_t b = uint32_t(((i + 1) % nu) * nv + j);
+                uint32_t c = uint32_t(((i + 1) % nu) * nv + (j + 1) % nv);
+                uint32_t d = uint32_t(i * nv + (j + 1) % nv);
+                uint32_t tri[6] = { a, c, b, a, d, c };
+                indices.insert(indices.end(), tri, tri + 6);
+            }
+        }
+        return make_shared<triangle_mesh>(std::move(positions), std::move(indices), std::move(normals));
+    }
+
+    //8x8 个共享同一网格的圆环实例，漫反射和金属材质，由一个球形光源照明（直接光照采样）
+    inline void torus_field(hittable_list& world, hittable_list& lights, camera& cam) {
+        world.add(make_shared<sphere>(point3(0,-1000,0), 1000, make_shared<lambertian>(color(0.5, 0.5, 0.5))));
+
+        auto mesh = torus(0.5, 0.18, 96, 48);
+        for (int a = 0; a < 8; a++) {
+            for (int b = 0; b < 8; b++) {
+                shared_ptr<material> mat;
+                if (random_double() < 0.7)
+                    mat = make_shared<lambertian>(color::random() * color::random());
+                else
+                    mat = make_shared<metal>(color::random(0.5, 1), random_double(0, 0.3));
+
+                auto place = transform::translate(point3(1.6*a - 5.6, 0.7, 1.6*b - 5.6))
+                           * transform::rotate(vec3::random(-1, 1), random_double(0, 180));
+                world.add(make_shared<instance>(mesh, place, mat));
+            }
+        }
+
+        auto light = make_shared<sphere>(point3(0, 8, 2), 1.5, make_shared<diffuse_light>(color(12, 11, 10)));
+        world.add(light);
+        lights.add(light);
+
+        cam.aspect_ratio = 16.0 / 9.0;
+        cam.vfov     = 40;
+        cam.lookfrom = point3(0, 7, 12);
+        cam.lookat   = point3(0, 0, 0);
+        cam.vup      = vec3(0,1,0);
+        cam.defocus_angle = 0;
+    }
+
+    //以折射为主的场景：折射率各不相同的玻璃球、空心玻璃球和玻璃圆环，多次折射让路径都很长
+    inline void glass(hittable_list& world, hittable_list& lights, camera& cam) {
+        (void)lights;
+
+        world.add(make_shared<sphere>(point3(0,-1000,0), 1000, make_shared<lambertian>(color(0.6, 0.35, 0.2))));
+
+        for (int a = -3; a <= 3; a++) {
+            for (int b = -3; b <= 3; b++) {
+                double radius = random_double(0.25, 0.45);
+                point3 center(1.1*a + 0.2*random_double(), radius, 1.1*b + 0.2*random_double());
+                double ior = random_double(1.3, 1.8);
+                world.add(make_shared<sphere>(center, radius, make_shared<dielectric>(ior)));
+                // 每隔几个放一个空心球：内部再放一个折射率取倒数的球，等效于一层玻璃壳
+                if ((a + b) % 3 == 0)
+                    world.add(make_shared<sphere>(center, 0.85 * radius, make_shared<dielectric>(1.0 / ior)));
+            }
+        }
+
+        auto mesh = torus(0.8, 0.25, 64, 32);
+        auto torus_glass = make_shared<dielectric>(1.5);
+        for (int i = 0; i < 3; i++) {
+            auto place = transform::translate(point3(2.4*i - 2.4, 1.4, 0))
+                       * transform::rotate(vec3(1, 0, 0), 60 + 30*i);
+            world.add(make_shared<instance>(mesh, place, torus_glass));
+        }
+
+        cam.aspect_ratio = 16.0 / 9.0;
+        cam.vfov     = 35;
+        cam.lookfrom = point3(0, 5, 9);
+        cam.lookat   = point3(0, 0.5, 0);
+        cam.vup      = vec3(0,1,0);
+        cam.defocus_angle = 0;
+    }
+
+} // namespace scenes
+
+#endif
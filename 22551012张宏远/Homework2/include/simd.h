@@ -0,0 +1,131 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+//8 路 float 向量，射线包求交用
+//编译时打开 AVX2（-mavx2 / /arch:AVX2）就用 __m256，否则退化为逐元素循环
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+
+struct float8 {
+    __m256 v;
+
+    float8() {}
+    float8(__m256 v) : v(v) {}
+    explicit float8(float s) : v(_mm256_set1_ps(s)) {}
+
+    static float8 load(const float* p) { return float8(_mm256_loadu_ps(p)); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    // 把整数的位模式放进各个通道，和 select 一起用来记录物体下标
+    static float8 from_int_bits(int32_t i) { return float8(_mm256_castsi256_ps(_mm256_set1_epi32(i))); }
+    static float8 load_int_bits(const int32_t* p) { return float8(_mm256_castsi256_ps(_mm256_loadu_si256((const __m256i*)p))); }
+    void store_int_bits(int32_t* p) const { _mm256_storeu_si256((__m256i*)p, _mm256_castps_si256(v)); }
+};
+
+inline float8 operator+(const float8& a, const float8& b) { return float8(_mm256_add_ps(a.v, b.v)); }
+inline float8 operator-(const float8& a, const float8& b) { return float8(_mm256_sub_ps(a.v, b.v)); }
+inline float8 operator*(const float8& a, const float8& b) { return float8(_mm256_mul_ps(a.v, b.v)); }
+inline float8 operator/(const float8& a, const float8& b) { return float8(_mm256_div_ps(a.v, b.v)); }
+inline float8 operator&(const float8& a, const float8& b) { return float8(_mm256_and_ps(a.v, b.v)); }
+
+// 与 _mm256_min_ps/_mm256_max_ps 一致：有 NaN 时返回 b
+inline float8 min8(const float8& a, const float8& b) { return float8(_mm256_min_ps(a.v, b.v)); }
+inline float8 max8(const float8& a, const float8& b) { return float8(_mm256_max_ps(a.v, b.v)); }
+inline float8 sqrt8(const float8& a) { return float8(_mm256_sqrt_ps(a.v)); }
+
+inline float8 operator<(const float8& a, const float8& b)  { return float8(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+inline float8 operator<=(const float8& a, const float8& b) { return float8(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+inline float8 operator>(const float8& a, const float8& b)  { return float8(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+inline float8 operator>=(const float8& a, const float8& b) { return float8(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+
+// mask 为真的通道取 a，否则取 b
+inline float8 select(const float8& mask, const float8& a, const float8& b) {
+    return float8(_mm256_blendv_ps(b.v, a.v, mask.v));
+}
+
+inline int movemask(const float8& mask) { return _mm256_movemask_ps(mask.v); }
+
+#else
+
+struct float8 {
+    float v[8];
+
+    float8() {}
+    explicit float8(float s) { for (int i = 0; i < 8; i++) v[i] = s; }
+
+    static float8 load(const float* p) { float8 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+    void store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+
+    static float8 from_int_bits(int32_t i) {
+        float8 r;
+        for (int k = 0; k < 8; k++) std::memcpy(&r.v[k], &i, sizeof(float));
+        return r;
+    }
+    static float8 load_int_bits(const int32_t* p) { float8 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+    void store_int_bits(int32_t* p) const { std::memcpy(p, v, sizeof(v)); }
+};
+
+#define FLOAT8_BINARY(name, expr)                                    \
+    inline float8 name(const float8& a, const float8& b) {          \
+        float8 r;                                                    \
+        for (int i = 0; i < 8; i++) { float x = a.v[i], y = b.v[i]; r.v[i] = (expr); } \
+        return r;                                                    \
+    }
+
+// 比较结果用全 1 / 全 0 的位模式表示，和 AVX 的掩码一致
+inline float mask_bits(bool m) {
+    uint32_t bits = m ? 0xffffffffu : 0u;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+inline bool mask_set(float m) {
+    uint32_t bits;
+    std::memcpy(&bits, &m, sizeof(bits));
+    return (bits >> 31) != 0;
+}
+
+FLOAT8_BINARY(operator+, x + y)
+FLOAT8_BINARY(operator-, x - y)
+FLOAT8_BINARY(operator*, x * y)
+FLOAT8_BINARY(operator/, x / y)
+FLOAT8_BINARY(min8, x < y ? x : y)
+FLOAT8_BINARY(max8, x > y ? x : y)
+FLOAT8_BINARY(operator<,  mask_bits(x < y))
+FLOAT8_BINARY(operator<=, mask_bits(x <= y))
+FLOAT8_BINARY(operator>,  mask_bits(x > y))
+FLOAT8_BINARY(operator>=, mask_bits(x >= y))
+FLOAT8_BINARY(operator&,  mask_bits(mask_set(x) && mask_set(y)))
+
+#undef FLOAT8_BINARY
+
+inline float8 sqrt8(const float8& a) {
+    float8 r;
+    for (int i = 0; i < 8; i++) r.v[i] = std::sqrt(a.v[i]);
+    return r;
+}
+
+inline float8 select(const float8& mask, const float8& a, const float8& b) {
+    float8 r;
+    for (int i = 0; i < 8; i++) r.v[i] = mask_set(mask.v[i]) ? a.v[i] : b.v[i];
+    return r;
+}
+
+inline int movemask(const float8& mask) {
+    int m = 0;
+    for (int i = 0; i < 8; i++) m |= int(mask_set(mask.v[i])) << i;
+    return m;
+}
+
+#endif
+
+#endif
@@ -7,22 +7,31 @@
 class sphere : public hittable {
   public:
     sphere(const point3& center, double radius, shared_ptr<material> mat)
-      : center(center), radius(std::fmax(0,radius)), mat(mat) {} 
+      : center(center), radius(std::fmax(0,radius)), mat(mat)
+    {
+        auto rvec = vec3(radius, radius, radius);
+        bbox = aabb(center - rvec, center + rvec);
+    }
 
     bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
-        vec3 oc = center - r.origin();
-        auto a = r.direction().length_squared();
-        auto h = dot(r.direction(), oc);
-        auto c = oc.length_squared() - radius*radius;
+        // 二次方程在 hit_real 下求解：地面是半径 1000 的球，h*h 和 a*c 都在 1e6 量级，相减后只剩很小的差
+        hit_real oc[3], d[3];
+        for (int k = 0; k < 3; k++) {
+            oc[k] = hit_real(center[k]) - hit_real(r.origin()[k]);
+            d[k] = r.direction()[k];
+        }
+        hit_real a = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+        hit_real h = d[0]*oc[0] + d[1]*oc[1] + d[2]*oc[2];
+        hit_real c = oc[0]*oc[0] + oc[1]*oc[1] + oc[2]*oc[2] - hit_real(radius)*radius;
 
-        auto discriminant = h*h - a*c;
+        hit_real discriminant = h*h - a*c;
         if (discriminant < 0)
             return false;
 
-        auto sqrtd = std::sqrt(discriminant);
+        hit_real sqrtd = std::sqrt(discriminant);
 
         // Find the nearest root that lies in the acceptable range.
-        auto root = (h - sqrtd) / a;
+        hit_real root = (h - sqrtd) / a;
         if (!ray_t.surrounds(root)) {
             root = (h + sqrtd) / a;
             if (!ray_t.surrounds(root))
@@ -34,15 +43,57 @@ class sphere : public hittable {
 
         vec3 outward_normal = (rec.p - center) / radius;
         rec.set_face_normal(r,outward_normal);
-        rec.mat = mat;
+        rec.mat = mat.get();
 
         return true;
     }
 
+    aabb bounding_box() const override { return bbox; }
+
+    // 在球对 origin 张成的圆锥内均匀采样方向，密度为 1 / 立体角
+    double pdf_value(const point3& origin, const vec3& direction) const override {
+        hit_record rec;
+        if (!this->hit(ray(origin, direction), interval(0.001, infinity), rec))
+            return 0;
+
+        auto dist_squared = (center - origin).length_squared();
+        if (dist_squared <= radius*radius)
+            return 0;   // origin 在球内，没有圆锥可采样
+        auto cos_theta_max = std::sqrt(1 - radius*radius/dist_squared);
+        auto solid_angle = 2*pi*(1-cos_theta_max);
+
+        return 1 / solid_angle;
+    }
+
+    vec3 random(const point3& origin) const override {
+        vec3 direction = center - origin;
+        auto distance_squared = direction.length_squared();
+
+        // 以指向球心的方向为 w 建立正交基
+        vec3 w = unit_vector(direction);
+        vec3 a = (std::fabs(w.x()) > 0.9) ? vec3(0,1,0) : vec3(1,0,0);
+        vec3 v = unit_vector(cross(w, a));
+        vec3 u = cross(w, v);
+
+        auto r1 = random_real();
+        auto r2 = random_real();
+        auto z = 1 + r2*(std::sqrt(1-radius*radius/distance_squared) - 1);
+
+        auto phi = 2*pi*r1;
+        auto x = std::cos(phi) * std::sqrt(1-z*z);
+        auto y = std::sin(phi) * std::sqrt(1-z*z);
+
+        return x*u + y*v + z*w;
+    }
+
+    const point3& get_center() const { return center; }
+    double get_radius() const { return radius; }
+
   private:
     point3 center;
     double radius;
     shared_ptr<material> mat;
+    aabb bbox;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,187 @@
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include "bvh.h"
+#include "fast_obj_loader.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//索引三角形网格：顶点、索引和三角形 BVH（BLAS）都只存一份
+//网格本身不是 hittable，不带材质，通过 instance 放进场景；多个实例共享同一个网格
+class triangle_mesh {
+  public:
+    // positions 每个顶点 3 个 float；indices 每个三角形 3 个下标；normals 可以为空，非空时与 positions 一一对应
+    triangle_mesh(std::vector<float> positions, std::vector<uint32_t> indices,
+                  std::vector<float> normals = std::vector<float>(), int build_threads = 0)
+      : positions(std::move(positions)), normals(std::move(normals))
+    {
+        size_t count = indices.size() / 3;
+        std::vector<aabb> boxes(count);
+        for (size_t i = 0; i < count; i++) {
+            point3 a = vertex(indices[3*i]), b = vertex(indices[3*i + 1]), c = vertex(indices[3*i + 2]);
+            boxes[i] = aabb(aabb(a, b), aabb(c, c));
+        }
+
+        std::vector<uint32_t> order;
+        tree.build(boxes, build_threads, order);
+
+        // 三角形按叶子顺序重排，叶子直接对应一段连续的索引
+        triangles.resize(3 * count);
+        for (size_t i = 0; i < count; i++)
+            for (int k = 0; k < 3; k++)
+                triangles[3*i + k] = indices[3*order[i] + k];
+    }
+
+    //用 fast_obj_loader 读取 OBJ，只保留位置和法线；失败时返回空指针
+    static shared_ptr<triangle_mesh> load_obj(const std::string& path, int build_threads = 0) {
+        fastobj::weld_options_t weld;
+        weld.texcoords = false;
+        fastobj::indexed_mesh_t mesh;
+        std::string err;
+        if (!fastobj::LoadIndexedObj(&mesh, &err, path.c_str(), fastobj::load_options_t(), weld)) {
+            std::clog << "Cannot load " << path << ": " << err << "\n";
+            return nullptr;
+        }
+        std::vector<uint32_t> indices(mesh.indices.begin(), mesh.indices.end());
+        return make_shared<triangle_mesh>(std::move(mesh.vertices), std::move(indices),
+                                          std::move(mesh.normals), build_threads);
+    }
+
+    //在网格自身的坐标系里求交；rec.mat 由 instance 填写
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const {
+        watertight_ray wr(r);
+        uint32_t best = 0;
+        hit_real best_b[3];
+        bool found = tree.traverse(r, ray_t, [&](uint32_t i, interval& t) {
+            hit_real t_hit, b[3];
+            if (!intersect(wr, i, t, t_hit, b))
+                return false;
+            t.max = t_hit;
+            best = i;
+            best_b[0] = b[0]; best_b[1] = b[1]; best_b[2] = b[2];
+            return true;
+        });
+        if (!found)
+            return false;
+
+        const uint32_t* idx = &triangles[3 * best];
+        point3 a = vertex(idx[0]), b = vertex(idx[1]), c = vertex(idx[2]);
+
+        rec.t = ray_t.max;
+        // 用重心坐标插值出交点，比 r.at(t) 更贴近三角形平面
+        rec.p = best_b[0]*a + best_b[1]*b + best_b[2]*c;
+        rec.set_face_normal(r, unit_vector(cross(b - a, c - a)));
+
+        // 有顶点法线时插值作着色法线，但不让它翻到几何法线的另一侧
+        if (!normals.empty()) {
+            vec3 n = best_b[0]*normal(idx[0]) + best_b[1]*normal(idx[1]) + best_b[2]*normal(idx[2]);
+            if (n.length_squared() > 0) {
+                n = unit_vector(n);
+                if (!rec.front_face)
+                    n = -n;
+                if (dot(n, rec.normal) > 0)
+                    rec.normal = n;
+            }
+        }
+        return true;
+    }
+
+    aabb bounding_box() const { return tree.bounds(); }
+
+    size_t triangle_count() const { return triangles.size() / 3; }
+    size_t vertex_count() const { return positions.size() / 3; }
+
+    // 几何数据和 BLAS 占用的字节数
+    size_t memory_bytes() const {
+        return positions.capacity() * sizeof(float) + normals.capacity() * sizeof(float)
+             + triangles.capacity() * sizeof(uint32_t) + tree.memory_bytes();
+    }
+
+  private:
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<uint32_t> triangles;   // 按 BVH 叶子顺序排列，每个三角形 3 个顶点下标
+    bvh_tree tree;
+
+    //水密求交（Woop, Benthin, Wald 2013）每条射线只算一次的部分：
+    //以方向分量绝对值最大的轴为 z，把射线变换到 +z 方向，三角形投影到 xy 平面上做边函数测试；
+    //整个测试在 hit_real 下进行，float 下也是水密的，只是交点的 t 误差更大
+    struct watertight_ray {
+        int kx, ky, kz;
+        hit_real sx, sy, sz;
+        hit_real org[3];
+
+        watertight_ray(const ray& r) {
+            const vec3& d = r.direction();
+            for (int k = 0; k < 3; k++)
+                org[k] = r.origin()[k];
+            kz = std::fabs(d.x()) > std::fabs(d.y())
+               ? (std::fabs(d.x()) > std::fabs(d.z()) ? 0 : 2)
+               : (std::fabs(d.y()) > std::fabs(d.z()) ? 1 : 2);
+            kx = (kz + 1) % 3;
+            ky = (kx + 1) % 3;
+            if (d[kz] < 0)
+                std::swap(kx, ky);   // 保持三角形的环绕方向
+            sx = hit_real(d[kx]) / d[kz];
+            sy = hit_real(d[ky]) / d[kz];
+            sz = 1 / hit_real(d[kz]);
+        }
+    };
+
+    point3 vertex(uint32_t i) const {
+        return point3(positions[3*i], positions[3*i + 1], positions[3*i + 2]);
+    }
+
+    vec3 normal(uint32_t i) const {
+        return vec3(normals[3*i], normals[3*i + 1], normals[3*i + 2]);
+    }
+
+    // 二维边函数。两个端点按固定顺序相乘，共享一条边的两个三角形算出的值只差一个符号，
+    // 即使编译器把乘减合并成 FMA 也一样，射线不会从两个三角形之间漏过去
+    static hit_real edge(hit_real px, hit_real py, hit_real qx, hit_real qy) {
+        if (px < qx || (px == qx && py < qy))
+            return px*qy - py*qx;
+        return -(qx*py - qy*px);
+    }
+
+    bool intersect(const watertight_ray& w, uint32_t tri, const interval& ray_t,
+                   hit_real& t, hit_real* bary) const {
+        const uint32_t* idx = &triangles[3 * tri];
+        hit_real a[3], b[3], c[3];
+        for (int k = 0; k < 3; k++) {
+            a[k] = hit_real(positions[3*idx[0] + k]) - w.org[k];
+            b[k] = hit_real(positions[3*idx[1] + k]) - w.org[k];
+            c[k] = hit_real(positions[3*idx[2] + k]) - w.org[k];
+        }
+
+        hit_real ax = a[w.kx] - w.sx*a[w.kz], ay = a[w.ky] - w.sy*a[w.kz];
+        hit_real bx = b[w.kx] - w.sx*b[w.kz], by = b[w.ky] - w.sy*b[w.kz];
+        hit_real cx = c[w.kx] - w.sx*c[w.kz], cy = c[w.ky] - w.sy*c[w.kz];
+
+        hit_real u = edge(cx, cy, bx, by);
+        hit_real v = edge(ax, ay, cx, cy);
+        hit_real e = edge(bx, by, ax, ay);
+
+        // 三个边函数同号（允许为 0）才在三角形内，正反两面都算
+        if ((u < 0 || v < 0 || e < 0) && (u > 0 || v > 0 || e > 0))
+            return false;
+        hit_real det = u + v + e;
+        if (det == 0)
+            return false;
+
+        hit_real az = w.sz*a[w.kz], bz = w.sz*b[w.kz], cz = w.sz*c[w.kz];
+        t = (u*az + v*bz + e*cz) / det;
+        if (!ray_t.surrounds(t))
+            return false;
+
+        bary[0] = u / det;
+        bary[1] = v / det;
+        bary[2] = e / det;
+        return true;
+    }
+};
+
+#endif
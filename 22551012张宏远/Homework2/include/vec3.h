@@ -4,126 +4,145 @@
 #include<cmath>
 #include<iostream>
 
-class vec3{
+//三维向量，分量类型 T 由 rtweekend.h 里的精度策略决定（vec3 = vec3_t<real>）
+//float 版本按 16 字节对齐，大小正好是一个 SSE 寄存器，编译器可以整个装入做运算
+//运算符和 dot、cross 等都写成类内的友元：不是模板函数，double 的常数和变量可以直接与 float 向量相乘
+template <typename T>
+class alignas(sizeof(T) == 4 ? 16 : alignof(T)) vec3_t {
 public :
-    double e[3];
-    vec3() : e{0,0,0} {}
-    vec3(double e0,double e1,double e2) : e{e0,e1,e2} {}
+    typedef T value_type;
 
-    double x() const {return e[0];}
-    double y() const {return e[1];}
-    double z() const {return e[2];}
+    T e[3];
+    vec3_t() : e{0,0,0} {}
+    vec3_t(T e0,T e1,T e2) : e{e0,e1,e2} {}
 
-    vec3 operator-() const {return vec3(-e[0],-e[1],-e[2]);}
-    double operator[](int i) const {return e[i];}
-    double& operator[](int i) {return e[i];}
+    T x() const {return e[0];}
+    T y() const {return e[1];}
+    T z() const {return e[2];}
 
-   vec3& operator+=(const vec3& v) {
+    vec3_t operator-() const {return vec3_t(-e[0],-e[1],-e[2]);}
+    T operator[](int i) const {return e[i];}
+    T& operator[](int i) {return e[i];}
+
+   vec3_t& operator+=(const vec3_t& v) {
         e[0] += v.e[0];
         e[1] += v.e[1];
         e[2] += v.e[2];
         return *this;
     }
 
-    vec3& operator*=(double t) {
+    vec3_t& operator*=(T t) {
         e[0] *= t;
         e[1] *= t;
         e[2] *= t;
         return *this;
     }
 
-    vec3& operator/=(double t) {
+    vec3_t& operator/=(T t) {
         return *this *= 1/t;
     }
 
-    double length() const {
+    T length() const {
         return std::sqrt(length_squared());
     }
 
-    double length_squared() const {
+    T length_squared() const {
         return e[0]*e[0] + e[1]*e[1] + e[2]*e[2];
     }
 
     bool near_zero() const {
-        auto s = 1e-8;
+        auto s = T(1e-8);
         return (std::fabs(e[0]) < s) && (std::fabs(e[1]) < s) && (std::fabs(e[2]) < s);
     }
 
-    static vec3 random(){
-        return vec3(random_double(),random_double(),random_double());
+    //场景生成用，保持用 random_double，换精度策略时生成的场景不变
+    static vec3_t random(){
+        return vec3_t(random_double(),random_double(),random_double());
     }
 
-    static vec3 random(double min,double max){
-        return vec3(random_double(min,max),random_double(min,max),random_double(min,max));
+    static vec3_t random(double min,double max){
+        return vec3_t(random_double(min,max),random_double(min,max),random_double(min,max));
     }
-};
 
-//将point3 定义为vec3 的别名
-using point3 = vec3;
+    //向量通用函数
 
-//向量通用函数
+    friend std::ostream& operator<<(std::ostream& out, const vec3_t& v) {
+        return out << v.e[0] << ' ' << v.e[1] << ' ' << v.e[2];
+    }
 
-inline std::ostream& operator<<(std::ostream& out, const vec3& v) {
-    return out << v.e[0] << ' ' << v.e[1] << ' ' << v.e[2];
-}
+    friend vec3_t operator+(const vec3_t& u, const vec3_t& v) {
+        return vec3_t(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
+    }
 
-inline vec3 operator+(const vec3& u, const vec3& v) {
-    return vec3(u.e[0] + v.e[0], u.e[1] + v.e[1], u.e[2] + v.e[2]);
-}
+    friend vec3_t operator-(const vec3_t& u, const vec3_t& v) {
+        return vec3_t(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
+    }
 
-inline vec3 operator-(const vec3& u, const vec3& v) {
-    return vec3(u.e[0] - v.e[0], u.e[1] - v.e[1], u.e[2] - v.e[2]);
-}
+    friend vec3_t operator*(const vec3_t& u, const vec3_t& v) {
+        return vec3_t(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
+    }
 
-inline vec3 operator*(const vec3& u, const vec3& v) {
-    return vec3(u.e[0] * v.e[0], u.e[1] * v.e[1], u.e[2] * v.e[2]);
-}
+    friend vec3_t operator*(T t, const vec3_t& v) {
+        return vec3_t(t*v.e[0], t*v.e[1], t*v.e[2]);
+    }
 
-inline vec3 operator*(double t, const vec3& v) {
-    return vec3(t*v.e[0], t*v.e[1], t*v.e[2]);
-}
+    friend vec3_t operator*(const vec3_t& v, T t) {
+        return t * v;
+    }
 
-inline vec3 operator*(const vec3& v, double t) {
-    return t * v;
-}
+    friend vec3_t operator/(const vec3_t& v, T t) {
+        return (1/t) * v;
+    }
 
-inline vec3 operator/(const vec3& v, double t) {
-    return (1/t) * v;
-}
+    friend T dot(const vec3_t& u, const vec3_t& v) {
+        return u.e[0] * v.e[0]
+             + u.e[1] * v.e[1]
+             + u.e[2] * v.e[2];
+    }
 
-inline double dot(const vec3& u, const vec3& v) {
-    return u.e[0] * v.e[0]
-         + u.e[1] * v.e[1]
-         + u.e[2] * v.e[2];
-}
+    friend vec3_t cross(const vec3_t& u, const vec3_t& v) {
+        return vec3_t(u.e[1] * v.e[2] - u.e[2] * v.e[1],
+                      u.e[2] * v.e[0] - u.e[0] * v.e[2],
+                      u.e[0] * v.e[1] - u.e[1] * v.e[0]);
+    }
 
-inline vec3 cross(const vec3& u, const vec3& v) {
-    return vec3(u.e[1] * v.e[2] - u.e[2] * v.e[1],
-                u.e[2] * v.e[0] - u.e[0] * v.e[2],
-                u.e[0] * v.e[1] - u.e[1] * v.e[0]);
-}
+    friend vec3_t unit_vector(const vec3_t& v) {
+        return v / v.length();
+    }
+};
+
+//将point3 定义为vec3 的别名
+using vec3 = vec3_t<real>;
+using point3 = vec3;
 
-inline vec3 unit_vector(const vec3& v) {
-    return v / v.length();
-}
 
+//下面的采样都是从均匀随机数直接映射，不用拒绝采样：每个样本消耗的随机数个数固定，
+//没有次数不定的循环，射线包里的各条射线走同样的指令
 
+//单位圆盘内均匀分布的点（Shirley-Chiu 同心映射，把正方形的同心方环映射到同心圆环）
 inline vec3 random_in_unit_disk(){
-    while (true) {
-        auto p = vec3(random_double(-1,1), random_double(-1,1), 0);
-        if (p.length_squared() < 1)
-            return p;
+    real a = 2*random_real() - 1;
+    real b = 2*random_real() - 1;
+    if (a == 0 && b == 0)
+        return vec3(0, 0, 0);
+
+    real r, phi;
+    if (std::fabs(a) > std::fabs(b)) {
+        r = a;
+        phi = real(pi/4) * (b / a);
+    } else {
+        r = b;
+        phi = real(pi/2) - real(pi/4) * (a / b);
     }
+    return vec3(r * std::cos(phi), r * std::sin(phi), 0);
 }
 
+//单位球面上均匀分布的方向：z 在 [-1,1] 上均匀（阿基米德定理），方位角在 [0,2π) 上均匀
 inline vec3 random_unit_vector(){
-    while(true)
-    {
-        auto p = vec3::random(-1,1);
-        auto lensq = p.length_squared();
-        if(1e-160 < lensq && lensq <= 1)
-            return p / sqrt(lensq);
-    }
+    real z = 1 - 2*random_real();
+    real r = std::sqrt(std::fmax(real(0), 1 - z*z));
+    real phi = real(2*pi) * random_real();
+    return vec3(r * std::cos(phi), r * std::sin(phi), z);
 }
 
 inline vec3 random_on_hemisphere(const vec3& normal){
@@ -139,12 +158,12 @@ inline vec3 reflect(const vec3& v, const vec3& n) {
 }
 
 
-inline vec3 refract(const vec3& uv, const vec3& n, double etai_over_etat) {
-    auto cos_theta = std::fmin(dot(-uv, n), 1.0);
+inline vec3 refract(const vec3& uv, const vec3& n, real etai_over_etat) {
+    auto cos_theta = std::fmin(dot(-uv, n), real(1));
     vec3 r_out_perp =  etai_over_etat * (uv + cos_theta*n);
-    vec3 r_out_parallel = -std::sqrt(std::fabs(1.0 - r_out_perp.length_squared())) * n;
+    vec3 r_out_parallel = -std::sqrt(std::fabs(1 - r_out_perp.length_squared())) * n;
     return r_out_perp + r_out_parallel;
 }
 
 
-#endif 
\ No newline at end of file
+#endif
@@ -1,68 +1,50 @@
 //22551012
 //张宏远
 
+#define FAST_OBJ_LOADER_IMPLEMENTATION
 #include "rtweekend.h"
 #include "camera.h"
+#include "scenes.h"
 
 
-int main() {
-    hittable_list world;
-
-    auto ground_material = make_shared<lambertian>(color(0.5, 0.5, 0.5));
-    world.add(make_shared<sphere>(point3(0,-1000,0), 1000, ground_material));
-
-    for (int a = -11; a < 11; a++) {
-        for (int b = -11; b < 11; b++) {
-            auto choose_mat = random_double();
-            point3 center(a + 0.9*random_double(), 0.2, b + 0.9*random_double());
-
-            if ((center - point3(4, 0.2, 0)).length() > 0.9) {
-                shared_ptr<material> sphere_material;
+int main(int argc, char* argv[]) {
+    hittable_list world, lights;
+    camera cam;
 
-                if (choose_mat < 0.8) {
-                    // diffuse
-                    auto albedo = color::random() * color::random();
-                    sphere_material = make_shared<lambertian>(albedo);
-                    world.add(make_shared<sphere>(center, 0.2, sphere_material));
-                } else if (choose_mat < 0.95) {
-                    // metal
-                    auto albedo = color::random(0.5, 1);
-                    auto fuzz = random_double(0, 0.5);
-                    sphere_material = make_shared<metal>(albedo, fuzz);
-                    world.add(make_shared<sphere>(center, 0.2, sphere_material));
-                } else {
-                    // glass
-                    sphere_material = make_shared<dielectric>(1.5);
-                    world.add(make_shared<sphere>(center, 0.2, sphere_material));
-                }
+    // 场景和相机视角在 include/scenes.h 中，基准测试用的是同一个场景
+    scenes::random_spheres(world, lights, cam);
+
+    // 命令行给出 OBJ 文件时，在大球旁边斜着摆一排网格实例，它们共享同一份顶点和 BLAS
+    if (argc > 1) {
+        auto mesh = triangle_mesh::load_obj(argv[1]);
+        if (mesh) {
+            // 缩放到最长边为 1.5，底面中心放到原点
+            aabb box = mesh->bounding_box();
+            double extent = std::fmax(box.x.size(), std::fmax(box.y.size(), box.z.size()));
+            point3 base(0.5*(box.x.min + box.x.max), box.y.min, 0.5*(box.z.min + box.z.max));
+            auto fit = transform::scale(1.5 / extent) * transform::translate(-base);
+
+            shared_ptr<material> mesh_materials[] = {
+                make_shared<lambertian>(color(0.8, 0.3, 0.2)),
+                make_shared<metal>(color(0.8, 0.8, 0.9), 0.05),
+                make_shared<lambertian>(color(0.2, 0.5, 0.8)),
+            };
+            for (int i = 0; i < 5; i++) {
+                auto place = transform::translate(point3(-6 + 3*i, 0, 2.4 - 0.6*i))
+                           * transform::rotate(vec3(0,1,0), 60 - 30*i) * fit;
+                world.add(make_shared<instance>(mesh, place, mesh_materials[i % 3]));
             }
+            std::clog << argv[1] << ": " << mesh->triangle_count() << " triangles, "
+                      << mesh->memory_bytes() / 1024 << " KiB shared by 5 instances\n";
         }
     }
 
-    auto material1 = make_shared<dielectric>(1.5);
-    world.add(make_shared<sphere>(point3(0, 1, 0), 1.0, material1));
-
-    auto material2 = make_shared<lambertian>(color(0.4, 0.2, 0.1));
-    world.add(make_shared<sphere>(point3(-4, 1, 0), 1.0, material2));
+    // 用 BVH 代替逐个物体求交；其中的 instance 各自带有网格的 BLAS，合起来是两级 BVH
+    world = hittable_list(make_shared<bvh>(world));
 
-    auto material3 = make_shared<metal>(color(0.7, 0.6, 0.5), 0.0);
-    world.add(make_shared<sphere>(point3(4, 1, 0), 1.0, material3));
-
-    
-    camera cam;
-
-    cam.aspect_ratio      = 16.0 / 9.0;
     cam.image_width       = 600;
     cam.samples_per_pixel = 50;
     cam.max_depth         = 50;
 
-    cam.vfov     = 20;
-    cam.lookfrom = point3(13,2,3);
-    cam.lookat   = point3(0,0,0);
-    cam.vup      = vec3(0,1,0);
-
-    cam.defocus_angle = 0.6;
-    cam.focus_dist    = 10.0;
-
     cam.render(world);
 }
\ No newline at end of file
@@ -3,8 +3,8 @@
 #include <algorithm>
 #include <glm/glm.hpp>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#define FAST_OBJ_LOADER_IMPLEMENTATION
+#include "fast_obj_loader.h"
 
 static glm::vec3 safeNormalize(const glm::vec3& v) {
     float len = glm::length(v);
@@ -28,35 +28,27 @@ static void computeNormals(std::vector<VertexPN>& vertices, const std::vector<ui
 bool loadOBJ_PN_Fast(const std::string& path, std::vector<VertexPN>& outVerts, std::vector<uint32_t>& outIdx) {
     std::cout << "▶ Load OBJ: " << path << "\n";
 
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    // positions only: normals are recomputed below, texcoords are unused
+    fastobj::load_options_t options;
+    fastobj::weld_options_t weld;
+    weld.texcoords = false;
+    weld.normals = false;
+    fastobj::indexed_mesh_t mesh;
+    std::string err;
 
-    bool ok = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), nullptr, true);
-    if (!warn.empty()) std::cout << "⚠ " << warn << "\n";
+    bool ok = fastobj::LoadIndexedObj(&mesh, &err, path.c_str(), options, weld);
     if (!err.empty())  std::cerr << "❌ " << err << "\n";
     if (!ok) return false;
 
-    size_t vCount = attrib.vertices.size() / 3;
-    std::cout << "  v=" << vCount << " shapes=" << shapes.size() << "\n";
+    size_t vCount = mesh.num_vertices();
+    std::cout << "  v=" << vCount << " groups=" << mesh.groups.size() << "\n";
 
     outVerts.assign(vCount, VertexPN{});
     for (size_t i = 0; i < vCount; i++) {
-        outVerts[i].pos = glm::vec3(attrib.vertices[3 * i + 0], attrib.vertices[3 * i + 1], attrib.vertices[3 * i + 2]);
+        outVerts[i].pos = glm::vec3(mesh.vertices[3 * i + 0], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
         outVerts[i].nrm = glm::vec3(0);
     }
-
-    size_t totalIdx = 0;
-    for (auto& s : shapes) totalIdx += s.mesh.indices.size();
-    outIdx.clear();
-    outIdx.reserve(totalIdx);
-
-    for (auto& s : shapes) {
-        for (auto& id : s.mesh.indices) {
-            if (id.vertex_index >= 0) outIdx.push_back((uint32_t)id.vertex_index);
-        }
-    }
+    outIdx.swap(mesh.indices);
 
     computeNormals(outVerts, outIdx);
     std::cout << "  verts=" << outVerts.size() << " idx=" << outIdx.size() << "\n";
@@ -58,22 +58,105 @@ bool Shader::loadFromFiles(const std::string& vsPath, const std::string& fsPath)
     unsigned int vs = compile(GL_VERTEX_SHADER, vsCode.c_str());
     unsigned int fs = compile(GL_FRAGMENT_SHADER, fsCode.c_str());
     id = link(vs, fs);
+    if (id) reflectUniforms();
     return id != 0;
 }
 
+void Shader::reflectUniforms() {
+    uniforms.clear();
+    int count = 0, maxLen = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+    std::string buf(maxLen > 0 ? maxLen : 1, '\0');
+
+    for (int i = 0; i < count; i++) {
+        GLsizei len = 0;
+        GLint arraySize = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id, (GLuint)i, (GLsizei)buf.size(), &len, &arraySize, &type, &buf[0]);
+        std::string name(buf.data(), len);
+
+        int loc = glGetUniformLocation(id, name.c_str());
+        if (loc < 0) continue; // member of a uniform block
+        uniforms[name] = loc;
+
+        // arrays are reported as "name[0]": also register "name" and every element
+        size_t bracket = name.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            std::string base = name.substr(0, bracket);
+            uniforms[base] = loc;
+            for (int e = 1; e < arraySize; e++) {
+                std::string elem = base + "[" + std::to_string(e) + "]";
+                uniforms[elem] = glGetUniformLocation(id, elem.c_str());
+            }
+        }
+    }
+}
+
+int Shader::uniform(const std::string& name) const {
+    auto it = uniforms.find(name);
+    return it == uniforms.end() ? -1 : it->second;
+}
+
+bool Shader::bindUniformBlock(const char* blockName, unsigned int binding) const {
+    GLuint index = glGetUniformBlockIndex(id, blockName);
+    if (index == GL_INVALID_INDEX) {
+        std::cerr << "❌ Uniform block not found: " << blockName << "\n";
+        return false;
+    }
+    glUniformBlockBinding(id, index, binding);
+    return true;
+}
+
 void Shader::use() const {
     glUseProgram(id);
 }
 
+void Shader::setMat4(int loc, const glm::mat4& m) const {
+    glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
+}
+void Shader::setVec3(int loc, const glm::vec3& v) const {
+    glUniform3fv(loc, 1, &v[0]);
+}
+void Shader::setFloat(int loc, float f) const {
+    glUniform1f(loc, f);
+}
+void Shader::setInt(int loc, int v) const {
+    glUniform1i(loc, v);
+}
+
 void Shader::setMat4(const char* name, const glm::mat4& m) const {
-    glUniformMatrix4fv(glGetUniformLocation(id, name), 1, GL_FALSE, &m[0][0]);
+    setMat4(uniform(name), m);
 }
 void Shader::setVec3(const char* name, const glm::vec3& v) const {
-    glUniform3fv(glGetUniformLocation(id, name), 1, &v[0]);
+    setVec3(uniform(name), v);
 }
 void Shader::setFloat(const char* name, float f) const {
-    glUniform1f(glGetUniformLocation(id, name), f);
+    setFloat(uniform(name), f);
 }
 void Shader::setInt(const char* name, int v) const {
-    glUniform1i(glGetUniformLocation(id, name), v);
+    setInt(uniform(name), v);
+}
+
+// -------------------- UniformBuffer --------------------
+bool UniformBuffer::create(size_t bytes, unsigned int bindingPoint) {
+    size = bytes;
+    binding = bindingPoint;
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)bytes, nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    return ubo != 0;
+}
+
+void UniformBuffer::update(const void* data, size_t bytes) const {
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, (GLsizeiptr)bytes, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::destroy() {
+    if (ubo) glDeleteBuffers(1, &ubo);
+    ubo = 0;
 }
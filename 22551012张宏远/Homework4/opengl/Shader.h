@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
 class Shader {
@@ -12,13 +13,42 @@ public:
 
     void use() const;
 
+    // Location of an active uniform, resolved once after linking (-1 if inactive).
+    // Resolve these at load time and keep the ints; the name setters below only
+    // do a hash lookup, but per-frame code should not build names at all.
+    int uniform(const std::string& name) const;
+
+    // Binds a std140 uniform block to a UniformBuffer binding point.
+    bool bindUniformBlock(const char* blockName, unsigned int binding) const;
+
+    void setMat4(int loc, const glm::mat4& m) const;
+    void setVec3(int loc, const glm::vec3& v) const;
+    void setFloat(int loc, float f) const;
+    void setInt(int loc, int v) const;
+
     void setMat4(const char* name, const glm::mat4& m) const;
     void setVec3(const char* name, const glm::vec3& v) const;
     void setFloat(const char* name, float f) const;
     void setInt(const char* name, int v) const;
 
 private:
+    std::unordered_map<std::string, int> uniforms;
+
+    void reflectUniforms();
     static std::string readTextFile(const std::string& path);
     static unsigned int compile(unsigned int type, const char* src);
     static unsigned int link(unsigned int vs, unsigned int fs);
 };
+
+// A uniform buffer object bound to a fixed binding point.
+// Fill a std140-laid-out struct on the CPU and upload it with one update() per frame.
+class UniformBuffer {
+public:
+    unsigned int ubo = 0;
+    unsigned int binding = 0;
+    size_t size = 0;
+
+    bool create(size_t bytes, unsigned int bindingPoint);
+    void update(const void* data, size_t bytes) const;
+    void destroy();
+};
@@ -117,6 +117,43 @@ static void buildSpherePN(int stacks, int slices,
     }
 }
 
+// -------------------- uniform blocks --------------------
+// std140 mirrors of the Lights / Material blocks in mesh.frag
+const int MAX_POINT_LIGHTS = 8;
+const unsigned int LIGHTS_BINDING = 0;
+const unsigned int MATERIAL_BINDING = 1;
+
+struct DirLightStd140 {
+    glm::vec3 dir;
+    float intensity;
+    glm::vec3 color;
+    float pad;
+};
+
+struct PointLightStd140 {
+    glm::vec3 pos;
+    float intensity;
+    glm::vec3 color;
+    float a, b, c;
+    float pad[2];
+};
+
+struct LightsStd140 {
+    DirLightStd140 dir;
+    PointLightStd140 points[MAX_POINT_LIGHTS];
+    int pointCount;
+    int pad[3];
+};
+
+struct MaterialStd140 {
+    glm::vec3 albedo;
+    float shininess;
+};
+
+static_assert(sizeof(DirLightStd140) == 32, "std140 DirLight is 32 bytes");
+static_assert(sizeof(PointLightStd140) == 48, "std140 PointLight stride is 48 bytes");
+static_assert(sizeof(MaterialStd140) == 16, "std140 Material is 16 bytes");
+
 // -------------------- input / camera --------------------
 struct InputState {
     bool lmb = false, rmb = false;
@@ -262,6 +299,34 @@ int main() {
     if (!meshSh.loadFromFiles("mesh.vert", "mesh.frag")) return -1;
     if (!lightSh.loadFromFiles("light.vert", "light.frag")) return -1;
 
+    // uniform locations are resolved once here instead of every frame
+    const int skyTime = skySh.uniform("uTime");
+    const int floorView = floorSh.uniform("uView");
+    const int floorProj = floorSh.uniform("uProj");
+    const int floorShowGrid = floorSh.uniform("uShowGrid");
+    const int meshModel = meshSh.uniform("uModel");
+    const int meshView = meshSh.uniform("uView");
+    const int meshProj = meshSh.uniform("uProj");
+    const int meshCamPos = meshSh.uniform("uCamPos");
+    const int meshExposure = meshSh.uniform("uExposure");
+    const int lightView = lightSh.uniform("uView");
+    const int lightProj = lightSh.uniform("uProj");
+    const int lightModel = lightSh.uniform("uModel");
+    const int lightColor = lightSh.uniform("uColor");
+    const int lightBoost = lightSh.uniform("uBoost");
+
+    // lights and material live in std140 uniform buffers
+    meshSh.bindUniformBlock("Lights", LIGHTS_BINDING);
+    meshSh.bindUniformBlock("Material", MATERIAL_BINDING);
+
+    UniformBuffer lightsUbo, materialUbo;
+    lightsUbo.create(sizeof(LightsStd140), LIGHTS_BINDING);
+    materialUbo.create(sizeof(MaterialStd140), MATERIAL_BINDING);
+
+    MaterialStd140 material = { glm::vec3(0.80f, 0.80f, 0.86f), 64.0f };
+    materialUbo.update(&material, sizeof(material));
+    LightsStd140 lights = {};
+
     // ---------------- Fullscreen quad for sky ----------------
     GLuint skyVAO = 0, skyVBO = 0;
     float skyVerts[] = {
@@ -350,14 +415,14 @@ int main() {
         // ---------------- Draw sky background ----------------
         glDisable(GL_DEPTH_TEST);
         skySh.use();
-        skySh.setFloat("uTime", (float)animTime);
+        skySh.setFloat(skyTime, (float)animTime);
         glBindVertexArray(skyVAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
         glEnable(GL_DEPTH_TEST);
 
         // ---------------- Animate point lights ----------------
-        const int MAXP = 6; // <= 8
+        const int MAXP = 6; // <= MAX_POINT_LIGHTS
         glm::vec3 pointPos[MAXP];
         glm::vec3 pointCol[MAXP];
         float pointIntensity[MAXP];
@@ -392,9 +457,9 @@ int main() {
         // ---------------- Draw floor (double-sided) ----------------
         glDisable(GL_CULL_FACE);
         floorSh.use();
-        floorSh.setMat4("uView", view);
-        floorSh.setMat4("uProj", proj);
-        floorSh.setInt("uShowGrid", g_in.showGrid ? 1 : 0);
+        floorSh.setMat4(floorView, view);
+        floorSh.setMat4(floorProj, proj);
+        floorSh.setInt(floorShowGrid, g_in.showGrid ? 1 : 0);
         floorMesh.draw();
         glEnable(GL_CULL_FACE);
 
@@ -405,53 +470,49 @@ int main() {
         }
 
         meshSh.use();
-        meshSh.setMat4("uModel", model);
-        meshSh.setMat4("uView", view);
-        meshSh.setMat4("uProj", proj);
-        meshSh.setVec3("uCamPos", camPos);
-
-        // material
-        meshSh.setVec3("uAlbedo", glm::vec3(0.80f, 0.80f, 0.86f));
-        meshSh.setFloat("uShininess", 64.0f);
-
-        // directional
-        meshSh.setVec3("uDir.dir", dirDir);
-        meshSh.setVec3("uDir.color", glm::vec3(1, 1, 1));
-        meshSh.setFloat("uDir.intensity", 0.18f);
+        meshSh.setMat4(meshModel, model);
+        meshSh.setMat4(meshView, view);
+        meshSh.setMat4(meshProj, proj);
+        meshSh.setVec3(meshCamPos, camPos);
 
         // exposure (mesh.frag needs this uniform if you applied tone mapping)
-        // If your mesh.frag doesn't have uExposure, you can comment this line.
-        meshSh.setFloat("uExposure", 0.50f);
+        // If your mesh.frag doesn't have uExposure, the location is -1 and the call is ignored.
+        meshSh.setFloat(meshExposure, 0.50f);
+
+        // directional + point lights, uploaded in one call
+        lights.dir.dir = dirDir;
+        lights.dir.color = glm::vec3(1, 1, 1);
+        lights.dir.intensity = 0.18f;
 
-        // point light uniforms
-        meshSh.setInt("uPointCount", MAXP);
+        lights.pointCount = MAXP;
         for (int i = 0; i < MAXP; i++) {
-            std::string base = "uPoints[" + std::to_string(i) + "].";
-            meshSh.setVec3((base + "pos").c_str(), pointPos[i]);
-            meshSh.setVec3((base + "color").c_str(), pointCol[i]);
-            meshSh.setFloat((base + "intensity").c_str(), pointIntensity[i]);
-
-            meshSh.setFloat((base + "a").c_str(), 1.0f);
-            meshSh.setFloat((base + "b").c_str(), 0.10f);
-            meshSh.setFloat((base + "c").c_str(), 0.02f);
+            PointLightStd140& pl = lights.points[i];
+            pl.pos = pointPos[i];
+            pl.color = pointCol[i];
+            pl.intensity = pointIntensity[i];
+
+            pl.a = 1.0f;
+            pl.b = 0.10f;
+            pl.c = 0.02f;
         }
+        lightsUbo.update(&lights, sizeof(lights));
 
         modelMesh.draw();
 
         // ---------------- Draw point light balls ----------------
         glDisable(GL_CULL_FACE);
         lightSh.use();
-        lightSh.setMat4("uView", view);
-        lightSh.setMat4("uProj", proj);
+        lightSh.setMat4(lightView, view);
+        lightSh.setMat4(lightProj, proj);
 
         for (int i = 0; i < MAXP; i++) {
             glm::mat4 lm(1.0f);
             lm = glm::translate(lm, pointPos[i]);
             lm = glm::scale(lm, glm::vec3(0.10f)); // size
 
-            lightSh.setMat4("uModel", lm);
-            lightSh.setVec3("uColor", pointCol[i]);
-            lightSh.setFloat("uBoost", 5.0f); // brighter
+            lightSh.setMat4(lightModel, lm);
+            lightSh.setVec3(lightColor, pointCol[i]);
+            lightSh.setFloat(lightBoost, 5.0f); // brighter
 
             lightBallMesh.draw();
         }
@@ -472,6 +533,8 @@ int main() {
     modelMesh.destroy();
     floorMesh.destroy();
     lightBallMesh.destroy();
+    lightsUbo.destroy();
+    materialUbo.destroy();
 
     glDeleteBuffers(1, &skyVBO);
     glDeleteVertexArrays(1, &skyVAO);
@@ -3,29 +3,36 @@ in vec3 vPosWS;
 in vec3 vNrmWS;
 out vec4 FragColor;
 
+// 字段顺序按 std140 排过：vec3 后面紧跟一个 float，和 main.cpp 里的 C++ 结构体逐字节对应
 struct DirLight {
     vec3 dir;
-    vec3 color;
     float intensity;
+    vec3 color;
 };
 
 struct PointLight {
     vec3 pos;
-    vec3 color;
     float intensity;
+    vec3 color;
     float a;
     float b;
     float c;
 };
 
-uniform vec3 uCamPos;
-uniform DirLight uDir;
+// 每帧一次 glBufferSubData 上传（binding 0）
+layout(std140) uniform Lights {
+    DirLight uDir;
+    PointLight uPoints[8];
+    int uPointCount;
+};
 
-uniform int uPointCount;
-uniform PointLight uPoints[8];
+// binding 1
+layout(std140) uniform Material {
+    vec3 uAlbedo;
+    float uShininess;
+};
 
-uniform vec3 uAlbedo;
-uniform float uShininess;
+uniform vec3 uCamPos;
 
 // ✅ 新增：曝光控制
 uniform float uExposure;
@@ -11,6 +11,7 @@
 #include <learnopengl/filesystem.h>
 #include <learnopengl/model.h>
 #include <learnopengl/shader_m.h>
+#include <learnopengl/entity.h>
 
 #include <car_game/car.h>
 #include <car_game/fixed_camera.h>
@@ -33,11 +34,9 @@ void updateFixedCamera();
 void applyCarVelocity();
 
 void renderLight(Shader& shader, const glm::vec3& viewPos);
-void renderCarAndCamera(Model& carModel, Model& cameraModel, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
-void renderCar(Model& model, glm::mat4 modelMatrix, Shader& shader);
-void renderCamera(Model& model, glm::mat4 modelMatrix, Shader& shader);
-void renderStopSign(Model& model, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
-void renderRaceTrack(Model& model, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
+void updateCarTransforms(Entity& carRig, Entity& carEntity, Entity& cameraEntity);
+void renderScene(Entity& scene, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
+void renderScene(Entity& scene, EntityCuller& culler, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
 void renderSkyBox(Shader& shader);
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -204,6 +203,31 @@ int main()
     Model raceTrackModel("resources/objects/race-track/race-track.obj");
     // STOP牌模型
     Model stopSignModel("resources/objects/StopSign/StopSign.obj");
+
+    // ---------------------------------
+    // 场景图（层级建模）
+    // ---------------------------------
+
+    // scene
+    //  |- 赛道
+    //  |- STOP牌
+    //  |- 车辆节点（车的位置和一半的延迟转向，没有模型）
+    //      |- 汽车
+    //      |- 相机模型
+    Entity scene;
+    scene.addChild(raceTrackModel);
+    Entity& stopSign = scene.addChild(stopSignModel);
+    stopSign.transform.setLocalPosition(glm::vec3(3.0f, 1.5f, -4.0f));
+    stopSign.transform.setLocalRotation(glm::vec3(0.0f, -120.0f, 0.0f));
+
+    Entity& carRig = scene.addChild();
+    Entity& carEntity = carRig.addChild(carModel);
+    carEntity.transform.setLocalScale(glm::vec3(0.004f)); // 调整模型大小
+    Entity& cameraEntity = carRig.addChild(cameraModel);
+    cameraEntity.transform.setLocalScale(glm::vec3(0.01f));
+
+    // 主视角按相机视锥剔除场景图
+    EntityCuller sceneCuller;
     // ---------------------------------
     // shader 纹理配置
     // ---------------------------------
@@ -263,9 +287,8 @@ int main()
         glClear(GL_DEPTH_BUFFER_BIT);
         glm::mat4 depthPassView = glm::mat4(1.0f);
         glm::mat4 depthPassProj = glm::mat4(1.0f);
-        renderCarAndCamera(carModel, cameraModel, depthShader, depthPassView, depthPassProj);
-        renderRaceTrack(raceTrackModel, depthShader, depthPassView, depthPassProj);
-        renderStopSign(stopSignModel, depthShader, depthPassView, depthPassProj);
+        updateCarTransforms(carRig, carEntity, cameraEntity);
+        renderScene(scene, depthShader, depthPassView, depthPassProj);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         // 复原视口
@@ -292,14 +315,9 @@ int main()
         glm::mat4 mainViewMatrix = camera.GetViewMatrix();
         glm::mat4 mainProjMatrix = camera.GetProjMatrix((float)SCR_WIDTH / (float)SCR_HEIGHT);
 
-        // 使用shader渲染car和Camera（层级模型）
-        renderCarAndCamera(carModel, cameraModel, shader, mainViewMatrix, mainProjMatrix);
-
-        // 渲染Stop牌
-        renderStopSign(stopSignModel, shader, mainViewMatrix, mainProjMatrix);
-
-        // 渲染赛道
-        renderRaceTrack(raceTrackModel, shader, mainViewMatrix, mainProjMatrix);
+        // 使用shader渲染场景图：赛道、Stop牌、car和Camera（层级模型）
+        updateCarTransforms(carRig, carEntity, cameraEntity);
+        renderScene(scene, sceneCuller, shader, mainViewMatrix, mainProjMatrix);
 
         // --------------
         // 最后再渲染天空盒
@@ -332,9 +350,7 @@ int main()
 
             shader.use();
             renderLight(shader, miniMapPos);
-            renderCarAndCamera(carModel, cameraModel, shader, miniViewMatrix, miniProjMatrix);
-            renderStopSign(stopSignModel, shader, miniViewMatrix, miniProjMatrix);
-            renderRaceTrack(raceTrackModel, shader, miniViewMatrix, miniProjMatrix);
+            renderScene(scene, shader, miniViewMatrix, miniProjMatrix);
 
             glDisable(GL_SCISSOR_TEST);
             glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
@@ -500,77 +516,40 @@ void renderLight(Shader& shader, const glm::vec3& viewPos)
     glBindTexture(GL_TEXTURE_2D, depthMap);
 }
 
-void renderCarAndCamera(Model& carModel, Model& cameraModel, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix)
+// 由车辆状态设置场景图中车辆节点、汽车和相机模型的局部变换，世界矩阵在绘制前由层级统一更新
+void updateCarTransforms(Entity& carRig, Entity& carEntity, Entity& cameraEntity)
 {
-    shader.setMat4("view", viewMatrix);
-    shader.setMat4("projection", projMatrix);
-
-    // -------
-    // 层级建模
-
-    // 模型转换
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
-    modelMatrix = glm::translate(modelMatrix, car.getMidValPosition());
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(car.getDelayYaw() / 2), WORLD_UP);
-
-    // 渲染汽车
-    renderCar(carModel, modelMatrix, shader);
-
-    // 由于mat4作函数参数时为值传递，故不需要备份modelMatrix
-
-    // 渲染相机
-    renderCamera(cameraModel, modelMatrix, shader);
-}
-
-// 渲染汽车
-void renderCar(Model& model, glm::mat4 modelMatrix, Shader& shader)
-{
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(car.getYaw() - car.getDelayYaw() / 2), WORLD_UP);
-    // 抵消模型原本自带的旋转
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(-90.0f), WORLD_UP);
-    // 调整模型大小
-    modelMatrix = glm::scale(modelMatrix, glm::vec3(0.004f, 0.004f, 0.004f));
-
-    // 应用变换矩阵
-    shader.setMat4("model", modelMatrix);
-
-    model.Draw(shader);
-}
-
-void renderCamera(Model& model, glm::mat4 modelMatrix, Shader& shader)
-{
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(fixedCamera.getYaw() + car.getYaw() / 2), WORLD_UP);
-    modelMatrix = glm::translate(modelMatrix, cameraPos);
-    modelMatrix = glm::scale(modelMatrix, glm::vec3(0.01f, 0.01f, 0.01f));
-
-    // 应用变换矩阵
-    shader.setMat4("model", modelMatrix);
-
-    model.Draw(shader);
+    // 车辆节点：平移到车的位置，先转过一半的延迟转向
+    carRig.transform.setLocalPosition(car.getMidValPosition());
+    carRig.transform.setLocalRotation(glm::vec3(0.0f, car.getDelayYaw() / 2, 0.0f));
+
+    // 汽车：转过剩余的角度，并抵消模型原本自带的旋转（-90度）
+    carEntity.transform.setLocalRotation(glm::vec3(0.0f, car.getYaw() - car.getDelayYaw() / 2 - 90.0f, 0.0f));
+
+    // 相机模型：先旋转再平移到cameraPos，所以局部位置是旋转后的cameraPos
+    float cameraYaw = fixedCamera.getYaw() + car.getYaw() / 2;
+    glm::mat4 rotateMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(cameraYaw), WORLD_UP);
+    cameraEntity.transform.setLocalPosition(glm::vec3(rotateMatrix * glm::vec4(cameraPos, 1.0f)));
+    cameraEntity.transform.setLocalRotation(glm::vec3(0.0f, cameraYaw, 0.0f));
 }
 
-void renderStopSign(Model& model, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix)
+// 渲染整个场景图（深度图、小地图这类没有透视相机的视角）
+void renderScene(Entity& scene, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix)
 {
     shader.setMat4("view", viewMatrix);
-    // 模型转换
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
-    modelMatrix = glm::translate(modelMatrix, glm::vec3(3.0f, 1.5f, -4.0f));
-    modelMatrix = glm::rotate(modelMatrix, glm::radians(-120.0f), WORLD_UP);
-    shader.setMat4("model", modelMatrix);
     shader.setMat4("projection", projMatrix);
 
-    model.Draw(shader);
+    scene.drawSelfAndChild(shader);
 }
 
-void renderRaceTrack(Model& model, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix)
+// 渲染场景图中位于主相机视锥内的物体
+void renderScene(Entity& scene, EntityCuller& culler, Shader& shader, const glm::mat4& viewMatrix, const glm::mat4& projMatrix)
 {
     shader.setMat4("view", viewMatrix);
-    // 模型转换
-    glm::mat4 modelMatrix = glm::mat4(1.0f);
-    shader.setMat4("model", modelMatrix);
     shader.setMat4("projection", projMatrix);
 
-    model.Draw(shader);
+    Frustum frustum = createFrustumFromCamera(camera, (float)SCR_WIDTH / (float)SCR_HEIGHT, glm::radians(camera.Zoom), 0.1f, STADIA);
+    scene.drawSelfAndChild(frustum, shader, culler);
 }
 
 void renderSkyBox(Shader& shader)
@@ -9,8 +9,12 @@
 #include "learnopengl/camera.h"
 #include "learnopengl/model.h"
 #include "learnopengl/filesystem.h"
+#include "learnopengl/nbody.h"
 
 #include <iostream>
+#include <random>
+#include <chrono>
+#include <string>
 
 
 // ======================= settings =======================
@@ -34,11 +38,32 @@ glm::vec3 lightPos(0.0f, 0.0f, 0.0f);
 const float R_earthOrbit = 10.0f; // 半径
 const float W_earthOrbit = 0.1f; // 角速度
 const float R_moonOrbit = 1.0f;
-const float W_moonOrbit = 10.0f;
 const float Scale_earth = 1.0f; // 缩放
 const float Scale_moon = 0.15f;
 const float Scale_sun = 2.0f;
 
+// ======================= 引力模拟 =======================
+// 取 G = 1，太阳质量由地球轨道的半径和角速度反推（圆轨道 GM = w^2 r^3）
+const double Mass_sun = (double)W_earthOrbit * W_earthOrbit * R_earthOrbit * R_earthOrbit * R_earthOrbit;
+// 地球质量要让月球轨道留在地球的希尔球（约 R * (m / 3M)^(1/3)）之内
+const double Mass_earth = 0.05 * Mass_sun;
+const double Mass_moon = 0.01 * Mass_earth;
+// 小行星是试验粒子：只受引力、不产生引力（总质量本来就可以忽略），每步只需对三个有质量的天体求和
+const double Mass_asteroid = 0.0;
+const int Num_asteroids = 2000;
+// 小行星带要离地球够远：地球质量较大，轨道附近的混沌区约为 r * 1.3 (m / M)^(2/7)，内侧到 r = 4.5 左右，
+// 放在 5~7 时大量小行星会被甩出小行星带
+const float R_beltInner = 3.0f;
+const float R_beltOuter = 4.0f;
+const double Physics_step = 1.0 / 120.0; // 固定步长，与帧率无关
+
+enum BodyIndex { BODY_SUN = 0, BODY_EARTH = 1, BODY_MOON = 2, BODY_FIRST_ASTEROID = 3 };
+
+// ======================= 无窗口检查（solar_system --check） =======================
+const double Check_duration = 300.0;        // 模拟时长（秒）
+const double Check_maxEnergyDrift = 1e-6;   // 相对能量误差上限
+const double Check_maxStepShare = 0.25;     // 一步的计算时间最多占步长的 1/4，其余留给渲染
+
 // ======================= callbacks ======================
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -165,8 +190,137 @@ void drawOrbit(Shader& shader, const glm::mat4& projection, const glm::mat4& vie
 
 
 
-int main()
+// ======================= 引力系统的初始化 =======================
+// 初始速度取相对中心天体的圆轨道速度 v = sqrt(G(M + m) / r)
+void setupBodies(NBodySystem& bodies)
+{
+    const double vEarth = std::sqrt((Mass_sun + Mass_earth) / R_earthOrbit);
+    const double vMoon = std::sqrt((Mass_earth + Mass_moon) / R_moonOrbit);
+    bodies.addBody(glm::dvec3(0.0), glm::dvec3(0.0), Mass_sun);
+    bodies.addBody(glm::dvec3(R_earthOrbit, 0.0, 0.0), glm::dvec3(0.0, 0.0, vEarth), Mass_earth);
+    bodies.addBody(glm::dvec3(R_earthOrbit + R_moonOrbit, 0.0, 0.0), glm::dvec3(0.0, 0.0, vEarth + vMoon), Mass_moon);
+
+    // 小行星带：半径和相位随机，带一点倾角，固定种子保证每次运行一致
+    std::mt19937 rng(2025);
+    std::uniform_real_distribution<double> radius(R_beltInner, R_beltOuter);
+    std::uniform_real_distribution<double> phase(0.0, 2.0 * 3.14159265358979);
+    std::uniform_real_distribution<double> height(-0.1, 0.1);
+    for (int i = 0; i < Num_asteroids; i++)
+    {
+        double r = radius(rng), theta = phase(rng);
+        double v = std::sqrt(Mass_sun / r);
+        // 与地球同向公转（x -> z）
+        bodies.addBody(glm::dvec3(r * cos(theta), height(rng), r * sin(theta)),
+            glm::dvec3(-v * sin(theta), 0.0, v * cos(theta)), Mass_asteroid);
+    }
+
+    // 质心放在原点并保持静止，否则整个系统会慢慢漂走
+    bodies.moveToCenterOfMassFrame();
+}
+
+// 不开窗口，按渲染时的固定步长把完整场景推进 Check_duration 秒，检查能量守恒、小行星带是否散开和每步耗时
+// 小行星没有质量，能量只包含太阳、地球和月球；小行星的积分是否正常由是否留在带内来判断
+int runCheck()
+{
+    NBodySystem bodies;
+    setupBodies(bodies);
+
+    const double initialEnergy = bodies.totalEnergy();
+    const int steps = (int)(Check_duration / Physics_step + 0.5);
+    const int stepsPerSecond = (int)(1.0 / Physics_step + 0.5);
+    double maxDrift = 0.0;
+    double stepSeconds = 0.0;
+    for (int i = 0; i < steps; i++)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        bodies.step(Physics_step);
+        stepSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        // 每模拟一秒测一次能量（势能是 O(N^2)，不计入耗时）
+        if ((i + 1) % stepsPerSecond == 0)
+            maxDrift = std::max(maxDrift, std::abs((bodies.totalEnergy() - initialEnergy) / initialEnergy));
+    }
+
+    // 相对太阳的轨道半径留在小行星带附近（留 10% 余量），高度不超过 0.5
+    int escaped = 0;
+    glm::dvec3 sun = bodies.getPosition(BODY_SUN);
+    for (int i = 0; i < Num_asteroids; i++)
+    {
+        glm::dvec3 d = bodies.getPosition(BODY_FIRST_ASTEROID + i) - sun;
+        double r = std::sqrt(d.x * d.x + d.z * d.z);
+        if (r < 0.9 * R_beltInner || r > 1.1 * R_beltOuter || std::abs(d.y) > 0.5)
+            escaped++;
+    }
+
+    const double msPerStep = stepSeconds * 1000.0 / steps;
+    const double msBudget = Check_maxStepShare * Physics_step * 1000.0;
+    std::cout << "bodies: " << bodies.size() << ", simulated " << Check_duration << " s in " << steps << " steps\n";
+    std::cout << "max relative energy drift: " << maxDrift << " (limit " << Check_maxEnergyDrift << ")\n";
+    std::cout << "asteroids outside the belt: " << escaped << " / " << Num_asteroids << "\n";
+    std::cout << "step time: " << msPerStep << " ms (limit " << msBudget << " ms)\n";
+
+    const bool ok = maxDrift <= Check_maxEnergyDrift && escaped == 0 && msPerStep <= msBudget;
+    std::cout << (ok ? "check passed" : "check FAILED") << "\n";
+    return ok ? 0 : 1;
+}
+
+// ======================= 小行星带的绘制 =======================
+unsigned int beltVAO, beltVBO;
+std::vector<float> beltVertices; // 每个点有位置和颜色，每帧更新位置
+
+void setupBelt()
+{
+    beltVertices.assign(Num_asteroids * 6, 0.6f); // 灰色
+
+    glGenVertexArrays(1, &beltVAO);
+    glGenBuffers(1, &beltVBO);
+
+    glBindVertexArray(beltVAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, beltVBO);
+    glBufferData(GL_ARRAY_BUFFER, beltVertices.size() * sizeof(float), beltVertices.data(), GL_DYNAMIC_DRAW);
+
+    // 位置属性
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    // 颜色属性
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+}
+
+void drawBelt(Shader& shader, const glm::mat4& projection, const glm::mat4& view,
+    const NBodySystem& bodies, const FixedStepper& stepper)
+{
+    for (int i = 0; i < Num_asteroids; i++)
+    {
+        glm::vec3 p = glm::vec3(stepper.getPosition(bodies, BODY_FIRST_ASTEROID + i));
+        beltVertices[i * 6 + 0] = p.x;
+        beltVertices[i * 6 + 1] = p.y;
+        beltVertices[i * 6 + 2] = p.z;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, beltVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, beltVertices.size() * sizeof(float), beltVertices.data());
+
+    shader.use();
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+    shader.setMat4("model", glm::mat4(1.0f));
+
+    glBindVertexArray(beltVAO);
+    glDrawArrays(GL_POINTS, 0, Num_asteroids);
+    glBindVertexArray(0);
+}
+
+
+
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::string(argv[1]) == "--check")
+        return runCheck();
+
     // glfw
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -238,6 +392,11 @@ int main()
     setupAxis();
     // 初始化地球公转轨道
     setupOrbit();
+    // 初始化引力系统和小行星带
+    NBodySystem bodies;
+    setupBodies(bodies);
+    FixedStepper stepper(Physics_step);
+    setupBelt();
 
     while (!glfwWindowShouldClose(window))
     {
@@ -254,6 +413,13 @@ int main()
 
         processInput(window);
 
+        // 物理按固定步长推进，渲染时在上一步和当前步之间插值
+        stepper.advance(bodies, deltaTime);
+        glm::vec3 sunPos = glm::vec3(stepper.getPosition(bodies, BODY_SUN));
+        glm::vec3 earthPos = glm::vec3(stepper.getPosition(bodies, BODY_EARTH));
+        glm::vec3 moonPos = glm::vec3(stepper.getPosition(bodies, BODY_MOON));
+        lightPos = sunPos;
+
         glClearColor(0.02f, 0.02f, 0.05f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -271,6 +437,7 @@ int main()
 
         drawAxis(defaultShader, projection, view); // 绘制坐标轴
         drawOrbit(defaultShader, projection, view); // 绘制地球公转轨道
+        drawBelt(defaultShader, projection, view, bodies, stepper); // 绘制小行星带
 
         // 设置Lightning Shader的uniforms
 
@@ -299,7 +466,7 @@ int main()
         
         // set model
         glm::mat4 sunModel = glm::mat4(1.0f);
-        //sunModel = glm::translate(sunModel, lightPos);
+        sunModel = glm::translate(sunModel, sunPos); // 太阳绕质心有微小的摆动
         sunModel = glm::scale(sunModel, glm::vec3(Scale_sun));
         //加个缓慢的自转
         float sunSelfRotateAngleSpeed = 0.05f; // 太阳自转角速度
@@ -321,10 +488,8 @@ int main()
         glm::mat4 earthModel = glm::mat4(1.0f);
         // earthModel = glm::rotate(earthModel, t * 0.5f, glm::vec3(0, 1, 0));
         // earthModel = glm::translate(earthModel, glm::vec3(3.0f, 0.0f, 0.0f));
-        // 改为使用三角函数计算每一时刻的位置，仅平移
-        float earthX = R_earthOrbit * cos(t * W_earthOrbit);
-        float earthZ = R_earthOrbit * sin(t * W_earthOrbit);
-        earthModel = glm::translate(earthModel, glm::vec3(earthX, 0.0f, earthZ));
+        // 位置来自引力模拟，仅平移
+        earthModel = glm::translate(earthModel, earthPos);
         earthModel = glm::scale(earthModel, glm::vec3(Scale_earth));
         //另外再加个地球自转
         float earthSelfRotateAngleSpeed = 2.0f; // 地球自转角速度
@@ -346,10 +511,8 @@ int main()
 
         // set model
         glm::mat4 moonModel = glm::mat4(1.0f);
-        // 改为使用三角函数计算相对地球的位置，仅平移
-        float moonX = R_moonOrbit * cos(t * W_moonOrbit);
-        float moonZ = R_moonOrbit * sin(t * W_moonOrbit);
-        moonModel = glm::translate(moonModel, glm::vec3(earthX + moonX, 0.0f, earthZ + moonZ));
+        // 位置来自引力模拟，仅平移
+        moonModel = glm::translate(moonModel, moonPos);
         moonModel = glm::scale(moonModel, glm::vec3(Scale_moon));
         lightingShader.setMat4("model", moonModel);
 
@@ -6,6 +6,9 @@
 #include <array> //std::array
 #include <memory> //std::unique_ptr
 
+#include <learnopengl/transform_hierarchy.h>
+#include <learnopengl/frustum_culling.h>
+
 class Transform
 {
 protected:
@@ -20,6 +23,10 @@ protected:
 	//Dirty flag
 	bool m_isDirty = true;
 
+	//When bound, the world matrix lives in the hierarchy and m_modelMatrix/m_isDirty are unused
+	TransformHierarchy* m_hierarchy = nullptr;
+	TransformHierarchy::Handle m_node = TransformHierarchy::invalidHandle;
+
 protected:
 	glm::mat4 getLocalModelMatrix()
 	{
@@ -33,8 +40,35 @@ protected:
 		// translation * rotation * scale (also know as TRS matrix)
 		return glm::translate(glm::mat4(1.0f), m_pos) * rotationMatrix * glm::scale(glm::mat4(1.0f), m_scale);
 	}
+
+	void localChanged()
+	{
+		if (m_hierarchy)
+			m_hierarchy->setLocalMatrix(m_node, getLocalModelMatrix());
+		else
+			m_isDirty = true;
+	}
+
 public:
 
+	//Stores this transform in a flat hierarchy node; the current local position, rotation and scale are kept
+	void bind(TransformHierarchy& hierarchy, TransformHierarchy::Handle node)
+	{
+		m_hierarchy = &hierarchy;
+		m_node = node;
+		m_hierarchy->setLocalMatrix(m_node, getLocalModelMatrix());
+	}
+
+	TransformHierarchy* getHierarchy() const
+	{
+		return m_hierarchy;
+	}
+
+	TransformHierarchy::Handle getNode() const
+	{
+		return m_node;
+	}
+
 	void computeModelMatrix()
 	{
 		m_modelMatrix = getLocalModelMatrix();
@@ -50,24 +84,24 @@ public:
 	void setLocalPosition(const glm::vec3& newPosition)
 	{
 		m_pos = newPosition;
-		m_isDirty = true;
+		localChanged();
 	}
 
 	void setLocalRotation(const glm::vec3& newRotation)
 	{
 		m_eulerRot = newRotation;
-		m_isDirty = true;
+		localChanged();
 	}
 
 	void setLocalScale(const glm::vec3& newScale)
 	{
 		m_scale = newScale;
-		m_isDirty = true;
+		localChanged();
 	}
 
-	const glm::vec3& getGlobalPosition() const
+	glm::vec3 getGlobalPosition() const
 	{
-		return m_modelMatrix[3];
+		return getModelMatrix()[3];
 	}
 
 	const glm::vec3& getLocalPosition() const
@@ -87,28 +121,28 @@ public:
 
 	const glm::mat4& getModelMatrix() const
 	{
-		return m_modelMatrix;
+		return m_hierarchy ? m_hierarchy->getWorldMatrix(m_node) : m_modelMatrix;
 	}
 
 	glm::vec3 getRight() const
 	{
-		return m_modelMatrix[0];
+		return getModelMatrix()[0];
 	}
 
 
 	glm::vec3 getUp() const
 	{
-		return m_modelMatrix[1];
+		return getModelMatrix()[1];
 	}
 
 	glm::vec3 getBackward() const
 	{
-		return m_modelMatrix[2];
+		return getModelMatrix()[2];
 	}
 
 	glm::vec3 getForward() const
 	{
-		return -m_modelMatrix[2];
+		return -getModelMatrix()[2];
 	}
 
 	glm::vec3 getGlobalScale() const
@@ -118,7 +152,7 @@ public:
 
 	bool isDirty() const
 	{
-		return m_isDirty;
+		return m_hierarchy ? m_hierarchy->isDirty(m_node) : m_isDirty;
 	}
 };
 
@@ -345,7 +379,7 @@ Frustum createFrustumFromCamera(const Camera& cam, float aspect, float fovY, flo
 AABB generateAABB(const Model& model)
 {
 	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
+	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::lowest());
 	for (auto&& mesh : model.meshes)
 	{
 		for (auto&& vertex : mesh.vertices)
@@ -365,7 +399,7 @@ AABB generateAABB(const Model& model)
 Sphere generateSphereBV(const Model& model)
 {
 	glm::vec3 minAABB = glm::vec3(std::numeric_limits<float>::max());
-	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
+	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::lowest());
 	for (auto&& mesh : model.meshes)
 	{
 		for (auto&& vertex : mesh.vertices)
@@ -383,6 +417,8 @@ Sphere generateSphereBV(const Model& model)
 	return Sphere((maxAABB + minAABB) * 0.5f, glm::length(minAABB - maxAABB));
 }
 
+class EntityCuller;
+
 class Entity
 {
 public:
@@ -392,14 +428,23 @@ public:
 
 	//Space information
 	Transform transform;
+	//Only the root entity owns the hierarchy; descendants are nodes in their root's hierarchy
+	std::unique_ptr<TransformHierarchy> hierarchy;
 
 	Model* pModel = nullptr;
 	std::unique_ptr<AABB> boundingVolume;
 
 
+	//Group node without a model: it is never drawn, but its transform applies to its children
+	Entity() : hierarchy{ std::make_unique<TransformHierarchy>() }
+	{
+		transform.bind(*hierarchy, hierarchy->create());
+	}
+
 	// constructor, expects a filepath to a 3D model.
-	Entity(Model& model) : pModel{ &model }
+	Entity(Model& model) : hierarchy{ std::make_unique<TransformHierarchy>() }, pModel{ &model }
 	{
+		transform.bind(*hierarchy, hierarchy->create());
 		boundingVolume = std::make_unique<AABB>(generateAABB(model));
 		//boundingVolume = std::make_unique<Sphere>(generateSphereBV(model));
 	}
@@ -430,56 +475,150 @@ public:
 	}
 
 	//Add child. Argument input is argument of any constructor that you create. By default you can use the default constructor and don't put argument input.
+	//Returns the new child so that it can be given children of its own.
 	template<typename... TArgs>
-	void addChild(TArgs&... args)
+	Entity& addChild(TArgs&... args)
 	{
 		children.emplace_back(std::make_unique<Entity>(args...));
-		children.back()->parent = this;
+		Entity& child = *children.back();
+		child.parent = this;
+
+		//Move the new child from its own hierarchy into ours
+		TransformHierarchy& rootHierarchy = *transform.getHierarchy();
+		child.transform.bind(rootHierarchy, rootHierarchy.create(transform.getNode()));
+		child.hierarchy.reset();
+		return child;
 	}
 
-	//Update transform if it was changed
-	void updateSelfAndChild()
+	//Update transforms that were changed, and their descendants.
+	//All entities share their root's flat hierarchy, so this updates the whole scene whichever entity it is called on.
+	void updateSelfAndChild(bool parallel = false)
 	{
-		if (transform.isDirty()) {
-			forceUpdateSelfAndChild();
-			return;
-		}
-			
-		for (auto&& child : children)
-		{
-			child->updateSelfAndChild();
-		}
+		transform.getHierarchy()->update(parallel);
 	}
 
 	//Force update of transform even if local space don't change
-	void forceUpdateSelfAndChild()
+	void forceUpdateSelfAndChild(bool parallel = false)
 	{
-		if (parent)
-			transform.computeModelMatrix(parent->transform.getModelMatrix());
-		else
-			transform.computeModelMatrix();
-
-		for (auto&& child : children)
-		{
-			child->forceUpdateSelfAndChild();
-		}
+		transform.getHierarchy()->markDirty(transform.getNode());
+		transform.getHierarchy()->update(parallel);
 	}
 
 
-	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, unsigned int& display, unsigned int& total)
+	//Draw the entities of this scene graph that are on the frustum. The culler keeps the visible and total counts.
+	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, EntityCuller& culler);
+
+	//Draw every entity of this scene graph, e.g. for passes that have no perspective camera (shadow map, top view)
+	void drawSelfAndChild(Shader& ourShader)
 	{
-		if (boundingVolume->isOnFrustum(frustum, transform))
+		transform.getHierarchy()->update();
+		drawSubtree(ourShader);
+	}
+
+private:
+	void drawSubtree(Shader& ourShader)
+	{
+		if (pModel)
 		{
 			ourShader.setMat4("model", transform.getModelMatrix());
 			pModel->Draw(ourShader);
-			display++;
 		}
-		total++;
-
 		for (auto&& child : children)
+			child->drawSubtree(ourShader);
+	}
+};
+
+//Frustum culling of a whole scene graph through a BVH over the entities' world AABBs.
+//Use one culler per root entity; it is rebuilt automatically when entities are added. Group nodes are not culled.
+class EntityCuller
+{
+public:
+	//Returns the entities of the scene graph that are on the frustum, in the same order as a depth-first traversal
+	const std::vector<Entity*>& cull(Entity& root, const Frustum& frustum)
+	{
+		TransformHierarchy& hierarchy = *root.transform.getHierarchy();
+		hierarchy.update();
+		if (&root != m_root || hierarchy.size() != m_hierarchySize)
+			rebuild(root);
+		else
+			m_culler.refresh(hierarchy);
+
+		const FrustumCuller::Planes planes = {
+			toPlane(frustum.leftFace), toPlane(frustum.rightFace),
+			toPlane(frustum.topFace), toPlane(frustum.bottomFace),
+			toPlane(frustum.nearFace), toPlane(frustum.farFace)
+		};
+
+		m_visible.clear();
+		for (uint32_t index : m_culler.cull(planes))
+			m_visible.push_back(m_entities[index]);
+		return m_visible;
+	}
+
+	//Forces a rebuild on the next cull, e.g. after entities were removed
+	void invalidate()
+	{
+		m_root = nullptr;
+	}
+
+	unsigned int getVisibleCount() const
+	{
+		return (unsigned int)m_visible.size();
+	}
+
+	unsigned int getTotalCount() const
+	{
+		return (unsigned int)m_entities.size();
+	}
+
+private:
+	static glm::vec4 toPlane(const Plane& plane)
+	{
+		return glm::vec4(plane.normal, plane.distance);
+	}
+
+	void rebuild(Entity& root)
+	{
+		m_root = &root;
+		m_hierarchySize = root.transform.getHierarchy()->size();
+
+		m_entities.clear();
+		collect(root);
+
+		std::vector<TransformHierarchy::Handle> handles(m_entities.size());
+		std::vector<glm::vec3> centers(m_entities.size());
+		std::vector<glm::vec3> extents(m_entities.size());
+		for (size_t i = 0; i < m_entities.size(); i++)
 		{
-			child->drawSelfAndChild(frustum, ourShader, display, total);
+			handles[i] = m_entities[i]->transform.getNode();
+			centers[i] = m_entities[i]->boundingVolume->center;
+			extents[i] = m_entities[i]->boundingVolume->extents;
 		}
+		m_culler.build(*root.transform.getHierarchy(), handles, centers, extents);
+	}
+
+	void collect(Entity& entity)
+	{
+		//Group nodes have nothing to draw
+		if (entity.pModel)
+			m_entities.push_back(&entity);
+		for (auto&& child : entity.children)
+			collect(*child);
 	}
+
+	Entity* m_root = nullptr;
+	size_t m_hierarchySize = 0;
+	std::vector<Entity*> m_entities; //depth-first order, as drawn
+	std::vector<Entity*> m_visible;
+	FrustumCuller m_culler;
 };
+
+inline void Entity::drawSelfAndChild(const Frustum& frustum, Shader& ourShader, EntityCuller& culler)
+{
+	for (Entity* entity : culler.cull(*this, frustum))
+	{
+		ourShader.setMat4("model", entity->transform.getModelMatrix());
+		entity->pModel->Draw(ourShader);
+	}
+}
 #endif
@@ -0,0 +1,450 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <glm/glm.hpp> //glm::vec3, glm::vec4
+#include <array> //std::array
+#include <vector> //std::vector
+#include <cstdint> //uint32_t
+#include <cmath> //std::abs
+#include <limits> //std::numeric_limits
+#include <algorithm> //std::sort, std::min, std::max
+
+#include <learnopengl/transform_hierarchy.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE 1
+#endif
+
+//Frustum culling of many oriented boxes attached to TransformHierarchy nodes.
+//World AABBs are cached in SoA arrays and refreshed only for nodes whose world matrix changed. A BVH over them
+//rejects or accepts whole groups at once, and its leaves (up to 8 boxes, contiguous in the SoA arrays) are tested
+//against the frustum planes 8 at a time with AVX, or 2x4 with SSE.
+//Boxes are tested exactly like AABB::isOnFrustum, so the visible set is the same as testing them one by one.
+class FrustumCuller
+{
+public:
+	//Frustum plane: xyz is the unit normal pointing inside, w the distance to the origin (see Plane)
+	typedef std::array<glm::vec4, 6> Planes;
+
+	static constexpr uint32_t maxLeafSize = 8;
+
+	//Sets the boxes to cull: object i is the local AABB (center, extents) of node handles[i].
+	//Builds the BVH from the current world matrices.
+	void build(const TransformHierarchy& hierarchy, const std::vector<TransformHierarchy::Handle>& handles,
+		const std::vector<glm::vec3>& centers, const std::vector<glm::vec3>& extents)
+	{
+		const size_t count = handles.size();
+		m_handle = handles;
+		m_localCenter = centers;
+		m_localExtents = extents;
+		m_version.assign(count, 0);
+		m_seenUpdateCount = hierarchy.getUpdateCount();
+
+		//World boxes in object order, to build the tree
+		std::vector<glm::vec3> worldCenter(count);
+		std::vector<glm::vec3> worldExtents(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			computeWorldBox(hierarchy.getWorldMatrix(handles[i]), centers[i], extents[i], worldCenter[i], worldExtents[i]);
+			m_version[i] = hierarchy.getWorldVersion(handles[i]);
+		}
+
+		m_order.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+			m_order[i] = i;
+
+		m_nodes.clear();
+		m_nodes.reserve(count > 0 ? 2 * ((count + maxLeafSize - 1) / maxLeafSize) : 0);
+		if (count > 0)
+		{
+			m_nodes.push_back({});
+			buildNode(0, 0, (uint32_t)count, worldCenter, worldExtents);
+		}
+
+		//SoA arrays in leaf order, padded so a leaf can always load 8 lanes
+		const size_t padded = count + maxLeafSize;
+		m_cx.assign(padded, 0.0f); m_cy.assign(padded, 0.0f); m_cz.assign(padded, 0.0f);
+		m_ex.assign(padded, 0.0f); m_ey.assign(padded, 0.0f); m_ez.assign(padded, 0.0f);
+		m_slotOfObject.resize(count);
+		for (uint32_t slot = 0; slot < count; slot++)
+		{
+			const uint32_t object = m_order[slot];
+			m_slotOfObject[object] = slot;
+			storeBox(slot, worldCenter[object], worldExtents[object]);
+		}
+		refitNodes();
+	}
+
+	//Refreshes the world boxes of the objects whose node moved since the last build or refresh
+	void refresh(const TransformHierarchy& hierarchy)
+	{
+		if (hierarchy.getUpdateCount() == m_seenUpdateCount)
+			return;
+		m_seenUpdateCount = hierarchy.getUpdateCount();
+
+		bool changed = false;
+		for (size_t i = 0; i < m_handle.size(); i++)
+		{
+			const uint32_t version = hierarchy.getWorldVersion(m_handle[i]);
+			if (version == m_version[i])
+				continue;
+			m_version[i] = version;
+
+			glm::vec3 center, extents;
+			computeWorldBox(hierarchy.getWorldMatrix(m_handle[i]), m_localCenter[i], m_localExtents[i], center, extents);
+			storeBox(m_slotOfObject[i], center, extents);
+			changed = true;
+		}
+		if (changed)
+			refitNodes();
+	}
+
+	//Returns the indices of the visible objects, in increasing order
+	const std::vector<uint32_t>& cull(const Planes& planes)
+	{
+		m_visible.clear();
+		if (m_nodes.empty())
+			return m_visible;
+
+		glm::vec4 absNormals[6];
+		for (int p = 0; p < 6; p++)
+			absNormals[p] = glm::vec4(glm::abs(glm::vec3(planes[p])), 0.0f);
+
+		//Each entry carries the planes that still have to be tested; planes a node is fully inside of are dropped
+		m_stack.clear();
+		m_stack.push_back({ 0, 0x3Fu });
+
+		while (!m_stack.empty())
+		{
+			const StackEntry entry = m_stack.back();
+			m_stack.pop_back();
+			const Node& node = m_nodes[entry.node];
+
+			uint32_t planeMask = entry.planeMask;
+			bool outside = false;
+			const glm::vec3 center = (node.min + node.max) * 0.5f;
+			const glm::vec3 extents = (node.max - node.min) * 0.5f;
+			for (int p = 0; p < 6 && !outside; p++)
+			{
+				if (!(planeMask & (1u << p)))
+					continue;
+				const float d = glm::dot(glm::vec3(planes[p]), center) - planes[p].w;
+				const float r = glm::dot(glm::vec3(absNormals[p]), extents);
+				//Margin so that boxes close to a plane are left to the exact per-object test
+				const float margin = 1e-5f * (std::abs(d) + r);
+				if (d + r < -margin)
+					outside = true;
+				else if (d - r > margin)
+					planeMask &= ~(1u << p);
+			}
+			if (outside)
+				continue;
+
+			if (planeMask == 0)
+			{
+				for (uint32_t slot = node.first; slot < node.first + node.count; slot++)
+					m_visible.push_back(m_order[slot]);
+			}
+			else if (node.child == 0)
+			{
+				uint32_t mask = testLeaf(node.first, node.count, planes, absNormals, planeMask);
+				while (mask)
+				{
+					const uint32_t lane = lowestBit(mask);
+					m_visible.push_back(m_order[node.first + lane]);
+					mask &= mask - 1;
+				}
+			}
+			else
+			{
+				m_stack.push_back({ node.child + 1, planeMask });
+				m_stack.push_back({ node.child, planeMask });
+			}
+		}
+
+		std::sort(m_visible.begin(), m_visible.end());
+		return m_visible;
+	}
+
+	size_t size() const
+	{
+		return m_handle.size();
+	}
+
+private:
+	struct Node
+	{
+		glm::vec3 min;
+		uint32_t child = 0; //index of the left child, the right one follows; 0 for leaves
+		glm::vec3 max;
+		uint32_t first = 0; //first slot of the subtree in the SoA arrays
+		uint32_t count = 0; //number of slots of the subtree
+	};
+
+	struct StackEntry
+	{
+		uint32_t node;
+		uint32_t planeMask;
+	};
+
+	static constexpr int sahBinCount = 12;
+
+	//Same arithmetic as AABB::isOnFrustum
+	static void computeWorldBox(const glm::mat4& world, const glm::vec3& localCenter, const glm::vec3& localExtents,
+		glm::vec3& center, glm::vec3& extents)
+	{
+		center = glm::vec3(world * glm::vec4(localCenter, 1.f));
+		const glm::vec3 right = glm::vec3(world[0]) * localExtents.x;
+		const glm::vec3 up = glm::vec3(world[1]) * localExtents.y;
+		const glm::vec3 forward = -glm::vec3(world[2]) * localExtents.z;
+		extents.x = std::abs(right.x) + std::abs(up.x) + std::abs(forward.x);
+		extents.y = std::abs(right.y) + std::abs(up.y) + std::abs(forward.y);
+		extents.z = std::abs(right.z) + std::abs(up.z) + std::abs(forward.z);
+	}
+
+	static uint32_t lowestBit(uint32_t mask)
+	{
+		uint32_t bit = 0;
+		while (!(mask & 1u))
+		{
+			mask >>= 1;
+			bit++;
+		}
+		return bit;
+	}
+
+	void storeBox(uint32_t slot, const glm::vec3& center, const glm::vec3& extents)
+	{
+		m_cx[slot] = center.x; m_cy[slot] = center.y; m_cz[slot] = center.z;
+		m_ex[slot] = extents.x; m_ey[slot] = extents.y; m_ez[slot] = extents.z;
+	}
+
+	//Binned SAH split over the centroids of m_order[first, first + count)
+	void buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count,
+		const std::vector<glm::vec3>& worldCenter, const std::vector<glm::vec3>& worldExtents)
+	{
+		m_nodes[nodeIndex].first = first;
+		m_nodes[nodeIndex].count = count;
+		if (count <= maxLeafSize)
+			return;
+
+		glm::vec3 centroidMin(std::numeric_limits<float>::max());
+		glm::vec3 centroidMax(-std::numeric_limits<float>::max());
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			centroidMin = glm::min(centroidMin, worldCenter[m_order[i]]);
+			centroidMax = glm::max(centroidMax, worldCenter[m_order[i]]);
+		}
+		const glm::vec3 size = centroidMax - centroidMin;
+		const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+
+		uint32_t mid = first + count / 2;
+		if (size[axis] > 0.0f)
+		{
+			struct Bin
+			{
+				glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+				glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+				uint32_t count = 0;
+			};
+			Bin bins[sahBinCount];
+			const float scale = sahBinCount / size[axis];
+			auto binOf = [&](uint32_t object)
+			{
+				return std::min(sahBinCount - 1, (int)((worldCenter[object][axis] - centroidMin[axis]) * scale));
+			};
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				const uint32_t object = m_order[i];
+				Bin& bin = bins[binOf(object)];
+				bin.min = glm::min(bin.min, worldCenter[object] - worldExtents[object]);
+				bin.max = glm::max(bin.max, worldCenter[object] + worldExtents[object]);
+				bin.count++;
+			}
+
+			auto area = [](const glm::vec3& min, const glm::vec3& max)
+			{
+				const glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+				return e.x * e.y + e.y * e.z + e.z * e.x;
+			};
+			float rightArea[sahBinCount];
+			uint32_t rightCount[sahBinCount];
+			Bin accumulated;
+			for (int b = sahBinCount - 1; b > 0; b--)
+			{
+				accumulated.min = glm::min(accumulated.min, bins[b].min);
+				accumulated.max = glm::max(accumulated.max, bins[b].max);
+				accumulated.count += bins[b].count;
+				rightArea[b] = area(accumulated.min, accumulated.max);
+				rightCount[b] = accumulated.count;
+			}
+
+			float bestCost = std::numeric_limits<float>::max();
+			int bestSplit = -1;
+			accumulated = Bin();
+			for (int b = 0; b < sahBinCount - 1; b++)
+			{
+				accumulated.min = glm::min(accumulated.min, bins[b].min);
+				accumulated.max = glm::max(accumulated.max, bins[b].max);
+				accumulated.count += bins[b].count;
+				if (accumulated.count == 0 || rightCount[b + 1] == 0)
+					continue;
+				const float cost = area(accumulated.min, accumulated.max) * accumulated.count + rightArea[b + 1] * rightCount[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestSplit = b;
+				}
+			}
+
+			if (bestSplit >= 0)
+			{
+				const uint32_t* split = std::partition(m_order.data() + first, m_order.data() + first + count,
+					[&](uint32_t object) { return binOf(object) <= bestSplit; });
+				mid = (uint32_t)(split - m_order.data());
+			}
+		}
+		if (mid == first || mid == first + count || size[axis] <= 0.0f)
+		{
+			//Degenerate centroids: split in the middle of the sorted range
+			mid = first + count / 2;
+			std::nth_element(m_order.begin() + first, m_order.begin() + mid, m_order.begin() + first + count,
+				[&](uint32_t a, uint32_t b) { return worldCenter[a][axis] < worldCenter[b][axis]; });
+		}
+
+		const uint32_t left = (uint32_t)m_nodes.size();
+		m_nodes.push_back({});
+		m_nodes.push_back({});
+		m_nodes[nodeIndex].child = left;
+		buildNode(left, first, mid - first, worldCenter, worldExtents);
+		buildNode(left + 1, mid, first + count - mid, worldCenter, worldExtents);
+	}
+
+	//Children always come after their parent, so a backward pass computes every bound
+	void refitNodes()
+	{
+		for (size_t n = m_nodes.size(); n-- > 0;)
+		{
+			Node& node = m_nodes[n];
+			if (node.child != 0)
+			{
+				node.min = glm::min(m_nodes[node.child].min, m_nodes[node.child + 1].min);
+				node.max = glm::max(m_nodes[node.child].max, m_nodes[node.child + 1].max);
+				continue;
+			}
+			node.min = glm::vec3(std::numeric_limits<float>::max());
+			node.max = glm::vec3(-std::numeric_limits<float>::max());
+			for (uint32_t slot = node.first; slot < node.first + node.count; slot++)
+			{
+				const glm::vec3 center(m_cx[slot], m_cy[slot], m_cz[slot]);
+				const glm::vec3 extents(m_ex[slot], m_ey[slot], m_ez[slot]);
+				node.min = glm::min(node.min, center - extents);
+				node.max = glm::max(node.max, center + extents);
+			}
+		}
+	}
+
+	//Returns one bit per visible box of the leaf. Each box passes a plane when -r <= d, with
+	//d = dot(n, c) - distance and r = dot(extents, |n|), evaluated in the same order as Plane/AABB.
+	uint32_t testLeaf(uint32_t first, uint32_t count, const Planes& planes, const glm::vec4* absNormals, uint32_t planeMask) const
+	{
+		const uint32_t laneMask = (1u << count) - 1u;
+#if defined(FRUSTUM_CULLING_AVX)
+		const __m256 cx = _mm256_loadu_ps(&m_cx[first]);
+		const __m256 cy = _mm256_loadu_ps(&m_cy[first]);
+		const __m256 cz = _mm256_loadu_ps(&m_cz[first]);
+		const __m256 ex = _mm256_loadu_ps(&m_ex[first]);
+		const __m256 ey = _mm256_loadu_ps(&m_ey[first]);
+		const __m256 ez = _mm256_loadu_ps(&m_ez[first]);
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			if (!(planeMask & (1u << p)))
+				continue;
+			const __m256 d = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_set1_ps(planes[p].x), cx),
+				_mm256_mul_ps(_mm256_set1_ps(planes[p].y), cy)),
+				_mm256_mul_ps(_mm256_set1_ps(planes[p].z), cz)),
+				_mm256_set1_ps(planes[p].w));
+			const __m256 r = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(ex, _mm256_set1_ps(absNormals[p].x)),
+				_mm256_mul_ps(ey, _mm256_set1_ps(absNormals[p].y))),
+				_mm256_mul_ps(ez, _mm256_set1_ps(absNormals[p].z)));
+			const __m256 minusR = _mm256_sub_ps(_mm256_setzero_ps(), r);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(minusR, d, _CMP_LE_OQ));
+		}
+		return (uint32_t)_mm256_movemask_ps(inside) & laneMask;
+#elif defined(FRUSTUM_CULLING_SSE)
+		uint32_t result = 0;
+		for (uint32_t half = 0; half < count; half += 4)
+		{
+			const uint32_t s = first + half;
+			const __m128 cx = _mm_loadu_ps(&m_cx[s]);
+			const __m128 cy = _mm_loadu_ps(&m_cy[s]);
+			const __m128 cz = _mm_loadu_ps(&m_cz[s]);
+			const __m128 ex = _mm_loadu_ps(&m_ex[s]);
+			const __m128 ey = _mm_loadu_ps(&m_ey[s]);
+			const __m128 ez = _mm_loadu_ps(&m_ez[s]);
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				if (!(planeMask & (1u << p)))
+					continue;
+				const __m128 d = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(planes[p].x), cx),
+					_mm_mul_ps(_mm_set1_ps(planes[p].y), cy)),
+					_mm_mul_ps(_mm_set1_ps(planes[p].z), cz)),
+					_mm_set1_ps(planes[p].w));
+				const __m128 r = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(ex, _mm_set1_ps(absNormals[p].x)),
+					_mm_mul_ps(ey, _mm_set1_ps(absNormals[p].y))),
+					_mm_mul_ps(ez, _mm_set1_ps(absNormals[p].z)));
+				const __m128 minusR = _mm_sub_ps(_mm_setzero_ps(), r);
+				inside = _mm_and_ps(inside, _mm_cmple_ps(minusR, d));
+			}
+			result |= (uint32_t)_mm_movemask_ps(inside) << half;
+		}
+		return result & laneMask;
+#else
+		uint32_t result = 0;
+		for (uint32_t lane = 0; lane < count; lane++)
+		{
+			const uint32_t s = first + lane;
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++)
+			{
+				if (!(planeMask & (1u << p)))
+					continue;
+				const float d = planes[p].x * m_cx[s] + planes[p].y * m_cy[s] + planes[p].z * m_cz[s] - planes[p].w;
+				const float r = m_ex[s] * absNormals[p].x + m_ey[s] * absNormals[p].y + m_ez[s] * absNormals[p].z;
+				inside = -r <= d;
+			}
+			result |= (uint32_t)inside << lane;
+		}
+		return result;
+#endif
+	}
+
+	//Per object, in build order
+	std::vector<TransformHierarchy::Handle> m_handle;
+	std::vector<glm::vec3> m_localCenter;
+	std::vector<glm::vec3> m_localExtents;
+	std::vector<uint32_t> m_version; //world version the cached box was computed from
+	std::vector<uint32_t> m_slotOfObject;
+	uint32_t m_seenUpdateCount = 0;
+
+	//World boxes in SoA form, in leaf order; m_order maps a slot back to its object
+	std::vector<float> m_cx, m_cy, m_cz;
+	std::vector<float> m_ex, m_ey, m_ez;
+	std::vector<uint32_t> m_order;
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_visible;
+	std::vector<StackEntry> m_stack;
+};
+
+#endif
@@ -0,0 +1,637 @@
+#ifndef NBODY_H
+#define NBODY_H
+
+#include <glm/glm.hpp> //glm::dvec3
+#include <vector> //std::vector
+#include <cstdint> //uint32_t
+#include <cmath> //std::sqrt
+#include <algorithm> //std::min, std::max
+#include <limits> //std::numeric_limits
+#include <memory> //std::unique_ptr
+#include <thread> //std::thread::hardware_concurrency
+
+#include <learnopengl/transform_hierarchy.h> //TransformWorkers
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define NBODY_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NBODY_SSE2 1
+#endif
+
+//Gravitational N-body system.
+//Bodies are stored as structure-of-arrays in double precision and integrated with kick-drift-kick leapfrog,
+//which is symplectic: the energy error oscillates but does not drift, so orbits stay closed over long runs.
+//Accelerations come from an exact pairwise sum (AVX/SSE2) for small systems and from a Barnes-Hut octree
+//above the tree threshold, e.g. for asteroid belts. Each body's acceleration is summed in a fixed order by a
+//single thread, so a run is reproducible whatever the thread count.
+//Bodies with zero mass are test particles: they feel gravity but exert none. The direct sum only loops over
+//massive bodies, so a belt of N test particles around a few massive bodies costs N times that few per step.
+//No OpenGL dependency: can be stepped headless to measure energy drift and throughput.
+class NBodySystem
+{
+public:
+	enum class Solver
+	{
+		Auto, //Direct below m_treeThreshold massive bodies, Barnes-Hut above
+		Direct,
+		BarnesHut
+	};
+
+	explicit NBodySystem(double gravity = 1.0, double softening = 1e-3)
+		: m_gravity(gravity), m_softening2(softening * softening)
+	{
+	}
+
+	size_t addBody(const glm::dvec3& position, const glm::dvec3& velocity, double mass)
+	{
+		m_px.push_back(position.x);
+		m_py.push_back(position.y);
+		m_pz.push_back(position.z);
+		m_vx.push_back(velocity.x);
+		m_vy.push_back(velocity.y);
+		m_vz.push_back(velocity.z);
+		m_ax.push_back(0.0);
+		m_ay.push_back(0.0);
+		m_az.push_back(0.0);
+		m_mass.push_back(mass);
+		m_accelerationValid = false;
+		return m_mass.size() - 1;
+	}
+
+	size_t size() const
+	{
+		return m_mass.size();
+	}
+
+	glm::dvec3 getPosition(size_t i) const
+	{
+		return glm::dvec3(m_px[i], m_py[i], m_pz[i]);
+	}
+
+	glm::dvec3 getVelocity(size_t i) const
+	{
+		return glm::dvec3(m_vx[i], m_vy[i], m_vz[i]);
+	}
+
+	double getMass(size_t i) const
+	{
+		return m_mass[i];
+	}
+
+	double getTime() const
+	{
+		return m_time;
+	}
+
+	void setSolver(Solver solver)
+	{
+		m_solver = solver;
+	}
+
+	//Barnes-Hut opening angle: a cell is used as a point mass when size / distance < theta
+	void setTheta(double theta)
+	{
+		m_theta = theta;
+	}
+
+	void setTreeThreshold(size_t bodyCount)
+	{
+		m_treeThreshold = bodyCount;
+	}
+
+	//Shifts positions and velocities so the centre of mass sits at the origin and stays at rest
+	void moveToCenterOfMassFrame()
+	{
+		double totalMass = 0.0;
+		glm::dvec3 position(0.0), momentum(0.0);
+		for (size_t i = 0; i < size(); i++)
+		{
+			totalMass += m_mass[i];
+			position += m_mass[i] * getPosition(i);
+			momentum += m_mass[i] * getVelocity(i);
+		}
+		if (totalMass <= 0.0)
+			return;
+		position /= totalMass;
+		momentum /= totalMass;
+		for (size_t i = 0; i < size(); i++)
+		{
+			m_px[i] -= position.x;
+			m_py[i] -= position.y;
+			m_pz[i] -= position.z;
+			m_vx[i] -= momentum.x;
+			m_vy[i] -= momentum.y;
+			m_vz[i] -= momentum.z;
+		}
+		m_accelerationValid = false;
+	}
+
+	//One kick-drift-kick leapfrog step
+	void step(double dt)
+	{
+		const size_t count = size();
+		if (!m_accelerationValid)
+			computeAccelerations();
+
+		const double halfDt = 0.5 * dt;
+		for (size_t i = 0; i < count; i++)
+		{
+			m_vx[i] += m_ax[i] * halfDt;
+			m_vy[i] += m_ay[i] * halfDt;
+			m_vz[i] += m_az[i] * halfDt;
+			m_px[i] += m_vx[i] * dt;
+			m_py[i] += m_vy[i] * dt;
+			m_pz[i] += m_vz[i] * dt;
+		}
+
+		computeAccelerations();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			m_vx[i] += m_ax[i] * halfDt;
+			m_vy[i] += m_ay[i] * halfDt;
+			m_vz[i] += m_az[i] * halfDt;
+		}
+		m_time += dt;
+	}
+
+	double kineticEnergy() const
+	{
+		double energy = 0.0;
+		for (size_t i = 0; i < size(); i++)
+			energy += 0.5 * m_mass[i] * (m_vx[i] * m_vx[i] + m_vy[i] * m_vy[i] + m_vz[i] * m_vz[i]);
+		return energy;
+	}
+
+	//Exact softened potential energy, O(N^2); meant for checking drift, not for every frame
+	double potentialEnergy() const
+	{
+		double energy = 0.0;
+		for (size_t i = 0; i < size(); i++)
+		{
+			if (m_mass[i] == 0.0)
+				continue;
+			for (size_t j = i + 1; j < size(); j++)
+			{
+				const double dx = m_px[j] - m_px[i];
+				const double dy = m_py[j] - m_py[i];
+				const double dz = m_pz[j] - m_pz[i];
+				energy -= m_gravity * m_mass[i] * m_mass[j] / std::sqrt(dx * dx + dy * dy + dz * dz + m_softening2);
+			}
+		}
+		return energy;
+	}
+
+	double totalEnergy() const
+	{
+		return kineticEnergy() + potentialEnergy();
+	}
+
+private:
+	//Octree cell. Children of a cell are stored contiguously; leaves own a range of m_treeBodies.
+	//The opening test uses the bounds of the bodies actually in the cell rather than the cell cube, which
+	//matters for flat systems such as a belt: their cubes are mostly empty.
+	struct TreeNode
+	{
+		double comX, comY, comZ, mass; //centre of mass
+		double minX, minY, minZ; //bounds of the bodies in the cell
+		double maxX, maxY, maxZ;
+		double size; //largest side of those bounds
+		uint32_t first; //first child node, or first entry in m_treeBodies for a leaf
+		uint32_t count; //number of children, or number of bodies for a leaf
+		bool leaf;
+	};
+
+	static const uint32_t TREE_LEAF_SIZE = 8;
+	static const int TREE_MAX_DEPTH = 32;
+
+	void computeAccelerations()
+	{
+		const size_t count = size();
+		gatherSources();
+		const size_t sourceCount = m_sourceMass.size();
+		const bool useTree = m_solver == Solver::BarnesHut || (m_solver == Solver::Auto && sourceCount > m_treeThreshold);
+		if (useTree)
+			buildTree();
+
+		auto job = [this, useTree](size_t begin, size_t end)
+		{
+			if (useTree)
+				treeAccelerations(begin, end);
+			else
+				directAccelerations(begin, end);
+		};
+
+		//Splitting is only worth it when there is real work: N x sources pairs or a big tree walk
+		const size_t work = useTree ? count * 64 : count * sourceCount;
+		if (work >= 1u << 16)
+		{
+			if (!m_workers)
+			{
+				const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+				m_workers = std::make_unique<TransformWorkers>(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+			}
+			m_workers->run(count, useTree ? 256 : 32, job);
+		}
+		else
+		{
+			job(0, count);
+		}
+		m_accelerationValid = true;
+	}
+
+	//Copies the massive bodies into contiguous arrays, the only ones the direct sum has to visit
+	void gatherSources()
+	{
+		m_sourceX.clear();
+		m_sourceY.clear();
+		m_sourceZ.clear();
+		m_sourceMass.clear();
+		for (size_t i = 0; i < size(); i++)
+		{
+			if (m_mass[i] == 0.0)
+				continue;
+			m_sourceX.push_back(m_px[i]);
+			m_sourceY.push_back(m_py[i]);
+			m_sourceZ.push_back(m_pz[i]);
+			m_sourceMass.push_back(m_mass[i]);
+		}
+	}
+
+	//Exact pairwise sum over the massive bodies for bodies [begin, end)
+	void directAccelerations(size_t begin, size_t end)
+	{
+		const size_t count = m_sourceMass.size();
+		const double* sourceX = m_sourceX.data();
+		const double* sourceY = m_sourceY.data();
+		const double* sourceZ = m_sourceZ.data();
+		const double* sourceMass = m_sourceMass.data();
+		for (size_t i = begin; i < end; i++)
+		{
+			const double xi = m_px[i], yi = m_py[i], zi = m_pz[i];
+			double ax = 0.0, ay = 0.0, az = 0.0;
+			size_t j = 0;
+#if defined(NBODY_AVX)
+			const __m256d pxi = _mm256_set1_pd(xi), pyi = _mm256_set1_pd(yi), pzi = _mm256_set1_pd(zi);
+			const __m256d eps2 = _mm256_set1_pd(m_softening2);
+			const __m256d zero = _mm256_setzero_pd();
+			__m256d sx = zero, sy = zero, sz = zero;
+			for (; j + 4 <= count; j += 4)
+			{
+				const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(sourceX + j), pxi);
+				const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(sourceY + j), pyi);
+				const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(sourceZ + j), pzi);
+				const __m256d r2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)),
+					_mm256_add_pd(_mm256_mul_pd(dz, dz), eps2));
+				//r2 == 0 only for the body itself with zero softening; mask it instead of producing inf * 0
+				const __m256d valid = _mm256_cmp_pd(r2, zero, _CMP_GT_OQ);
+				const __m256d invR = _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(r2));
+				const __m256d s = _mm256_and_pd(valid,
+					_mm256_mul_pd(_mm256_loadu_pd(sourceMass + j), _mm256_mul_pd(invR, _mm256_mul_pd(invR, invR))));
+				sx = _mm256_add_pd(sx, _mm256_mul_pd(dx, s));
+				sy = _mm256_add_pd(sy, _mm256_mul_pd(dy, s));
+				sz = _mm256_add_pd(sz, _mm256_mul_pd(dz, s));
+			}
+			double lanes[4];
+			_mm256_storeu_pd(lanes, sx);
+			ax = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+			_mm256_storeu_pd(lanes, sy);
+			ay = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+			_mm256_storeu_pd(lanes, sz);
+			az = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(NBODY_SSE2)
+			const __m128d pxi = _mm_set1_pd(xi), pyi = _mm_set1_pd(yi), pzi = _mm_set1_pd(zi);
+			const __m128d eps2 = _mm_set1_pd(m_softening2);
+			const __m128d zero = _mm_setzero_pd();
+			__m128d sx = zero, sy = zero, sz = zero;
+			for (; j + 2 <= count; j += 2)
+			{
+				const __m128d dx = _mm_sub_pd(_mm_loadu_pd(sourceX + j), pxi);
+				const __m128d dy = _mm_sub_pd(_mm_loadu_pd(sourceY + j), pyi);
+				const __m128d dz = _mm_sub_pd(_mm_loadu_pd(sourceZ + j), pzi);
+				const __m128d r2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)),
+					_mm_add_pd(_mm_mul_pd(dz, dz), eps2));
+				const __m128d valid = _mm_cmpgt_pd(r2, zero);
+				const __m128d invR = _mm_div_pd(_mm_set1_pd(1.0), _mm_sqrt_pd(r2));
+				const __m128d s = _mm_and_pd(valid,
+					_mm_mul_pd(_mm_loadu_pd(sourceMass + j), _mm_mul_pd(invR, _mm_mul_pd(invR, invR))));
+				sx = _mm_add_pd(sx, _mm_mul_pd(dx, s));
+				sy = _mm_add_pd(sy, _mm_mul_pd(dy, s));
+				sz = _mm_add_pd(sz, _mm_mul_pd(dz, s));
+			}
+			double lanes[2];
+			_mm_storeu_pd(lanes, sx);
+			ax = lanes[0] + lanes[1];
+			_mm_storeu_pd(lanes, sy);
+			ay = lanes[0] + lanes[1];
+			_mm_storeu_pd(lanes, sz);
+			az = lanes[0] + lanes[1];
+#endif
+			for (; j < count; j++)
+				accumulate(xi, yi, zi, sourceX[j], sourceY[j], sourceZ[j], sourceMass[j], ax, ay, az);
+
+			m_ax[i] = m_gravity * ax;
+			m_ay[i] = m_gravity * ay;
+			m_az[i] = m_gravity * az;
+		}
+	}
+
+	//Adds m / r^3 * d to a, skipping the body itself
+	void accumulate(double xi, double yi, double zi, double xj, double yj, double zj, double mass,
+		double& ax, double& ay, double& az) const
+	{
+		const double dx = xj - xi, dy = yj - yi, dz = zj - zi;
+		const double r2 = dx * dx + dy * dy + dz * dz + m_softening2;
+		if (r2 <= 0.0)
+			return;
+		const double invR = 1.0 / std::sqrt(r2);
+		const double s = mass * invR * invR * invR;
+		ax += dx * s;
+		ay += dy * s;
+		az += dz * s;
+	}
+
+	void buildTree()
+	{
+		const size_t count = size();
+		m_treeNodes.clear();
+		m_treeBodies.resize(count);
+		for (size_t i = 0; i < count; i++)
+			m_treeBodies[i] = (uint32_t)i;
+
+		glm::dvec3 lo(0.0), hi(0.0);
+		if (count > 0)
+		{
+			lo = hi = getPosition(0);
+			for (size_t i = 1; i < count; i++)
+			{
+				lo = glm::min(lo, getPosition(i));
+				hi = glm::max(hi, getPosition(i));
+			}
+		}
+		const glm::dvec3 center = 0.5 * (lo + hi);
+		const glm::dvec3 extent = hi - lo;
+		const double halfSize = 0.5 * std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-9));
+
+		m_treeNodes.push_back(TreeNode());
+		buildNode(0, 0, (uint32_t)count, center.x, center.y, center.z, halfSize, 0);
+
+		//Leaf bodies are read as x, y, z, mass in tree order so a leaf is one contiguous block
+		m_treeData.resize(4 * count);
+		for (size_t k = 0; k < count; k++)
+		{
+			const uint32_t b = m_treeBodies[k];
+			m_treeData[4 * k + 0] = m_px[b];
+			m_treeData[4 * k + 1] = m_py[b];
+			m_treeData[4 * k + 2] = m_pz[b];
+			m_treeData[4 * k + 3] = m_mass[b];
+		}
+	}
+
+	void buildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end, double cx, double cy, double cz, double halfSize, int depth)
+	{
+		if (end - begin <= TREE_LEAF_SIZE || depth >= TREE_MAX_DEPTH)
+		{
+			TreeNode& node = m_treeNodes[nodeIndex];
+			resetNode(node);
+			double mx = 0.0, my = 0.0, mz = 0.0;
+			for (uint32_t k = begin; k < end; k++)
+			{
+				const uint32_t b = m_treeBodies[k];
+				node.mass += m_mass[b];
+				mx += m_mass[b] * m_px[b];
+				my += m_mass[b] * m_py[b];
+				mz += m_mass[b] * m_pz[b];
+				growNode(node, m_px[b], m_py[b], m_pz[b], m_px[b], m_py[b], m_pz[b]);
+			}
+			finishNode(node, mx, my, mz, begin, end - begin, true);
+			return;
+		}
+
+		//Counting sort of the range into octants, keeping the original order inside each octant
+		uint32_t octantCount[8] = { 0 };
+		for (uint32_t k = begin; k < end; k++)
+			octantCount[octant(m_treeBodies[k], cx, cy, cz)]++;
+		uint32_t octantStart[9];
+		octantStart[0] = begin;
+		for (int o = 0; o < 8; o++)
+			octantStart[o + 1] = octantStart[o] + octantCount[o];
+		m_scratch.resize(end - begin);
+		uint32_t cursor[8];
+		for (int o = 0; o < 8; o++)
+			cursor[o] = octantStart[o] - begin;
+		for (uint32_t k = begin; k < end; k++)
+		{
+			const uint32_t b = m_treeBodies[k];
+			m_scratch[cursor[octant(b, cx, cy, cz)]++] = b;
+		}
+		std::copy(m_scratch.begin(), m_scratch.begin() + (end - begin), m_treeBodies.begin() + begin);
+
+		//Allocate the non-empty children next to each other, then fill them
+		uint32_t childCount = 0;
+		for (int o = 0; o < 8; o++)
+			childCount += octantCount[o] > 0 ? 1 : 0;
+		const uint32_t firstChild = (uint32_t)m_treeNodes.size();
+		m_treeNodes.resize(m_treeNodes.size() + childCount);
+
+		const double childHalf = 0.5 * halfSize;
+		uint32_t child = firstChild;
+		for (int o = 0; o < 8; o++)
+		{
+			if (octantCount[o] == 0)
+				continue;
+			buildNode(child, octantStart[o], octantStart[o + 1],
+				cx + ((o & 1) ? childHalf : -childHalf),
+				cy + ((o & 2) ? childHalf : -childHalf),
+				cz + ((o & 4) ? childHalf : -childHalf),
+				childHalf, depth + 1);
+			child++;
+		}
+
+		//Children are final now and m_treeNodes no longer grows, so the reference stays valid
+		TreeNode& node = m_treeNodes[nodeIndex];
+		resetNode(node);
+		double mx = 0.0, my = 0.0, mz = 0.0;
+		for (uint32_t c = firstChild; c < firstChild + childCount; c++)
+		{
+			const TreeNode& childNode = m_treeNodes[c];
+			node.mass += childNode.mass;
+			mx += childNode.mass * childNode.comX;
+			my += childNode.mass * childNode.comY;
+			mz += childNode.mass * childNode.comZ;
+			growNode(node, childNode.minX, childNode.minY, childNode.minZ, childNode.maxX, childNode.maxY, childNode.maxZ);
+		}
+		finishNode(node, mx, my, mz, firstChild, childCount, false);
+	}
+
+	static void resetNode(TreeNode& node)
+	{
+		node.mass = 0.0;
+		node.minX = node.minY = node.minZ = std::numeric_limits<double>::max();
+		node.maxX = node.maxY = node.maxZ = -std::numeric_limits<double>::max();
+	}
+
+	static void growNode(TreeNode& node, double loX, double loY, double loZ, double hiX, double hiY, double hiZ)
+	{
+		node.minX = std::min(node.minX, loX);
+		node.minY = std::min(node.minY, loY);
+		node.minZ = std::min(node.minZ, loZ);
+		node.maxX = std::max(node.maxX, hiX);
+		node.maxY = std::max(node.maxY, hiY);
+		node.maxZ = std::max(node.maxZ, hiZ);
+	}
+
+	static void finishNode(TreeNode& node, double mx, double my, double mz, uint32_t first, uint32_t count, bool leaf)
+	{
+		node.comX = node.mass > 0.0 ? mx / node.mass : 0.5 * (node.minX + node.maxX);
+		node.comY = node.mass > 0.0 ? my / node.mass : 0.5 * (node.minY + node.maxY);
+		node.comZ = node.mass > 0.0 ? mz / node.mass : 0.5 * (node.minZ + node.maxZ);
+		node.size = std::max(std::max(node.maxX - node.minX, node.maxY - node.minY), node.maxZ - node.minZ);
+		node.first = first;
+		node.count = count;
+		node.leaf = leaf;
+	}
+
+	int octant(uint32_t body, double cx, double cy, double cz) const
+	{
+		return (m_px[body] >= cx ? 1 : 0) | (m_py[body] >= cy ? 2 : 0) | (m_pz[body] >= cz ? 4 : 0);
+	}
+
+	//Barnes-Hut walk for entries [begin, end) of m_treeBodies.
+	//Going through bodies in tree order means neighbouring walks open nearly the same cells, which keeps them in cache.
+	void treeAccelerations(size_t begin, size_t end)
+	{
+		const double theta2 = m_theta * m_theta;
+		//Each level pushes at most 8 children and pops one, so the stack never exceeds 7 per level plus one
+		uint32_t stack[8 * TREE_MAX_DEPTH + 8];
+		for (size_t k = begin; k < end; k++)
+		{
+			const uint32_t i = m_treeBodies[k];
+			const double xi = m_treeData[4 * k + 0], yi = m_treeData[4 * k + 1], zi = m_treeData[4 * k + 2];
+			double ax = 0.0, ay = 0.0, az = 0.0;
+			int top = 0;
+			stack[top++] = 0;
+			while (top > 0)
+			{
+				const TreeNode& node = m_treeNodes[stack[--top]];
+				if (node.leaf)
+				{
+					for (uint32_t n = node.first; n < node.first + node.count; n++)
+					{
+						const double* body = &m_treeData[4 * n];
+						if (n != k)
+							accumulate(xi, yi, zi, body[0], body[1], body[2], body[3], ax, ay, az);
+					}
+					continue;
+				}
+
+				const double dx = node.comX - xi, dy = node.comY - yi, dz = node.comZ - zi;
+				const double d2 = dx * dx + dy * dy + dz * dz;
+				const bool inside = xi >= node.minX && xi <= node.maxX
+					&& yi >= node.minY && yi <= node.maxY
+					&& zi >= node.minZ && zi <= node.maxZ;
+				if (!inside && node.size * node.size < theta2 * d2)
+				{
+					accumulate(xi, yi, zi, node.comX, node.comY, node.comZ, node.mass, ax, ay, az);
+					continue;
+				}
+				//Push in reverse so children are visited in storage order
+				for (uint32_t c = node.count; c > 0; c--)
+					stack[top++] = node.first + c - 1;
+			}
+			m_ax[i] = m_gravity * ax;
+			m_ay[i] = m_gravity * ay;
+			m_az[i] = m_gravity * az;
+		}
+	}
+
+	double m_gravity;
+	double m_softening2;
+	double m_theta = 0.5;
+	double m_time = 0.0;
+	size_t m_treeThreshold = 1024;
+	Solver m_solver = Solver::Auto;
+	bool m_accelerationValid = false;
+
+	std::vector<double> m_px, m_py, m_pz;
+	std::vector<double> m_vx, m_vy, m_vz;
+	std::vector<double> m_ax, m_ay, m_az;
+	std::vector<double> m_mass;
+
+	//Massive bodies only, for the direct sum
+	std::vector<double> m_sourceX, m_sourceY, m_sourceZ, m_sourceMass;
+
+	std::vector<TreeNode> m_treeNodes;
+	std::vector<uint32_t> m_treeBodies;
+	std::vector<double> m_treeData;
+	std::vector<uint32_t> m_scratch;
+
+	std::unique_ptr<TransformWorkers> m_workers;
+};
+
+//Steps an NBodySystem with a fixed timestep, independent of the render frame rate.
+//Leftover frame time is carried to the next frame; alpha() tells how far the renderer is between the previous
+//and the current state, and getPosition() interpolates between them.
+class FixedStepper
+{
+public:
+	explicit FixedStepper(double stepSize, int maxStepsPerFrame = 8)
+		: m_stepSize(stepSize), m_maxSteps(maxStepsPerFrame)
+	{
+	}
+
+	//Returns the number of steps taken. When the simulation cannot keep up, extra time is dropped instead of
+	//piling up (which would make every following frame slower still).
+	int advance(NBodySystem& system, double frameTime)
+	{
+		m_accumulator += frameTime;
+		int steps = 0;
+		while (m_accumulator >= m_stepSize && steps < m_maxSteps)
+		{
+			//Only the state before the last step of the frame is needed for interpolation
+			if (m_accumulator < 2.0 * m_stepSize || steps + 1 == m_maxSteps)
+				savePrevious(system);
+			system.step(m_stepSize);
+			m_accumulator -= m_stepSize;
+			steps++;
+		}
+		if (steps == m_maxSteps && m_accumulator > m_stepSize)
+			m_accumulator = m_stepSize * 0.999;
+		if (m_previous.size() != system.size())
+			savePrevious(system);
+		return steps;
+	}
+
+	double alpha() const
+	{
+		return std::min(1.0, m_accumulator / m_stepSize);
+	}
+
+	double getStepSize() const
+	{
+		return m_stepSize;
+	}
+
+	glm::dvec3 getPosition(const NBodySystem& system, size_t i) const
+	{
+		const double a = alpha();
+		return m_previous[i] * (1.0 - a) + system.getPosition(i) * a;
+	}
+
+private:
+	void savePrevious(const NBodySystem& system)
+	{
+		m_previous.resize(system.size());
+		for (size_t i = 0; i < system.size(); i++)
+			m_previous[i] = system.getPosition(i);
+	}
+
+	double m_stepSize;
+	int m_maxSteps;
+	double m_accumulator = 0.0;
+	std::vector<glm::dvec3> m_previous;
+};
+
+#endif
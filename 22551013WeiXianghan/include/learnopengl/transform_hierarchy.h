@@ -0,0 +1,476 @@
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <glm/glm.hpp> //glm::mat4
+#include <vector> //std::vector
+#include <cstdint> //uint8_t, uint32_t
+#include <cstring> //std::memset
+#include <algorithm> //std::min
+#include <atomic> //std::atomic
+#include <condition_variable> //std::condition_variable
+#include <functional> //std::function
+#include <memory> //std::unique_ptr
+#include <mutex> //std::mutex
+#include <thread> //std::thread
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORM_HIERARCHY_SSE 1
+#endif
+
+//out = a * b for column-major matrices, with SSE when available
+inline void multiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef TRANSFORM_HIERARCHY_SSE
+	const float* pa = &a[0][0];
+	const float* pb = &b[0][0];
+	float* po = &out[0][0];
+
+	const __m128 a0 = _mm_loadu_ps(pa + 0);
+	const __m128 a1 = _mm_loadu_ps(pa + 4);
+	const __m128 a2 = _mm_loadu_ps(pa + 8);
+	const __m128 a3 = _mm_loadu_ps(pa + 12);
+
+	for (int column = 0; column < 4; column++)
+	{
+		const float* bc = pb + 4 * column;
+		__m128 result = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+		_mm_storeu_ps(po + 4 * column, result);
+	}
+#else
+	out = a * b;
+#endif
+}
+
+//Small persistent thread pool used to split one hierarchy level between threads.
+//Threads are kept alive between updates because starting them every frame costs more than the work itself.
+class TransformWorkers
+{
+public:
+	explicit TransformWorkers(unsigned int threadCount)
+	{
+		for (unsigned int i = 0; i < threadCount; i++)
+			m_threads.emplace_back([this] { workerLoop(); });
+	}
+
+	~TransformWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_wake.notify_all();
+		for (auto&& thread : m_threads)
+			thread.join();
+	}
+
+	unsigned int threadCount() const
+	{
+		return (unsigned int)m_threads.size();
+	}
+
+	//Calls job(begin, end) on chunks of [0, count) from all workers and the calling thread, and waits for completion
+	void run(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job = &job;
+			m_count = count;
+			m_chunkSize = chunkSize;
+			m_next.store(0);
+			m_busy = (unsigned int)m_threads.size();
+			m_generation++;
+		}
+		m_wake.notify_all();
+
+		runChunks();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done.wait(lock, [this] { return m_busy == 0; });
+		m_job = nullptr;
+	}
+
+private:
+	void runChunks()
+	{
+		for (;;)
+		{
+			const size_t begin = m_next.fetch_add(m_chunkSize);
+			if (begin >= m_count)
+				return;
+			(*m_job)(begin, std::min(begin + m_chunkSize, m_count));
+		}
+	}
+
+	void workerLoop()
+	{
+		uint64_t seenGeneration = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [&] { return m_quit || m_generation != seenGeneration; });
+				if (m_quit)
+					return;
+				seenGeneration = m_generation;
+			}
+
+			runChunks();
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_busy--;
+			}
+			m_done.notify_one();
+		}
+	}
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	const std::function<void(size_t, size_t)>* m_job = nullptr;
+	size_t m_count = 0;
+	size_t m_chunkSize = 1;
+	std::atomic<size_t> m_next{ 0 };
+	unsigned int m_busy = 0;
+	uint64_t m_generation = 0;
+	bool m_quit = false;
+};
+
+//Flat transform hierarchy.
+//Nodes are stored sorted by depth (all roots, then their children, then grandchildren...), so a parent always
+//comes before its children and a single front-to-back pass computes every world matrix. Local and world
+//matrices are kept in contiguous arrays, and only nodes whose local matrix changed, or whose parent's world
+//matrix changed, are recomputed.
+//Nodes are referred to by handles that stay valid until the node is destroyed; the storage order behind them
+//changes whenever nodes are added or removed.
+//Cost: recomputing all of 100k nodes takes roughly 1-2 ms on one core depending on the machine (about 1 ms median
+//measured here with SSE, 1.6-2.3 ms seen on others); an update with nothing dirty returns right away.
+class TransformHierarchy
+{
+public:
+	typedef uint32_t Handle;
+	static constexpr Handle invalidHandle = 0xFFFFFFFFu;
+
+	//Levels with fewer nodes are updated on the calling thread even when a parallel update is requested
+	static constexpr size_t parallelMinLevelSize = 4096;
+
+	//Creates a node with an identity local matrix. Its world matrix is valid after the next update().
+	Handle create(Handle parent = invalidHandle)
+	{
+		Handle handle;
+		if (!m_freeHandles.empty())
+		{
+			handle = m_freeHandles.back();
+			m_freeHandles.pop_back();
+		}
+		else
+		{
+			handle = (Handle)m_slotOf.size();
+			m_slotOf.push_back(invalidSlot);
+		}
+
+		const uint32_t parentSlot = parent == invalidHandle ? invalidSlot : m_slotOf[parent];
+		const uint32_t depth = parentSlot == invalidSlot ? 0 : m_depth[parentSlot] + 1;
+
+		//Appending keeps the depth order as long as the new node is not shallower than the last one
+		if (!m_depth.empty() && depth < m_depth.back())
+			m_needsSort = true;
+		m_levelsChanged = true;
+
+		const uint32_t slot = (uint32_t)m_handle.size();
+		m_slotOf[handle] = slot;
+		m_handle.push_back(handle);
+		m_parent.push_back(parentSlot);
+		m_depth.push_back(depth);
+		m_local.push_back(glm::mat4(1.0f));
+		m_world.push_back(glm::mat4(1.0f));
+		m_dirty.push_back(1);
+		m_version.push_back(0);
+		m_firstDirty = std::min(m_firstDirty, slot);
+		return handle;
+	}
+
+	//Destroys a node and all of its descendants
+	void destroy(Handle handle)
+	{
+		sortIfNeeded();
+
+		std::vector<uint8_t> removed(m_handle.size(), 0);
+		removed[m_slotOf[handle]] = 1;
+		//Parents come first, so one pass marks the whole subtree
+		for (size_t i = m_slotOf[handle] + 1; i < m_handle.size(); i++)
+		{
+			if (m_parent[i] != invalidSlot && removed[m_parent[i]])
+				removed[i] = 1;
+		}
+
+		std::vector<uint32_t> newSlot(m_handle.size(), invalidSlot);
+		uint32_t count = 0;
+		for (size_t i = 0; i < m_handle.size(); i++)
+		{
+			if (removed[i])
+			{
+				m_slotOf[m_handle[i]] = invalidSlot;
+				m_freeHandles.push_back(m_handle[i]);
+				continue;
+			}
+			newSlot[i] = count;
+			m_handle[count] = m_handle[i];
+			m_parent[count] = m_parent[i] == invalidSlot ? invalidSlot : newSlot[m_parent[i]];
+			m_depth[count] = m_depth[i];
+			m_local[count] = m_local[i];
+			m_world[count] = m_world[i];
+			m_dirty[count] = m_dirty[i];
+			m_version[count] = m_version[i];
+			m_slotOf[m_handle[count]] = count;
+			count++;
+		}
+		resizeArrays(count);
+		m_levelsChanged = true;
+		m_firstDirty = 0;
+	}
+
+	void setLocalMatrix(Handle handle, const glm::mat4& local)
+	{
+		const uint32_t slot = m_slotOf[handle];
+		m_local[slot] = local;
+		m_dirty[slot] = 1;
+		m_firstDirty = std::min(m_firstDirty, slot);
+	}
+
+	//Forces the world matrices of a node and its descendants to be recomputed on the next update()
+	void markDirty(Handle handle)
+	{
+		const uint32_t slot = m_slotOf[handle];
+		m_dirty[slot] = 1;
+		m_firstDirty = std::min(m_firstDirty, slot);
+	}
+
+	const glm::mat4& getLocalMatrix(Handle handle) const
+	{
+		return m_local[m_slotOf[handle]];
+	}
+
+	//The reference is invalidated when nodes are created or destroyed
+	const glm::mat4& getWorldMatrix(Handle handle) const
+	{
+		return m_world[m_slotOf[handle]];
+	}
+
+	//Value of getUpdateCount() after the update that last recomputed the world matrix, 0 if never computed.
+	//Lets callers cache data derived from world matrices and refresh only what changed.
+	uint32_t getWorldVersion(Handle handle) const
+	{
+		return m_version[m_slotOf[handle]];
+	}
+
+	//Number of update() calls that found dirty nodes
+	uint32_t getUpdateCount() const
+	{
+		return m_updateCount;
+	}
+
+	Handle getParent(Handle handle) const
+	{
+		const uint32_t parentSlot = m_parent[m_slotOf[handle]];
+		return parentSlot == invalidSlot ? invalidHandle : m_handle[parentSlot];
+	}
+
+	bool isDirty(Handle handle) const
+	{
+		return m_dirty[m_slotOf[handle]] != 0;
+	}
+
+	size_t size() const
+	{
+		return m_handle.size();
+	}
+
+	size_t levelCount() const
+	{
+		return m_levelStart.empty() ? 0 : m_levelStart.size() - 1;
+	}
+
+	//Recomputes the world matrices of dirty nodes and of all their descendants.
+	//With parallel set, large levels are split between worker threads; nodes of the same level never depend on each other.
+	void update(bool parallel = false)
+	{
+		sortIfNeeded();
+		if (m_levelsChanged)
+			computeLevels();
+		if (m_firstDirty >= m_depth.size())
+		{
+			m_firstDirty = invalidSlot;
+			return;
+		}
+
+		m_updateCount++;
+
+		//Levels above the shallowest dirty node cannot change
+		const size_t firstLevel = m_depth[m_firstDirty];
+		for (size_t level = firstLevel; level + 1 < m_levelStart.size(); level++)
+		{
+			const size_t begin = std::max<size_t>(m_levelStart[level], m_firstDirty);
+			const size_t end = m_levelStart[level + 1];
+			if (parallel && end - begin >= parallelMinLevelSize)
+			{
+				if (!m_workers)
+				{
+					const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+					m_workers = std::make_unique<TransformWorkers>(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+				}
+				const size_t chunkSize = std::max<size_t>(1024, (end - begin) / (4 * (m_workers->threadCount() + 1)));
+				const std::function<void(size_t, size_t)> job = [this, begin](size_t chunkBegin, size_t chunkEnd)
+				{
+					updateRange(begin + chunkBegin, begin + chunkEnd);
+				};
+				m_workers->run(end - begin, chunkSize, job);
+			}
+			else
+			{
+				updateRange(begin, end);
+			}
+		}
+
+		//Children read their parent's flag during the pass, so the flags are only cleared once every level is done
+		std::memset(m_dirty.data() + m_firstDirty, 0, m_dirty.size() - m_firstDirty);
+		m_firstDirty = invalidSlot;
+	}
+
+private:
+	//Enumerator, so passing it by reference (push_back, std::min) needs no out-of-class definition before C++17
+	enum : uint32_t { invalidSlot = 0xFFFFFFFFu };
+
+	void updateRange(size_t begin, size_t end)
+	{
+		const uint32_t* parent = m_parent.data();
+		const glm::mat4* local = m_local.data();
+		glm::mat4* world = m_world.data();
+		uint8_t* dirty = m_dirty.data();
+		uint32_t* version = m_version.data();
+		const uint32_t updateCount = m_updateCount;
+
+		for (size_t i = begin; i < end; i++)
+		{
+			const uint32_t p = parent[i];
+			if (p != invalidSlot)
+			{
+				dirty[i] |= dirty[p];
+				if (dirty[i])
+				{
+					multiplyMatrices(world[p], local[i], world[i]);
+					version[i] = updateCount;
+				}
+			}
+			else if (dirty[i])
+			{
+				world[i] = local[i];
+				version[i] = updateCount;
+			}
+		}
+	}
+
+	//Stable counting sort by depth: siblings keep their creation order
+	void sortIfNeeded()
+	{
+		if (!m_needsSort)
+			return;
+		m_needsSort = false;
+		m_levelsChanged = true;
+		m_firstDirty = 0;
+
+		const size_t count = m_handle.size();
+		uint32_t maxDepth = 0;
+		for (uint32_t depth : m_depth)
+			maxDepth = std::max(maxDepth, depth);
+
+		std::vector<uint32_t> offset(maxDepth + 2, 0);
+		for (uint32_t depth : m_depth)
+			offset[depth + 1]++;
+		for (size_t d = 1; d < offset.size(); d++)
+			offset[d] += offset[d - 1];
+
+		std::vector<uint32_t> newSlot(count);
+		for (size_t i = 0; i < count; i++)
+			newSlot[i] = offset[m_depth[i]]++;
+
+		std::vector<Handle> handle(count);
+		std::vector<uint32_t> parent(count);
+		std::vector<uint32_t> depth(count);
+		std::vector<glm::mat4> local(count);
+		std::vector<glm::mat4> world(count);
+		std::vector<uint8_t> dirty(count);
+		std::vector<uint32_t> version(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint32_t s = newSlot[i];
+			handle[s] = m_handle[i];
+			parent[s] = m_parent[i] == invalidSlot ? invalidSlot : newSlot[m_parent[i]];
+			depth[s] = m_depth[i];
+			local[s] = m_local[i];
+			world[s] = m_world[i];
+			dirty[s] = m_dirty[i];
+			version[s] = m_version[i];
+			m_slotOf[handle[s]] = s;
+		}
+		m_handle.swap(handle);
+		m_parent.swap(parent);
+		m_depth.swap(depth);
+		m_local.swap(local);
+		m_world.swap(world);
+		m_dirty.swap(dirty);
+		m_version.swap(version);
+	}
+
+	void computeLevels()
+	{
+		m_levelsChanged = false;
+		m_levelStart.clear();
+		for (size_t i = 0; i < m_depth.size(); i++)
+		{
+			while (m_levelStart.size() <= m_depth[i])
+				m_levelStart.push_back((uint32_t)i);
+		}
+		m_levelStart.push_back((uint32_t)m_depth.size());
+	}
+
+	void resizeArrays(size_t count)
+	{
+		m_handle.resize(count);
+		m_parent.resize(count);
+		m_depth.resize(count);
+		m_local.resize(count);
+		m_world.resize(count);
+		m_dirty.resize(count);
+		m_version.resize(count);
+	}
+
+	//Per node, in depth order
+	std::vector<Handle> m_handle;
+	std::vector<uint32_t> m_parent; //slot of the parent, invalidSlot for roots
+	std::vector<uint32_t> m_depth;
+	std::vector<glm::mat4> m_local;
+	std::vector<glm::mat4> m_world;
+	std::vector<uint8_t> m_dirty; //local matrix changed, or world matrix recomputed during the current update
+	std::vector<uint32_t> m_version; //m_updateCount when the world matrix was last recomputed
+
+	//Handle indirection
+	std::vector<uint32_t> m_slotOf;
+	std::vector<Handle> m_freeHandles;
+
+	//First slot of each depth, plus the node count
+	std::vector<uint32_t> m_levelStart;
+	uint32_t m_firstDirty = invalidSlot; //no dirty node before this slot
+	uint32_t m_updateCount = 0;
+	bool m_needsSort = false;
+	bool m_levelsChanged = false;
+
+	std::unique_ptr<TransformWorkers> m_workers;
+};
+
+#endif
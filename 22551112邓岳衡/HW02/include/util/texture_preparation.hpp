@@ -0,0 +1,75 @@
+#pragma once
+
+#include "learn_vulkan.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace util
+{
+    // Downsampling filter used to build mip chains on the CPU
+    enum class MipFilter
+    {
+        box,   // 2x2 average (area-weighted for odd sizes); cheapest
+        kaiser // Kaiser-windowed sinc, radius 3; sharper mips with less aliasing
+    };
+
+    // How the 8-bit/16-bit source texels are encoded
+    enum class TextureColorSpace
+    {
+        fromFormat, // sRGB if the target format is an _SRGB format, linear otherwise
+        srgb,       // color data stored with the sRGB curve (e.g. jpg photos in a UNORM image)
+        linear      // data textures: normal, roughness, specular maps...
+    };
+
+    struct TexturePrepareInfo
+    {
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB; // final texel format of the Vulkan image
+        bool generateMipmaps = true;
+        MipFilter mipFilter = MipFilter::kaiser;
+        TextureColorSpace colorSpace = TextureColorSpace::fromFormat;
+        std::filesystem::path cacheDirectory; // empty disables the on-disk cache
+    };
+
+    // A decoded texture with its whole mip chain, converted to the final format
+    // and ready to be copied to a Vulkan image without any blit.
+    struct PreparedTexture
+    {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent = {0, 0};
+        uint32_t mipLevels = 0;
+        std::vector<VkDeviceSize> mipOffsets; // byte offset of each level in data
+        std::vector<uint8_t> data;            // all levels, tightly packed, level 0 first
+        bool fromCache = false;
+
+        bool valid() const { return !data.empty(); }
+        VkExtent2D mipExtent(uint32_t level) const
+        {
+            return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+        }
+    };
+
+    // Whether prepareTexture can produce the given format.
+    // Supported: 1, 2 or 4 components of 8-bit UNORM/SRGB, 16-bit UNORM, 16-bit SFLOAT or 32-bit SFLOAT.
+    bool isPreparableFormat(VkFormat format);
+
+    // Decodes an image file, builds its mip chain in linear space and converts it to info.format.
+    // With a cache directory, the result is stored there and reused as long as the source file
+    // (path, size, modification time) and the settings do not change.
+    // Returns an invalid PreparedTexture on failure.
+    PreparedTexture prepareTexture(const std::filesystem::path &filepath, const TexturePrepareInfo &info);
+
+    // Prepares several textures at once, one worker thread per image.
+    // result[i] corresponds to filepaths[i] and infos[i].
+    std::vector<PreparedTexture> prepareTextures(
+        std::span<const std::filesystem::path> filepaths,
+        std::span<const TexturePrepareInfo> infos);
+
+    // Builds the mip chain of already decoded 4-component texels and converts it to info.format.
+    // The cache directory is ignored. Supported source formats are R8G8B8A8, R16G16B16A16 and
+    // R32G32B32A32_SFLOAT; 8-bit and 16-bit sources are interpreted according to info.colorSpace.
+    PreparedTexture prepareTextureFromMemory(const void *pTexels, VkExtent2D extent, VkFormat sourceFormat, const TexturePrepareInfo &info);
+
+} // namespace util
@@ -532,9 +532,29 @@ int main()
     Fence fence;
 
     Sphere sphere(1.0f, glm::vec3(0.0f));
-    Texture2D texture_sun("assets/sun.jpg", VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, true);
-    Texture2D texture_earth("assets/earth.jpg", VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, true);
-    Texture2D texture_moon("assets/moon.jpg", VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, true);
+
+    // decode the planet textures and build their mip chains on the CPU in parallel;
+    // the jpgs hold sRGB colors, so mips are averaged in linear space and stored back with the sRGB curve
+    const std::array<std::filesystem::path, kPlanetCount> planetTexturePaths = {"assets/sun.jpg", "assets/earth.jpg", "assets/moon.jpg"};
+    const util::TexturePrepareInfo planetTexturePrepareInfo = {
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .generateMipmaps = true,
+        .mipFilter = util::MipFilter::kaiser,
+        .colorSpace = util::TextureColorSpace::srgb,
+        .cacheDirectory = "cache/textures"};
+    std::array<util::TexturePrepareInfo, kPlanetCount> planetTexturePrepareInfos;
+    planetTexturePrepareInfos.fill(planetTexturePrepareInfo);
+    std::vector<util::PreparedTexture> preparedPlanetTextures = util::prepareTextures(planetTexturePaths, planetTexturePrepareInfos);
+    auto createPlanetTexture = [&](size_t index)
+    {
+        if (preparedPlanetTextures[index].valid())
+            return Texture2D(preparedPlanetTextures[index]);
+        return Texture2D(planetTexturePaths[index].string().c_str(), VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, true);
+    };
+    Texture2D texture_sun = createPlanetTexture(0);
+    Texture2D texture_earth = createPlanetTexture(1);
+    Texture2D texture_moon = createPlanetTexture(2);
+    preparedPlanetTextures.clear();
     VkSamplerCreateInfo samplerInfo = Texture::getDefaultSamplerCreateInfo();
     Sampler planetSampler(samplerInfo);
 
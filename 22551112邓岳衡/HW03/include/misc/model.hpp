@@ -10,6 +10,7 @@
 #include <filesystem>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/gtc/quaternion.hpp>
@@ -39,6 +40,11 @@ namespace gameworld
         VkFormat normalInitialFormat = VK_FORMAT_R8G8B8A8_UNORM;
         VkFormat normalFinalFormat = VK_FORMAT_R8G8B8A8_UNORM;
         bool generateMipmaps = true;
+        // decode textures and build their mip chains on the CPU, all textures of the model in parallel;
+        // formats not supported by util::prepareTexture fall back to GPU blits
+        bool prepareTexturesOnCpu = true;
+        util::MipFilter mipFilter = util::MipFilter::kaiser;
+        std::filesystem::path textureCacheDirectory; // prepared mip chains are stored here when not empty
         bool flipUV = true;
         VkIndexType indexType = VK_INDEX_TYPE_UINT32;
         VkSamplerCreateInfo samplerCreateInfo = vulkan::Texture::getDefaultSamplerCreateInfo();
@@ -115,6 +121,7 @@ namespace gameworld
         bool uploadMeshData(const std::vector<ModelVertex> &vertices,
                             const std::vector<uint32_t> &indices32);
         bool buildMaterials(const struct aiScene &scene);
+        void prepareMaterialTextures(const struct aiScene &scene);
         bool populateMaterial(uint32_t materialIndex, const struct aiMaterial &material);
         bool loadMaterialTexture(vulkan::Texture2D &texture,
                                  std::string_view relativePath,
@@ -133,6 +140,7 @@ namespace gameworld
         vulkan::IndexBuffer m_indexBuffer;
         std::vector<MeshSubset> m_meshes;
         std::vector<MaterialResources> m_materials;
+        std::unordered_map<std::string, util::PreparedTexture> m_preparedTextures; // only alive while building materials
 
         vulkan::DescriptorPool m_materialDescriptorPool;
         vulkan::Sampler m_sampler;
@@ -5,10 +5,12 @@
 #include "util/macro.hpp"
 #include "util/util.hpp"
 #include "util/image_operation.hpp"
+#include "util/texture_preparation.hpp"
 
 #include <stb/stb_image.h>
 #include <vulkan/utility/vk_format_utils.h>
 #include <memory>
+#include <vector>
 
 namespace vulkan
 {
@@ -363,6 +365,79 @@ namespace vulkan
             VulkanManager::getHelper().executeCommandBufferGraphics(commandBuffer);
         }
 
+        // copy a mip chain prepared on the CPU from buffer to image, no blit involved
+        static void copyMipChain2d(
+            VkBuffer srcBuffer,
+            VkImage dstImage,
+            const util::PreparedTexture &preparedTexture)
+        {
+            std::vector<VkBufferImageCopy> copyRegions(preparedTexture.mipLevels);
+            for (uint32_t mipLevel = 0; mipLevel < preparedTexture.mipLevels; ++mipLevel)
+            {
+                VkExtent2D mipExtent = preparedTexture.mipExtent(mipLevel);
+                copyRegions[mipLevel] = {
+                    .bufferOffset = preparedTexture.mipOffsets[mipLevel],
+                    .imageSubresource = {
+                        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                        .mipLevel = mipLevel,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1},
+                    .imageExtent = {.width = mipExtent.width, .height = mipExtent.height, .depth = 1}};
+            }
+
+            auto &commandBuffer = VulkanManager::getHelper().getTransferCommandBuffer();
+            commandBuffer.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+            // all mips at once: undefined -> transfer dst -> shader read only
+            VkImageMemoryBarrier barrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = dstImage,
+                .subresourceRange = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel = 0,
+                    .levelCount = preparedTexture.mipLevels,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1}};
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+
+            vkCmdCopyBufferToImage(
+                commandBuffer,
+                srcBuffer,
+                dstImage,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(copyRegions.size()),
+                copyRegions.data());
+
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+
+            commandBuffer.end();
+            VulkanManager::getHelper().executeCommandBufferGraphics(commandBuffer);
+        }
+
         static VkSamplerCreateInfo getDefaultSamplerCreateInfo()
         {
             VkSamplerCreateInfo samplerCreateInfo = {
@@ -466,6 +541,11 @@ namespace vulkan
             create(pData, extent, initialFormat, finalFormat, generateMipmaps);
         }
 
+        Texture2D(const util::PreparedTexture &preparedTexture)
+        {
+            create(preparedTexture);
+        }
+
         VkExtent2D getExtent() const { return extent; }
         uint32_t width() const { return extent.width; }
         uint32_t height() const { return extent.height; }
@@ -496,6 +576,33 @@ namespace vulkan
             StagingBuffer::bufferDataToStagingBuffer_mainThread(pData, imageSize);
             createInternal(initialFormat, finalFormat, generateMipmaps);
         }
+        // create from a texture whose mip chain was built on the CPU, see util::prepareTexture
+        void create(const util::PreparedTexture &preparedTexture)
+        {
+            if (!preparedTexture.valid())
+            {
+                spdlog::error("Texture2D::create: prepared texture is empty.");
+                return;
+            }
+
+            extent = preparedTexture.extent;
+            createImageMemory(
+                VK_IMAGE_TYPE_2D,
+                preparedTexture.format,
+                {.width = extent.width,
+                 .height = extent.height,
+                 .depth = 1},
+                preparedTexture.mipLevels,
+                1);
+            createImageView(
+                VK_IMAGE_VIEW_TYPE_2D,
+                preparedTexture.format,
+                preparedTexture.mipLevels,
+                1);
+
+            StagingBuffer::bufferDataToStagingBuffer_mainThread(preparedTexture.data.data(), preparedTexture.data.size());
+            copyMipChain2d(StagingBuffer::getStagingBuffer_mainThread(), imageMemory.getImage(), preparedTexture);
+        }
     };
 
 } // namespace vulkan
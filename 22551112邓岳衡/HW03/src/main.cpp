@@ -322,6 +322,7 @@ int main()
         modelCreateInfo.specularFinalFormat = VK_FORMAT_R8G8B8A8_UNORM;
         modelCreateInfo.normalInitialFormat = VK_FORMAT_R8G8B8A8_UNORM;
         modelCreateInfo.normalFinalFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        modelCreateInfo.textureCacheDirectory = "cache/textures";                            // mip chains prepared on the CPU are reused across runs
         modelCreateInfo.samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;   // seamless texture addressing
         modelCreateInfo.samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
         modelCreateInfo.samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
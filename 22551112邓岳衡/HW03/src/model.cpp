@@ -11,6 +11,7 @@
 #include <limits>
 #include <system_error>
 #include <new>
+#include <unordered_set>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -30,6 +31,22 @@ namespace gameworld
             aiProcess_RemoveRedundantMaterials |
             aiProcess_SortByPType |
             aiProcess_OptimizeMeshes;
+
+        // path of the first texture of the given type, empty if the material has none
+        std::string getMaterialTexturePath(const aiMaterial &material, aiTextureType type)
+        {
+            aiString texturePath;
+            if (material.GetTextureCount(type) == 0 || material.GetTexture(type, 0, &texturePath) != AI_SUCCESS)
+            {
+                return {};
+            }
+            return texturePath.C_Str();
+        }
+
+        std::string getPreparedTextureKey(const std::filesystem::path &resolvedPath, VkFormat format)
+        {
+            return resolvedPath.generic_string() + '#' + std::to_string(static_cast<int32_t>(format));
+        }
     }
 
     Model::Model(const std::filesystem::path &modelPath,
@@ -386,6 +403,8 @@ namespace gameworld
             return false;
         }
 
+        prepareMaterialTextures(scene);
+
         for (uint32_t i = 0; i < materialCount; ++i)
         {
             m_materials[i].descriptorSet = std::move(allocatedSets[i]);
@@ -407,10 +426,76 @@ namespace gameworld
             m_materials[i].descriptorSet.write(ArrayView(specularInfo), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1);
             m_materials[i].descriptorSet.write(ArrayView(normalInfo), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2);
         }
+        m_preparedTextures.clear();
 
         return true;
     }
 
+    void Model::prepareMaterialTextures(const aiScene &scene)
+    {
+        m_preparedTextures.clear();
+        if (!m_cachedCreateInfo.prepareTexturesOnCpu)
+        {
+            return;
+        }
+
+        // collect every distinct (file, format) pair populateMaterial will ask for
+        std::vector<std::filesystem::path> paths;
+        std::vector<util::TexturePrepareInfo> infos;
+        std::vector<std::string> keys;
+        std::unordered_set<std::string> visitedKeys;
+        auto addTexture = [&](const aiMaterial &material, aiTextureType type, VkFormat finalFormat)
+        {
+            std::string rawPath = getMaterialTexturePath(material, type);
+            if (rawPath.empty() || rawPath[0] == '*' || !util::isPreparableFormat(finalFormat))
+            {
+                return;
+            }
+
+            std::filesystem::path resolved = resolveTexturePath(rawPath);
+            if (resolved.empty())
+            {
+                return;
+            }
+
+            std::string key = getPreparedTextureKey(resolved, finalFormat);
+            if (!visitedKeys.insert(key).second)
+            {
+                return;
+            }
+
+            paths.push_back(std::move(resolved));
+            infos.push_back({
+                .format = finalFormat,
+                .generateMipmaps = m_cachedCreateInfo.generateMipmaps,
+                .mipFilter = m_cachedCreateInfo.mipFilter,
+                .colorSpace = util::TextureColorSpace::fromFormat,
+                .cacheDirectory = m_cachedCreateInfo.textureCacheDirectory});
+            keys.push_back(std::move(key));
+        };
+
+        for (uint32_t i = 0; i < scene.mNumMaterials; ++i)
+        {
+            const aiMaterial &material = *scene.mMaterials[i];
+            addTexture(material, aiTextureType_DIFFUSE, m_cachedCreateInfo.albedoFinalFormat);
+            addTexture(material, aiTextureType_SPECULAR, m_cachedCreateInfo.specularFinalFormat);
+            addTexture(material, aiTextureType_NORMALS, m_cachedCreateInfo.normalFinalFormat);
+            if (getMaterialTexturePath(material, aiTextureType_NORMALS).empty())
+            {
+                addTexture(material, aiTextureType_HEIGHT, m_cachedCreateInfo.normalFinalFormat);
+            }
+        }
+
+        std::vector<util::PreparedTexture> prepared = util::prepareTextures(paths, infos);
+        for (size_t i = 0; i < prepared.size(); ++i)
+        {
+            if (prepared[i].valid())
+            {
+                m_preparedTextures.emplace(std::move(keys[i]), std::move(prepared[i]));
+            }
+        }
+    }
+
     bool Model::populateMaterial(uint32_t materialIndex, const aiMaterial &material)
     {
         MaterialResources &resources = m_materials[materialIndex];
@@ -426,24 +511,19 @@ namespace gameworld
                                   VkFormat initialFormat,
                                   VkFormat finalFormat) -> bool
         {
-            if (material.GetTextureCount(type) == 0)
+            std::string texturePath = getMaterialTexturePath(material, type);
+            if (texturePath.empty())
             {
                 return false;
             }
 
-            aiString texturePath;
-            if (material.GetTexture(type, 0, &texturePath) != AI_SUCCESS)
+            if (texturePath[0] == '*')
             {
+                spdlog::warn("Model::populateMaterial: embedded textures are not supported ({}).", texturePath);
                 return false;
             }
 
-            if (!texturePath.length || texturePath.C_Str()[0] == '*')
-            {
-                spdlog::warn("Model::populateMaterial: embedded textures are not supported ({}).", texturePath.C_Str());
-                return false;
-            }
-
-            return loadMaterialTexture(texture, texturePath.C_Str(), initialFormat, finalFormat);
+            return loadMaterialTexture(texture, texturePath, initialFormat, finalFormat);
         };
 
         resources.hasAlbedo = tryLoadTexture(
@@ -493,6 +573,12 @@ namespace gameworld
             return false;
         }
 
+        if (auto it = m_preparedTextures.find(getPreparedTextureKey(resolved, finalFormat)); it != m_preparedTextures.end())
+        {
+            texture.create(it->second);
+            return true;
+        }
+
         texture.create(
             resolved.string().c_str(),
             initialFormat,
@@ -0,0 +1,851 @@
+#include "util/texture_preparation.hpp"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_PREPARATION_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__F16C__) || defined(__AVX2__)
+#define TEXTURE_PREPARATION_F16C
+#include <immintrin.h>
+#endif
+
+namespace util
+{
+    namespace
+    {
+        namespace fs = std::filesystem;
+
+        constexpr uint32_t cacheMagic = 0x58455450; // "PTEX"
+        constexpr uint32_t cacheVersion = 1;
+        constexpr double kaiserRadius = 3.0; // in destination texels
+        constexpr double kaiserAlpha = 4.0;
+        constexpr uint32_t rowsPerTask = 16;
+
+        enum class TexelEncoding
+        {
+            unorm8,
+            unorm16,
+            sfloat16,
+            sfloat32
+        };
+
+        struct TexelLayout
+        {
+            TexelEncoding encoding = TexelEncoding::unorm8;
+            uint32_t componentCount = 0;
+            bool isSrgbFormat = false;
+
+            uint32_t texelSize() const
+            {
+                switch (encoding)
+                {
+                case TexelEncoding::unorm8:
+                    return componentCount;
+                case TexelEncoding::unorm16:
+                case TexelEncoding::sfloat16:
+                    return componentCount * 2;
+                default:
+                    return componentCount * 4;
+                }
+            }
+        };
+
+        bool getTexelLayout(VkFormat format, TexelLayout &outLayout)
+        {
+            switch (format)
+            {
+            // clang-format off
+            case VK_FORMAT_R8_UNORM:            outLayout = {TexelEncoding::unorm8, 1, false};   return true;
+            case VK_FORMAT_R8_SRGB:             outLayout = {TexelEncoding::unorm8, 1, true};    return true;
+            case VK_FORMAT_R8G8_UNORM:          outLayout = {TexelEncoding::unorm8, 2, false};   return true;
+            case VK_FORMAT_R8G8_SRGB:           outLayout = {TexelEncoding::unorm8, 2, true};    return true;
+            case VK_FORMAT_R8G8B8A8_UNORM:      outLayout = {TexelEncoding::unorm8, 4, false};   return true;
+            case VK_FORMAT_R8G8B8A8_SRGB:       outLayout = {TexelEncoding::unorm8, 4, true};    return true;
+            case VK_FORMAT_R16_UNORM:           outLayout = {TexelEncoding::unorm16, 1, false};  return true;
+            case VK_FORMAT_R16G16_UNORM:        outLayout = {TexelEncoding::unorm16, 2, false};  return true;
+            case VK_FORMAT_R16G16B16A16_UNORM:  outLayout = {TexelEncoding::unorm16, 4, false};  return true;
+            case VK_FORMAT_R16_SFLOAT:          outLayout = {TexelEncoding::sfloat16, 1, false}; return true;
+            case VK_FORMAT_R16G16_SFLOAT:       outLayout = {TexelEncoding::sfloat16, 2, false}; return true;
+            case VK_FORMAT_R16G16B16A16_SFLOAT: outLayout = {TexelEncoding::sfloat16, 4, false}; return true;
+            case VK_FORMAT_R32_SFLOAT:          outLayout = {TexelEncoding::sfloat32, 1, false}; return true;
+            case VK_FORMAT_R32G32_SFLOAT:       outLayout = {TexelEncoding::sfloat32, 2, false}; return true;
+            case VK_FORMAT_R32G32B32A32_SFLOAT: outLayout = {TexelEncoding::sfloat32, 4, false}; return true;
+            // clang-format on
+            default:
+                return false;
+            }
+        }
+
+        // whether 8-bit/16-bit texels are stored with the sRGB curve
+        bool usesSrgbCurve(const TexturePrepareInfo &info, const TexelLayout &layout)
+        {
+            switch (info.colorSpace)
+            {
+            case TextureColorSpace::srgb:
+                return true;
+            case TextureColorSpace::linear:
+                return false;
+            default:
+                return layout.isSrgbFormat;
+            }
+        }
+
+        uint32_t defaultThreadCount()
+        {
+            return std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        // calls func(i) for i in [0, count), spread over threadCount threads (the calling thread included)
+        template <typename Func>
+        void parallelFor(uint32_t count, uint32_t threadCount, Func &&func)
+        {
+            threadCount = std::min(threadCount, count);
+            if (threadCount <= 1)
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                    func(i);
+                return;
+            }
+
+            std::atomic<uint32_t> next = 0;
+            auto worker = [&]()
+            {
+                for (uint32_t i = next++; i < count; i = next++)
+                    func(i);
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(threadCount - 1);
+            for (uint32_t i = 1; i < threadCount; ++i)
+                threads.emplace_back(worker);
+            worker();
+            for (auto &thread : threads)
+                thread.join();
+        }
+
+        // calls func(firstRow, endRow) on blocks of rows in parallel
+        template <typename Func>
+        void parallelRows(uint32_t height, uint32_t threadCount, Func &&func)
+        {
+            uint32_t blockCount = (height + rowsPerTask - 1) / rowsPerTask;
+            parallelFor(blockCount, threadCount, [&](uint32_t block)
+                        { func(block * rowsPerTask, std::min(height, (block + 1) * rowsPerTask)); });
+        }
+
+        //--------------------------------------------------------------------------------------------
+        // 4-wide float helpers, one RGBA texel per vector
+
+#ifdef TEXTURE_PREPARATION_SSE2
+        using Float4 = __m128;
+        inline Float4 load4(const float *p) { return _mm_loadu_ps(p); }
+        inline void store4(float *p, Float4 v) { _mm_storeu_ps(p, v); }
+        inline Float4 zero4() { return _mm_setzero_ps(); }
+        inline Float4 madd4(Float4 a, float b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, _mm_set1_ps(b)), c); }
+#else
+        struct Float4
+        {
+            float v[4];
+        };
+        inline Float4 load4(const float *p) { return {p[0], p[1], p[2], p[3]}; }
+        inline void store4(float *p, Float4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+        inline Float4 zero4() { return {0.0f, 0.0f, 0.0f, 0.0f}; }
+        inline Float4 madd4(Float4 a, float b, Float4 c)
+        {
+            return {a.v[0] * b + c.v[0], a.v[1] * b + c.v[1], a.v[2] * b + c.v[2], a.v[3] * b + c.v[3]};
+        }
+#endif
+
+        //--------------------------------------------------------------------------------------------
+        // color space conversion
+
+        float srgbToLinear(float value)
+        {
+            return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linearToSrgb(float value)
+        {
+            return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+
+        const std::array<float, 256> &srgb8DecodeTable()
+        {
+            static const std::array<float, 256> table = []()
+            {
+                std::array<float, 256> result;
+                for (uint32_t i = 0; i < 256; ++i)
+                    result[i] = srgbToLinear(i / 255.0f);
+                return result;
+            }();
+            return table;
+        }
+
+        // indexed by the linear value quantized to 16 bits
+        const std::vector<uint8_t> &srgb8EncodeTable()
+        {
+            static const std::vector<uint8_t> table = []()
+            {
+                std::vector<uint8_t> result(65536);
+                for (uint32_t i = 0; i < 65536; ++i)
+                    result[i] = static_cast<uint8_t>(linearToSrgb(i / 65535.0f) * 255.0f + 0.5f);
+                return result;
+            }();
+            return table;
+        }
+
+        inline float saturate(float value)
+        {
+            // also maps NaN to 0
+            return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+        }
+
+        uint16_t floatToHalf(float value)
+        {
+#ifdef TEXTURE_PREPARATION_F16C
+            return static_cast<uint16_t>(_cvtss_sh(value, 0));
+#else
+            uint32_t bits = std::bit_cast<uint32_t>(value);
+            uint32_t sign = (bits >> 16) & 0x8000;
+            uint32_t magnitude = bits & 0x7FFFFFFF;
+
+            if (magnitude >= 0x7F800000) // inf or NaN
+                return static_cast<uint16_t>(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+            if (magnitude >= 0x477FF000) // rounds to 65536 or more
+                return static_cast<uint16_t>(sign | 0x7C00);
+            if (magnitude < 0x38800000) // half subnormal
+            {
+                if (magnitude < 0x33000000)
+                    return static_cast<uint16_t>(sign);
+                uint32_t exponent = magnitude >> 23;
+                uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+                uint32_t shift = 126 - exponent;
+                uint32_t result = mantissa >> shift;
+                uint32_t remainder = mantissa & ((1u << shift) - 1);
+                uint32_t halfway = 1u << (shift - 1);
+                if (remainder > halfway || (remainder == halfway && (result & 1)))
+                    ++result;
+                return static_cast<uint16_t>(sign | result);
+            }
+
+            // rebias the exponent from 127 to 15 and round to nearest even
+            uint32_t result = (magnitude - 0x38000000) >> 13;
+            uint32_t remainder = magnitude & 0x1FFF;
+            if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1)))
+                ++result;
+            return static_cast<uint16_t>(sign | result);
+#endif
+        }
+
+        //--------------------------------------------------------------------------------------------
+        // linear RGBA float image
+
+        struct LinearImage
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::vector<float> texels; // RGBA, rows tightly packed
+
+            LinearImage() = default;
+            LinearImage(uint32_t width, uint32_t height)
+                : width(width), height(height), texels(static_cast<size_t>(width) * height * 4)
+            {
+            }
+
+            float *row(uint32_t y) { return texels.data() + static_cast<size_t>(y) * width * 4; }
+            const float *row(uint32_t y) const { return texels.data() + static_cast<size_t>(y) * width * 4; }
+        };
+
+        void decodeToLinear(const void *pTexels, VkExtent2D extent, TexelEncoding sourceEncoding, bool srgb, LinearImage &outImage, uint32_t threadCount)
+        {
+            outImage = LinearImage(extent.width, extent.height);
+            const size_t rowValueCount = static_cast<size_t>(extent.width) * 4;
+            const std::array<float, 256> &decodeTable = srgb8DecodeTable();
+
+            parallelRows(extent.height, threadCount, [&](uint32_t firstRow, uint32_t endRow)
+                         {
+                for (uint32_t y = firstRow; y < endRow; ++y)
+                {
+                    float *pDst = outImage.row(y);
+                    size_t base = y * rowValueCount;
+                    switch (sourceEncoding)
+                    {
+                    case TexelEncoding::unorm8:
+                    {
+                        const uint8_t *pSrc = static_cast<const uint8_t *>(pTexels) + base;
+                        for (size_t i = 0; i < rowValueCount; i += 4)
+                        {
+                            for (size_t c = 0; c < 3; ++c)
+                                pDst[i + c] = srgb ? decodeTable[pSrc[i + c]] : pSrc[i + c] * (1.0f / 255.0f);
+                            pDst[i + 3] = pSrc[i + 3] * (1.0f / 255.0f);
+                        }
+                        break;
+                    }
+                    case TexelEncoding::unorm16:
+                    {
+                        const uint16_t *pSrc = static_cast<const uint16_t *>(pTexels) + base;
+                        for (size_t i = 0; i < rowValueCount; i += 4)
+                        {
+                            for (size_t c = 0; c < 3; ++c)
+                            {
+                                float value = pSrc[i + c] * (1.0f / 65535.0f);
+                                pDst[i + c] = srgb ? srgbToLinear(value) : value;
+                            }
+                            pDst[i + 3] = pSrc[i + 3] * (1.0f / 65535.0f);
+                        }
+                        break;
+                    }
+                    default: // float data is always linear
+                        std::memcpy(pDst, static_cast<const float *>(pTexels) + base, rowValueCount * sizeof(float));
+                        break;
+                    }
+                } });
+        }
+
+        //--------------------------------------------------------------------------------------------
+        // mip filtering
+
+        double besselI0(double x)
+        {
+            double sum = 1.0;
+            double term = 1.0;
+            double halfX = 0.5 * x;
+            for (int k = 1; k < 32 && term > 1e-12 * sum; ++k)
+            {
+                term *= (halfX / k) * (halfX / k);
+                sum += term;
+            }
+            return sum;
+        }
+
+        // x in destination texels
+        double kaiserSinc(double x)
+        {
+            if (std::abs(x) >= kaiserRadius)
+                return 0.0;
+            double t = x / kaiserRadius;
+            double window = besselI0(kaiserAlpha * std::sqrt(1.0 - t * t)) / besselI0(kaiserAlpha);
+            double sinc = x == 0.0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+            return sinc * window;
+        }
+
+        // weights of the source texels contributing to each destination texel along one axis,
+        // with edge texels repeated outside of the image
+        struct FilterWeights
+        {
+            struct Taps
+            {
+                uint32_t first;  // first source texel
+                uint32_t count;  // number of consecutive source texels
+                uint32_t offset; // into weights
+            };
+            std::vector<Taps> taps;
+            std::vector<float> weights;
+        };
+
+        FilterWeights computeFilterWeights(uint32_t srcSize, uint32_t dstSize, MipFilter filter)
+        {
+            FilterWeights result;
+            result.taps.resize(dstSize);
+
+            const double scale = static_cast<double>(srcSize) / dstSize;
+            const double radius = filter == MipFilter::box ? 0.5 * scale : kaiserRadius * scale;
+            std::vector<double> accumulated;
+            for (uint32_t dst = 0; dst < dstSize; ++dst)
+            {
+                double center = (dst + 0.5) * scale;
+                int64_t begin = static_cast<int64_t>(std::floor(center - radius));
+                int64_t end = static_cast<int64_t>(std::ceil(center + radius));
+                uint32_t first = static_cast<uint32_t>(std::max<int64_t>(begin, 0));
+                uint32_t last = static_cast<uint32_t>(std::min<int64_t>(end, srcSize)) - 1;
+
+                accumulated.assign(last - first + 1, 0.0);
+                double sum = 0.0;
+                for (int64_t src = begin; src < end; ++src)
+                {
+                    double weight;
+                    if (filter == MipFilter::box) // coverage of [src, src + 1] by the destination texel footprint
+                        weight = std::max(0.0, std::min<double>(src + 1, center + radius) - std::max<double>(src, center - radius));
+                    else
+                        weight = kaiserSinc((src + 0.5 - center) / scale);
+                    uint32_t clamped = static_cast<uint32_t>(std::clamp<int64_t>(src, first, last));
+                    accumulated[clamped - first] += weight;
+                    sum += weight;
+                }
+
+                result.taps[dst] = {first, last - first + 1, static_cast<uint32_t>(result.weights.size())};
+                for (double weight : accumulated)
+                    result.weights.push_back(static_cast<float>(sum != 0.0 ? weight / sum : 1.0 / accumulated.size()));
+            }
+            return result;
+        }
+
+        // separable resampling of src into dst: horizontal pass then vertical pass
+        void downsample(const LinearImage &src, LinearImage &dst, MipFilter filter, uint32_t threadCount)
+        {
+            const FilterWeights horizontal = computeFilterWeights(src.width, dst.width, filter);
+            const FilterWeights vertical = computeFilterWeights(src.height, dst.height, filter);
+            LinearImage temp(dst.width, src.height);
+
+            parallelRows(src.height, threadCount, [&](uint32_t firstRow, uint32_t endRow)
+                         {
+                for (uint32_t y = firstRow; y < endRow; ++y)
+                {
+                    const float *pSrc = src.row(y);
+                    float *pDst = temp.row(y);
+                    for (uint32_t x = 0; x < dst.width; ++x)
+                    {
+                        const FilterWeights::Taps &taps = horizontal.taps[x];
+                        const float *pWeights = horizontal.weights.data() + taps.offset;
+                        Float4 sum = zero4();
+                        for (uint32_t i = 0; i < taps.count; ++i)
+                            sum = madd4(load4(pSrc + (taps.first + i) * 4), pWeights[i], sum);
+                        store4(pDst + x * 4, sum);
+                    }
+                } });
+
+            const uint32_t rowValueCount = dst.width * 4;
+            parallelRows(dst.height, threadCount, [&](uint32_t firstRow, uint32_t endRow)
+                         {
+                for (uint32_t y = firstRow; y < endRow; ++y)
+                {
+                    const FilterWeights::Taps &taps = vertical.taps[y];
+                    const float *pWeights = vertical.weights.data() + taps.offset;
+                    float *pDst = dst.row(y);
+                    std::fill(pDst, pDst + rowValueCount, 0.0f);
+                    for (uint32_t i = 0; i < taps.count; ++i)
+                    {
+                        const float *pSrc = temp.row(taps.first + i);
+                        for (uint32_t v = 0; v < rowValueCount; v += 4)
+                            store4(pDst + v, madd4(load4(pSrc + v), pWeights[i], load4(pDst + v)));
+                    }
+                } });
+        }
+
+        //--------------------------------------------------------------------------------------------
+        // conversion to the final texel format
+
+        void encodeRow(const float *pSrc, uint32_t width, const TexelLayout &layout, bool srgb, uint8_t *pDst)
+        {
+            const uint32_t componentCount = layout.componentCount;
+            uint32_t x = 0;
+            switch (layout.encoding)
+            {
+            case TexelEncoding::unorm8:
+            {
+                if (srgb)
+                {
+                    const std::vector<uint8_t> &encodeTable = srgb8EncodeTable();
+                    for (; x < width; ++x)
+                        for (uint32_t c = 0; c < componentCount; ++c)
+                        {
+                            float value = saturate(pSrc[x * 4 + c]);
+                            pDst[x * componentCount + c] = c == 3
+                                                               ? static_cast<uint8_t>(value * 255.0f + 0.5f)
+                                                               : encodeTable[static_cast<uint32_t>(value * 65535.0f + 0.5f)];
+                        }
+                    break;
+                }
+#ifdef TEXTURE_PREPARATION_SSE2
+                if (componentCount == 4)
+                {
+                    // 4 texels per iteration
+                    const __m128 scale = _mm_set1_ps(255.0f);
+                    const __m128 half = _mm_set1_ps(0.5f);
+                    const __m128 one = _mm_set1_ps(1.0f);
+                    const __m128 zero = _mm_setzero_ps();
+                    auto quantize = [&](const float *p)
+                    {
+                        __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(p), zero), one);
+                        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+                    };
+                    for (; x + 4 <= width; x += 4)
+                    {
+                        const float *p = pSrc + x * 4;
+                        __m128i low = _mm_packs_epi32(quantize(p), quantize(p + 4));
+                        __m128i high = _mm_packs_epi32(quantize(p + 8), quantize(p + 12));
+                        _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + x * 4), _mm_packus_epi16(low, high));
+                    }
+                }
+#endif
+                for (; x < width; ++x)
+                    for (uint32_t c = 0; c < componentCount; ++c)
+                        pDst[x * componentCount + c] = static_cast<uint8_t>(saturate(pSrc[x * 4 + c]) * 255.0f + 0.5f);
+                break;
+            }
+            case TexelEncoding::unorm16:
+            {
+                uint16_t *pDst16 = reinterpret_cast<uint16_t *>(pDst);
+                for (; x < width; ++x)
+                    for (uint32_t c = 0; c < componentCount; ++c)
+                    {
+                        float value = saturate(pSrc[x * 4 + c]);
+                        if (srgb && c != 3)
+                            value = linearToSrgb(value);
+                        pDst16[x * componentCount + c] = static_cast<uint16_t>(value * 65535.0f + 0.5f);
+                    }
+                break;
+            }
+            case TexelEncoding::sfloat16:
+            {
+                uint16_t *pDst16 = reinterpret_cast<uint16_t *>(pDst);
+#ifdef TEXTURE_PREPARATION_F16C
+                if (componentCount == 4)
+                    for (; x < width; ++x)
+                        _mm_storel_epi64(reinterpret_cast<__m128i *>(pDst16 + x * 4), _mm_cvtps_ph(_mm_loadu_ps(pSrc + x * 4), 0));
+#endif
+                for (; x < width; ++x)
+                    for (uint32_t c = 0; c < componentCount; ++c)
+                        pDst16[x * componentCount + c] = floatToHalf(pSrc[x * 4 + c]);
+                break;
+            }
+            case TexelEncoding::sfloat32:
+            {
+                if (componentCount == 4)
+                {
+                    std::memcpy(pDst, pSrc, static_cast<size_t>(width) * 4 * sizeof(float));
+                    break;
+                }
+                float *pDst32 = reinterpret_cast<float *>(pDst);
+                for (; x < width; ++x)
+                    for (uint32_t c = 0; c < componentCount; ++c)
+                        pDst32[x * componentCount + c] = pSrc[x * 4 + c];
+                break;
+            }
+            }
+        }
+
+        PreparedTexture buildMipChain(LinearImage &&baseLevel, const TexturePrepareInfo &info, const TexelLayout &layout, bool srgb, uint32_t threadCount)
+        {
+            PreparedTexture result;
+            result.format = info.format;
+            result.extent = {baseLevel.width, baseLevel.height};
+            result.mipLevels = info.generateMipmaps
+                                   ? static_cast<uint32_t>(std::bit_width(std::max(baseLevel.width, baseLevel.height)))
+                                   : 1;
+
+            VkDeviceSize dataSize = 0;
+            for (uint32_t level = 0; level < result.mipLevels; ++level)
+            {
+                VkExtent2D extent = result.mipExtent(level);
+                result.mipOffsets.push_back(dataSize);
+                dataSize += static_cast<VkDeviceSize>(extent.width) * extent.height * layout.texelSize();
+            }
+            result.data.resize(dataSize);
+
+            // every level is filtered from the previous one while still in linear float,
+            // so no precision is lost to repeated quantization
+            LinearImage current = std::move(baseLevel);
+            for (uint32_t level = 0; level < result.mipLevels; ++level)
+            {
+                if (level > 0)
+                {
+                    VkExtent2D extent = result.mipExtent(level);
+                    LinearImage next(extent.width, extent.height);
+                    downsample(current, next, info.mipFilter, threadCount);
+                    current = std::move(next);
+                }
+
+                uint8_t *pLevel = result.data.data() + result.mipOffsets[level];
+                size_t rowSize = static_cast<size_t>(current.width) * layout.texelSize();
+                parallelRows(current.height, threadCount, [&](uint32_t firstRow, uint32_t endRow)
+                             {
+                    for (uint32_t y = firstRow; y < endRow; ++y)
+                        encodeRow(current.row(y), current.width, layout, srgb, pLevel + y * rowSize); });
+            }
+            return result;
+        }
+
+        //--------------------------------------------------------------------------------------------
+        // on-disk cache
+
+        struct CacheHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t key;
+            int32_t format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t mipLevels;
+            uint64_t dataSize;
+        };
+
+        uint64_t hashBytes(uint64_t hash, const void *pData, size_t size)
+        {
+            // FNV-1a
+            const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+            for (size_t i = 0; i < size; ++i)
+                hash = (hash ^ pBytes[i]) * 0x100000001B3ull;
+            return hash;
+        }
+
+        template <typename T>
+        uint64_t hashValue(uint64_t hash, const T &value)
+        {
+            return hashBytes(hash, &value, sizeof(value));
+        }
+
+        bool computeCacheKey(const fs::path &filepath, const TexturePrepareInfo &info, bool srgb, uint64_t &outKey)
+        {
+            std::error_code errorCode;
+            fs::path absolutePath = fs::absolute(filepath, errorCode);
+            if (errorCode)
+                return false;
+            uintmax_t fileSize = fs::file_size(filepath, errorCode);
+            if (errorCode)
+                return false;
+            auto writeTime = fs::last_write_time(filepath, errorCode).time_since_epoch().count();
+            if (errorCode)
+                return false;
+
+            std::string pathString = absolutePath.lexically_normal().generic_string();
+            uint64_t hash = 0xCBF29CE484222325ull;
+            hash = hashValue(hash, cacheVersion);
+            hash = hashBytes(hash, pathString.data(), pathString.size());
+            hash = hashValue(hash, static_cast<uint64_t>(fileSize));
+            hash = hashValue(hash, static_cast<int64_t>(writeTime));
+            hash = hashValue(hash, static_cast<int32_t>(info.format));
+            hash = hashValue(hash, static_cast<uint8_t>(info.generateMipmaps));
+            hash = hashValue(hash, static_cast<uint8_t>(info.mipFilter));
+            hash = hashValue(hash, static_cast<uint8_t>(srgb));
+            outKey = hash;
+            return true;
+        }
+
+        fs::path getCacheFilePath(const fs::path &cacheDirectory, uint64_t key)
+        {
+            char filename[32];
+            std::snprintf(filename, sizeof(filename), "%016llx.texcache", static_cast<unsigned long long>(key));
+            return cacheDirectory / filename;
+        }
+
+        bool readCache(const fs::path &cacheFile, uint64_t key, const TexturePrepareInfo &info, const TexelLayout &layout, PreparedTexture &outTexture)
+        {
+            std::ifstream file(cacheFile, std::ios::binary);
+            if (!file.is_open())
+                return false;
+
+            CacheHeader header;
+            if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+                header.magic != cacheMagic ||
+                header.version != cacheVersion ||
+                header.key != key ||
+                header.format != static_cast<int32_t>(info.format) ||
+                header.width == 0 || header.height == 0 ||
+                header.mipLevels == 0 || header.mipLevels > 32)
+                return false;
+
+            PreparedTexture texture;
+            texture.format = info.format;
+            texture.extent = {header.width, header.height};
+            texture.mipLevels = header.mipLevels;
+            texture.mipOffsets.resize(header.mipLevels);
+            if (!file.read(reinterpret_cast<char *>(texture.mipOffsets.data()), header.mipLevels * sizeof(VkDeviceSize)))
+                return false;
+
+            // the offsets must describe tightly packed levels of the expected size
+            VkDeviceSize expectedOffset = 0;
+            for (uint32_t level = 0; level < header.mipLevels; ++level)
+            {
+                if (texture.mipOffsets[level] != expectedOffset)
+                    return false;
+                VkExtent2D extent = texture.mipExtent(level);
+                expectedOffset += static_cast<VkDeviceSize>(extent.width) * extent.height * layout.texelSize();
+            }
+            if (expectedOffset != header.dataSize)
+                return false;
+
+            texture.data.resize(header.dataSize);
+            if (!file.read(reinterpret_cast<char *>(texture.data.data()), header.dataSize))
+                return false;
+
+            texture.fromCache = true;
+            outTexture = std::move(texture);
+            return true;
+        }
+
+        void writeCache(const fs::path &cacheFile, uint64_t key, const PreparedTexture &texture)
+        {
+            std::error_code errorCode;
+            fs::create_directories(cacheFile.parent_path(), errorCode);
+
+            // write to a temporary file first so that concurrent readers never see a partial file
+            fs::path tempFile = cacheFile;
+            tempFile += ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+            {
+                std::ofstream file(tempFile, std::ios::binary | std::ios::trunc);
+                if (!file.is_open())
+                {
+                    spdlog::warn("util::prepareTexture: failed to write texture cache file {}.", tempFile.string());
+                    return;
+                }
+
+                CacheHeader header = {
+                    .magic = cacheMagic,
+                    .version = cacheVersion,
+                    .key = key,
+                    .format = static_cast<int32_t>(texture.format),
+                    .width = texture.extent.width,
+                    .height = texture.extent.height,
+                    .mipLevels = texture.mipLevels,
+                    .dataSize = texture.data.size()};
+                file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+                file.write(reinterpret_cast<const char *>(texture.mipOffsets.data()), texture.mipOffsets.size() * sizeof(VkDeviceSize));
+                file.write(reinterpret_cast<const char *>(texture.data.data()), texture.data.size());
+                if (!file)
+                {
+                    file.close();
+                    fs::remove(tempFile, errorCode);
+                    spdlog::warn("util::prepareTexture: failed to write texture cache file {}.", tempFile.string());
+                    return;
+                }
+            }
+
+            fs::rename(tempFile, cacheFile, errorCode);
+            if (errorCode)
+                fs::remove(tempFile, errorCode);
+        }
+
+        //--------------------------------------------------------------------------------------------
+
+        PreparedTexture prepareTextureInternal(const fs::path &filepath, const TexturePrepareInfo &info, uint32_t threadCount)
+        {
+            TexelLayout layout;
+            if (!getTexelLayout(info.format, layout))
+            {
+                spdlog::error("util::prepareTexture: format {} is not supported.", static_cast<int32_t>(info.format));
+                return {};
+            }
+            bool srgb = usesSrgbCurve(info, layout);
+
+            uint64_t key = 0;
+            fs::path cacheFile;
+            if (!info.cacheDirectory.empty() && computeCacheKey(filepath, info, srgb, key))
+            {
+                cacheFile = getCacheFilePath(info.cacheDirectory, key);
+                PreparedTexture cached;
+                if (readCache(cacheFile, key, info, layout, cached))
+                    return cached;
+            }
+
+            // decode at the source precision: hdr as float, 16-bit pngs as 16-bit, everything else as 8-bit
+            std::string pathString = filepath.string();
+            int width = 0;
+            int height = 0;
+            int channelCount = 0;
+            void *pTexels = nullptr;
+            TexelEncoding sourceEncoding;
+            if (stbi_is_hdr(pathString.c_str()))
+            {
+                pTexels = stbi_loadf(pathString.c_str(), &width, &height, &channelCount, 4);
+                sourceEncoding = TexelEncoding::sfloat32;
+            }
+            else if (stbi_is_16_bit(pathString.c_str()))
+            {
+                pTexels = stbi_load_16(pathString.c_str(), &width, &height, &channelCount, 4);
+                sourceEncoding = TexelEncoding::unorm16;
+            }
+            else
+            {
+                pTexels = stbi_load(pathString.c_str(), &width, &height, &channelCount, 4);
+                sourceEncoding = TexelEncoding::unorm8;
+            }
+            if (!pTexels)
+            {
+                spdlog::error("util::prepareTexture: failed to load image {}: {}.", pathString, stbi_failure_reason());
+                return {};
+            }
+
+            VkExtent2D extent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+            LinearImage baseLevel;
+            decodeToLinear(pTexels, extent, sourceEncoding, srgb, baseLevel, threadCount);
+            stbi_image_free(pTexels);
+
+            PreparedTexture result = buildMipChain(std::move(baseLevel), info, layout, srgb, threadCount);
+            if (!cacheFile.empty())
+                writeCache(cacheFile, key, result);
+            return result;
+        }
+    } // namespace
+
+    bool isPreparableFormat(VkFormat format)
+    {
+        TexelLayout layout;
+        return getTexelLayout(format, layout);
+    }
+
+    PreparedTexture prepareTexture(const std::filesystem::path &filepath, const TexturePrepareInfo &info)
+    {
+        return prepareTextureInternal(filepath, info, defaultThreadCount());
+    }
+
+    std::vector<PreparedTexture> prepareTextures(
+        std::span<const std::filesystem::path> filepaths,
+        std::span<const TexturePrepareInfo> infos)
+    {
+        if (filepaths.size() != infos.size())
+        {
+            spdlog::error("util::prepareTextures: {} paths were given with {} infos.", filepaths.size(), infos.size());
+            return {};
+        }
+
+        // images go to separate threads; threads left over are shared out inside each image
+        std::vector<PreparedTexture> results(filepaths.size());
+        uint32_t count = static_cast<uint32_t>(filepaths.size());
+        uint32_t threadCount = defaultThreadCount();
+        uint32_t threadsPerImage = count ? std::max(threadCount / count, 1u) : 1;
+        parallelFor(count, threadCount, [&](uint32_t i)
+                    { results[i] = prepareTextureInternal(filepaths[i], infos[i], threadsPerImage); });
+        return results;
+    }
+
+    PreparedTexture prepareTextureFromMemory(const void *pTexels, VkExtent2D extent, VkFormat sourceFormat, const TexturePrepareInfo &info)
+    {
+        TexelLayout layout;
+        if (!getTexelLayout(info.format, layout))
+        {
+            spdlog::error("util::prepareTextureFromMemory: format {} is not supported.", static_cast<int32_t>(info.format));
+            return {};
+        }
+
+        TexelEncoding sourceEncoding;
+        switch (sourceFormat)
+        {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            sourceEncoding = TexelEncoding::unorm8;
+            break;
+        case VK_FORMAT_R16G16B16A16_UNORM:
+            sourceEncoding = TexelEncoding::unorm16;
+            break;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            sourceEncoding = TexelEncoding::sfloat32;
+            break;
+        default:
+            spdlog::error("util::prepareTextureFromMemory: source format {} is not supported.", static_cast<int32_t>(sourceFormat));
+            return {};
+        }
+        if (!pTexels || extent.width == 0 || extent.height == 0)
+        {
+            spdlog::error("util::prepareTextureFromMemory: no texels given.");
+            return {};
+        }
+
+        bool srgb = usesSrgbCurve(info, layout);
+        uint32_t threadCount = defaultThreadCount();
+        LinearImage baseLevel;
+        decodeToLinear(pTexels, extent, sourceEncoding, srgb, baseLevel, threadCount);
+        return buildMipChain(std::move(baseLevel), info, layout, srgb, threadCount);
+    }
+
+} // namespace util
@@ -1,44 +1,35 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include "model.hpp"
 
+#define FAST_OBJ_LOADER_IMPLEMENTATION
+#include "fast_obj_loader.h"
+
 Model::Model(const char* filename) : verts_(), faces_(), norms_(), uv_(), diffusemap_(), normalmap_(), specularmap_() {
-    std::ifstream in;
-    in.open(filename, std::ifstream::in);
-    if (in.fail()) return;
-    std::string line;
-    while (!in.eof()) {
-        std::getline(in, line);
-        std::istringstream iss(line.c_str());
-        char trash;
-        if (!line.compare(0, 2, "v ")) {
-            iss >> trash;
-            vec3f v;
-            for (int i = 0; i < 3; i++) iss >> v[i];
-            verts_.push_back(v);
-        }
-        else if (!line.compare(0, 3, "vn ")) {
-            iss >> trash >> trash;
-            vec3f n;
-            for (int i = 0; i < 3; i++) iss >> n[i];
-            norms_.push_back(n);
-        }
-        else if (!line.compare(0, 3, "vt ")) {
-            iss >> trash >> trash;
-            vec2f uv;
-            for (int i = 0; i < 2; i++) iss >> uv[i];
-            uv_.push_back(uv);
-        }
-        else if (!line.compare(0, 2, "f ")) {
-            std::vector<vec3i> f;
-            vec3i tmp;
-            iss >> trash;
-            while (iss >> tmp[0] >> trash >> tmp[1] >> trash >> tmp[2]) {
-                for (int i = 0; i < 3; i++) tmp[i]--; // in wavefront obj all indices start at 1, not zero
-                f.push_back(tmp);
-            }
-            faces_.push_back(f);
+    fastobj::mesh_t mesh;
+    fastobj::load_options_t options;
+    std::string err;
+    if (!fastobj::LoadObj(&mesh, &err, filename, options)) {
+        std::cerr << err << std::endl;
+        return;
+    }
+
+    verts_.resize(mesh.vertices.size() / 3);
+    for (size_t i = 0; i < verts_.size(); i++)
+        verts_[i] = vec3f(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+    norms_.resize(mesh.normals.size() / 3);
+    for (size_t i = 0; i < norms_.size(); i++)
+        norms_[i] = vec3f(mesh.normals[3 * i], mesh.normals[3 * i + 1], mesh.normals[3 * i + 2]);
+    uv_.resize(mesh.texcoords.size() / 2);
+    for (size_t i = 0; i < uv_.size(); i++)
+        uv_[i] = vec2f(mesh.texcoords[2 * i], mesh.texcoords[2 * i + 1]);
+
+    // polygons arrive fan-triangulated, indices already 0-based
+    faces_.resize(mesh.indices.size() / 3);
+    for (size_t i = 0; i < faces_.size(); i++) {
+        faces_[i].resize(3);
+        for (int k = 0; k < 3; k++) {
+            const fastobj::index_t& index = mesh.indices[3 * i + k];
+            faces_[i][k] = vec3i(index.vertex_index, index.texcoord_index, index.normal_index);
         }
     }
     std::cerr << "# v# " << verts_.size() << " f# " << faces_.size() << " vt# " << uv_.size() << " vn# " << norms_.size() << std::endl;
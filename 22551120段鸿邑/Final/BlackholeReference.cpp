@@ -0,0 +1,643 @@
+// ================= 黑洞光线步进 CPU 参考实现 =================
+// 逐行移植 Shaders/blackhole.frag 的积分器，常量直接 #include 同一份 blackhole_constants.glsl，
+// 用于离线验证与调参：
+//   - 固定步长：与 shader 逐步一致（STEP / MAX_STEPS 相同）
+//   - 自适应步长：视界过渡区（含光子球）内按曲率缩小步长，区外随 r 放大步长，总光程不变
+//   - SSE 4 路光线包（SoA），不支持时回退到标量
+//   - 按 tile 多线程渲染，输出 PPM 图像与逐像素步数热力图
+//   - --sweep：默认以 720 步固定步长为基准（--ref-steps 可改），统计不同步数预算下的耗时与误差
+//
+// 编译（只用到 glm 与 GLFW 头文件，Camera.cpp 引用了按键常量）：
+//   g++ -O2 -std=c++17 -pthread BlackholeReference.cpp Camera.cpp -o BlackholeReference
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BH_SIMD 1
+#else
+#define BH_SIMD 0
+#endif
+
+#include "camera.h"
+
+namespace bh {
+#include "Shaders/blackhole_constants.glsl"
+}
+
+// ================= 参数 =================
+// 自适应步长：视界过渡区内每步偏转不超过 ADAPT_ANGLE 弧度（按 STEP 计，随基础步长等比缩放），
+// 步长在基础步长的 [ADAPT_MIN_SCALE, 1] 倍之间；区外随 r 线性放大，不超过 ADAPT_MAX_SCALE 倍。
+// ADAPT_ANGLE 取 0.01 时过渡区外沿的步长恰为基础步长，跨过边界时步长连续
+const float ADAPT_ANGLE = 0.01f;
+const float ADAPT_MIN_SCALE = 0.5f;
+const float ADAPT_MAX_SCALE = 16.0f;
+const float FADE_CUTOFF = 0.002f;
+
+struct MarchSettings {
+    int maxSteps = bh::MAX_STEPS;   // 每条光线的步数上限
+    float step = bh::STEP;          // 基础步长，总光程固定为 STEP * MAX_STEPS
+    bool adaptive = false;
+    float spin = 0.9f;
+
+    // 步数预算为 steps 时保持总光程不变
+    static MarchSettings withBudget(int steps, bool adaptive) {
+        MarchSettings s;
+        s.maxSteps = steps;
+        s.step = (float)((double)bh::STEP * bh::MAX_STEPS / steps);
+        s.adaptive = adaptive;
+        return s;
+    }
+
+    float pathLength() const { return step * maxSteps; }
+};
+
+glm::vec3 starfield(const glm::vec3& d);
+
+struct RaySample {
+    glm::vec3 disk;     // 吸积盘累积的颜色
+    glm::vec3 dir;      // 出射方向，用于采样星空
+    float fade;
+    int steps;
+
+    glm::vec3 color() const { return disk + starfield(dir) * fade; }
+};
+
+// ================= 与 shader 对应的标量函数 =================
+inline float smoothstepf(float e0, float e1, float x) {
+    float t = glm::clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+glm::vec3 starfield(const glm::vec3& d) {
+    float s = std::sin(glm::dot(glm::vec2(d.x, d.y), glm::vec2(12.9898f, 78.233f))) * 43758.5453f;
+    float n = s - std::floor(s);
+    float stars = smoothstepf(0.997f, 1.0f, n);
+    return glm::vec3(stars) * 5.5f;
+}
+
+float diskVolume(const glm::vec3& p) {
+    float r = std::sqrt(p.x * p.x + p.z * p.z);
+    float h = std::fabs(p.y);
+    if (r < bh::DISK_INNER || r > bh::DISK_OUTER) return 0.0f;
+
+    float thickness = std::exp(-h * 4.5f);
+    float radial = smoothstepf(bh::DISK_OUTER, bh::DISK_INNER, r);
+    return thickness * radial;
+}
+
+glm::vec3 cinematicDoppler(float v) {
+    float intensity = 1.0f + v * 0.35f;
+    float warmth = v * 0.05f;
+
+    glm::vec3 warmBase(1.4f, 1.25f, 0.9f);
+    glm::vec3 warmTint(1.05f, 1.0f, 0.95f);
+
+    glm::vec3 col = warmBase * glm::mix(glm::vec3(1.0f), warmTint, warmth);
+    return col * intensity;
+}
+
+// 事件视界反转区的一步：shader 里按“每步”作用的衰减与方向混合，
+// 步长变为 k 倍时改为 k 次方，k == 1 时与 shader 完全一致
+inline void horizonStep(const glm::vec3& pos, glm::vec3& dir, float& fade, float r, float h, float k) {
+    float horizonFade = smoothstepf(bh::Rs * bh::HORIZON_INNER, bh::Rs * bh::HORIZON_OUTER, r);
+    fade *= std::pow(glm::mix(0.92f, 1.0f, horizonFade), k);
+
+    if (r < bh::Rs * bh::HORIZON_OUTER) {
+        glm::vec3 inward = glm::normalize(pos);
+        dir = glm::normalize(glm::mix(-inward, dir, std::pow(horizonFade, k)));
+
+        float photon = (1.0f - horizonFade) * 6.0f;
+        dir += -inward * photon * h;
+    }
+}
+
+// 光子球（约 1.5 Rs）附近的轨道对每步偏转最敏感：视界过渡区内按透镜 + 帧拖拽的曲率限制偏转角，
+// 步长可以小于基础步长；区外弯曲随 1/r^2 减弱，步长按 r / (Rs * HORIZON_OUTER) 放大，
+// 省下的步数留给过渡区，所以同样的预算下整条光路仍能走完
+inline float adaptiveStep(float r, float base, float spin) {
+    const float zone = bh::Rs * bh::HORIZON_OUTER;
+    if (r >= zone) return base * std::min(r / zone, ADAPT_MAX_SCALE);
+
+    float curvature = (bh::Rs * (1.0f + 3.8f * std::exp(-r)) + spin) / (r * r);
+    float scale = ADAPT_ANGLE / (bh::STEP * curvature);
+    return base * std::min(std::max(scale, ADAPT_MIN_SCALE), 1.0f);
+}
+
+// ================= 标量积分器 =================
+RaySample marchRay(glm::vec3 pos, glm::vec3 dir, const MarchSettings& s) {
+    const float pathLength = s.pathLength();
+    const float endTolerance = s.step * 0.01f;
+
+    glm::vec3 color(0.0f);
+    float fade = 1.0f;
+    float travelled = 0.0f;
+    int i = 0;
+
+    while (i < s.maxSteps) {
+        float r = glm::length(pos);
+        float h = s.step;
+        if (s.adaptive) h = std::min(adaptiveStep(r, s.step, s.spin), pathLength - travelled);
+        float k = h / bh::STEP;
+
+        horizonStep(pos, dir, fade, r, h, k);
+
+        float density = diskVolume(pos);
+        if (density > 0.001f) {
+            glm::vec3 diskVel = glm::normalize(glm::cross(glm::vec3(0, 1, 0), pos));
+            float v = glm::dot(diskVel, dir);
+            color += cinematicDoppler(v) * density * 0.045f * fade * k;
+        }
+
+        float lens = bh::Rs / (r * r);
+        lens *= 1.0f + 3.8f * std::exp(-r);
+        dir += -(pos / r) * lens * h;
+
+        glm::vec3 frameDrag = s.spin * glm::cross(pos / r, glm::vec3(0, 1, 0)) / (r * r);
+        dir += frameDrag * h;
+
+        dir = glm::normalize(dir);
+        pos += dir * h;
+        travelled += h;
+        i++;
+
+        if (fade < FADE_CUTOFF) break;
+        if (s.adaptive && travelled >= pathLength - endTolerance) break;
+    }
+
+    return { color, dir, fade, i };
+}
+
+#if BH_SIMD
+// ================= SSE 4 路光线包 =================
+namespace simd {
+inline __m128 splat(float v) { return _mm_set1_ps(v); }
+inline __m128 add(__m128 a, __m128 b) { return _mm_add_ps(a, b); }
+inline __m128 sub(__m128 a, __m128 b) { return _mm_sub_ps(a, b); }
+inline __m128 mul(__m128 a, __m128 b) { return _mm_mul_ps(a, b); }
+inline __m128 div(__m128 a, __m128 b) { return _mm_div_ps(a, b); }
+inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+inline __m128 absf(__m128 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+
+inline __m128 smoothstep(float e0, float e1, __m128 x) {
+    __m128 t = div(sub(x, splat(e0)), splat(e1 - e0));
+    t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), splat(1.0f));
+    return mul(mul(t, t), sub(splat(3.0f), mul(splat(2.0f), t)));
+}
+
+// Cephes expf：2^n * P(f)，相对误差约 1e-7
+inline __m128 exp(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, splat(-87.3f)), splat(88.3f));
+    __m128 fx = add(mul(x, splat(1.44269504088896341f)), splat(0.5f));
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    fx = sub(t, _mm_and_ps(_mm_cmpgt_ps(t, fx), splat(1.0f)));
+
+    x = sub(x, mul(fx, splat(0.693359375f)));
+    x = sub(x, mul(fx, splat(-2.12194440e-4f)));
+
+    __m128 y = splat(1.9875691500e-4f);
+    y = add(mul(y, x), splat(1.3981999507e-3f));
+    y = add(mul(y, x), splat(8.3334519073e-3f));
+    y = add(mul(y, x), splat(4.1665795894e-2f));
+    y = add(mul(y, x), splat(1.6666665459e-1f));
+    y = add(mul(y, x), splat(5.0000001201e-1f));
+    y = add(add(mul(y, mul(x, x)), x), splat(1.0f));
+
+    __m128i n = _mm_add_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32(127));
+    return mul(y, _mm_castsi128_ps(_mm_slli_epi32(n, 23)));
+}
+}
+
+// 同一相机原点出发的 4 条光线一起步进，已结束的光线由 active 掩码屏蔽
+void marchPacket(const glm::vec3& origin, const glm::vec3 dirs[4], const MarchSettings& s,
+                 RaySample out[4]) {
+    using namespace simd;
+
+    __m128 px = splat(origin.x), py = splat(origin.y), pz = splat(origin.z);
+    __m128 dx = _mm_setr_ps(dirs[0].x, dirs[1].x, dirs[2].x, dirs[3].x);
+    __m128 dy = _mm_setr_ps(dirs[0].y, dirs[1].y, dirs[2].y, dirs[3].y);
+    __m128 dz = _mm_setr_ps(dirs[0].z, dirs[1].z, dirs[2].z, dirs[3].z);
+
+    __m128 cr = _mm_setzero_ps(), cg = _mm_setzero_ps(), cb = _mm_setzero_ps();
+    __m128 fade = splat(1.0f);
+    __m128 travelled = _mm_setzero_ps();
+    __m128 steps = _mm_setzero_ps();
+    __m128 active = _mm_cmpeq_ps(fade, fade);
+
+    const __m128 one = splat(1.0f);
+    const __m128 pathLength = splat(s.pathLength());
+    const __m128 pathEnd = splat(s.pathLength() - s.step * 0.01f);
+    const __m128 invStep = splat(1.0f / bh::STEP);
+
+    for (int i = 0; i < s.maxSteps; i++) {
+        __m128 r2 = add(add(mul(px, px), mul(py, py)), mul(pz, pz));
+        __m128 r = _mm_sqrt_ps(r2);
+        __m128 rxz = _mm_sqrt_ps(add(mul(px, px), mul(pz, pz)));
+        __m128 ay = absf(py);
+
+        __m128 expR = exp(sub(_mm_setzero_ps(), r));
+        __m128 lensR2 = mul(splat(bh::Rs), add(one, mul(splat(3.8f), expR)));   // lens * r^2
+
+        __m128 h = splat(s.step);
+        if (s.adaptive) {
+            const float zone = bh::Rs * bh::HORIZON_OUTER;
+            __m128 outer = _mm_min_ps(mul(r, splat(1.0f / zone)), splat(ADAPT_MAX_SCALE));
+            __m128 curvature = div(add(lensR2, splat(s.spin)), r2);
+            __m128 inner = div(splat(ADAPT_ANGLE / bh::STEP), curvature);
+            inner = _mm_min_ps(_mm_max_ps(inner, splat(ADAPT_MIN_SCALE)), one);
+            __m128 scale = select(_mm_cmplt_ps(r, splat(zone)), inner, outer);
+            h = _mm_min_ps(mul(splat(s.step), scale), sub(pathLength, travelled));
+        }
+        __m128 k = s.adaptive ? mul(h, invStep) : splat(s.step / bh::STEP);
+
+        // 视界过渡区只涉及少数光线，逐条走标量代码
+        __m128 nearHorizon = _mm_and_ps(_mm_cmplt_ps(r, splat(bh::Rs * bh::HORIZON_OUTER)), active);
+        if (int mask = _mm_movemask_ps(nearHorizon)) {
+            alignas(16) float lx[4], ly[4], lz[4], ldx[4], ldy[4], ldz[4], lf[4], lr[4], lh[4], lk[4];
+            _mm_store_ps(lx, px); _mm_store_ps(ly, py); _mm_store_ps(lz, pz);
+            _mm_store_ps(ldx, dx); _mm_store_ps(ldy, dy); _mm_store_ps(ldz, dz);
+            _mm_store_ps(lf, fade); _mm_store_ps(lr, r); _mm_store_ps(lh, h); _mm_store_ps(lk, k);
+            for (int l = 0; l < 4; l++) {
+                if (!(mask & (1 << l))) continue;
+                glm::vec3 d(ldx[l], ldy[l], ldz[l]);
+                horizonStep(glm::vec3(lx[l], ly[l], lz[l]), d, lf[l], lr[l], lh[l], lk[l]);
+                ldx[l] = d.x; ldy[l] = d.y; ldz[l] = d.z;
+            }
+            dx = _mm_load_ps(ldx); dy = _mm_load_ps(ldy); dz = _mm_load_ps(ldz);
+            fade = _mm_load_ps(lf);
+        }
+
+        // 吸积盘
+        __m128 inDisk = _mm_and_ps(_mm_cmpge_ps(rxz, splat(bh::DISK_INNER)),
+                                   _mm_cmple_ps(rxz, splat(bh::DISK_OUTER)));
+        __m128 density = mul(exp(mul(ay, splat(-4.5f))), smoothstep(bh::DISK_OUTER, bh::DISK_INNER, rxz));
+        density = _mm_and_ps(inDisk, density);
+        __m128 diskMask = _mm_and_ps(_mm_cmpgt_ps(density, splat(0.001f)), active);
+        if (_mm_movemask_ps(diskMask)) {
+            // normalize(cross(up, pos)) = (pz, 0, -px) / rxz
+            __m128 v = div(sub(mul(pz, dx), mul(px, dz)), rxz);
+            __m128 intensity = add(one, mul(v, splat(0.35f)));
+            __m128 warmth = mul(v, splat(0.05f));
+            __m128 cool = sub(one, warmth);
+            __m128 w = mul(mul(mul(mul(density, splat(0.045f)), fade), k), intensity);
+            w = _mm_and_ps(diskMask, w);
+            cr = add(cr, mul(mul(splat(1.4f), add(cool, mul(splat(1.05f), warmth))), w));
+            cg = add(cg, mul(mul(splat(1.25f), add(cool, warmth)), w));
+            cb = add(cb, mul(mul(splat(0.9f), add(cool, mul(splat(0.95f), warmth))), w));
+        }
+
+        // 引力透镜 + 帧拖拽
+        __m128 invR = div(one, r);
+        __m128 nx = mul(px, invR), ny = mul(py, invR), nz = mul(pz, invR);
+        __m128 lens = div(lensR2, r2);
+        __m128 g = mul(lens, h);
+        __m128 drag = mul(div(splat(s.spin), r2), h);
+
+        __m128 ndx = add(sub(dx, mul(nx, g)), mul(sub(_mm_setzero_ps(), nz), drag));
+        __m128 ndy = sub(dy, mul(ny, g));
+        __m128 ndz = add(sub(dz, mul(nz, g)), mul(nx, drag));
+        __m128 invLen = div(one, _mm_sqrt_ps(add(add(mul(ndx, ndx), mul(ndy, ndy)), mul(ndz, ndz))));
+        ndx = mul(ndx, invLen); ndy = mul(ndy, invLen); ndz = mul(ndz, invLen);
+
+        dx = select(active, ndx, dx);
+        dy = select(active, ndy, dy);
+        dz = select(active, ndz, dz);
+        px = select(active, add(px, mul(ndx, h)), px);
+        py = select(active, add(py, mul(ndy, h)), py);
+        pz = select(active, add(pz, mul(ndz, h)), pz);
+        travelled = add(travelled, _mm_and_ps(active, h));
+        steps = add(steps, _mm_and_ps(active, one));
+
+        active = _mm_and_ps(active, _mm_cmpge_ps(fade, splat(FADE_CUTOFF)));
+        if (s.adaptive) active = _mm_and_ps(active, _mm_cmplt_ps(travelled, pathEnd));
+        if (!_mm_movemask_ps(active)) break;
+    }
+
+    alignas(16) float lr[4], lg[4], lb[4], lf[4], ln[4], ldx[4], ldy[4], ldz[4];
+    _mm_store_ps(lr, cr); _mm_store_ps(lg, cg); _mm_store_ps(lb, cb);
+    _mm_store_ps(lf, fade); _mm_store_ps(ln, steps);
+    _mm_store_ps(ldx, dx); _mm_store_ps(ldy, dy); _mm_store_ps(ldz, dz);
+    for (int l = 0; l < 4; l++)
+        out[l] = { glm::vec3(lr[l], lg[l], lb[l]), glm::vec3(ldx[l], ldy[l], ldz[l]), lf[l], (int)ln[l] };
+}
+#endif
+
+// ================= tile 并行渲染 =================
+struct RenderSettings {
+    int width = 1280;
+    int height = 800;
+    int threads = 0;        // 0 = 硬件线程数
+    int tileSize = 16;
+    bool packets = true;
+    MarchSettings march;
+    glm::vec3 camPos{ 0.0f, 1.2f, 7.5f };
+    glm::mat3 camRot{ 1.0f };
+};
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> color;   // 行 0 为底部，与 gl_FragCoord 一致
+    std::vector<glm::vec3> disk;
+    std::vector<glm::vec3> dir;
+    std::vector<int> steps;
+
+    void store(size_t i, const RaySample& s) {
+        color[i] = s.color();
+        disk[i] = s.disk;
+        dir[i] = s.dir;
+        steps[i] = s.steps;
+    }
+};
+
+// 与 fullscreen.vert + blackhole.frag 的主光线一致（像素中心采样）
+inline glm::vec3 primaryDir(const glm::mat3& camRot, int x, int y, int width, int height) {
+    glm::vec2 p((x + 0.5f) / width * 2.0f - 1.0f, (y + 0.5f) / height * 2.0f - 1.0f);
+    p.x *= 1.6f;
+    return glm::normalize(camRot * glm::vec3(p, -1.9f));
+}
+
+void renderTile(const RenderSettings& rs, Image& img, int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; y++) {
+#if BH_SIMD
+        if (rs.packets) {
+            for (int x = x0; x < x1; x += 4) {
+                glm::vec3 dirs[4];
+                RaySample samples[4];
+                for (int l = 0; l < 4; l++)
+                    dirs[l] = primaryDir(rs.camRot, std::min(x + l, x1 - 1), y, rs.width, rs.height);
+                marchPacket(rs.camPos, dirs, rs.march, samples);
+                for (int l = 0; l < 4 && x + l < x1; l++)
+                    img.store((size_t)y * rs.width + x + l, samples[l]);
+            }
+            continue;
+        }
+#endif
+        for (int x = x0; x < x1; x++) {
+            img.store((size_t)y * rs.width + x,
+                      marchRay(rs.camPos, primaryDir(rs.camRot, x, y, rs.width, rs.height), rs.march));
+        }
+    }
+}
+
+Image render(const RenderSettings& rs) {
+    Image img;
+    img.width = rs.width;
+    img.height = rs.height;
+    img.color.assign((size_t)rs.width * rs.height, glm::vec3(0.0f));
+    img.disk.assign(img.color.size(), glm::vec3(0.0f));
+    img.dir.assign(img.color.size(), glm::vec3(0.0f));
+    img.steps.assign(img.color.size(), 0);
+
+    const int tilesX = (rs.width + rs.tileSize - 1) / rs.tileSize;
+    const int tilesY = (rs.height + rs.tileSize - 1) / rs.tileSize;
+    std::atomic<int> nextTile(0);
+
+    auto worker = [&]() {
+        for (int t = nextTile++; t < tilesX * tilesY; t = nextTile++) {
+            int x0 = (t % tilesX) * rs.tileSize;
+            int y0 = (t / tilesX) * rs.tileSize;
+            renderTile(rs, img, x0, y0, std::min(x0 + rs.tileSize, rs.width), std::min(y0 + rs.tileSize, rs.height));
+        }
+    };
+
+    int threadCount = rs.threads > 0 ? rs.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threadCount; i++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    return img;
+}
+
+// ================= 输出与统计 =================
+inline unsigned char toByte(float v) {
+    return (unsigned char)(glm::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+bool writePPM(const std::string& path, int width, int height, const std::vector<glm::vec3>& pixels) {
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    f << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row(width * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        for (int x = 0; x < width; x++) {
+            const glm::vec3& c = pixels[y * width + x];
+            row[x * 3 + 0] = toByte(c.r);
+            row[x * 3 + 1] = toByte(c.g);
+            row[x * 3 + 2] = toByte(c.b);
+        }
+        f.write((const char*)row.data(), row.size());
+    }
+    return (bool)f;
+}
+
+// 步数热力图：黑 → 蓝 → 青 → 黄 → 红，满量程为步数上限
+glm::vec3 heatColor(float t) {
+    static const glm::vec3 ramp[] = {
+        { 0.0f, 0.0f, 0.0f }, { 0.1f, 0.1f, 0.8f }, { 0.1f, 0.8f, 0.8f }, { 0.9f, 0.9f, 0.1f }, { 1.0f, 0.2f, 0.1f }
+    };
+    t = glm::clamp(t, 0.0f, 1.0f) * 4.0f;
+    int i = std::min((int)t, 3);
+    return glm::mix(ramp[i], ramp[i + 1], t - i);
+}
+
+bool writeHeatmap(const std::string& path, const Image& img, int maxSteps) {
+    std::vector<glm::vec3> pixels(img.steps.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+        pixels[i] = heatColor((float)img.steps[i] / maxSteps);
+    return writePPM(path, img.width, img.height, pixels);
+}
+
+struct StepStats {
+    double mean = 0.0;
+    int max = 0;
+    long long total = 0;
+};
+
+StepStats stepStats(const Image& img) {
+    StepStats s;
+    for (int n : img.steps) {
+        s.total += n;
+        s.max = std::max(s.max, n);
+    }
+    s.mean = img.steps.empty() ? 0.0 : (double)s.total / img.steps.size();
+    return s;
+}
+
+// 星空是 fract(sin(...)) 哈希，出射方向的微小差异就会让星点整体跳变，
+// 因此误差分两部分统计：吸积盘颜色（显示值域 [0,1]）与出射方向的角度误差
+struct ImageError {
+    double diskRmse = 0.0;
+    double diskPsnr = 0.0;
+    double meanAngle = 0.0;     // 度
+    double maxAngle = 0.0;
+};
+
+ImageError compareImages(const Image& a, const Image& ref) {
+    ImageError e;
+    double sum = 0.0, angleSum = 0.0;
+    for (size_t i = 0; i < a.disk.size(); i++) {
+        glm::vec3 d = glm::clamp(a.disk[i], 0.0f, 1.0f) - glm::clamp(ref.disk[i], 0.0f, 1.0f);
+        sum += glm::dot(d, d) / 3.0;
+
+        double c = glm::clamp((double)glm::dot(a.dir[i], ref.dir[i]), -1.0, 1.0);
+        double angle = std::acos(c) * 180.0 / 3.14159265358979;
+        angleSum += angle;
+        e.maxAngle = std::max(e.maxAngle, angle);
+    }
+    e.diskRmse = std::sqrt(sum / a.disk.size());
+    e.diskPsnr = e.diskRmse > 0.0 ? 20.0 * std::log10(1.0 / e.diskRmse) : INFINITY;
+    e.meanAngle = angleSum / a.disk.size();
+    return e;
+}
+
+double timedRender(const RenderSettings& rs, Image& img) {
+    auto t0 = std::chrono::steady_clock::now();
+    img = render(rs);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// 以 refSteps 步固定步长为基准，比较不同步数预算下固定/自适应步长的耗时与误差；
+// 默认与 shader 相同的 MAX_STEPS，评估自适应步长的精度时应取更大的值（如 8 倍）
+void runSweep(RenderSettings rs, int refSteps) {
+    const float spin = rs.march.spin;
+    rs.march = MarchSettings::withBudget(refSteps, false);
+    rs.march.spin = spin;
+    Image reference;
+    double refMs = timedRender(rs, reference);
+    std::printf("reference: fixed %d steps, %.1f ms\n\n", refSteps, refMs);
+    std::printf("%-9s %7s %10s %11s %6s %10s %10s %10s %10s\n", "mode", "budget", "time(ms)", "mean steps", "max",
+                "disk RMSE", "PSNR(dB)", "dir(deg)", "max(deg)");
+
+    const int budgets[] = { 720, 480, 360, 240, 180, 120, 90, 60 };
+    for (int adaptive = 0; adaptive < 2; adaptive++) {
+        for (int budget : budgets) {
+            rs.march = MarchSettings::withBudget(budget, adaptive != 0);
+            rs.march.spin = spin;
+            Image img;
+            double ms = timedRender(rs, img);
+            StepStats st = stepStats(img);
+            ImageError e = compareImages(img, reference);
+            std::printf("%-9s %7d %10.1f %11.1f %6d %10.6f %10.2f %10.4f %10.3f\n",
+                        adaptive ? "adaptive" : "fixed", budget, ms, st.mean, st.max,
+                        e.diskRmse, e.diskPsnr, e.meanAngle, e.maxAngle);
+        }
+    }
+}
+
+void printUsage() {
+    std::printf(
+        "usage: BlackholeReference [options]\n"
+        "  -o <file>          color image (PPM), default blackhole_cpu.ppm\n"
+        "  --heatmap <file>   per-pixel step count (PPM), default blackhole_steps.ppm\n"
+        "  --size <w> <h>     default 1280 800\n"
+        "  --steps <n>        step budget, total path length stays STEP * MAX_STEPS\n"
+        "  --adaptive         adaptive step size: finer near the photon sphere, coarser with r\n"
+        "  --scalar           disable SSE ray packets\n"
+        "  --compare          also render the scalar fixed-step reference and report the error\n"
+        "  --sweep            time/error table over step budgets, fixed and adaptive\n"
+        "  --ref-steps <n>    fixed-step budget of the reference for --compare/--sweep, default MAX_STEPS\n"
+        "  --threads <n>      worker threads, default hardware concurrency\n"
+        "  --spin <a>         default 0.9\n"
+        "  --cam <x> <y> <z>  default 0 1.2 7.5\n"
+        "  --yaw <deg> --pitch <deg>\n");
+}
+
+int main(int argc, char** argv) {
+    RenderSettings rs;
+    Camera camera;
+    camera.position = rs.camPos;
+    std::string outPath = "blackhole_cpu.ppm";
+    std::string heatmapPath = "blackhole_steps.ppm";
+    int budget = bh::MAX_STEPS;
+    int refSteps = bh::MAX_STEPS;
+    bool adaptive = false, sweep = false, compare = false;
+    float spin = rs.march.spin;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasNext = i + 1 < argc;
+        if (a == "-o" && hasNext) outPath = argv[++i];
+        else if (a == "--heatmap" && hasNext) heatmapPath = argv[++i];
+        else if (a == "--size" && i + 2 < argc) { rs.width = std::atoi(argv[++i]); rs.height = std::atoi(argv[++i]); }
+        else if (a == "--steps" && hasNext) budget = std::atoi(argv[++i]);
+        else if (a == "--adaptive") adaptive = true;
+        else if (a == "--scalar") rs.packets = false;
+        else if (a == "--compare") compare = true;
+        else if (a == "--sweep") sweep = true;
+        else if (a == "--ref-steps" && hasNext) refSteps = std::atoi(argv[++i]);
+        else if (a == "--threads" && hasNext) rs.threads = std::atoi(argv[++i]);
+        else if (a == "--spin" && hasNext) spin = (float)std::atof(argv[++i]);
+        else if (a == "--cam" && i + 3 < argc) {
+            camera.position.x = (float)std::atof(argv[++i]);
+            camera.position.y = (float)std::atof(argv[++i]);
+            camera.position.z = (float)std::atof(argv[++i]);
+        }
+        else if (a == "--yaw" && hasNext) camera.yaw = (float)std::atof(argv[++i]);
+        else if (a == "--pitch" && hasNext) camera.pitch = (float)std::atof(argv[++i]);
+        else {
+            printUsage();
+            return a == "-h" || a == "--help" ? 0 : 1;
+        }
+    }
+    if (rs.width <= 0 || rs.height <= 0 || budget <= 0 || refSteps <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    rs.camPos = camera.position;
+    rs.camRot = camera.getRotation();
+    rs.march = MarchSettings::withBudget(budget, adaptive);
+    rs.march.spin = spin;
+#if !BH_SIMD
+    rs.packets = false;
+#endif
+
+    if (sweep) {
+        runSweep(rs, refSteps);
+        return 0;
+    }
+
+    Image img;
+    double ms = timedRender(rs, img);
+    StepStats st = stepStats(img);
+    std::printf("%dx%d, %s %d steps, %s: %.1f ms, mean %.1f / max %d steps, %.1f Msteps/s\n",
+                rs.width, rs.height, adaptive ? "adaptive" : "fixed", budget,
+                rs.packets ? "SSE packets" : "scalar", ms, st.mean, st.max, st.total / (ms * 1000.0));
+
+    if (compare) {
+        RenderSettings ref = rs;
+        ref.packets = false;
+        ref.march = MarchSettings::withBudget(refSteps, false);
+        ref.march.spin = spin;
+        Image refImg;
+        timedRender(ref, refImg);
+        ImageError e = compareImages(img, refImg);
+        std::printf("vs scalar fixed %d steps: disk RMSE %.6f (%.2f dB), exit dir mean %.4f / max %.3f deg\n",
+                    refSteps, e.diskRmse, e.diskPsnr, e.meanAngle, e.maxAngle);
+    }
+
+    if (!writePPM(outPath, img.width, img.height, img.color)) {
+        std::cout << "Failed to write " << outPath << "\n";
+        return 1;
+    }
+    if (!writeHeatmap(heatmapPath, img, budget)) {
+        std::cout << "Failed to write " << heatmapPath << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,9 @@
 
 #include "camera.h"
 
+#define GL_PROGRAM_CACHE_IMPLEMENTATION
+#include "../../third_party/gl_program_cache/gl_program_cache.h"
+
 // ================= ߺ =================
 std::string loadFile(const char* path) {
     std::ifstream f(path);
@@ -18,23 +21,26 @@ std::string loadFile(const char* path) {
     return ss.str();
 }
 
-GLuint compileShader(const char* vs, const char* fs) {
-    GLuint v = glCreateShader(GL_VERTEX_SHADER);
-    GLuint f = glCreateShader(GL_FRAGMENT_SHADER);
-
-    glShaderSource(v, 1, &vs, nullptr);
-    glShaderSource(f, 1, &fs, nullptr);
-    glCompileShader(v);
-    glCompileShader(f);
-
-    GLuint p = glCreateProgram();
-    glAttachShader(p, v);
-    glAttachShader(p, f);
-    glLinkProgram(p);
-
-    glDeleteShader(v);
-    glDeleteShader(f);
-    return p;
+//  shader չ׵ #include "xxx" shader Ŀ¼
+// GLSL 330 ֧ includeblackhole.frag  CPU οʵֹ
+std::string loadShader(const char* path) {
+    std::string dir(path);
+    size_t slash = dir.find_last_of("/\\");
+    dir = (slash == std::string::npos) ? std::string() : dir.substr(0, slash + 1);
+
+    std::istringstream in(loadFile(path));
+    std::string line, out;
+    while (std::getline(in, line)) {
+        const std::string directive = "#include \"";
+        if (line.compare(0, directive.size(), directive) == 0) {
+            size_t end = line.find('"', directive.size());
+            out += loadFile((dir + line.substr(directive.size(), end - directive.size())).c_str());
+        } else {
+            out += line;
+        }
+        out += "\n";
+    }
+    return out;
 }
 
 // ================= ȫ =================
@@ -77,9 +83,12 @@ int main() {
     glEnableVertexAttribArray(0);
 
     // =================  shader =================
+    // Դϣƣύ룬 HDR ͼͬʱ
+    glcache::ProgramCache programCache;
+    programCache.Init((glcache::load_proc_t)glfwGetProcAddress, "shader_cache");
     auto vs = loadFile("Shaders/fullscreen.vert");
-    auto fs = loadFile("Shaders/blackhole.frag");
-    GLuint program = compileShader(vs.c_str(), fs.c_str());
+    auto fs = loadShader("Shaders/blackhole.frag");
+    int programRequest = programCache.Request(vs.c_str(), fs.c_str());
 
     // =================  HDR ǿ =================
     stbi_set_flip_vertically_on_load(true);
@@ -100,6 +109,13 @@ int main() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     stbi_image_free(data);
 
+    std::string shaderError;
+    GLuint program = programCache.Wait(programRequest, &shaderError);
+    if (!program) {
+        std::cout << shaderError << "\n";
+        return -1;
+    }
+
     camera.position = glm::vec3(0.0f, 1.2f, 7.5f);
 
     float lastTime = glfwGetTime();
@@ -6,9 +6,8 @@ uniform vec3 camPos;
 uniform mat3 camRot;
 uniform float spin;
 
-const float Rs = 1.0;
-const float STEP = 0.02;
-const int MAX_STEPS = 720;
+// Rs / STEP / MAX_STEPS 等常量与 CPU 参考实现共享，由 Final.cpp 加载时展开
+#include "blackhole_constants.glsl"
 
 // ================= HDR 星空 =================
 vec3 starfield(vec3 d) {
@@ -21,10 +20,10 @@ vec3 starfield(vec3 d) {
 float diskVolume(vec3 p) {
     float r = length(p.xz);
     float h = abs(p.y);
-    if (r < 1.8 || r > 7.0) return 0.0;
+    if (r < DISK_INNER || r > DISK_OUTER) return 0.0;
 
     float thickness = exp(-h * 4.5);
-    float radial = smoothstep(7.0, 1.8, r);
+    float radial = smoothstep(DISK_OUTER, DISK_INNER, r);
     return thickness * radial;
 }
 
@@ -56,10 +55,10 @@ void main() {
         float r = length(pos);
 
         // ================= 超大事件视界反转区 =================
-        float horizonFade = smoothstep(Rs * 0.9, Rs * 2.2, r);
+        float horizonFade = smoothstep(Rs * HORIZON_INNER, Rs * HORIZON_OUTER, r);
         fade *= mix(0.92, 1.0, horizonFade);
 
-        if (r < Rs * 2.2) {
+        if (r < Rs * HORIZON_OUTER) {
             vec3 inward = normalize(pos);
             dir = normalize(mix(-inward, dir, horizonFade));
 
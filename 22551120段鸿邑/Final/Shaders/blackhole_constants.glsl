@@ -0,0 +1,14 @@
+// 黑洞光线步进的共享常量
+// 由 Final.cpp 在编译前插入 blackhole.frag，同时被 BlackholeReference.cpp 直接 #include，
+// 因此这里只能写 GLSL 与 C++ 都合法的 const 声明（不要加 f 后缀或 #define）。
+const float Rs = 1.0;
+const float STEP = 0.02;
+const int MAX_STEPS = 720;
+
+// 事件视界反转区：[Rs * HORIZON_INNER, Rs * HORIZON_OUTER]
+const float HORIZON_INNER = 0.9;
+const float HORIZON_OUTER = 2.2;
+
+// 吸积盘径向范围
+const float DISK_INNER = 1.8;
+const float DISK_OUTER = 7.0;
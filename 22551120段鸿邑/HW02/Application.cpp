@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include<vector>
+#include "Picking.h"
 // stb_image 配置
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -38,7 +39,13 @@ struct SphereInfo {
     glm::vec3 worldCenter;  // 世界空间球心
     float worldRadius;      // 世界空间实际半径
 };
-std::vector<SphereInfo> sphereList; // 球体列表，存储太阳和地球的信息
+std::vector<SphereInfo> sphereList; // 球体列表，存储太阳和地球的信息（下标与 pickScene 中的实例编号一致）
+
+// 拾取用的CPU端网格数据和加速结构
+std::vector<glm::vec3> spherePositions;   // 球体模型空间顶点位置
+std::vector<unsigned int> sphereIndices;  // 球体索引
+pick::MeshBVH sphereBVH;                  // 球体网格的三角形BVH（太阳和地球共用）
+pick::PickScene pickScene;                // 场景顶层BVH，地球公转时只做refit
 
 // 射线结构体：起点 + 归一化方向
 struct Ray {
@@ -83,25 +90,18 @@ Ray screenToWorldRay(float mouseX, float mouseY, const glm::mat4& viewMat, const
     // GLFW窗口坐标：左上角为(0,0)，Y轴向下；NDC：中心为(0,0)，Y轴向上
     float x = (2.0f * mouseX) / windowWidth - 1.0f;
     float y = 1.0f - (2.0f * mouseY) / windowHeight; // 翻转Y轴
-    float z = -1.0f; // 近裁剪面Z值
-    glm::vec4 ndcNear = glm::vec4(x, y, z, 1.0f);
-    z = 1.0f; // 远裁剪面Z值
-    glm::vec4 ndcFar = glm::vec4(x, y, z, 1.0f);
-
-    // 步骤2：NDC转世界空间（乘以投影矩阵逆 + 视图矩阵逆）
-    glm::mat4 invProjView = glm::inverse(projMat * viewMat);
-    // 近裁剪面世界空间坐标
-    glm::vec4 worldNear = invProjView * ndcNear;
-    // 远裁剪面世界空间坐标
-    glm::vec4 worldFar = invProjView * ndcFar;
-
-    // 步骤3：透视除法（齐次坐标转笛卡尔坐标，除以w分量）
-    worldNear /= worldNear.w;
-    worldFar /= worldFar.w;
-
-    // 步骤4：构建射线（起点=相机位置，方向=远-近，归一化）
+
+    // 步骤2：NDC转观察空间方向
+    // 透视投影矩阵的 [0][0]、[1][1] 就是 1/(aspect*tan(fov/2)) 和 1/tan(fov/2)，不需要对矩阵求逆
+    glm::vec3 viewDir = glm::vec3(x / projMat[0][0], y / projMat[1][1], -1.0f);
+
+    // 步骤3：观察空间转世界空间
+    // 视图矩阵是刚体变换，旋转部分的逆就是转置
+    glm::mat3 viewToWorld = glm::transpose(glm::mat3(viewMat));
+
+    // 步骤4：构建射线（起点=相机位置，归一化方向）
     ray.origin = cameraPos;
-    ray.dir = glm::normalize(glm::vec3(worldFar - worldNear));
+    ray.dir = glm::normalize(viewToWorld * viewDir);
 
     return ray;
 }
@@ -118,32 +118,22 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
         glm::mat4 currentView = view;
         glm::mat4 currentProj = projection;
 
-        // 步骤3：转换为世界空间射线
-        Ray ray = screenToWorldRay((float)mouseX, (float)mouseY, currentView, currentProj, SCR_WIDTH, SCR_HEIGHT);
+        // 步骤3：转换为世界空间射线（窗口可能被调整过大小，用当前窗口尺寸）
+        int windowWidth, windowHeight;
+        glfwGetWindowSize(window, &windowWidth, &windowHeight);
+        if (windowWidth <= 0 || windowHeight <= 0) return;
+        Ray ray = screenToWorldRay((float)mouseX, (float)mouseY, currentView, currentProj, windowWidth, windowHeight);
 
-        // 步骤4：遍历所有球体，检测相交（记录最近的球体）
+        // 步骤4：通过BVH求射线与场景三角形的最近交点
+        pick::Hit hit;
         std::string hitSphereName = "";
-        float minT = FLT_MAX; // 最近交点的t值
-        for (const auto& sphere : sphereList) {
-            // 先判断是否相交
-            glm::vec3 oc = ray.origin - sphere.worldCenter;
-            float a = glm::dot(ray.dir, ray.dir);
-            float b = 2.0f * glm::dot(oc, ray.dir);
-            float c = glm::dot(oc, oc) - sphere.worldRadius * sphere.worldRadius;
-            float discriminant = b * b - 4 * a * c;
-
-            if (discriminant >= 0) {
-                float t = (-b - glm::sqrt(discriminant)) / (2.0f * a);
-                if (t > 0.0001f && t < minT) {
-                    minT = t;
-                    hitSphereName = sphere.name;
-                }
-            }
+        if (pickScene.intersect(ray.origin, ray.dir, hit)) {
+            hitSphereName = sphereList[hit.instance].name;
         }
 
         // 步骤5：若命中球体，打印名称
         if (!hitSphereName.empty()) {
-            std::cout << "点击了球体：" << hitSphereName << std::endl;
+            std::cout << "点击了球体：" << hitSphereName << "（三角形 " << hit.triangle << "）" << std::endl;
         }
         else {
             std::cout << "未点击到任何球体" << std::endl;
@@ -452,6 +442,14 @@ void generateSphere(float radius, unsigned int sectors, unsigned int stacks)
 
     sphereIndexCount = indices.size();
 
+    // 保留一份CPU端数据给拾取BVH使用
+    spherePositions.clear();
+    for (size_t i = 0; i < vertices.size(); i += 14)
+    {
+        spherePositions.push_back(glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]));
+    }
+    sphereIndices = indices;
+
     // 绑定VAO/VBO/EBO
     glGenVertexArrays(1, &sphereVAO);
     glGenBuffers(1, &sphereVBO);
@@ -642,6 +640,7 @@ void renderFrame()
     // 关键：实时更新地球的世界球心（因公转位置变化）
     if (!sphereList.empty() && sphereList.size() >= 2) {
         sphereList[1].worldCenter = earthWorldPos;
+        pickScene.setTransform(1, earthModel); // 只更新包围盒，点击时再refit顶层BVH
     }
 }
 
@@ -725,6 +724,11 @@ int main()
     earth.worldRadius = 1.0f * 0.5f; // 局部半径1.0f * 缩放0.5倍
     sphereList.push_back(earth);
 
+    // 构建拾取BVH：太阳和地球共用同一个球体网格，作为两个实例加入场景
+    sphereBVH.build(spherePositions, sphereIndices);
+    pickScene.addInstance(&sphereBVH, glm::scale(glm::mat4(1.0f), glm::vec3(sun.worldRadius)));
+    pickScene.addInstance(&sphereBVH, glm::scale(glm::translate(glm::mat4(1.0f), earth.worldCenter), glm::vec3(earth.worldRadius)));
+
     // 7. 渲染循环
     while (!glfwWindowShouldClose(window))
     {
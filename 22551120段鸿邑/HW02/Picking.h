@@ -0,0 +1,557 @@
+#pragma once
+// 射线拾取加速结构
+// MeshBVH：单个网格在模型空间下的三角形 SAH BVH，多线程构建，叶子里 4 个三角形一组用 SSE 同时求交
+// PickScene：由实例（网格 + 模型矩阵）组成的顶层 BVH，物体沿轨道运动时只更新包围盒（refit），不重建
+#include <glm/glm.hpp>
+#include <vector>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PICK_USE_SSE 1
+#endif
+
+namespace pick {
+
+// 轴对齐包围盒
+struct AABB {
+    glm::vec3 bmin = glm::vec3(FLT_MAX);
+    glm::vec3 bmax = glm::vec3(-FLT_MAX);
+
+    void grow(const glm::vec3& p) { bmin = glm::min(bmin, p); bmax = glm::max(bmax, p); }
+    void grow(const AABB& b) { bmin = glm::min(bmin, b.bmin); bmax = glm::max(bmax, b.bmax); }
+    bool empty() const { return bmin.x > bmax.x; }
+    // 表面积的一半，SAH 只关心比值
+    float area() const {
+        if (empty()) return 0.0f;
+        glm::vec3 e = bmax - bmin;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+    glm::vec3 center() const { return (bmin + bmax) * 0.5f; }
+};
+
+// 拾取结果：实例编号、三角形编号、射线参数 t 和重心坐标
+struct Hit {
+    int instance = -1;
+    int triangle = -1;
+    float t = FLT_MAX;
+    float u = 0.0f, v = 0.0f;
+};
+
+// 预先算好方向倒数的射线，t 的单位与 dir 的长度一致
+struct RayQuery {
+    glm::vec3 origin;
+    glm::vec3 dir;
+    glm::vec3 invDir;
+
+    RayQuery(const glm::vec3& o, const glm::vec3& d) : origin(o), dir(d), invDir(1.0f / d.x, 1.0f / d.y, 1.0f / d.z) {}
+};
+
+// BVH 节点：内部节点 count == 0，first 为左孩子下标（右孩子紧随其后）；叶子节点 first 为第一个图元
+struct BVHNode {
+    glm::vec3 bmin;
+    uint32_t first;
+    glm::vec3 bmax;
+    uint32_t count;
+};
+
+// slab 测试，返回进入距离，不相交时返回 FLT_MAX
+inline float intersectAABB(const RayQuery& r, const glm::vec3& bmin, const glm::vec3& bmax, float tMax) {
+    glm::vec3 t0 = (bmin - r.origin) * r.invDir;
+    glm::vec3 t1 = (bmax - r.origin) * r.invDir;
+    glm::vec3 tn = glm::min(t0, t1);
+    glm::vec3 tf = glm::max(t0, t1);
+    float tNear = std::max(std::max(tn.x, tn.y), std::max(tn.z, 0.0f));
+    float tFar = std::min(std::min(tf.x, tf.y), std::min(tf.z, tMax));
+    return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+namespace detail {
+
+// 遍历栈的容量：每下降一层最多压入一个远孩子，树深不超过它时栈不会越界
+const int BVH_STACK_SIZE = 64;
+
+// 通用的分箱 SAH 构建器：输入每个图元的包围盒，输出节点数组和图元顺序
+// 节点数组预先分配 2N-1 个，子节点下标用原子计数分配，左右子树可以交给不同线程并行构建
+class SAHBuilder {
+public:
+    SAHBuilder(const std::vector<AABB>& primBounds, uint32_t maxLeafSize, std::vector<BVHNode>& outNodes,
+               std::vector<uint32_t>& outOrder)
+        : bounds(primBounds), maxLeaf(maxLeafSize), nodes(outNodes), order(outOrder), used(1) {}
+
+    void run() {
+        uint32_t n = (uint32_t)bounds.size();
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0u);
+        centers.resize(n);
+        for (uint32_t i = 0; i < n; i++) centers[i] = bounds[i].center();
+
+        nodes.assign(n > 0 ? 2 * n - 1 : 1, BVHNode());
+        if (n == 0) {
+            nodes[0].bmin = glm::vec3(FLT_MAX);
+            nodes[0].bmax = glm::vec3(-FLT_MAX);
+            nodes[0].first = 0;
+            nodes[0].count = 0;
+            return;
+        }
+
+        // 线程数取 2 的幂次层数，上层子树各开一个任务
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        int spawnDepth = 0;
+        while ((1u << spawnDepth) < threads) spawnDepth++;
+
+        build(0, 0, n, 0, spawnDepth);
+        nodes.resize(used.load());
+    }
+
+private:
+    static const int BIN_COUNT = 16;
+    static const uint32_t PARALLEL_THRESHOLD = 4096; // 图元太少时开线程不划算
+    // SAH 对成簇或按几何级数分布的图元可能每层只剥掉一两个，树深没有上限；
+    // 超过这个深度改用中位数划分，每层图元数减半，uint32 个图元至多再分 32 层，总深度不超过遍历栈
+    static const int SAH_MAX_DEPTH = BVH_STACK_SIZE - 32;
+
+    const std::vector<AABB>& bounds;
+    uint32_t maxLeaf;
+    std::vector<BVHNode>& nodes;
+    std::vector<uint32_t>& order;
+    std::vector<glm::vec3> centers;
+    std::atomic<uint32_t> used;
+
+    void build(uint32_t nodeIndex, uint32_t begin, uint32_t end, int depth, int spawnDepth) {
+        BVHNode& node = nodes[nodeIndex];
+        AABB box, centerBox;
+        for (uint32_t i = begin; i < end; i++) {
+            box.grow(bounds[order[i]]);
+            centerBox.grow(centers[order[i]]);
+        }
+        node.bmin = box.bmin;
+        node.bmax = box.bmax;
+        node.first = begin;
+        node.count = end - begin;
+
+        uint32_t count = end - begin;
+        if (count <= 1) return;
+
+        // 在三个轴上分箱求 SAH 代价最小的划分
+        int bestAxis = -1, bestBin = 0;
+        float bestCost = FLT_MAX;
+        glm::vec3 extent = centerBox.bmax - centerBox.bmin;
+        for (int axis = 0; axis < 3 && depth < SAH_MAX_DEPTH; axis++) {
+            if (extent[axis] <= 0.0f) continue;
+            float scale = BIN_COUNT / extent[axis];
+            // 范围是非规格化数时 scale 溢出为 inf，0 * inf 得到 NaN，转成 int 后桶下标为负
+            if (!std::isfinite(scale)) continue;
+            AABB binBox[BIN_COUNT];
+            uint32_t binCount[BIN_COUNT] = {0};
+            for (uint32_t i = begin; i < end; i++) {
+                int b = std::min(BIN_COUNT - 1, (int)((centers[order[i]][axis] - centerBox.bmin[axis]) * scale));
+                binCount[b]++;
+                binBox[b].grow(bounds[order[i]]);
+            }
+            float leftArea[BIN_COUNT - 1];
+            uint32_t leftCount[BIN_COUNT - 1];
+            AABB acc;
+            uint32_t sum = 0;
+            for (int b = 0; b < BIN_COUNT - 1; b++) {
+                acc.grow(binBox[b]);
+                sum += binCount[b];
+                leftArea[b] = acc.area();
+                leftCount[b] = sum;
+            }
+            acc = AABB();
+            sum = 0;
+            for (int b = BIN_COUNT - 1; b > 0; b--) {
+                acc.grow(binBox[b]);
+                sum += binCount[b];
+                if (leftCount[b - 1] == 0 || sum == 0) continue;
+                float cost = leftArea[b - 1] * leftCount[b - 1] + acc.area() * sum;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b;
+                }
+            }
+        }
+
+        // 不划分的代价（以父节点表面积归一化，遍历代价取 1）
+        float leafCost = box.area() * count;
+        if (count <= maxLeaf && (bestAxis < 0 || bestCost + box.area() >= leafCost)) return;
+
+        uint32_t mid;
+        if (bestAxis >= 0) {
+            float scale = BIN_COUNT / extent[bestAxis];
+            float lo = centerBox.bmin[bestAxis];
+            const std::vector<glm::vec3>& c = centers;
+            int axis = bestAxis, split = bestBin;
+            mid = (uint32_t)(std::partition(order.begin() + begin, order.begin() + end,
+                                            [&](uint32_t p) {
+                                                return std::min(BIN_COUNT - 1, (int)((c[p][axis] - lo) * scale)) < split;
+                                            }) -
+                             order.begin());
+        } else {
+            // 超过深度上限或找不到 SAH 划分：按中心点最长轴的中位数对半分（中心点全部重合时顺序无所谓）
+            mid = begin + count / 2;
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+            if (extent[axis] > 0.0f) {
+                const std::vector<glm::vec3>& c = centers;
+                std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                                 [&](uint32_t a, uint32_t b) { return c[a][axis] < c[b][axis]; });
+            }
+        }
+        if (mid == begin || mid == end) mid = begin + count / 2;
+
+        uint32_t left = used.fetch_add(2);
+        node.first = left;
+        node.count = 0;
+
+        if (spawnDepth > 0 && count >= PARALLEL_THRESHOLD) {
+            std::future<void> task = std::async(std::launch::async, [this, left, begin, mid, depth, spawnDepth]() {
+                build(left, begin, mid, depth + 1, spawnDepth - 1);
+            });
+            build(left + 1, mid, end, depth + 1, spawnDepth - 1);
+            task.get();
+        } else {
+            build(left, begin, mid, depth + 1, 0);
+            build(left + 1, mid, end, depth + 1, 0);
+        }
+    }
+};
+
+} // namespace detail
+
+// 单个网格的三角形 BVH（模型空间）
+class MeshBVH {
+public:
+    void build(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices) {
+        idx = indices;
+        uint32_t triCount = (uint32_t)(idx.size() / 3);
+        std::vector<AABB> triBounds(triCount);
+        for (uint32_t i = 0; i < triCount; i++) {
+            triBounds[i].grow(positions[idx[3 * i]]);
+            triBounds[i].grow(positions[idx[3 * i + 1]]);
+            triBounds[i].grow(positions[idx[3 * i + 2]]);
+        }
+
+        std::vector<uint32_t> order;
+        detail::SAHBuilder(triBounds, 4, nodes, order).run();
+
+        // 每个叶子最多 4 个三角形，打包成一个 SoA 块，叶子的 first 改为块下标
+        blocks.clear();
+        for (BVHNode& node : nodes) {
+            if (node.count == 0) continue;
+            Tri4 block;
+            for (int lane = 0; lane < 4; lane++) {
+                block.id[lane] = lane < (int)node.count ? (int32_t)order[node.first + lane] : -1;
+            }
+            node.first = (uint32_t)blocks.size();
+            blocks.push_back(block);
+        }
+        refitTriangles(positions);
+    }
+
+    // 拓扑不变、顶点移动后只更新三角形数据和节点包围盒
+    void refit(const std::vector<glm::vec3>& positions) {
+        // 空网格只有一个 count == 0 的根节点，不能当作内部节点去读子节点；它的包围盒在 build 时已置空
+        if (blocks.empty()) return;
+        refitTriangles(positions);
+        for (size_t i = nodes.size(); i-- > 0;) {
+            BVHNode& node = nodes[i];
+            AABB box;
+            if (node.count > 0) {
+                const Tri4& block = blocks[node.first];
+                for (int lane = 0; lane < 4; lane++) {
+                    if (block.id[lane] < 0) continue;
+                    for (int k = 0; k < 3; k++) box.grow(positions[idx[3 * block.id[lane] + k]]);
+                }
+            } else {
+                // 子节点下标总是大于父节点，倒序遍历即可自底向上
+                const BVHNode& l = nodes[node.first];
+                const BVHNode& r = nodes[node.first + 1];
+                box.bmin = glm::min(l.bmin, r.bmin);
+                box.bmax = glm::max(l.bmax, r.bmax);
+            }
+            node.bmin = box.bmin;
+            node.bmax = box.bmax;
+        }
+    }
+
+    AABB bounds() const {
+        AABB box;
+        if (!nodes.empty()) {
+            box.bmin = nodes[0].bmin;
+            box.bmax = nodes[0].bmax;
+        }
+        return box;
+    }
+
+    size_t triangleCount() const { return idx.size() / 3; }
+
+    // 与 hit.t 之前最近的三角形求交，命中时更新 hit 的 t/triangle/u/v
+    bool intersect(const RayQuery& ray, Hit& hit) const {
+        if (blocks.empty()) return false;
+        if (intersectAABB(ray, nodes[0].bmin, nodes[0].bmax, hit.t) == FLT_MAX) return false;
+
+        bool found = false;
+        uint32_t stack[detail::BVH_STACK_SIZE];
+        int sp = 0;
+        uint32_t current = 0;
+        while (true) {
+            const BVHNode& node = nodes[current];
+            if (node.count > 0) {
+                found |= intersectBlock(ray, blocks[node.first], hit);
+                if (sp == 0) break;
+                current = stack[--sp];
+                continue;
+            }
+            uint32_t a = node.first, b = node.first + 1;
+            float da = intersectAABB(ray, nodes[a].bmin, nodes[a].bmax, hit.t);
+            float db = intersectAABB(ray, nodes[b].bmin, nodes[b].bmax, hit.t);
+            if (db < da) {
+                std::swap(a, b);
+                std::swap(da, db);
+            }
+            if (da == FLT_MAX) {
+                if (sp == 0) break;
+                current = stack[--sp];
+                continue;
+            }
+            current = a; // 先走近的孩子，远的入栈
+            if (db != FLT_MAX) stack[sp++] = b;
+        }
+        return found;
+    }
+
+private:
+    // 4 个三角形的 SoA 数据：顶点 v0 与两条边，空槽位 id 为 -1、边为 0（行列式为 0，不会命中）
+    struct Tri4 {
+        float v0[3][4];
+        float e1[3][4];
+        float e2[3][4];
+        int32_t id[4];
+    };
+
+    std::vector<BVHNode> nodes;
+    std::vector<Tri4> blocks;
+    std::vector<unsigned int> idx;
+
+    void refitTriangles(const std::vector<glm::vec3>& positions) {
+        for (Tri4& block : blocks) {
+            for (int lane = 0; lane < 4; lane++) {
+                glm::vec3 a(0.0f), e1(0.0f), e2(0.0f);
+                if (block.id[lane] >= 0) {
+                    a = positions[idx[3 * block.id[lane]]];
+                    e1 = positions[idx[3 * block.id[lane] + 1]] - a;
+                    e2 = positions[idx[3 * block.id[lane] + 2]] - a;
+                }
+                for (int k = 0; k < 3; k++) {
+                    block.v0[k][lane] = a[k];
+                    block.e1[k][lane] = e1[k];
+                    block.e2[k][lane] = e2[k];
+                }
+            }
+        }
+    }
+
+    // Möller-Trumbore，一次测试 4 个三角形
+    static bool intersectBlock(const RayQuery& ray, const Tri4& tri, Hit& hit) {
+        const float EPS = 1e-8f;
+        float t[4], u[4], v[4];
+        int mask;
+#ifdef PICK_USE_SSE
+        __m128 dx = _mm_set1_ps(ray.dir.x), dy = _mm_set1_ps(ray.dir.y), dz = _mm_set1_ps(ray.dir.z);
+        __m128 e1x = _mm_loadu_ps(tri.e1[0]), e1y = _mm_loadu_ps(tri.e1[1]), e1z = _mm_loadu_ps(tri.e1[2]);
+        __m128 e2x = _mm_loadu_ps(tri.e2[0]), e2y = _mm_loadu_ps(tri.e2[1]), e2z = _mm_loadu_ps(tri.e2[2]);
+
+        // p = d x e2, det = e1 . p
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+        __m128 valid = _mm_cmpgt_ps(absDet, _mm_set1_ps(EPS));
+        __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+        // s = o - v0, u = (s . p) / det
+        __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_loadu_ps(tri.v0[0]));
+        __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_loadu_ps(tri.v0[1]));
+        __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_loadu_ps(tri.v0[2]));
+        __m128 uu = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv);
+
+        // q = s x e1, v = (d . q) / det, t = (e2 . q) / det
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 vv = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv);
+        __m128 tt = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv);
+
+        __m128 zero = _mm_setzero_ps();
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(uu, zero));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(vv, zero));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(uu, vv), _mm_set1_ps(1.0f)));
+        valid = _mm_and_ps(valid, _mm_cmpgt_ps(tt, _mm_set1_ps(0.0001f)));
+        valid = _mm_and_ps(valid, _mm_cmplt_ps(tt, _mm_set1_ps(hit.t)));
+        mask = _mm_movemask_ps(valid);
+        if (mask == 0) return false;
+        _mm_storeu_ps(t, tt);
+        _mm_storeu_ps(u, uu);
+        _mm_storeu_ps(v, vv);
+#else
+        mask = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            glm::vec3 e1(tri.e1[0][lane], tri.e1[1][lane], tri.e1[2][lane]);
+            glm::vec3 e2(tri.e2[0][lane], tri.e2[1][lane], tri.e2[2][lane]);
+            glm::vec3 p = glm::cross(ray.dir, e2);
+            float det = glm::dot(e1, p);
+            if (std::fabs(det) <= EPS) continue;
+            float inv = 1.0f / det;
+            glm::vec3 s = ray.origin - glm::vec3(tri.v0[0][lane], tri.v0[1][lane], tri.v0[2][lane]);
+            glm::vec3 q = glm::cross(s, e1);
+            u[lane] = glm::dot(s, p) * inv;
+            v[lane] = glm::dot(ray.dir, q) * inv;
+            t[lane] = glm::dot(e2, q) * inv;
+            if (u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f && t[lane] > 0.0001f && t[lane] < hit.t)
+                mask |= 1 << lane;
+        }
+        if (mask == 0) return false;
+#endif
+        for (int lane = 0; lane < 4; lane++) {
+            if ((mask & (1 << lane)) && t[lane] < hit.t) {
+                hit.t = t[lane];
+                hit.u = u[lane];
+                hit.v = v[lane];
+                hit.triangle = tri.id[lane];
+            }
+        }
+        return true;
+    }
+};
+
+// 场景：若干网格实例组成的顶层 BVH
+class PickScene {
+public:
+    // 返回实例编号，编号按添加顺序递增
+    int addInstance(const MeshBVH* mesh, const glm::mat4& toWorld) {
+        Instance inst;
+        inst.mesh = mesh;
+        instances.push_back(inst);
+        needsBuild = true;
+        setTransform((int)instances.size() - 1, toWorld);
+        return (int)instances.size() - 1;
+    }
+
+    // 实例移动只需重算包围盒，下次求交前自动 refit
+    void setTransform(int instance, const glm::mat4& toWorld) {
+        Instance& inst = instances[instance];
+        inst.toWorld = toWorld;
+        inst.toLocal = glm::inverse(toWorld);
+        inst.worldBounds = AABB();
+        AABB local = inst.mesh->bounds();
+        if (!local.empty()) {
+            for (int i = 0; i < 8; i++) {
+                glm::vec3 corner((i & 1) ? local.bmax.x : local.bmin.x, (i & 2) ? local.bmax.y : local.bmin.y,
+                                 (i & 4) ? local.bmax.z : local.bmin.z);
+                inst.worldBounds.grow(glm::vec3(toWorld * glm::vec4(corner, 1.0f)));
+            }
+        }
+        dirty = true;
+    }
+
+    void build() {
+        std::vector<AABB> boxes(instances.size());
+        for (size_t i = 0; i < instances.size(); i++) boxes[i] = instances[i].worldBounds;
+        detail::SAHBuilder(boxes, 2, nodes, order).run();
+        needsBuild = false;
+        dirty = false;
+    }
+
+    void refit() {
+        for (size_t i = nodes.size(); i-- > 0;) {
+            BVHNode& node = nodes[i];
+            AABB box;
+            if (node.count > 0) {
+                for (uint32_t k = 0; k < node.count; k++) box.grow(instances[order[node.first + k]].worldBounds);
+            } else if (!instances.empty()) {
+                const BVHNode& l = nodes[node.first];
+                const BVHNode& r = nodes[node.first + 1];
+                box.bmin = glm::min(l.bmin, r.bmin);
+                box.bmax = glm::max(l.bmax, r.bmax);
+            }
+            node.bmin = box.bmin;
+            node.bmax = box.bmax;
+        }
+        dirty = false;
+    }
+
+    // 世界空间射线求最近的三角形，dir 不必归一化（hit.t 以 dir 的长度为单位）
+    bool intersect(const glm::vec3& origin, const glm::vec3& dir, Hit& hit) {
+        if (needsBuild) build();
+        else if (dirty) refit();
+        if (instances.empty()) return false;
+
+        RayQuery ray(origin, dir);
+        if (intersectAABB(ray, nodes[0].bmin, nodes[0].bmax, hit.t) == FLT_MAX) return false;
+
+        bool found = false;
+        uint32_t stack[detail::BVH_STACK_SIZE];
+        int sp = 0;
+        uint32_t current = 0;
+        while (true) {
+            const BVHNode& node = nodes[current];
+            if (node.count > 0) {
+                for (uint32_t k = 0; k < node.count; k++) {
+                    int id = (int)order[node.first + k];
+                    const Instance& inst = instances[id];
+                    // 射线变换到模型空间，参数 t 保持不变
+                    RayQuery local(glm::vec3(inst.toLocal * glm::vec4(origin, 1.0f)),
+                                   glm::vec3(inst.toLocal * glm::vec4(dir, 0.0f)));
+                    if (inst.mesh->intersect(local, hit)) {
+                        hit.instance = id;
+                        found = true;
+                    }
+                }
+                if (sp == 0) break;
+                current = stack[--sp];
+                continue;
+            }
+            uint32_t a = node.first, b = node.first + 1;
+            float da = intersectAABB(ray, nodes[a].bmin, nodes[a].bmax, hit.t);
+            float db = intersectAABB(ray, nodes[b].bmin, nodes[b].bmax, hit.t);
+            if (db < da) {
+                std::swap(a, b);
+                std::swap(da, db);
+            }
+            if (da == FLT_MAX) {
+                if (sp == 0) break;
+                current = stack[--sp];
+                continue;
+            }
+            current = a;
+            if (db != FLT_MAX) stack[sp++] = b;
+        }
+        return found;
+    }
+
+private:
+    struct Instance {
+        const MeshBVH* mesh = nullptr;
+        glm::mat4 toWorld = glm::mat4(1.0f);
+        glm::mat4 toLocal = glm::mat4(1.0f);
+        AABB worldBounds;
+    };
+
+    std::vector<Instance> instances;
+    std::vector<BVHNode> nodes;
+    std::vector<uint32_t> order;
+    bool needsBuild = true;
+    bool dirty = false;
+};
+
+} // namespace pick
@@ -48,15 +48,15 @@ namespace bg {
     class Renderable {
     private:
         unsigned int VAO;
-        unsigned int VBO;
-        unsigned int TexCoordVBO;
-        unsigned int NormalVBO;
+        unsigned int VBO;       // 交错的位置、纹理坐标、法线
         unsigned int EBO;
         Shader* renderShader;
         TextureInfo textureInfo;
         ObjModel objModel;
         unsigned int type;
-        int NumberOfVertices;
+        int NumberOfVertices;   // 焊接后的顶点数
+        int NumberOfIndices;
+        unsigned int IndexType; // GL_UNSIGNED_SHORT 或 GL_UNSIGNED_INT
         glm::mat4 Model;        // 注意旋转平移之后会变化，可能需要重置
 
         // 绑定普通纹理
@@ -82,6 +82,8 @@ namespace bg {
 
         unsigned int GetVAO() const;
         int GetNumberOfVertices() const;
+        int GetNumberOfIndices() const;
+        unsigned int GetIndexType() const;
         glm::mat4 GetModel();
         void SetShader(Shader* shader);
         Shader* GetShader() const;
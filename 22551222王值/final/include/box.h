@@ -8,6 +8,7 @@
 #include "glm/gtc/type_ptr.hpp"
 
 class Box;
+class BoxTree;
 
 enum BoxType{
     wallBox,
@@ -21,6 +22,7 @@ extern std::shared_ptr<Box> bluePortalableBox;
 extern std::shared_ptr<Box> orangePortalBox;
 extern std::shared_ptr<Box> orangePortalableBox;
 extern std::shared_ptr<Box> cameraBox;
+extern BoxTree wallBoxTree;
 
 /// @brief 各边与轴平行的Box
 class Box {
@@ -35,6 +37,10 @@ public:
     static bool checkCollision(Box &b1, Box &b2);
     static bool checkInside(Box &b_out, Box &b_in);
     static bool checkPlaceAt(Box &b, glm::vec3 cameraPos, glm::vec3 dir, glm::vec3 &resPos, glm::vec3 &resNorm);
+    /// @brief 连续碰撞检测：box 沿 offset 移动时最早碰到 obstacle 的时刻
+    /// @param t 碰撞时刻，0 为起点，1 为终点
+    /// @return 移动过程中是否会碰撞。已经接触且正在远离时不算碰撞
+    static bool checkSweep(Box &box, glm::vec3 offset, Box &obstacle, float &t);
 
     void setP1(glm::vec3 p);
     void setP2(glm::vec3 p);
@@ -50,4 +56,38 @@ private:
     glm::vec3 p2;
 };
 
+/// @brief 墙体Box的AABB树，碰撞和射线查询先用树剔除，再对候选Box做精确检测
+/// 修改 wallBoxList（添加、删除、替换Box）后需要调用 invalidate()；Box被移动后需要调用 refit()
+class BoxTree {
+public:
+    /// @brief 与 wallBoxList 同步：调用过 invalidate() 或数量变化时重建
+    void update();
+    /// @brief wallBoxList 被修改后调用，下次查询时重建。树中保存的是裸指针，替换掉的Box不能再被访问
+    void invalidate();
+    /// @brief Box的位置改变后重新计算各节点的包围盒
+    void refit();
+
+    /// @brief box 沿 offset 移动时最早的碰撞时刻，不会因为移动过快而穿墙
+    bool checkSweep(Box &box, glm::vec3 offset, float &t);
+    /// @brief 射线与墙体最近的交点（同对每个墙体调用 Box::checkPlaceAt）
+    /// @return 命中的Box，没有命中时返回 nullptr
+    Box *checkPlaceAt(glm::vec3 cameraPos, glm::vec3 dir, glm::vec3 &resPos, glm::vec3 &resNorm);
+
+private:
+    struct Node {
+        glm::vec3 p1;   // xyz均最大的点
+        glm::vec3 p2;   // xyz均最小的点
+        int left = -1;  // 左子节点，右子节点为 left + 1；叶子节点为 -1
+        int first = 0;  // 叶子节点的Box在 boxes 中的起始下标
+        int count = 0;
+    };
+
+    void build(int nodeIndex, int first, int count);
+
+    std::vector<Box *> boxes;   // 按叶子节点排列，不持有所有权
+    std::vector<Node> nodes;
+    bool valid = false;         // boxes 与 wallBoxList 一致
+    std::vector<int> stack;
+};
+
 #endif
\ No newline at end of file
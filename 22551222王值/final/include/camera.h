@@ -36,6 +36,7 @@ const float SPEED       =  20.0f;
 const float SENSITIVITY =  0.1f;
 const float ZOOM        =  45.0f;
 const float BOXSIZE     =  0.3f;
+const float SKIN        =  1e-3f;   // 碰撞后与墙体保留的间隙
 
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
 class Camera
@@ -123,9 +124,11 @@ public:
         if (direction == DOWN)
             newPosOffset -= glm::vec3(0.f, 1.f, 0.f) * velocity;
 
+        Box oldBox = *cameraBox.get();
         cameraBox.get()->setP1(cameraBox.get()->getP1() + newPosOffset);
         cameraBox.get()->setP2(cameraBox.get()->getP2() + newPosOffset);
         bool isCollision = false;
+        float hitT = 0.f;   // 与墙体碰撞时，沿移动方向能走到的比例
         int res = Trigger::NONE;
         if(isBothPlaced) {
             if (Box::checkInside(*bluePortalBox.get(), *cameraBox.get())) {
@@ -141,12 +144,7 @@ public:
             }
             else {
                 // hasJustPotaled = false;
-                for (auto b : wallBoxList) {
-                    if (Box::checkCollision(*b.get(), *cameraBox.get())) {
-                        isCollision = true;
-                        break;
-                    }
-                }
+                isCollision = wallBoxTree.checkSweep(oldBox, newPosOffset, hitT);
             }
         }
         else{
@@ -157,20 +155,19 @@ public:
                 isCollision = true;
             }
             else{
-                for (auto b : wallBoxList) {
-                    if (Box::checkCollision(*b.get(), *cameraBox.get())) {
-                        isCollision = true;
-                        break;
-                    }
-                }
+                isCollision = wallBoxTree.checkSweep(oldBox, newPosOffset, hitT);
             }
         }
 
         if (!isCollision) {
             Position += newPosOffset;
         } else {
-            cameraBox.get()->setP1(cameraBox.get()->getP1() - newPosOffset);
-            cameraBox.get()->setP2(cameraBox.get()->getP2() - newPosOffset);
+            // 退回原位，再沿移动方向前进到刚好碰到墙体为止，避免速度快时穿墙或停在离墙一步远的地方
+            float distance = glm::length(newPosOffset) * hitT - SKIN;
+            glm::vec3 allowedOffset = distance > 0.f ? glm::normalize(newPosOffset) * distance : glm::vec3(0.f);
+            Position += allowedOffset;
+            cameraBox.get()->setP1(oldBox.getP1() + allowedOffset);
+            cameraBox.get()->setP2(oldBox.getP2() + allowedOffset);
         }
         return res;
     }
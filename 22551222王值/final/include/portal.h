@@ -1,6 +1,7 @@
 #ifndef PORTAL_H
 #define PORTAL_H
 
+#include <array>
 #include <memory>
 #include "portalRenderer.h"
 #include "box.h"
@@ -44,6 +45,8 @@ namespace portal {
         glm::vec3 GetUpDir();
         Renderable* getFrameRenderable();
         Renderable* getHoleRenderable();
+        /// @brief 获取洞口外接矩形的四个角（世界坐标），用于在CPU上估计传送门在屏幕上的范围
+        std::array<glm::vec3, 4> GetHoleCorners();
         Portal* GetPairedPortal();
 
         /**
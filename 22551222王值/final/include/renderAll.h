@@ -6,6 +6,14 @@
 #include "lightRenderer.hpp"
 #include "portal.h"
 
+/// @brief 屏幕上的矩形范围，NDC坐标，[-1, 1]
+struct ScreenRect {
+    float minX = -1.f, minY = -1.f;
+    float maxX = 1.f, maxY = 1.f;
+
+    bool IsEmpty() const { return minX >= maxX || minY >= maxY; }
+};
+
 /// @brief 一定要初始化上下文再创建这个类的实例
 class RenderAll {
   private:
@@ -20,6 +28,14 @@ class RenderAll {
 
     Shader *depth, *shadow, *debug_quad, *sun;
 
+    /// @brief 计算传送门洞口在屏幕上的范围并与 clipRect 求交
+    /// @return 传送门背对摄像机或者与 clipRect 不相交时返回 false
+    bool GetPortalRect(portal::Portal* p, glm::mat4 view_mat, glm::mat4 proj_mat, const ScreenRect& clipRect,
+                       ScreenRect& portalRect);
+
+    /// @brief 把后续的绘制和清屏限制在 rect 覆盖的像素内
+    void SetScissor(const ScreenRect& rect);
+
   public:
     light::LightRenderer* lightRenderer; // 渲染光照阴影贴图
 
@@ -40,12 +56,15 @@ class RenderAll {
     /// @param view_mat
     /// @param proj_mat
     /// @param recursionLevel 迭代的层数
-    void RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm::mat4 proj_mat, int recursionLevel);
+    /// @param clipRect 本层能看到的屏幕范围（经过的所有传送门在屏幕上范围的交集），之外的传送门和物体都不渲染
+    void RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm::mat4 proj_mat, int recursionLevel,
+                       const ScreenRect& clipRect = ScreenRect());
 
     /// @brief 渲染除了传送门外的场景
     /// @param view_mat
     /// @param proj_mat
-    void RenderBaseScene(glm::mat4 view_mat, glm::mat4 proj_mat);
+    /// @param clipRect 不为空时剔除投影后不在该范围内（或在近平面之前）的物体
+    void RenderBaseScene(glm::mat4 view_mat, glm::mat4 proj_mat, const ScreenRect* clipRect = nullptr);
 
     /// @brief 获取传送门指针
     /// @param isBlue true：蓝色门 false：橙色门
@@ -21,6 +21,7 @@ Bg::Bg(glm::vec3 pos, const std::string &obj_path, const std::string &texture_pa
     // std::cout << p2.x << " " << p2.y << " " << p2.z << std::endl;
     std::shared_ptr<Box> b = std::make_shared<Box>(Box(p1, p2, BoxType::wallBox));
     wallBoxList.push_back(b);
+    wallBoxTree.invalidate();
     box = b;
 }
 
@@ -39,6 +40,7 @@ Bg::Bg(glm::vec3 pos, const std::string &obj_path, const std::string &texture_pa
     // std::cout << p2.x << " " << p2.y << " " << p2.z << std::endl;
     std::shared_ptr<Box> b = std::make_shared<Box>(Box(p1, p2, BoxType::wallBox));
     wallBoxList.push_back(b);
+    wallBoxTree.invalidate();
     box = b;
 }
 
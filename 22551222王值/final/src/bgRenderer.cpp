@@ -27,7 +27,7 @@ void BgRenderer::RenderBg(Renderable* renderable) {
     renderable->GetShader()->setMat4("proj", this->projMat);
 
     // 绘制
-    glDrawArrays(renderable->GetDrawType(), 0, renderable->GetNumberOfVertices());
+    glDrawElements(renderable->GetDrawType(), renderable->GetNumberOfIndices(), renderable->GetIndexType(), 0);
 }
 
 void BgRenderer::userCameraMatrix(Camera* camera) {
@@ -51,51 +51,23 @@ Renderable::Renderable(const std::string obj_path, [[maybe_unused]]const std::st
     this->Model = glm::mat4(1.0f);
     this->type = draw_type;
 
-    std::vector<float> vertexData;
-    std::vector<float> texCoordData;
-    std::vector<int> indexData;
-    std::vector<float> normalData;
-
-    // 重复使用顶点
-    for (int i = 0; i < static_cast<int>(objModel.faces.size()); i++) {
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v1].x);
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v1].y);
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v1].z);
-
-        texCoordData.push_back(objModel.texcoords[objModel.faces[i].vt1].u);
-        texCoordData.push_back(objModel.texcoords[objModel.faces[i].vt1].v);
-
-        normalData.push_back(objModel.normals[objModel.faces[i].vn1].nx);
-        normalData.push_back(objModel.normals[objModel.faces[i].vn1].ny);
-        normalData.push_back(objModel.normals[objModel.faces[i].vn1].nz);
-
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v2].x);
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v2].y);
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v2].z);
-
-        texCoordData.push_back(objModel.texcoords[objModel.faces[i].vt2].u);
-        texCoordData.push_back(objModel.texcoords[objModel.faces[i].vt2].v);
-
-        normalData.push_back(objModel.normals[objModel.faces[i].vn2].nx);
-        normalData.push_back(objModel.normals[objModel.faces[i].vn2].ny);
-        normalData.push_back(objModel.normals[objModel.faces[i].vn2].nz);
-
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v3].x);
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v3].y);
-        vertexData.push_back(objModel.vertices[objModel.faces[i].v3].z);
-
-        texCoordData.push_back(objModel.texcoords[objModel.faces[i].vt3].u);
-        texCoordData.push_back(objModel.texcoords[objModel.faces[i].vt3].v);
+    // 交错顶点：位置(3) + 纹理坐标(2) + 法线(3)，缺少的属性补0
+    const fastobj::indexed_mesh_t& mesh = objModel.mesh;
+    const size_t vertexCount = mesh.num_vertices();
+    std::vector<float> vertexData(vertexCount * 8, 0.0f);
+    for (size_t i = 0; i < vertexCount; i++) {
+        float* dst = &vertexData[i * 8];
+        std::copy(&mesh.vertices[3 * i], &mesh.vertices[3 * i] + 3, dst);
+        if (!mesh.texcoords.empty()) std::copy(&mesh.texcoords[2 * i], &mesh.texcoords[2 * i] + 2, dst + 3);
+        if (!mesh.normals.empty()) std::copy(&mesh.normals[3 * i], &mesh.normals[3 * i] + 3, dst + 5);
+    }
 
-        normalData.push_back(objModel.normals[objModel.faces[i].vn3].nx);
-        normalData.push_back(objModel.normals[objModel.faces[i].vn3].ny);
-        normalData.push_back(objModel.normals[objModel.faces[i].vn3].nz);
+    // 顶点数不超过65536时用16位下标
+    std::vector<unsigned char> indexData;
+    this->IndexType = fastobj::PackIndices(mesh, &indexData) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    this->NumberOfVertices = static_cast<int>(vertexCount);
+    this->NumberOfIndices = static_cast<int>(mesh.indices.size());
 
-        indexData.push_back(i * 3);
-        indexData.push_back(i * 3 + 1);
-        indexData.push_back(i * 3 + 2);
-    }
-    this->NumberOfVertices = static_cast<int>(vertexData.size() / 3);
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
 
@@ -103,26 +75,16 @@ Renderable::Renderable(const std::string obj_path, [[maybe_unused]]const std::st
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
-
-    glGenBuffers(1, &TexCoordVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, TexCoordVBO);
-    glBufferData(GL_ARRAY_BUFFER, texCoordData.size() * sizeof(float), texCoordData.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
-
-    glGenBuffers(1, &NormalVBO);
-    glBindBuffer(GL_ARRAY_BUFFER, NormalVBO);
-    glBufferData(GL_ARRAY_BUFFER, normalData.size() * sizeof(float), normalData.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
     glGenBuffers(1, &EBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(int), indexData.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
 
     glBindVertexArray(0);
 
@@ -178,6 +140,10 @@ unsigned int Renderable::GetVAO() const { return VAO; }
 
 int Renderable::GetNumberOfVertices() const { return NumberOfVertices; }
 
+int Renderable::GetNumberOfIndices() const { return NumberOfIndices; }
+
+unsigned int Renderable::GetIndexType() const { return IndexType; }
+
 glm::mat4 Renderable::GetModel() { return Model; }
 
 void Renderable::SetShader(Shader* shader) { this->renderShader = shader; }
@@ -1,4 +1,7 @@
 #include "box.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 std::vector<std::shared_ptr<Box>> wallBoxList;
 std::shared_ptr<Box> bluePortalBox;
@@ -6,6 +9,7 @@ std::shared_ptr<Box> bluePortalableBox;
 std::shared_ptr<Box> orangePortalBox;
 std::shared_ptr<Box> orangePortalableBox;
 std::shared_ptr<Box> cameraBox;
+BoxTree wallBoxTree;
 
 Box::Box(glm::vec3 p1, glm::vec3 p2, BoxType type) {
     this->p1 = p1;
@@ -81,6 +85,179 @@ bool Box::checkPlaceAt(Box &b, glm::vec3 cameraPos, glm::vec3 dir, glm::vec3 &re
     return isCross;
 }
 
+bool Box::checkSweep(Box &box, glm::vec3 offset, Box &obstacle, float &t) {
+    // 在每个轴上求出两个区间开始重叠和结束重叠的时刻，三个轴的交集就是碰撞的时间段
+    float tEnter = -std::numeric_limits<float>::infinity();
+    float tExit = std::numeric_limits<float>::infinity();
+    for (int i = 0; i < 3; i++) {
+        float aMax = box.getP1()[i], aMin = box.getP2()[i];
+        float bMax = obstacle.getP1()[i], bMin = obstacle.getP2()[i];
+        float d = offset[i];
+        if (d == 0.f) {
+            // 该轴不动：只有严格重叠时才可能碰撞，贴着滑动不算
+            if (!(aMin < bMax && bMin < aMax)) return false;
+            continue;
+        }
+        float enter = d > 0.f ? (bMin - aMax) / d : (bMax - aMin) / d;
+        float exit = d > 0.f ? (bMax - aMin) / d : (bMin - aMax) / d;
+        tEnter = std::max(tEnter, enter);
+        tExit = std::min(tExit, exit);
+    }
+    if (tEnter < tExit && tExit > 0.f && tEnter <= 1.f) {
+        t = std::max(tEnter, 0.f);
+        return true;
+    }
+    return false;
+}
+
+void BoxTree::update() {
+    if (valid && wallBoxList.size() == boxes.size()) return;
+    valid = true;
+    boxes.clear();
+    for (auto &b : wallBoxList) boxes.push_back(b.get());
+    nodes.clear();
+    if (boxes.empty()) return;
+    nodes.reserve(boxes.size() * 2);
+    nodes.push_back(Node());
+    build(0, 0, (int)boxes.size());
+    refit();
+}
+
+void BoxTree::invalidate() {
+    valid = false;
+}
+
+void BoxTree::build(int nodeIndex, int first, int count) {
+    nodes[nodeIndex].first = first;
+    nodes[nodeIndex].count = count;
+    if (count <= 4) return;
+
+    // 沿Box中心分布最长的轴按中位数切分
+    glm::vec3 cMax(-std::numeric_limits<float>::max()), cMin(std::numeric_limits<float>::max());
+    for (int i = first; i < first + count; i++) {
+        glm::vec3 c = (boxes[i]->getP1() + boxes[i]->getP2()) * 0.5f;
+        cMax = glm::max(cMax, c);
+        cMin = glm::min(cMin, c);
+    }
+    glm::vec3 size = cMax - cMin;
+    int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+    int mid = first + count / 2;
+    std::nth_element(boxes.begin() + first, boxes.begin() + mid, boxes.begin() + first + count,
+                     [axis](Box *a, Box *b) {
+                         return a->getP1()[axis] + a->getP2()[axis] < b->getP1()[axis] + b->getP2()[axis];
+                     });
+
+    int left = (int)nodes.size();
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    nodes[nodeIndex].left = left;
+    build(left, first, mid - first);
+    build(left + 1, mid, first + count - mid);
+}
+
+void BoxTree::refit() {
+    // 子节点总在父节点之后，倒序遍历即可自底向上
+    for (int n = (int)nodes.size() - 1; n >= 0; n--) {
+        Node &node = nodes[n];
+        if (node.left >= 0) {
+            node.p1 = glm::max(nodes[node.left].p1, nodes[node.left + 1].p1);
+            node.p2 = glm::min(nodes[node.left].p2, nodes[node.left + 1].p2);
+            continue;
+        }
+        node.p1 = glm::vec3(-std::numeric_limits<float>::max());
+        node.p2 = glm::vec3(std::numeric_limits<float>::max());
+        for (int i = node.first; i < node.first + node.count; i++) {
+            node.p1 = glm::max(node.p1, boxes[i]->getP1());
+            node.p2 = glm::min(node.p2, boxes[i]->getP2());
+        }
+    }
+}
+
+bool BoxTree::checkSweep(Box &box, glm::vec3 offset, float &t) {
+    update();
+    if (nodes.empty()) return false;
+    // 整个移动过程扫过的范围
+    glm::vec3 p1 = glm::max(box.getP1(), box.getP1() + offset);
+    glm::vec3 p2 = glm::min(box.getP2(), box.getP2() + offset);
+    bool isHit = false;
+    t = 1.f;
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (!(glm::all(glm::greaterThanEqual(p1, node.p2)) && glm::all(glm::greaterThanEqual(node.p1, p2)))) continue;
+        if (node.left >= 0) {
+            stack.push_back(node.left);
+            stack.push_back(node.left + 1);
+            continue;
+        }
+        for (int i = node.first; i < node.first + node.count; i++) {
+            float boxT;
+            if (Box::checkSweep(box, offset, *boxes[i], boxT) && boxT <= t) {
+                t = boxT;
+                isHit = true;
+            }
+        }
+    }
+    return isHit;
+}
+
+Box *BoxTree::checkPlaceAt(glm::vec3 cameraPos, glm::vec3 dir, glm::vec3 &resPos, glm::vec3 &resNorm) {
+    update();
+    if (nodes.empty()) return nullptr;
+
+    const float eps = 1e-3f;    // 节点包围盒略微放大，避免交点刚好在表面上时被误剔除
+    float dirLength = glm::length(dir);
+    float bestDist = glm::length(resPos - cameraPos);
+    // 射线进入节点包围盒的参数 t，未相交时返回 -1
+    auto enterT = [&](const Node &node) {
+        float tMin = 0.f, tMax = std::numeric_limits<float>::max();
+        for (int i = 0; i < 3; i++) {
+            float lo = node.p2[i] - eps, hi = node.p1[i] + eps;
+            if (dir[i] == 0.f) {
+                if (cameraPos[i] < lo || cameraPos[i] > hi) return -1.f;
+                continue;
+            }
+            float t0 = (lo - cameraPos[i]) / dir[i];
+            float t1 = (hi - cameraPos[i]) / dir[i];
+            if (t0 > t1) std::swap(t0, t1);
+            tMin = std::max(tMin, t0);
+            tMax = std::min(tMax, t1);
+            if (tMin > tMax) return -1.f;
+        }
+        return tMin;
+    };
+
+    Box *hitBox = nullptr;
+    stack.clear();
+    if (enterT(nodes[0]) >= 0.f) stack.push_back(0);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.left < 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                glm::vec3 lastPos = resPos;
+                if (Box::checkPlaceAt(*boxes[i], cameraPos, dir, resPos, resNorm) && resPos != lastPos) {
+                    hitBox = boxes[i];
+                    bestDist = glm::length(resPos - cameraPos);
+                }
+            }
+            continue;
+        }
+        // 近的子节点后入栈先处理；比当前最近交点还远的节点直接跳过
+        float tLeft = enterT(nodes[node.left]);
+        float tRight = enterT(nodes[node.left + 1]);
+        bool leftFirst = tLeft <= tRight;
+        int order[2] = {leftFirst ? node.left + 1 : node.left, leftFirst ? node.left : node.left + 1};
+        float orderT[2] = {leftFirst ? tRight : tLeft, leftFirst ? tLeft : tRight};
+        for (int k = 0; k < 2; k++) {
+            if (orderT[k] >= 0.f && orderT[k] * dirLength <= bestDist) stack.push_back(order[k]);
+        }
+    }
+    return hitBox;
+}
+
 void Box::setP1(glm::vec3 p) {p1 = p;}
 void Box::setP2(glm::vec3 p) {p2 = p;}
 void Box::setP1(BoxType type) {this->type = type;}
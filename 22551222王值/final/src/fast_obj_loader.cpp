@@ -0,0 +1,2 @@
+#define FAST_OBJ_LOADER_IMPLEMENTATION
+#include "../../../third_party/fast_obj_loader/fast_obj_loader.h"
\ No newline at end of file
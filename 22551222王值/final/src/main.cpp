@@ -154,6 +154,7 @@ void processInput(GLFWwindow *window)
             selectedThing->getRenderable()->GetP1P2(p1, p2);
             (*selectedThing->box).setP1(p1);
             (*selectedThing->box).setP2(p2);
+            wallBoxTree.refit();
             if(selectedThing == renderAll->bgs.back())
             {
                 renderAll->lightRenderer->lightPosition =  renderAll->lightRenderer->getLightPosition() + delta;
@@ -192,12 +193,7 @@ void mouse_button_callback([[maybe_unused]]GLFWwindow* window, int button, int a
         // std::cout << "Mouse button pressed" << std::endl;
         glm::vec3 resPos, resDir;
         resPos = glm::vec3(INF, INF, INF);
-        bool isPlace = false;
-        for (auto b : wallBoxList) {
-            if (Box::checkPlaceAt(*b.get(), camera.Position, camera.GetFront(), resPos, resDir)) {
-                isPlace = true;
-            }
-        }
+        bool isPlace = wallBoxTree.checkPlaceAt(camera.Position, camera.GetFront(), resPos, resDir) != nullptr;
         if (isPlace) {
             if (button == GLFW_MOUSE_BUTTON_LEFT) {
                 // std::cout << "Left mouse button pressed" << std::endl;
@@ -217,18 +213,20 @@ void mouse_button_callback([[maybe_unused]]GLFWwindow* window, int button, int a
     {
         glm::vec3 resPos, resDir;
         resPos = glm::vec3(INF, INF, INF);
-        auto t_selected_thing = selectedThing;
-        auto t_resPos = resPos;
-        for(auto bg: renderAll->bgs)
+        // 每个背景物体的Box都在 wallBoxList 中，最近的交点就是被选中的物体
+        Box *hitBox = wallBoxTree.checkPlaceAt(camera.Position, camera.GetFront(), resPos, resDir);
+        if(hitBox)
         {
-            t_resPos = resPos;
-            if(Box::checkPlaceAt(*bg->box, camera.Position, camera.GetFront(), resPos, resDir))
+            for(auto bg: renderAll->bgs)
             {
-                std::cout << "Thing selected!" << std::endl;
-                if(t_resPos != resPos) t_selected_thing = bg;
+                if(bg->box.get() == hitBox)
+                {
+                    std::cout << "Thing selected!" << std::endl;
+                    selectedThing = bg;
+                    break;
+                }
             }
         }
-        selectedThing = t_selected_thing;
     }
 }
 
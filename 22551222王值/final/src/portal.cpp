@@ -186,6 +186,16 @@ Renderable* Portal::getHoleRenderable() {
     return holeRenderable;
 }
 
+std::array<glm::vec3, 4> Portal::GetHoleCorners() {
+    glm::mat4 model = holeRenderable->GetModel();
+    return {
+        glm::vec3(model * glm::vec4(-PORTAL_GUT_WIDTH, -PORTAL_GUT_HEIGHT, 0.f, 1.f)),
+        glm::vec3(model * glm::vec4( PORTAL_GUT_WIDTH, -PORTAL_GUT_HEIGHT, 0.f, 1.f)),
+        glm::vec3(model * glm::vec4( PORTAL_GUT_WIDTH,  PORTAL_GUT_HEIGHT, 0.f, 1.f)),
+        glm::vec3(model * glm::vec4(-PORTAL_GUT_WIDTH,  PORTAL_GUT_HEIGHT, 0.f, 1.f)),
+    };
+}
+
 Portal* Portal::GetPairedPortal() {
     return pairedPortal;
 }
@@ -6,6 +6,8 @@
 #include "lightRenderer.hpp"
 #include "shader.h"
 #include <GL/gl.h>
+#include <algorithm>
+#include <cmath>
 
 namespace {
 const int MAX_RECURSION_LEVEL = 4;
@@ -13,6 +15,27 @@ const int PORTAL_BLUE = 0;
 const int PORTAL_ORANGE = 1;
 const bool ISBLUE = true;
 const bool ISORANGE = false;
+const float NEAR_W = 1e-4f; // 裁剪空间中 w 小于该值的点视为在摄像机后方
+
+/// @brief 世界坐标下的AABB投影后是否可能落在 rect 内
+/// 在齐次裁剪空间中对 rect 的四条边和近、远平面逐一检验，只要八个角点都在同一个平面外侧就一定看不到
+bool isBoxVisible(const glm::mat4& viewProj, glm::vec3 p1, glm::vec3 p2, const ScreenRect& rect) {
+    bool allOutside[6] = {true, true, true, true, true, true};
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner(i & 1 ? p1.x : p2.x, i & 2 ? p1.y : p2.y, i & 4 ? p1.z : p2.z);
+        glm::vec4 c = viewProj * glm::vec4(corner, 1.f);
+        allOutside[0] = allOutside[0] && c.x < rect.minX * c.w;
+        allOutside[1] = allOutside[1] && c.x > rect.maxX * c.w;
+        allOutside[2] = allOutside[2] && c.y < rect.minY * c.w;
+        allOutside[3] = allOutside[3] && c.y > rect.maxY * c.w;
+        allOutside[4] = allOutside[4] && c.z < -c.w; // 近平面，透过传送门时就是出口传送门所在的斜平面
+        allOutside[5] = allOutside[5] && c.z > c.w;
+    }
+    for (int i = 0; i < 6; i++) {
+        if (allOutside[i]) return false;
+    }
+    return true;
+}
 } // namespace
 extern bg::Bg *selectedThing;
 RenderAll::RenderAll(Camera& camera, int width, int height) {
@@ -102,11 +125,20 @@ void RenderAll::RenderLight(glm::mat4 view_mat, glm::mat4 proj_mat, Camera& came
     // lightRenderer->renderQuad();  // used for debug
 }
 
-void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm::mat4 proj_mat, int recursionLevel) {
-    for (auto p : portals) {
+void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm::mat4 proj_mat, int recursionLevel,
+                              const ScreenRect& clipRect) {
+    bool isVisible[2] = {false, false}; // 本层能看到的传送门
+    for (int i = 0; i < 2; i++) {
+        portal::Portal* p = portals[i];
 
         if (thePortal && p == thePortal) continue; // 除了第一次，剩下的递归只渲染一个传送门
 
+        // 先在CPU上求出传送门在屏幕上的范围，看不到的传送门既不标记模板也不再递归
+        ScreenRect portalRect;
+        if (!GetPortalRect(p, view_mat, proj_mat, clipRect, portalRect)) continue;
+        isVisible[i] = true;
+        SetScissor(clipRect);
+
         glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE); // 关闭颜色和深度缓存写入
         glDepthMask(GL_FALSE);
         glDisable(GL_DEPTH_TEST);
@@ -130,6 +162,7 @@ void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm
             glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
             glDepthMask(GL_TRUE);
 
+            SetScissor(portalRect);
             glClear(GL_DEPTH_BUFFER_BIT);
             glEnable(GL_DEPTH_TEST);
 
@@ -137,7 +170,7 @@ void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm
             glStencilMask(0x00);       // 禁止写入
             glStencilFunc(GL_EQUAL, recursionLevel + 1, 0xff); // 只对模板值满足条件的部分绘制
 
-            RenderBaseScene(new_view, new_proj);
+            RenderBaseScene(new_view, new_proj, &portalRect);
 
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -145,8 +178,10 @@ void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm
             portalRenderer->setProjMat(new_proj);
             portalRenderer->RenderPortal(thePortal->GetPairedPortal()->getFrameRenderable());
             glDisable(GL_BLEND);
+            SetScissor(clipRect);
         } else {
-            RenderPortals(p->GetPairedPortal(), new_view, new_proj, recursionLevel + 1);
+            RenderPortals(p->GetPairedPortal(), new_view, new_proj, recursionLevel + 1, portalRect);
+            SetScissor(clipRect);
         }
 
         glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
@@ -162,6 +197,8 @@ void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm
         portalRenderer->setProjMat(proj_mat);
         for (auto p2 : portals) { portalRenderer->RenderPortal(p2->getHoleRenderable()); }
     }
+    // 本层的像素都在 clipRect 内（模板值不小于本层的像素只会出现在经过的传送门里），所以清屏和绘制都可以裁剪到这里
+    SetScissor(clipRect);
 
     glDisable(GL_STENCIL_TEST);                          // 关闭模板测试
     glStencilMask(0x00);                                 // 关闭模板测试
@@ -177,7 +214,9 @@ void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm
     portalRenderer->setProjMat(proj_mat);
     if (thePortal != nullptr) portalRenderer->RenderPortal(thePortal->GetPairedPortal()->getHoleRenderable());
     else {
-        for (auto p : portals) { portalRenderer->RenderPortal(p->getHoleRenderable()); }
+        for (int i = 0; i < 2; i++) {
+            if (isVisible[i]) portalRenderer->RenderPortal(portals[i]->getHoleRenderable());
+        }
     }
 
     glDepthFunc(GL_LESS); // 将深度测试设回默认
@@ -189,7 +228,7 @@ void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     glDepthMask(GL_TRUE);
     glEnable(GL_DEPTH_TEST);
-    RenderBaseScene(view_mat, proj_mat);
+    RenderBaseScene(view_mat, proj_mat, &clipRect);
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -205,15 +244,73 @@ void RenderAll::RenderPortals(portal::Portal* thePortal, glm::mat4 view_mat, glm
         }
     }
     glDisable(GL_BLEND);
+
+    if (thePortal == nullptr) glDisable(GL_SCISSOR_TEST); // 回到主摄像机后取消裁剪，以免影响下一帧的清屏
+}
+
+bool RenderAll::GetPortalRect(portal::Portal* p, glm::mat4 view_mat, glm::mat4 proj_mat, const ScreenRect& clipRect,
+                              ScreenRect& portalRect) {
+    // 摄像机在洞口平面背面时看不到这个传送门
+    glm::vec3 cameraPos = glm::vec3(glm::inverse(view_mat)[3]);
+    glm::vec3 normal = glm::normalize(p->GetFaceDir());
+    glm::vec3 center = p->GetPosition() + 0.05f * normal;
+    if (glm::dot(cameraPos - center, normal) <= 0.f) return false;
+
+    glm::mat4 viewProj = proj_mat * view_mat;
+    std::array<glm::vec3, 4> corners = p->GetHoleCorners();
+    glm::vec4 clip[4];
+    bool allBeforeNear = true;
+    for (int i = 0; i < 4; i++) {
+        clip[i] = viewProj * glm::vec4(corners[i], 1.f);
+        allBeforeNear = allBeforeNear && clip[i].z < -clip[i].w;
+    }
+    // 整个洞口都在近平面之前（透过传送门时是在出口传送门的后面）
+    if (allBeforeNear) return false;
+
+    // 先把四边形裁剪到 w > NEAR_W 的部分再投影，避免摄像机后方的点投影后翻转
+    ScreenRect bounds;
+    bounds.minX = bounds.minY = INF;
+    bounds.maxX = bounds.maxY = -INF;
+    auto addPoint = [&bounds](glm::vec4 c) {
+        bounds.minX = std::min(bounds.minX, c.x / c.w);
+        bounds.maxX = std::max(bounds.maxX, c.x / c.w);
+        bounds.minY = std::min(bounds.minY, c.y / c.w);
+        bounds.maxY = std::max(bounds.maxY, c.y / c.w);
+    };
+    for (int i = 0; i < 4; i++) {
+        const glm::vec4& a = clip[i];
+        const glm::vec4& b = clip[(i + 1) % 4];
+        if (a.w > NEAR_W) addPoint(a);
+        if ((a.w > NEAR_W) != (b.w > NEAR_W)) addPoint(a + (b - a) * ((NEAR_W - a.w) / (b.w - a.w)));
+    }
+    if (bounds.minX > bounds.maxX) return false; // 全部在摄像机后方
+
+    portalRect.minX = std::max(bounds.minX, clipRect.minX);
+    portalRect.minY = std::max(bounds.minY, clipRect.minY);
+    portalRect.maxX = std::min(bounds.maxX, clipRect.maxX);
+    portalRect.maxY = std::min(bounds.maxY, clipRect.maxY);
+    return !portalRect.IsEmpty();
+}
+
+void RenderAll::SetScissor(const ScreenRect& rect) {
+    // 向外多留一个像素，保证光栅化时压到边界的像素也在范围内
+    int x0 = std::max(0, (int)std::floor((rect.minX * 0.5f + 0.5f) * scr_w) - 1);
+    int y0 = std::max(0, (int)std::floor((rect.minY * 0.5f + 0.5f) * scr_h) - 1);
+    int x1 = std::min(scr_w, (int)std::ceil((rect.maxX * 0.5f + 0.5f) * scr_w) + 1);
+    int y1 = std::min(scr_h, (int)std::ceil((rect.maxY * 0.5f + 0.5f) * scr_h) + 1);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
 }
 
-void RenderAll::RenderBaseScene(glm::mat4 view_mat, glm::mat4 proj_mat) {
+void RenderAll::RenderBaseScene(glm::mat4 view_mat, glm::mat4 proj_mat, const ScreenRect* clipRect) {
     /// @todo
     bgRenderer->setViewMat(view_mat);
     bgRenderer->setProjMat(proj_mat);
 
     // render background
+    glm::mat4 viewProj = proj_mat * view_mat;
     for (auto p : bgs) {
+        if (clipRect && !isBoxVisible(viewProj, p->box->getP1(), p->box->getP2(), *clipRect)) continue;
         bgRenderer->RenderBg(p->getRenderable());
     }
 }
@@ -5,7 +5,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <tiny_obj_loader.h>
+#define FAST_OBJ_LOADER_IMPLEMENTATION
+#include <fast_obj_loader.h>
+#define GL_PROGRAM_CACHE_IMPLEMENTATION
+#include <gl_program_cache.h>
 #include <iostream>
 #include <vector>
 #include <string>
@@ -18,10 +21,10 @@ unsigned int shaderProgram;
 unsigned int uiShaderProgram; // 2D UI着色器
 unsigned int VAO, VBO, EBO;
 unsigned int uiVAO, uiVBO; // 2D UI顶点缓冲
-std::vector<glm::vec3> vertices;
-std::vector<glm::vec2> texCoords;
-std::vector<glm::vec3> normals;
-std::vector<unsigned int> indices;
+std::vector<float> vertexData;        // 交错顶点：位置(3) + 纹理坐标(2) + 法线(3)
+std::vector<unsigned char> indexData; // 顶点数不超过65536时为16位下标，否则32位
+GLenum indexType = GL_UNSIGNED_INT;
+GLsizei indexCount = 0;
 unsigned int textureID = 0;
 
 // 视角控制
@@ -251,52 +254,44 @@ void processInput(GLFWwindow *window)
 // 加载OBJ模型
 bool loadOBJ(const std::string &path)
 {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    fastobj::indexed_mesh_t mesh;
+    fastobj::load_options_t options;
+    fastobj::weld_options_t weld;
+    weld.optimize_vertex_cache = true; // 相同 (v, vt, vn) 只保留一个顶点，并按顶点缓存重排三角形
+    std::string err;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+    if (!fastobj::LoadIndexedObj(&mesh, &err, path.c_str(), options, weld))
     {
-        std::cerr << warn << err << std::endl;
+        std::cerr << err << std::endl;
         return false;
     }
 
-    for (const auto &shape : shapes)
+    // 缺少纹理坐标或法线时补0
+    const size_t vertexCount = mesh.num_vertices();
+    vertexData.assign(vertexCount * 8, 0.0f);
+    for (size_t i = 0; i < vertexCount; i++)
     {
-        for (const auto &index : shape.mesh.indices)
+        float *dst = &vertexData[i * 8];
+        dst[0] = mesh.vertices[3 * i + 0];
+        dst[1] = mesh.vertices[3 * i + 1];
+        dst[2] = mesh.vertices[3 * i + 2];
+        if (!mesh.texcoords.empty())
         {
-            // 顶点位置
-            vertices.push_back(glm::vec3(
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]));
-            // 纹理坐标
-            if (attrib.texcoords.size() > 0)
-            {
-                texCoords.push_back(glm::vec2(
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]));
-            }
-            else
-            {
-                texCoords.push_back(glm::vec2(0.0f, 0.0f));
-            }
-            // 法线
-            if (attrib.normals.size() > 0)
-            {
-                normals.push_back(glm::vec3(
-                    attrib.normals[3 * index.normal_index + 0],
-                    attrib.normals[3 * index.normal_index + 1],
-                    attrib.normals[3 * index.normal_index + 2]));
-            }
-            else
-            {
-                normals.push_back(glm::vec3(0.0f, 0.0f, 0.0f));
-            }
-            indices.push_back(indices.size());
+            dst[3] = mesh.texcoords[2 * i + 0];
+            dst[4] = 1.0f - mesh.texcoords[2 * i + 1];
+        }
+        if (!mesh.normals.empty())
+        {
+            dst[5] = mesh.normals[3 * i + 0];
+            dst[6] = mesh.normals[3 * i + 1];
+            dst[7] = mesh.normals[3 * i + 2];
         }
     }
+
+    indexType = fastobj::PackIndices(mesh, &indexData) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    indexCount = (GLsizei)mesh.indices.size();
+    std::cout << "Model: " << indexCount / 3 << " triangles, " << vertexCount << " vertices, ACMR "
+              << fastobj::AverageCacheMissRatio(mesh.indices, vertexCount) << std::endl;
     return true;
 }
 
@@ -333,62 +328,29 @@ unsigned int loadTexture(const std::string &path)
     return texture;
 }
 
-// 编译着色器工具函数
-unsigned int compileShaderProgram(const char *vertSource, const char *fragSource)
-{
-    // 编译顶点着色器
-    unsigned int vertShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertShader, 1, &vertSource, NULL);
-    glCompileShader(vertShader);
-    // 检查顶点着色器编译错误
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertShader, 512, NULL, infoLog);
-        std::cerr << "Vertex Shader Compilation Failed:\n"
-                  << infoLog << std::endl;
-    }
+// 着色器程序缓存：按源码哈希把链接好的程序二进制存到 shader_cache/，下次启动直接 glProgramBinary
+glcache::ProgramCache programCache;
+int sceneProgramRequest = -1;
+int uiProgramRequest = -1;
 
-    // 编译片段着色器
-    unsigned int fragShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragShader, 1, &fragSource, NULL);
-    glCompileShader(fragShader);
-    // 检查片段着色器编译错误
-    glGetShaderiv(fragShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragShader, 512, NULL, infoLog);
-        std::cerr << "Fragment Shader Compilation Failed:\n"
-                  << infoLog << std::endl;
-    }
-
-    // 链接着色器程序
-    unsigned int program = glCreateProgram();
-    glAttachShader(program, vertShader);
-    glAttachShader(program, fragShader);
-    glLinkProgram(program);
-    // 检查链接错误
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success)
+// 等待异步编译完成并检查编译/链接错误
+unsigned int finishShaderProgram(int request, const char *name)
+{
+    std::string err;
+    unsigned int program = programCache.Wait(request, &err);
+    if (!program)
     {
-        glGetProgramInfoLog(program, 512, NULL, infoLog);
-        std::cerr << "Shader Program Linking Failed:\n"
-                  << infoLog << std::endl;
+        std::cerr << name << " Shader Program Failed:\n"
+                  << err << std::endl;
     }
-
-    // 删除临时着色器对象
-    glDeleteShader(vertShader);
-    glDeleteShader(fragShader);
     return program;
 }
 
 // 初始化2D UI
 void initUI()
 {
-    // 编译UI着色器
-    uiShaderProgram = compileShaderProgram(uiVertexShaderSource, uiFragmentShaderSource);
+    // UI着色器已在init中提交编译
+    uiShaderProgram = finishShaderProgram(uiProgramRequest, "UI");
 
     // 创建UI顶点缓冲
     glGenVertexArrays(1, &uiVAO);
@@ -453,8 +415,10 @@ void init()
         return;
     }
 
-    // 编译3D模型着色器
-    shaderProgram = compileShaderProgram(vertexShaderSource, fragmentShaderSource);
+    // 提交着色器编译（命中缓存则直接加载程序二进制），驱动编译的同时加载模型和纹理
+    programCache.Init((glcache::load_proc_t)glfwGetProcAddress, "shader_cache");
+    sceneProgramRequest = programCache.Request(vertexShaderSource, fragmentShaderSource);
+    uiProgramRequest = programCache.Request(uiVertexShaderSource, uiFragmentShaderSource);
 
     // 加载模型（替换为你的OBJ路径）
     if (!loadOBJ("model.obj"))
@@ -466,30 +430,20 @@ void init()
     // 加载纹理（替换为你的纹理路径，无纹理则使用默认白色纹理）
     textureID = loadTexture("texture.png");
 
+    // 3D模型着色器
+    shaderProgram = finishShaderProgram(sceneProgramRequest, "Scene");
+
     // 绑定3D模型VAO/VBO/EBO
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     glGenBuffers(1, &EBO);
     glBindVertexArray(VAO);
 
-    // 合并顶点数据（位置+纹理+法线）
-    std::vector<float> vertexData;
-    for (size_t i = 0; i < vertices.size(); i++)
-    {
-        vertexData.push_back(vertices[i].x);
-        vertexData.push_back(vertices[i].y);
-        vertexData.push_back(vertices[i].z);
-        vertexData.push_back(texCoords[i].x);
-        vertexData.push_back(texCoords[i].y);
-        vertexData.push_back(normals[i].x);
-        vertexData.push_back(normals[i].y);
-        vertexData.push_back(normals[i].z);
-    }
-
+    // 顶点数据在loadOBJ中已交错（位置+纹理+法线）
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), &vertexData[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(), GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size(), indexData.data(), GL_STATIC_DRAW);
 
     // 配置顶点属性
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
@@ -581,9 +535,9 @@ void render()
         glUniform1f(glGetUniformLocation(shaderProgram, (pointLight3 + ".quadratic").c_str()), 0.032f);
 
         // 绘制模型
-        if (!indices.empty())
+        if (indexCount > 0)
         {
-            glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+            glDrawElements(GL_TRIANGLES, indexCount, indexType, 0);
         }
 
         // 交换缓冲并轮询事件
@@ -600,8 +554,7 @@ void cleanup()
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &uiVBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
-    glDeleteProgram(uiShaderProgram);
+    programCache.Release(); // 删除shaderProgram和uiShaderProgram
     glfwTerminate();
 }
 
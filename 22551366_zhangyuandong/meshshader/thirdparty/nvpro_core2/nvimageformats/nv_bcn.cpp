@@ -0,0 +1,1688 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nv_bcn.h"
+
+#include <directx/dxgiformat.h>  // Included in third_party's dxh subproject
+#include "texture_formats.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#ifdef NVP_SUPPORTS_BASISU
+#include <basisu_gpu_texture.h>
+#endif
+
+#include <nvutils/parallel_work.hpp>
+
+namespace nv_bcn {
+
+#define UNWRAP_ERROR(expr_returning_error_with_text)                                                                   \
+  if(ErrorWithText unwrap_error_tmp = (expr_returning_error_with_text))                                                \
+  {                                                                                                                    \
+    return unwrap_error_tmp;                                                                                           \
+  }
+
+namespace {
+
+// Number of blocks handed to a thread at once. Blocks take a few microseconds
+// each, so this keeps the scheduling overhead small.
+constexpr uint64_t BLOCK_BATCH_SIZE = 64;
+
+// Squared-error weights for R, G and B. The perceptual weights are the Rec. 601
+// luma coefficients, scaled so that they sum to 3 like the uniform ones; this
+// keeps them balanced against the alpha channel in BC7.
+constexpr float kUniformWeights[3]    = {1.0f, 1.0f, 1.0f};
+constexpr float kPerceptualWeights[3] = {0.897f, 1.761f, 0.342f};
+
+// BC7 interpolation weights for 4-bit indices, out of 64.
+constexpr int kBC7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+template <class T>
+T clampT(T v, T lo, T hi)
+{
+  return std::min(std::max(v, lo), hi);
+}
+
+int roundToInt(float v)
+{
+  return static_cast<int>(std::lround(v));
+}
+
+uint32_t blocksAcross(uint32_t pixels)
+{
+  return (pixels + 3) / 4;
+}
+
+//-----------------------------------------------------------------------------
+// BC1 color blocks (also used by BC2 and BC3)
+//-----------------------------------------------------------------------------
+
+// Opaque texels of a block in structure-of-arrays layout, so that the
+// per-texel loops below auto-vectorize.
+struct ColorTexels
+{
+  float    c[3][16]{};
+  uint32_t count = 0;   // Number of opaque texels in c
+  uint8_t  slot[16]{};  // Position of each opaque texel in the block
+  bool     transparent[16]{};
+};
+
+uint16_t pack565(const float rgb[3])
+{
+  const uint32_t r = clampT(roundToInt(rgb[0] * (31.0f / 255.0f)), 0, 31);
+  const uint32_t g = clampT(roundToInt(rgb[1] * (63.0f / 255.0f)), 0, 63);
+  const uint32_t b = clampT(roundToInt(rgb[2] * (31.0f / 255.0f)), 0, 31);
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpack565(uint16_t c, int rgb[3])
+{
+  const int r = (c >> 11) & 31;
+  const int g = (c >> 5) & 63;
+  const int b = c & 31;
+  rgb[0]      = (r << 3) | (r >> 2);
+  rgb[1]      = (g << 2) | (g >> 4);
+  rgb[2]      = (b << 3) | (b >> 2);
+}
+
+// Builds the 4-entry BC1 palette. This must match decodeColorBlock().
+void colorPalette(uint16_t c0, uint16_t c1, bool threeColor, int palette[4][3])
+{
+  unpack565(c0, palette[0]);
+  unpack565(c1, palette[1]);
+  for(int k = 0; k < 3; k++)
+  {
+    if(threeColor)
+    {
+      palette[2][k] = (palette[0][k] + palette[1][k] + 1) / 2;
+      palette[3][k] = 0;
+    }
+    else
+    {
+      palette[2][k] = (2 * palette[0][k] + palette[1][k] + 1) / 3;
+      palette[3][k] = (palette[0][k] + 2 * palette[1][k] + 1) / 3;
+    }
+  }
+}
+
+// Chooses the best index of each texel for the given endpoints; returns the
+// weighted squared error. In 3-color mode, transparent texels use index 3 and
+// opaque texels never do, since index 3 decodes to transparent black in BC1.
+float fitColorIndices(const ColorTexels& texels, const float w[3], uint16_t c0, uint16_t c1, bool threeColor, uint8_t indices[16])
+{
+  int palette[4][3];
+  colorPalette(c0, c1, threeColor, palette);
+  const int numCandidates = threeColor ? 3 : 4;
+
+  for(int i = 0; i < 16; i++)
+  {
+    indices[i] = 3;
+  }
+
+  float total = 0.0f;
+  for(uint32_t t = 0; t < texels.count; t++)
+  {
+    float best    = std::numeric_limits<float>::max();
+    int   bestIdx = 0;
+    for(int p = 0; p < numCandidates; p++)
+    {
+      const float dr  = texels.c[0][t] - float(palette[p][0]);
+      const float dg  = texels.c[1][t] - float(palette[p][1]);
+      const float db  = texels.c[2][t] - float(palette[p][2]);
+      const float err = w[0] * dr * dr + w[1] * dg * dg + w[2] * db * db;
+      if(err < best)
+      {
+        best    = err;
+        bestIdx = p;
+      }
+    }
+    indices[texels.slot[t]] = static_cast<uint8_t>(bestIdx);
+    total += best;
+  }
+  return total;
+}
+
+// Endpoints from the bounding box of the texels, using the diagonal that
+// follows the sign of the covariance, inset by 1/16 of the range.
+void colorEndpointsBBox(const ColorTexels& texels, float e0[3], float e1[3])
+{
+  float mn[3], mx[3], mean[3];
+  for(int k = 0; k < 3; k++)
+  {
+    mn[k]   = 255.0f;
+    mx[k]   = 0.0f;
+    mean[k] = 0.0f;
+    for(uint32_t t = 0; t < texels.count; t++)
+    {
+      mn[k] = std::min(mn[k], texels.c[k][t]);
+      mx[k] = std::max(mx[k], texels.c[k][t]);
+      mean[k] += texels.c[k][t];
+    }
+    mean[k] /= float(texels.count);
+  }
+
+  // Flip G and B if they are anticorrelated with R (or G, if R is flat).
+  const int ref = (mx[0] > mn[0]) ? 0 : 1;
+  for(int k = ref + 1; k < 3; k++)
+  {
+    float cov = 0.0f;
+    for(uint32_t t = 0; t < texels.count; t++)
+    {
+      cov += (texels.c[ref][t] - mean[ref]) * (texels.c[k][t] - mean[k]);
+    }
+    if(cov < 0.0f)
+    {
+      std::swap(mn[k], mx[k]);
+    }
+  }
+
+  for(int k = 0; k < 3; k++)
+  {
+    const float inset = (mx[k] - mn[k]) / 16.0f;
+    e0[k]             = mx[k] - inset;
+    e1[k]             = mn[k] + inset;
+  }
+}
+
+// Computes the principal axis of `n` points in `dims` dimensions (given in
+// structure-of-arrays layout and already scaled by the channel weights) using
+// power iteration; returns the mean and the axis.
+void principalAxis(const float (*points)[16], uint32_t n, int dims, float mean[4], float axis[4])
+{
+  for(int k = 0; k < dims; k++)
+  {
+    mean[k] = 0.0f;
+    for(uint32_t t = 0; t < n; t++)
+    {
+      mean[k] += points[k][t];
+    }
+    mean[k] /= float(n);
+  }
+
+  float cov[4][4]{};
+  for(int a = 0; a < dims; a++)
+  {
+    for(int b = a; b < dims; b++)
+    {
+      float sum = 0.0f;
+      for(uint32_t t = 0; t < n; t++)
+      {
+        sum += (points[a][t] - mean[a]) * (points[b][t] - mean[b]);
+      }
+      cov[a][b] = sum;
+      cov[b][a] = sum;
+    }
+  }
+
+  // Start from the row with the largest diagonal entry; that's never
+  // orthogonal to the principal axis unless the covariance is degenerate.
+  int start = 0;
+  for(int k = 1; k < dims; k++)
+  {
+    if(cov[k][k] > cov[start][start])
+      start = k;
+  }
+  float v[4] = {};
+  for(int k = 0; k < dims; k++)
+  {
+    v[k] = cov[start][k];
+  }
+
+  for(int iter = 0; iter < 8; iter++)
+  {
+    float next[4] = {};
+    float maxAbs  = 0.0f;
+    for(int a = 0; a < dims; a++)
+    {
+      for(int b = 0; b < dims; b++)
+      {
+        next[a] += cov[a][b] * v[b];
+      }
+      maxAbs = std::max(maxAbs, std::abs(next[a]));
+    }
+    if(maxAbs < 1e-8f)
+      break;
+    for(int k = 0; k < dims; k++)
+    {
+      v[k] = next[k] / maxAbs;
+    }
+  }
+
+  float len = 0.0f;
+  for(int k = 0; k < dims; k++)
+  {
+    len += v[k] * v[k];
+  }
+  len = std::sqrt(len);
+  for(int k = 0; k < dims; k++)
+  {
+    axis[k] = (len > 1e-8f) ? v[k] / len : 1.0f / std::sqrt(float(dims));
+  }
+}
+
+// Endpoints at the extremes of the texels projected onto their principal
+// axis, computed in the weighted color space.
+void colorEndpointsPCA(const ColorTexels& texels, const float w[3], float e0[3], float e1[3])
+{
+  float sw[3];
+  float scaled[3][16];
+  for(int k = 0; k < 3; k++)
+  {
+    sw[k] = std::sqrt(w[k]);
+    for(uint32_t t = 0; t < texels.count; t++)
+    {
+      scaled[k][t] = texels.c[k][t] * sw[k];
+    }
+  }
+
+  float mean[4], axis[4];
+  principalAxis(scaled, texels.count, 3, mean, axis);
+
+  float tMin = std::numeric_limits<float>::max();
+  float tMax = -tMin;
+  for(uint32_t t = 0; t < texels.count; t++)
+  {
+    const float proj = (scaled[0][t] - mean[0]) * axis[0] + (scaled[1][t] - mean[1]) * axis[1] + (scaled[2][t] - mean[2]) * axis[2];
+    tMin = std::min(tMin, proj);
+    tMax = std::max(tMax, proj);
+  }
+
+  for(int k = 0; k < 3; k++)
+  {
+    e0[k] = clampT((mean[k] + axis[k] * tMax) / sw[k], 0.0f, 255.0f);
+    e1[k] = clampT((mean[k] + axis[k] * tMin) / sw[k], 0.0f, 255.0f);
+  }
+}
+
+// Least-squares endpoints for fixed indices. Returns false if the system is
+// singular (e.g. all texels use the same index).
+bool refineColorEndpoints(const ColorTexels& texels, const uint8_t indices[16], bool threeColor, float e0[3], float e1[3])
+{
+  // Weight of endpoint 0 for each index.
+  static const float kWeights4[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+  static const float kWeights3[4] = {1.0f, 0.0f, 0.5f, 0.0f};
+  const float*       weights      = threeColor ? kWeights3 : kWeights4;
+
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[3] = {}, bx[3] = {};
+  for(uint32_t t = 0; t < texels.count; t++)
+  {
+    const float alpha = weights[indices[texels.slot[t]]];
+    const float beta  = 1.0f - alpha;
+    aa += alpha * alpha;
+    ab += alpha * beta;
+    bb += beta * beta;
+    for(int k = 0; k < 3; k++)
+    {
+      ax[k] += alpha * texels.c[k][t];
+      bx[k] += beta * texels.c[k][t];
+    }
+  }
+
+  const float det = aa * bb - ab * ab;
+  if(std::abs(det) < 1e-6f)
+    return false;
+
+  for(int k = 0; k < 3; k++)
+  {
+    e0[k] = clampT((bb * ax[k] - ab * bx[k]) / det, 0.0f, 255.0f);
+    e1[k] = clampT((aa * bx[k] - ab * ax[k]) / det, 0.0f, 255.0f);
+  }
+  return true;
+}
+
+// Optimal 565 endpoints for a single 8-bit channel value when using index 2
+// (2/3 * e0 + 1/3 * e1), one table for 5-bit and one for 6-bit channels.
+struct SingleColorTable
+{
+  uint8_t e[2][256][2];
+
+  SingleColorTable()
+  {
+    for(int table = 0; table < 2; table++)
+    {
+      const int bits    = (table == 0) ? 5 : 6;
+      const int maxCode = (1 << bits) - 1;
+      for(int v = 0; v < 256; v++)
+      {
+        int bestErr = 256;
+        for(int a = 0; a <= maxCode; a++)
+        {
+          const int ea = (bits == 5) ? ((a << 3) | (a >> 2)) : ((a << 2) | (a >> 4));
+          for(int b = 0; b <= maxCode; b++)
+          {
+            const int eb  = (bits == 5) ? ((b << 3) | (b >> 2)) : ((b << 2) | (b >> 4));
+            const int err = std::abs((2 * ea + eb + 1) / 3 - v);
+            if(err < bestErr)
+            {
+              bestErr        = err;
+              e[table][v][0] = static_cast<uint8_t>(a);
+              e[table][v][1] = static_cast<uint8_t>(b);
+            }
+          }
+        }
+      }
+    }
+  }
+};
+
+const SingleColorTable& getSingleColorTable()
+{
+  static const SingleColorTable table;
+  return table;
+}
+
+void writeColorBlock(uint16_t c0, uint16_t c1, const uint8_t indices[16], uint8_t* out)
+{
+  uint32_t bits = 0;
+  for(int i = 0; i < 16; i++)
+  {
+    bits |= uint32_t(indices[i]) << (2 * i);
+  }
+  out[0] = static_cast<uint8_t>(c0 & 0xFF);
+  out[1] = static_cast<uint8_t>(c0 >> 8);
+  out[2] = static_cast<uint8_t>(c1 & 0xFF);
+  out[3] = static_cast<uint8_t>(c1 >> 8);
+  memcpy(out + 4, &bits, sizeof(bits));  // BCn is little-endian, like all platforms we support
+}
+
+// Orders the endpoints for the decoder's mode selection (c0 > c1 for 4-color
+// mode, c0 <= c1 for 3-color mode) and writes the block.
+void finishColorBlock(uint16_t c0, uint16_t c1, uint8_t indices[16], bool threeColor, uint8_t* out)
+{
+  if(threeColor)
+  {
+    if(c0 > c1)
+    {
+      std::swap(c0, c1);
+      for(int i = 0; i < 16; i++)
+      {
+        indices[i] = (indices[i] < 2) ? uint8_t(indices[i] ^ 1) : indices[i];
+      }
+    }
+  }
+  else if(c0 < c1)
+  {
+    std::swap(c0, c1);
+    for(int i = 0; i < 16; i++)
+    {
+      indices[i] ^= 1;  // 0 <-> 1, 2 <-> 3
+    }
+  }
+  else if(c0 == c1)
+  {
+    // All palette entries but 3 are equal, and 3 would decode as black.
+    for(int i = 0; i < 16; i++)
+    {
+      indices[i] = 0;
+    }
+  }
+  writeColorBlock(c0, c1, indices, out);
+}
+
+struct ColorCandidate
+{
+  uint16_t c0 = 0, c1 = 0;
+  uint8_t  indices[16]{};
+  float    error = std::numeric_limits<float>::max();
+};
+
+// Fits endpoints for one mode, then refines them with least squares.
+void searchColorMode(const ColorTexels& texels, const float w[3], const float start0[3], const float start1[3], bool threeColor, int refinePasses, ColorCandidate& best)
+{
+  float e0[3], e1[3];
+  std::copy(start0, start0 + 3, e0);
+  std::copy(start1, start1 + 3, e1);
+
+  for(int pass = 0; pass <= refinePasses; pass++)
+  {
+    ColorCandidate candidate;
+    candidate.c0    = pack565(e0);
+    candidate.c1    = pack565(e1);
+    candidate.error = fitColorIndices(texels, w, candidate.c0, candidate.c1, threeColor, candidate.indices);
+    if(candidate.error < best.error)
+    {
+      best = candidate;
+    }
+    else if(pass > 0)
+    {
+      break;  // Refinement stopped improving
+    }
+
+    if(pass == refinePasses || !refineColorEndpoints(texels, candidate.indices, threeColor, e0, e1))
+      break;
+  }
+}
+
+// Encodes the RGB part of a block. If `allowTransparency`, texels with alpha
+// below 128 are encoded as BC1 transparent black, and 3-color mode may be used.
+void encodeColorBlock(const uint8_t pixels[64], const float w[3], Quality quality, bool allowTransparency, uint8_t* out)
+{
+  ColorTexels texels;
+  bool        anyTransparent = false;
+  bool        solid          = true;
+  for(int i = 0; i < 16; i++)
+  {
+    const uint8_t* px = pixels + 4 * i;
+    if(allowTransparency && px[3] < 128)
+    {
+      texels.transparent[i] = true;
+      anyTransparent        = true;
+      continue;
+    }
+    const uint32_t t = texels.count++;
+    texels.slot[t]   = static_cast<uint8_t>(i);
+    for(int k = 0; k < 3; k++)
+    {
+      texels.c[k][t] = float(px[k]);
+      solid          = solid && (texels.c[k][t] == texels.c[k][0]);
+    }
+  }
+
+  uint8_t indices[16];
+  if(texels.count == 0)
+  {
+    for(int i = 0; i < 16; i++)
+    {
+      indices[i] = 3;
+    }
+    writeColorBlock(0, 0, indices, out);
+    return;
+  }
+
+  if(solid && !anyTransparent)
+  {
+    const SingleColorTable& table = getSingleColorTable();
+    const uint8_t*          px    = pixels + 4 * texels.slot[0];
+    const uint16_t          c0 = static_cast<uint16_t>((table.e[0][px[0]][0] << 11) | (table.e[1][px[1]][0] << 5) | table.e[0][px[2]][0]);
+    const uint16_t          c1 = static_cast<uint16_t>((table.e[0][px[0]][1] << 11) | (table.e[1][px[1]][1] << 5) | table.e[0][px[2]][1]);
+    for(int i = 0; i < 16; i++)
+    {
+      indices[i] = 2;
+    }
+    finishColorBlock(c0, c1, indices, false, out);
+    return;
+  }
+
+  float e0[3], e1[3];
+  if(quality == Quality::eFastest)
+  {
+    colorEndpointsBBox(texels, e0, e1);
+  }
+  else
+  {
+    colorEndpointsPCA(texels, w, e0, e1);
+  }
+
+  const int      refinePasses = (quality == Quality::eFastest) ? 0 : (quality == Quality::eNormal ? 1 : 3);
+  ColorCandidate best;
+  // Transparent texels require 3-color mode.
+  searchColorMode(texels, w, e0, e1, anyTransparent, refinePasses, best);
+  bool bestThreeColor = anyTransparent;
+  if(allowTransparency && !anyTransparent && quality == Quality::eHighest)
+  {
+    ColorCandidate threeColor;
+    searchColorMode(texels, w, e0, e1, true, refinePasses, threeColor);
+    if(threeColor.error < best.error)
+    {
+      best           = threeColor;
+      bestThreeColor = true;
+    }
+  }
+
+  for(int i = 0; i < 16; i++)
+  {
+    best.indices[i] = texels.transparent[i] ? 3 : best.indices[i];
+  }
+  finishColorBlock(best.c0, best.c1, best.indices, bestThreeColor, out);
+}
+
+void decodeColorBlock(const uint8_t* block, bool forceFourColor, uint8_t pixels[64])
+{
+  const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+  const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+  uint32_t       bits;
+  memcpy(&bits, block + 4, sizeof(bits));
+
+  const bool threeColor = !forceFourColor && (c0 <= c1);
+  int        palette[4][3];
+  colorPalette(c0, c1, threeColor, palette);
+  for(int i = 0; i < 16; i++)
+  {
+    const uint32_t idx = (bits >> (2 * i)) & 3;
+    for(int k = 0; k < 3; k++)
+    {
+      pixels[4 * i + k] = static_cast<uint8_t>(palette[idx][k]);
+    }
+    pixels[4 * i + 3] = (threeColor && idx == 3) ? 0 : 255;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// BC4 channel blocks (also used by BC3 alpha and BC5)
+//-----------------------------------------------------------------------------
+
+// Builds the 8-entry BC4 palette. e0 > e1 selects the 8-value mode, otherwise
+// the 6-value mode with explicit 0 and 255. This must match decodeChannelBlock().
+void channelPalette(int e0, int e1, int palette[8])
+{
+  palette[0] = e0;
+  palette[1] = e1;
+  if(e0 > e1)
+  {
+    for(int i = 2; i < 8; i++)
+    {
+      palette[i] = ((8 - i) * e0 + (i - 1) * e1 + 3) / 7;
+    }
+  }
+  else
+  {
+    for(int i = 2; i < 6; i++)
+    {
+      palette[i] = ((6 - i) * e0 + (i - 1) * e1 + 2) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+int fitChannelIndices(const int values[16], int e0, int e1, uint8_t indices[16])
+{
+  int palette[8];
+  channelPalette(e0, e1, palette);
+  int total = 0;
+  for(int i = 0; i < 16; i++)
+  {
+    int best    = std::numeric_limits<int>::max();
+    int bestIdx = 0;
+    for(int p = 0; p < 8; p++)
+    {
+      const int d   = values[i] - palette[p];
+      const int err = d * d;
+      if(err < best)
+      {
+        best    = err;
+        bestIdx = p;
+      }
+    }
+    indices[i] = static_cast<uint8_t>(bestIdx);
+    total += best;
+  }
+  return total;
+}
+
+// Encodes 16 8-bit values as a BC4 block.
+void encodeChannelBlock(const int values[16], Quality quality, uint8_t* out)
+{
+  int mn = 255, mx = 0;
+  // Range of values other than 0 and 255, for the 6-value mode.
+  int mn6 = 255, mx6 = 0;
+  for(int i = 0; i < 16; i++)
+  {
+    mn = std::min(mn, values[i]);
+    mx = std::max(mx, values[i]);
+    if(values[i] != 0 && values[i] != 255)
+    {
+      mn6 = std::min(mn6, values[i]);
+      mx6 = std::max(mx6, values[i]);
+    }
+  }
+
+  int     bestE0 = mx, bestE1 = mn;
+  uint8_t bestIndices[16];
+  int     bestError = fitChannelIndices(values, bestE0, bestE1, bestIndices);
+
+  auto tryEndpoints = [&](int e0, int e1) {
+    uint8_t   indices[16];
+    const int error = fitChannelIndices(values, e0, e1, indices);
+    if(error < bestError)
+    {
+      bestError = error;
+      bestE0    = e0;
+      bestE1    = e1;
+      memcpy(bestIndices, indices, sizeof(indices));
+    }
+  };
+
+  if(mn != mx && quality != Quality::eFastest)
+  {
+    if(mn6 > mx6)  // Only 0 and 255
+    {
+      mn6 = mx6 = 0;
+    }
+    tryEndpoints(mn6, mx6);
+
+    if(quality == Quality::eHighest)
+    {
+      // Local search around both modes' starting endpoints, keeping each
+      // mode's endpoint order.
+      for(int d0 = -2; d0 <= 2; d0++)
+      {
+        for(int d1 = -2; d1 <= 2; d1++)
+        {
+          const int a0 = clampT(mx + d0, 0, 255), a1 = clampT(mn + d1, 0, 255);
+          if(a0 > a1)
+            tryEndpoints(a0, a1);
+          const int b0 = clampT(mn6 + d0, 0, 255), b1 = clampT(mx6 + d1, 0, 255);
+          if(b0 <= b1)
+            tryEndpoints(b0, b1);
+        }
+      }
+    }
+  }
+
+  uint64_t bits = 0;
+  for(int i = 0; i < 16; i++)
+  {
+    bits |= uint64_t(bestIndices[i]) << (3 * i);
+  }
+  out[0] = static_cast<uint8_t>(bestE0);
+  out[1] = static_cast<uint8_t>(bestE1);
+  for(int i = 0; i < 6; i++)
+  {
+    out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+}
+
+// Decodes a BC4 block into every 4th byte of `out`.
+void decodeChannelBlock(const uint8_t* block, uint8_t* out)
+{
+  int palette[8];
+  channelPalette(block[0], block[1], palette);
+  uint64_t bits = 0;
+  for(int i = 0; i < 6; i++)
+  {
+    bits |= uint64_t(block[2 + i]) << (8 * i);
+  }
+  for(int i = 0; i < 16; i++)
+  {
+    out[4 * i] = static_cast<uint8_t>(palette[(bits >> (3 * i)) & 7]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// BC2 explicit alpha
+//-----------------------------------------------------------------------------
+
+void encodeExplicitAlpha(const uint8_t pixels[64], uint8_t* out)
+{
+  uint64_t bits = 0;
+  for(int i = 0; i < 16; i++)
+  {
+    const uint64_t a4 = (uint64_t(pixels[4 * i + 3]) * 15 + 127) / 255;
+    bits |= a4 << (4 * i);
+  }
+  memcpy(out, &bits, sizeof(bits));
+}
+
+void decodeExplicitAlpha(const uint8_t* block, uint8_t pixels[64])
+{
+  uint64_t bits;
+  memcpy(&bits, block, sizeof(bits));
+  for(int i = 0; i < 16; i++)
+  {
+    pixels[4 * i + 3] = static_cast<uint8_t>(((bits >> (4 * i)) & 15) * 17);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// BC7 mode 6
+//-----------------------------------------------------------------------------
+
+struct BitWriter
+{
+  uint8_t* out;
+  uint32_t pos = 0;
+
+  void put(uint32_t value, uint32_t numBits)
+  {
+    for(uint32_t i = 0; i < numBits; i++, pos++)
+    {
+      out[pos >> 3] |= static_cast<uint8_t>(((value >> i) & 1) << (pos & 7));
+    }
+  }
+};
+
+struct BitReader
+{
+  const uint8_t* in;
+  uint32_t       pos = 0;
+
+  uint32_t get(uint32_t numBits)
+  {
+    uint32_t value = 0;
+    for(uint32_t i = 0; i < numBits; i++, pos++)
+    {
+      value |= uint32_t((in[pos >> 3] >> (pos & 7)) & 1) << i;
+    }
+    return value;
+  }
+};
+
+struct BC7Texels
+{
+  float c[4][16];
+};
+
+// Quantizes an endpoint channel to 7 bits plus the given p-bit; returns the
+// 7-bit code.
+int quantizeBC7(float v, int pbit)
+{
+  return clampT(roundToInt((v - float(pbit)) * 0.5f), 0, 127);
+}
+
+struct BC7Candidate
+{
+  int     q[2][4]{};  // 7-bit endpoint codes
+  int     pbit[2]{};
+  uint8_t indices[16]{};
+  float   error = std::numeric_limits<float>::max();
+};
+
+// Chooses indices for quantized endpoints; returns the weighted squared error.
+// `exhaustive` tests all 16 palette entries; otherwise, texels are projected
+// onto the endpoint segment.
+float fitBC7Indices(const BC7Texels& texels, const float w[4], BC7Candidate& candidate, bool exhaustive)
+{
+  int e[2][4];
+  for(int j = 0; j < 2; j++)
+  {
+    for(int k = 0; k < 4; k++)
+    {
+      e[j][k] = (candidate.q[j][k] << 1) | candidate.pbit[j];
+    }
+  }
+  float palette[16][4];
+  for(int p = 0; p < 16; p++)
+  {
+    for(int k = 0; k < 4; k++)
+    {
+      palette[p][k] = float(((64 - kBC7Weights4[p]) * e[0][k] + kBC7Weights4[p] * e[1][k] + 32) >> 6);
+    }
+  }
+
+  float dir[4], dirLenSq = 0.0f;
+  for(int k = 0; k < 4; k++)
+  {
+    dir[k] = float(e[1][k] - e[0][k]) * w[k];
+    dirLenSq += float(e[1][k] - e[0][k]) * dir[k];
+  }
+
+  float total = 0.0f;
+  for(int i = 0; i < 16; i++)
+  {
+    int first = 0, last = 15;
+    if(!exhaustive)
+    {
+      float t = 0.0f;
+      if(dirLenSq > 0.0f)
+      {
+        for(int k = 0; k < 4; k++)
+        {
+          t += (texels.c[k][i] - float(e[0][k])) * dir[k];
+        }
+        t /= dirLenSq;
+      }
+      // The weights aren't uniform, so check the neighbors of the rounded index.
+      const int guess = clampT(roundToInt(t * 15.0f), 0, 15);
+      first           = std::max(guess - 1, 0);
+      last            = std::min(guess + 1, 15);
+    }
+
+    float best    = std::numeric_limits<float>::max();
+    int   bestIdx = 0;
+    for(int p = first; p <= last; p++)
+    {
+      float err = 0.0f;
+      for(int k = 0; k < 4; k++)
+      {
+        const float d = texels.c[k][i] - palette[p][k];
+        err += w[k] * d * d;
+      }
+      if(err < best)
+      {
+        best    = err;
+        bestIdx = p;
+      }
+    }
+    candidate.indices[i] = static_cast<uint8_t>(bestIdx);
+    total += best;
+  }
+  candidate.error = total;
+  return total;
+}
+
+// Quantizes float endpoints and fits indices, trying p-bits as allowed by the
+// quality; keeps the result in `best` if it is better.
+void searchBC7PBits(const BC7Texels& texels, const float w[4], const float e[2][4], Quality quality, BC7Candidate& best)
+{
+  const bool exhaustive = (quality == Quality::eHighest);
+  if(quality == Quality::eFastest)
+  {
+    // Pick each endpoint's p-bit by its own quantization error.
+    BC7Candidate candidate;
+    for(int j = 0; j < 2; j++)
+    {
+      float bestErr = std::numeric_limits<float>::max();
+      for(int pbit = 0; pbit < 2; pbit++)
+      {
+        float err = 0.0f;
+        for(int k = 0; k < 4; k++)
+        {
+          const float d = e[j][k] - float((quantizeBC7(e[j][k], pbit) << 1) | pbit);
+          err += w[k] * d * d;
+        }
+        if(err < bestErr)
+        {
+          bestErr           = err;
+          candidate.pbit[j] = pbit;
+        }
+      }
+      for(int k = 0; k < 4; k++)
+      {
+        candidate.q[j][k] = quantizeBC7(e[j][k], candidate.pbit[j]);
+      }
+    }
+    if(fitBC7Indices(texels, w, candidate, exhaustive) < best.error)
+    {
+      best = candidate;
+    }
+    return;
+  }
+
+  for(int pbits = 0; pbits < 4; pbits++)
+  {
+    BC7Candidate candidate;
+    candidate.pbit[0] = pbits & 1;
+    candidate.pbit[1] = pbits >> 1;
+    for(int j = 0; j < 2; j++)
+    {
+      for(int k = 0; k < 4; k++)
+      {
+        candidate.q[j][k] = quantizeBC7(e[j][k], candidate.pbit[j]);
+      }
+    }
+    if(fitBC7Indices(texels, w, candidate, exhaustive) < best.error)
+    {
+      best = candidate;
+    }
+  }
+}
+
+bool refineBC7Endpoints(const BC7Texels& texels, const uint8_t indices[16], float e[2][4])
+{
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[4] = {}, bx[4] = {};
+  for(int i = 0; i < 16; i++)
+  {
+    const float beta  = float(kBC7Weights4[indices[i]]) / 64.0f;
+    const float alpha = 1.0f - beta;
+    aa += alpha * alpha;
+    ab += alpha * beta;
+    bb += beta * beta;
+    for(int k = 0; k < 4; k++)
+    {
+      ax[k] += alpha * texels.c[k][i];
+      bx[k] += beta * texels.c[k][i];
+    }
+  }
+
+  const float det = aa * bb - ab * ab;
+  if(std::abs(det) < 1e-6f)
+    return false;
+
+  for(int k = 0; k < 4; k++)
+  {
+    e[0][k] = clampT((bb * ax[k] - ab * bx[k]) / det, 0.0f, 255.0f);
+    e[1][k] = clampT((aa * bx[k] - ab * ax[k]) / det, 0.0f, 255.0f);
+  }
+  return true;
+}
+
+void encodeBC7Block(const uint8_t pixels[64], const float rgbWeights[3], Quality quality, uint8_t* out)
+{
+  const float w[4] = {rgbWeights[0], rgbWeights[1], rgbWeights[2], 1.0f};
+  BC7Texels   texels;
+  float       sw[4];
+  float       scaled[4][16];
+  for(int k = 0; k < 4; k++)
+  {
+    sw[k] = std::sqrt(w[k]);
+    for(int i = 0; i < 16; i++)
+    {
+      texels.c[k][i] = float(pixels[4 * i + k]);
+      scaled[k][i]   = texels.c[k][i] * sw[k];
+    }
+  }
+
+  // Endpoints at the extremes of the principal axis. For the fastest tier,
+  // the axis is approximated by the bounding box diagonal.
+  float mean[4], axis[4];
+  if(quality == Quality::eFastest)
+  {
+    float mn[4], mx[4];
+    float len = 0.0f;
+    for(int k = 0; k < 4; k++)
+    {
+      mn[k]   = *std::min_element(scaled[k], scaled[k] + 16);
+      mx[k]   = *std::max_element(scaled[k], scaled[k] + 16);
+      mean[k] = 0.5f * (mn[k] + mx[k]);
+      axis[k] = mx[k] - mn[k];
+      len += axis[k] * axis[k];
+    }
+    // Orient each channel against the first one with a nonzero range.
+    int ref = 0;
+    while(ref < 3 && axis[ref] == 0.0f)
+      ref++;
+    for(int k = ref + 1; k < 4; k++)
+    {
+      float cov = 0.0f;
+      for(int i = 0; i < 16; i++)
+      {
+        cov += (scaled[ref][i] - mean[ref]) * (scaled[k][i] - mean[k]);
+      }
+      axis[k] = (cov < 0.0f) ? -axis[k] : axis[k];
+    }
+    len = std::sqrt(len);
+    for(int k = 0; k < 4; k++)
+    {
+      axis[k] = (len > 0.0f) ? axis[k] / len : 0.5f;
+    }
+  }
+  else
+  {
+    principalAxis(scaled, 16, 4, mean, axis);
+  }
+
+  float tMin = std::numeric_limits<float>::max();
+  float tMax = -tMin;
+  for(int i = 0; i < 16; i++)
+  {
+    float proj = 0.0f;
+    for(int k = 0; k < 4; k++)
+    {
+      proj += (scaled[k][i] - mean[k]) * axis[k];
+    }
+    tMin = std::min(tMin, proj);
+    tMax = std::max(tMax, proj);
+  }
+  float e[2][4];
+  for(int k = 0; k < 4; k++)
+  {
+    e[0][k] = clampT((mean[k] + axis[k] * tMin) / sw[k], 0.0f, 255.0f);
+    e[1][k] = clampT((mean[k] + axis[k] * tMax) / sw[k], 0.0f, 255.0f);
+  }
+
+  BC7Candidate best;
+  searchBC7PBits(texels, w, e, quality, best);
+  const int refinePasses = (quality == Quality::eFastest) ? 0 : (quality == Quality::eNormal ? 1 : 3);
+  for(int pass = 0; pass < refinePasses; pass++)
+  {
+    const float previousError = best.error;
+    if(!refineBC7Endpoints(texels, best.indices, e))
+      break;
+    searchBC7PBits(texels, w, e, quality, best);
+    if(best.error >= previousError)
+      break;
+  }
+
+  // The anchor (first) index is stored without its top bit, so it must be < 8.
+  // The weights are symmetric, so swapping the endpoints and mirroring the
+  // indices decodes to the same colors.
+  if(best.indices[0] >= 8)
+  {
+    for(int k = 0; k < 4; k++)
+    {
+      std::swap(best.q[0][k], best.q[1][k]);
+    }
+    std::swap(best.pbit[0], best.pbit[1]);
+    for(int i = 0; i < 16; i++)
+    {
+      best.indices[i] = static_cast<uint8_t>(15 - best.indices[i]);
+    }
+  }
+
+  memset(out, 0, 16);
+  BitWriter writer{out};
+  writer.put(1 << 6, 7);  // Mode 6
+  for(int k = 0; k < 4; k++)
+  {
+    writer.put(uint32_t(best.q[0][k]), 7);
+    writer.put(uint32_t(best.q[1][k]), 7);
+  }
+  writer.put(uint32_t(best.pbit[0]), 1);
+  writer.put(uint32_t(best.pbit[1]), 1);
+  writer.put(best.indices[0], 3);
+  for(int i = 1; i < 16; i++)
+  {
+    writer.put(best.indices[i], 4);
+  }
+}
+
+bool decodeBC7Mode6(const uint8_t* block, uint8_t pixels[64])
+{
+  BitReader reader{block};
+  if(reader.get(7) != (1 << 6))
+    return false;
+
+  int e[2][4];
+  for(int k = 0; k < 4; k++)
+  {
+    e[0][k] = int(reader.get(7)) << 1;
+    e[1][k] = int(reader.get(7)) << 1;
+  }
+  const int p0 = int(reader.get(1));
+  const int p1 = int(reader.get(1));
+  for(int k = 0; k < 4; k++)
+  {
+    e[0][k] |= p0;
+    e[1][k] |= p1;
+  }
+  for(int i = 0; i < 16; i++)
+  {
+    const int weight = kBC7Weights4[reader.get(i == 0 ? 3 : 4)];
+    for(int k = 0; k < 4; k++)
+    {
+      pixels[4 * i + k] = static_cast<uint8_t>(((64 - weight) * e[0][k] + weight * e[1][k] + 32) >> 6);
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Images
+//-----------------------------------------------------------------------------
+
+// Gathers a 4x4 block, replicating the last row and column at the edges.
+void loadBlock(const uint8_t* image, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, bool swapRB, uint8_t pixels[64])
+{
+  for(uint32_t y = 0; y < 4; y++)
+  {
+    const size_t sy = std::min(by * 4 + y, height - 1);
+    for(uint32_t x = 0; x < 4; x++)
+    {
+      const size_t   sx  = std::min(bx * 4 + x, width - 1);
+      const uint8_t* src = image + (sy * width + sx) * 4;
+      uint8_t*       dst = pixels + (y * 4 + x) * 4;
+      dst[0]             = src[swapRB ? 2 : 0];
+      dst[1]             = src[1];
+      dst[2]             = src[swapRB ? 0 : 2];
+      dst[3]             = src[3];
+    }
+  }
+}
+
+void storeBlock(const uint8_t pixels[64], uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t* image)
+{
+  for(uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+  {
+    const uint32_t columns = std::min(4u, width - bx * 4);
+    memcpy(image + ((size_t(by) * 4 + y) * width + size_t(bx) * 4) * 4, pixels + y * 16, size_t(columns) * 4);
+  }
+}
+
+ErrorWithText compressImpl(Format format, std::span<const char> rgba8, uint32_t width, uint32_t height, bool swapRB, std::span<char> output, const EncodeSettings& settings)
+{
+  if(width == 0 || height == 0)
+  {
+    return "nv_bcn: image dimensions must be greater than 0.";
+  }
+  size_t inputSize = 0;
+  if(!checked_math::mul3(width, height, 4, inputSize) || rgba8.size() < inputSize)
+  {
+    return "nv_bcn: the input holds " + std::to_string(rgba8.size()) + " bytes, but a " + std::to_string(width) + " x "
+           + std::to_string(height) + " RGBA8 image needs " + std::to_string(inputSize) + " bytes.";
+  }
+  const size_t outputSize = getCompressedSize(format, width, height);
+  if(output.size() < outputSize)
+  {
+    return "nv_bcn: the output holds " + std::to_string(output.size()) + " bytes, but " + std::to_string(outputSize)
+           + " bytes are needed.";
+  }
+
+  const uint32_t blocksX   = blocksAcross(width);
+  const uint32_t blocksY   = blocksAcross(height);
+  const uint32_t blockSize = getBlockSize(format);
+  const uint8_t* src       = reinterpret_cast<const uint8_t*>(rgba8.data());
+  uint8_t*       dst       = reinterpret_cast<uint8_t*>(output.data());
+
+  if(format == Format::eBC1 || format == Format::eBC2 || format == Format::eBC3)
+  {
+    getSingleColorTable();  // Build the table before the threads start
+  }
+
+  nvutils::parallel_batches_pooled<BLOCK_BATCH_SIZE>(
+      uint64_t(blocksX) * blocksY,
+      [&](uint64_t blockIndex, uint32_t) {
+        const uint32_t bx = static_cast<uint32_t>(blockIndex % blocksX);
+        const uint32_t by = static_cast<uint32_t>(blockIndex / blocksX);
+        uint8_t        pixels[64];
+        loadBlock(src, width, height, bx, by, swapRB, pixels);
+        compressBlock(format, pixels, dst + blockIndex * blockSize, settings);
+      },
+      settings.numThreads);
+  return {};
+}
+
+ErrorWithText decompressImpl(Format format, std::span<const char> blocks, uint32_t width, uint32_t height, std::span<char> rgba8, uint32_t numThreads)
+{
+  if(width == 0 || height == 0)
+  {
+    return "nv_bcn: image dimensions must be greater than 0.";
+  }
+  const size_t inputSize = getCompressedSize(format, width, height);
+  if(blocks.size() < inputSize)
+  {
+    return "nv_bcn: the input holds " + std::to_string(blocks.size()) + " bytes, but " + std::to_string(inputSize)
+           + " bytes of blocks are needed.";
+  }
+  size_t outputSize = 0;
+  if(!checked_math::mul3(width, height, 4, outputSize) || rgba8.size() < outputSize)
+  {
+    return "nv_bcn: the output holds " + std::to_string(rgba8.size()) + " bytes, but a " + std::to_string(width)
+           + " x " + std::to_string(height) + " RGBA8 image needs " + std::to_string(outputSize) + " bytes.";
+  }
+
+  const uint32_t blocksX   = blocksAcross(width);
+  const uint32_t blocksY   = blocksAcross(height);
+  const uint32_t blockSize = getBlockSize(format);
+  const uint8_t* src       = reinterpret_cast<const uint8_t*>(blocks.data());
+  uint8_t*       dst       = reinterpret_cast<uint8_t*>(rgba8.data());
+
+  std::atomic<bool> allValid = true;
+  nvutils::parallel_batches_pooled<BLOCK_BATCH_SIZE>(
+      uint64_t(blocksX) * blocksY,
+      [&](uint64_t blockIndex, uint32_t) {
+        const uint32_t bx = static_cast<uint32_t>(blockIndex % blocksX);
+        const uint32_t by = static_cast<uint32_t>(blockIndex / blocksX);
+        uint8_t        pixels[64];
+        if(!decompressBlock(format, src + blockIndex * blockSize, pixels))
+        {
+          allValid.store(false, std::memory_order_relaxed);
+        }
+        storeBlock(pixels, width, height, bx, by, dst);
+      },
+      numThreads);
+
+  if(!allValid)
+  {
+#ifdef NVP_SUPPORTS_BASISU
+    return "nv_bcn: the image contained invalid BC7 blocks; they were decoded as magenta.";
+#else
+    return "nv_bcn: the image contained BC7 blocks in modes other than 6, which require NVP_SUPPORTS_BASISU; they "
+           "were decoded as magenta.";
+#endif
+  }
+  return {};
+}
+
+// Compresses or decompresses one subresource of a possibly 3D image, slice by
+// slice.
+template <class SliceFn>
+ErrorWithText forEachSlice(uint32_t depth, size_t srcSliceSize, size_t dstSliceSize, std::span<const char> src, std::span<char> dst, SliceFn&& fn)
+{
+  if(src.size() < srcSliceSize * depth)
+  {
+    return "nv_bcn: a subresource held " + std::to_string(src.size()) + " bytes, but " + std::to_string(srcSliceSize * depth)
+           + " bytes were expected.";
+  }
+  for(uint32_t z = 0; z < depth; z++)
+  {
+    UNWRAP_ERROR(fn(src.subspan(z * srcSliceSize, srcSliceSize), dst.subspan(z * dstSliceSize, dstSliceSize)));
+  }
+  return {};
+}
+
+// Resizes a vector<char>, returning an error if the allocation fails.
+ErrorWithText resizeOrError(std::vector<char>& data, size_t size)
+{
+  try
+  {
+    data.resize(size);
+  }
+  catch(...)
+  {
+    return "nv_bcn: allocating " + std::to_string(size) + " bytes of data failed.";
+  }
+  return {};
+}
+
+}  // namespace
+
+uint32_t getBlockSize(Format format)
+{
+  return (format == Format::eBC1 || format == Format::eBC4) ? 8 : 16;
+}
+
+size_t getCompressedSize(Format format, uint32_t width, uint32_t height)
+{
+  return size_t(blocksAcross(width)) * size_t(blocksAcross(height)) * getBlockSize(format);
+}
+
+VkFormat toVkFormat(Format format, bool srgb)
+{
+  switch(format)
+  {
+    case Format::eBC1:
+      return srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case Format::eBC2:
+      return srgb ? VK_FORMAT_BC2_SRGB_BLOCK : VK_FORMAT_BC2_UNORM_BLOCK;
+    case Format::eBC3:
+      return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case Format::eBC4:
+      return VK_FORMAT_BC4_UNORM_BLOCK;
+    case Format::eBC5:
+      return VK_FORMAT_BC5_UNORM_BLOCK;
+    case Format::eBC7:
+      return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+  }
+  return VK_FORMAT_UNDEFINED;
+}
+
+uint32_t toDXGIFormat(Format format, bool srgb)
+{
+  switch(format)
+  {
+    case Format::eBC1:
+      return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+    case Format::eBC2:
+      return srgb ? DXGI_FORMAT_BC2_UNORM_SRGB : DXGI_FORMAT_BC2_UNORM;
+    case Format::eBC3:
+      return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+    case Format::eBC4:
+      return DXGI_FORMAT_BC4_UNORM;
+    case Format::eBC5:
+      return DXGI_FORMAT_BC5_UNORM;
+    case Format::eBC7:
+      return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+  }
+  return DXGI_FORMAT_UNKNOWN;
+}
+
+bool fromVkFormat(VkFormat vkFormat, Format& format)
+{
+  switch(vkFormat)
+  {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+      format = Format::eBC1;
+      return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+      format = Format::eBC2;
+      return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+      format = Format::eBC3;
+      return true;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+      format = Format::eBC4;
+      return true;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+      format = Format::eBC5;
+      return true;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+      format = Format::eBC7;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool fromDXGIFormat(uint32_t dxgiFormat, Format& format)
+{
+  switch(dxgiFormat)
+  {
+    case DXGI_FORMAT_BC1_TYPELESS:
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+      format = Format::eBC1;
+      return true;
+    case DXGI_FORMAT_BC2_TYPELESS:
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+      format = Format::eBC2;
+      return true;
+    case DXGI_FORMAT_BC3_TYPELESS:
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+      format = Format::eBC3;
+      return true;
+    case DXGI_FORMAT_BC4_TYPELESS:
+    case DXGI_FORMAT_BC4_UNORM:
+      format = Format::eBC4;
+      return true;
+    case DXGI_FORMAT_BC5_TYPELESS:
+    case DXGI_FORMAT_BC5_UNORM:
+      format = Format::eBC5;
+      return true;
+    case DXGI_FORMAT_BC7_TYPELESS:
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+      format = Format::eBC7;
+      return true;
+    default:
+      return false;
+  }
+}
+
+void compressBlock(Format format, const uint8_t pixels[64], uint8_t* block, const EncodeSettings& settings)
+{
+  const float* w = settings.perceptual ? kPerceptualWeights : kUniformWeights;
+  switch(format)
+  {
+    case Format::eBC1:
+      encodeColorBlock(pixels, w, settings.quality, true, block);
+      break;
+    case Format::eBC2:
+      encodeExplicitAlpha(pixels, block);
+      encodeColorBlock(pixels, w, settings.quality, false, block + 8);
+      break;
+    case Format::eBC3: {
+      int alpha[16];
+      for(int i = 0; i < 16; i++)
+      {
+        alpha[i] = pixels[4 * i + 3];
+      }
+      encodeChannelBlock(alpha, settings.quality, block);
+      encodeColorBlock(pixels, w, settings.quality, false, block + 8);
+      break;
+    }
+    case Format::eBC4:
+    case Format::eBC5: {
+      const int numChannels = (format == Format::eBC4) ? 1 : 2;
+      for(int c = 0; c < numChannels; c++)
+      {
+        int values[16];
+        for(int i = 0; i < 16; i++)
+        {
+          values[i] = pixels[4 * i + c];
+        }
+        encodeChannelBlock(values, settings.quality, block + 8 * c);
+      }
+      break;
+    }
+    case Format::eBC7:
+      encodeBC7Block(pixels, w, settings.quality, block);
+      break;
+  }
+}
+
+bool decompressBlock(Format format, const uint8_t* block, uint8_t pixels[64])
+{
+  switch(format)
+  {
+    case Format::eBC1:
+      decodeColorBlock(block, false, pixels);
+      return true;
+    case Format::eBC2:
+      decodeColorBlock(block + 8, true, pixels);
+      decodeExplicitAlpha(block, pixels);
+      return true;
+    case Format::eBC3:
+      decodeColorBlock(block + 8, true, pixels);
+      decodeChannelBlock(block, pixels + 3);
+      return true;
+    case Format::eBC4:
+    case Format::eBC5:
+      for(int i = 0; i < 16; i++)
+      {
+        pixels[4 * i + 1] = 0;
+        pixels[4 * i + 2] = 0;
+        pixels[4 * i + 3] = 255;
+      }
+      decodeChannelBlock(block, pixels);
+      if(format == Format::eBC5)
+      {
+        decodeChannelBlock(block + 8, pixels + 1);
+      }
+      return true;
+    case Format::eBC7: {
+#ifdef NVP_SUPPORTS_BASISU
+      const bool valid = basisu::unpack_bc7(block, reinterpret_cast<basisu::color_rgba*>(pixels));
+#else
+      const bool valid = decodeBC7Mode6(block, pixels);
+#endif
+      if(!valid)
+      {
+        for(int i = 0; i < 16; i++)
+        {
+          pixels[4 * i + 0] = 255;
+          pixels[4 * i + 1] = 0;
+          pixels[4 * i + 2] = 255;
+          pixels[4 * i + 3] = 255;
+        }
+      }
+      return valid;
+    }
+  }
+  return false;
+}
+
+ErrorWithText compress(Format format, std::span<const char> rgba8, uint32_t width, uint32_t height, std::span<char> output, const EncodeSettings& settings)
+{
+  return compressImpl(format, rgba8, width, height, false, output, settings);
+}
+
+ErrorWithText decompress(Format format, std::span<const char> blocks, uint32_t width, uint32_t height, std::span<char> rgba8, uint32_t numThreads)
+{
+  return decompressImpl(format, blocks, width, height, rgba8, numThreads);
+}
+
+ErrorWithText compressKTXImage(const nv_ktx::KTXImage& input, Format format, const EncodeSettings& settings, nv_ktx::KTXImage& output)
+{
+  bool swapRB = false;
+  switch(input.format)
+  {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+      break;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+      swapRB = true;
+      break;
+    default:
+      return "nv_bcn: KTX images can only be compressed from VK_FORMAT_R8G8B8A8_* or VK_FORMAT_B8G8R8A8_*, but the "
+             "format was "
+             + std::to_string(input.format) + ".";
+  }
+
+  UNWRAP_ERROR(output.allocate(input.num_mips, input.num_layers_possibly_0, input.num_faces));
+  const bool srgb                 = texture_formats::isVkFormatSRGB(input.format);
+  output.format                   = toVkFormat(format, srgb);
+  output.mip_0_width              = input.mip_0_width;
+  output.mip_0_height             = input.mip_0_height;
+  output.mip_0_depth              = input.mip_0_depth;
+  output.key_value_data           = input.key_value_data;
+  output.app_should_generate_mips = input.app_should_generate_mips;
+  output.is_premultiplied         = input.is_premultiplied;
+  output.is_srgb                  = input.is_srgb;
+  output.swizzle                  = input.swizzle;
+
+  for(uint32_t mip = 0; mip < input.num_mips; mip++)
+  {
+    const uint32_t width  = std::max(1u, input.mip_0_width >> mip);
+    const uint32_t height = std::max(1u, input.mip_0_height >> mip);
+    const uint32_t depth  = std::max(1u, input.mip_0_depth >> mip);
+    const size_t   srcSliceSize = size_t(width) * height * 4;
+    const size_t   dstSliceSize = getCompressedSize(format, width, height);
+    for(uint32_t layer = 0; layer < std::max(1u, input.num_layers_possibly_0); layer++)
+    {
+      for(uint32_t face = 0; face < input.num_faces; face++)
+      {
+        const std::vector<char>& src = input.subresource(mip, layer, face);
+        std::vector<char>&       dst = output.subresource(mip, layer, face);
+        UNWRAP_ERROR(resizeOrError(dst, dstSliceSize * depth));
+        UNWRAP_ERROR(forEachSlice(depth, srcSliceSize, dstSliceSize, src, dst, [&](std::span<const char> s, std::span<char> d) {
+          return compressImpl(format, s, width, height, swapRB, d, settings);
+        }));
+      }
+    }
+  }
+  return {};
+}
+
+ErrorWithText decompressKTXImage(const nv_ktx::KTXImage& input, nv_ktx::KTXImage& output, uint32_t numThreads)
+{
+  Format format;
+  if(!fromVkFormat(input.format, format))
+  {
+    return "nv_bcn: KTX image format " + std::to_string(input.format) + " is not a supported BCn format.";
+  }
+
+  UNWRAP_ERROR(output.allocate(input.num_mips, input.num_layers_possibly_0, input.num_faces));
+  output.format = texture_formats::isVkFormatSRGB(input.format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+  output.mip_0_width              = input.mip_0_width;
+  output.mip_0_height             = input.mip_0_height;
+  output.mip_0_depth              = input.mip_0_depth;
+  output.key_value_data           = input.key_value_data;
+  output.app_should_generate_mips = input.app_should_generate_mips;
+  output.is_premultiplied         = input.is_premultiplied;
+  output.is_srgb                  = input.is_srgb;
+  output.swizzle                  = input.swizzle;
+
+  for(uint32_t mip = 0; mip < input.num_mips; mip++)
+  {
+    const uint32_t width  = std::max(1u, input.mip_0_width >> mip);
+    const uint32_t height = std::max(1u, input.mip_0_height >> mip);
+    const uint32_t depth  = std::max(1u, input.mip_0_depth >> mip);
+    const size_t   srcSliceSize = getCompressedSize(format, width, height);
+    const size_t   dstSliceSize = size_t(width) * height * 4;
+    for(uint32_t layer = 0; layer < std::max(1u, input.num_layers_possibly_0); layer++)
+    {
+      for(uint32_t face = 0; face < input.num_faces; face++)
+      {
+        const std::vector<char>& src = input.subresource(mip, layer, face);
+        std::vector<char>&       dst = output.subresource(mip, layer, face);
+        UNWRAP_ERROR(resizeOrError(dst, dstSliceSize * depth));
+        UNWRAP_ERROR(forEachSlice(depth, srcSliceSize, dstSliceSize, src, dst, [&](std::span<const char> s, std::span<char> d) {
+          return decompressImpl(format, s, width, height, d, numThreads);
+        }));
+      }
+    }
+  }
+  return {};
+}
+
+namespace {
+// Copies everything but the format and the data.
+ErrorWithText copyDDSProperties(const nv_dds::Image& input, nv_dds::Image& output)
+{
+  UNWRAP_ERROR(output.allocate(input.getNumMips(), input.getNumLayers(), input.getNumFaces()));
+  output.mip0Width         = input.mip0Width;
+  output.mip0Height        = input.mip0Height;
+  output.mip0Depth         = input.mip0Depth;
+  output.resourceDimension = input.resourceDimension;
+  output.cubemapFaceFlags  = input.cubemapFaceFlags;
+  output.alphaMode         = input.alphaMode;
+  output.colorTransform    = input.colorTransform;
+  output.isNormal          = input.isNormal;
+  output.hasUserVersion    = input.hasUserVersion;
+  output.userVersion       = input.userVersion;
+  return {};
+}
+}  // namespace
+
+ErrorWithText compressDDSImage(const nv_dds::Image& input, Format format, const EncodeSettings& settings, nv_dds::Image& output)
+{
+  bool swapRB = false;
+  switch(input.dxgiFormat)
+  {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+      break;
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+      swapRB = true;
+      break;
+    default:
+      return "nv_bcn: DDS images can only be compressed from DXGI_FORMAT_R8G8B8A8_* or DXGI_FORMAT_B8G8R8A8_*, but the "
+             "format was "
+             + std::to_string(input.dxgiFormat) + ".";
+  }
+
+  UNWRAP_ERROR(copyDDSProperties(input, output));
+  output.dxgiFormat = toDXGIFormat(format, texture_formats::isDXGIFormatSRGB(input.dxgiFormat));
+
+  for(uint32_t mip = 0; mip < input.getNumMips(); mip++)
+  {
+    const uint32_t width        = input.getWidth(mip);
+    const uint32_t height       = input.getHeight(mip);
+    const uint32_t depth        = input.getDepth(mip);
+    const size_t   srcSliceSize = size_t(width) * height * 4;
+    const size_t   dstSliceSize = getCompressedSize(format, width, height);
+    for(uint32_t layer = 0; layer < input.getNumLayers(); layer++)
+    {
+      for(uint32_t face = 0; face < input.getNumFaces(); face++)
+      {
+        const std::vector<char>& src = input.subresource(mip, layer, face).data;
+        nv_dds::Subresource&     dst = output.subresource(mip, layer, face);
+        UNWRAP_ERROR(dst.create(dstSliceSize * depth, nullptr));
+        UNWRAP_ERROR(forEachSlice(depth, srcSliceSize, dstSliceSize, src, dst.data, [&](std::span<const char> s, std::span<char> d) {
+          return compressImpl(format, s, width, height, swapRB, d, settings);
+        }));
+      }
+    }
+  }
+  return {};
+}
+
+ErrorWithText decompressDDSImage(const nv_dds::Image& input, nv_dds::Image& output, uint32_t numThreads)
+{
+  Format format;
+  if(!fromDXGIFormat(input.dxgiFormat, format))
+  {
+    return "nv_bcn: DDS image format " + std::to_string(input.dxgiFormat) + " is not a supported BCn format.";
+  }
+
+  UNWRAP_ERROR(copyDDSProperties(input, output));
+  output.dxgiFormat = texture_formats::isDXGIFormatSRGB(input.dxgiFormat) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+  for(uint32_t mip = 0; mip < input.getNumMips(); mip++)
+  {
+    const uint32_t width        = input.getWidth(mip);
+    const uint32_t height       = input.getHeight(mip);
+    const uint32_t depth        = input.getDepth(mip);
+    const size_t   srcSliceSize = getCompressedSize(format, width, height);
+    const size_t   dstSliceSize = size_t(width) * height * 4;
+    for(uint32_t layer = 0; layer < input.getNumLayers(); layer++)
+    {
+      for(uint32_t face = 0; face < input.getNumFaces(); face++)
+      {
+        const std::vector<char>& src = input.subresource(mip, layer, face).data;
+        nv_dds::Subresource&     dst = output.subresource(mip, layer, face);
+        UNWRAP_ERROR(dst.create(dstSliceSize * depth, nullptr));
+        UNWRAP_ERROR(forEachSlice(depth, srcSliceSize, dstSliceSize, src, dst.data, [&](std::span<const char> s, std::span<char> d) {
+          return decompressImpl(format, s, width, height, d, numThreads);
+        }));
+      }
+    }
+  }
+  return {};
+}
+
+}  // namespace nv_bcn
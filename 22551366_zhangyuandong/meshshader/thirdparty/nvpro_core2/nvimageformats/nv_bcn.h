@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2025 NVIDIA CORPORATION
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*-----------------------------------------------------------------------------
+
+nv_bcn 1.0.0
+
+A CPU encoder and decoder for the BC1, BC2, BC3, BC4, BC5 and BC7 block
+compression formats, for baking textures offline and as a fallback on
+devices or tools that can't sample compressed data.
+
+To compress raw RGBA8 pixels, use `compress()`; to decompress blocks back
+to RGBA8, use `decompress()`. Blocks are processed in parallel using the
+nvutils thread pool.
+
+To compress whole containers, use `compressKTXImage()` and
+`compressDDSImage()`: they take an RGBA8 `nv_ktx::KTXImage` or
+`nv_dds::Image` and produce a block-compressed one with the same mips,
+layers and faces, which can then be written with the usual
+`writeKTX2File()` and `writeToFile()`. `decompressKTXImage()` and
+`decompressDDSImage()` go the other way.
+
+## Quality tiers
+
+* `eFastest`: bounding-box endpoints and a single index fit. Useful for
+previews and runtime compression.
+* `eNormal`: principal-axis endpoints with one least-squares refinement;
+BC4/BC5/BC3 alpha try both interpolation modes, and BC7 tries all p-bit pairs.
+* `eHighest`: more refinement passes, a local search over BC4 endpoints,
+BC1 3-color mode, and an exhaustive BC7 index search.
+
+## Limitations
+
+* BC7 is encoded using mode 6 (one subset, 4-bit indices, RGBA endpoints)
+only. All modes are decoded when `NVP_SUPPORTS_BASISU` is defined;
+otherwise, only mode 6 blocks are decoded.
+* BC6H and the SNORM variants of BC4 and BC5 are not supported.
+* BC1 stores 1-bit alpha: pixels with alpha below 128 become transparent.
+
+-----------------------------------------------------------------------------*/
+
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "nv_dds.h"
+#include "nv_ktx.h"
+
+namespace nv_bcn {
+// These functions return an empty std::optional if they succeeded, and a
+// value with text describing the error if they failed.
+using ErrorWithText = std::optional<std::string>;
+
+enum class Format
+{
+  eBC1,  // RGB + 1-bit alpha, 8 bytes per block
+  eBC2,  // RGB + explicit 4-bit alpha, 16 bytes per block
+  eBC3,  // RGB + interpolated alpha, 16 bytes per block
+  eBC4,  // R, 8 bytes per block
+  eBC5,  // RG, 16 bytes per block
+  eBC7,  // RGBA, 16 bytes per block
+};
+
+enum class Quality
+{
+  eFastest,
+  eNormal,
+  eHighest
+};
+
+struct EncodeSettings
+{
+  Quality quality = Quality::eNormal;
+  // Weights RGB errors by their contribution to luminance. Use this for color
+  // textures; turn it off for normal maps and other non-color data.
+  bool perceptual = true;
+  // 0 uses all threads of the nvutils thread pool; 1 runs on the calling thread.
+  uint32_t numThreads = 0;
+};
+
+// Returns the size in bytes of one 4x4 block.
+uint32_t getBlockSize(Format format);
+
+// Returns the size in bytes of a `width` x `height` image in the given format.
+// Partial blocks at the right and bottom edges count as full blocks.
+size_t getCompressedSize(Format format, uint32_t width, uint32_t height);
+
+// Format name translation. `srgb` only affects BC1, BC2, BC3 and BC7.
+VkFormat toVkFormat(Format format, bool srgb);
+uint32_t toDXGIFormat(Format format, bool srgb);
+// Return false if the format isn't one of the supported BCn formats.
+bool fromVkFormat(VkFormat vkFormat, Format& format);
+bool fromDXGIFormat(uint32_t dxgiFormat, Format& format);
+
+// Compresses `width` x `height` RGBA8 pixels with tightly packed rows.
+// `output` must hold at least getCompressedSize(format, width, height) bytes.
+// Edge blocks replicate the last row and column.
+ErrorWithText compress(Format                format,
+                       std::span<const char> rgba8,
+                       uint32_t              width,
+                       uint32_t              height,
+                       std::span<char>       output,
+                       const EncodeSettings& settings = {});
+
+// Decompresses blocks to `width` x `height` RGBA8 pixels with tightly packed
+// rows. BC4 decodes to (r, 0, 0, 255) and BC5 to (r, g, 0, 255).
+ErrorWithText decompress(Format                format,
+                         std::span<const char> blocks,
+                         uint32_t              width,
+                         uint32_t              height,
+                         std::span<char>       rgba8,
+                         uint32_t              numThreads = 0);
+
+// Single-block primitives. `pixels` holds the 16 RGBA8 texels of a 4x4 block
+// in row-major order; `block` holds getBlockSize(format) bytes.
+void compressBlock(Format format, const uint8_t pixels[64], uint8_t* block, const EncodeSettings& settings = {});
+// Returns false if the block can't be decoded (e.g. a reserved BC7 mode, or a
+// BC7 mode other than 6 without NVP_SUPPORTS_BASISU); the pixels are then
+// set to opaque magenta.
+bool decompressBlock(Format format, const uint8_t* block, uint8_t pixels[64]);
+
+// Compresses each subresource of `input` to `output`.
+// `input.format` must be VK_FORMAT_R8G8B8A8_UNORM/SRGB or
+// VK_FORMAT_B8G8R8A8_UNORM/SRGB. `output` receives the same dimensions,
+// swizzle, key/value data and transfer function; its format is the
+// corresponding BCn VkFormat.
+ErrorWithText compressKTXImage(const nv_ktx::KTXImage& input, Format format, const EncodeSettings& settings, nv_ktx::KTXImage& output);
+// Decompresses a BCn KTXImage to VK_FORMAT_R8G8B8A8_UNORM or _SRGB.
+ErrorWithText decompressKTXImage(const nv_ktx::KTXImage& input, nv_ktx::KTXImage& output, uint32_t numThreads = 0);
+
+// Same as above for DDS images; `input.dxgiFormat` must be
+// DXGI_FORMAT_R8G8B8A8_UNORM/SRGB or DXGI_FORMAT_B8G8R8A8_UNORM/SRGB.
+ErrorWithText compressDDSImage(const nv_dds::Image& input, Format format, const EncodeSettings& settings, nv_dds::Image& output);
+ErrorWithText decompressDDSImage(const nv_dds::Image& input, nv_dds::Image& output, uint32_t numThreads = 0);
+
+}  // namespace nv_bcn
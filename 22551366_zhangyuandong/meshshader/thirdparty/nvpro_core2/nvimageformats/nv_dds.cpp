@@ -1755,6 +1755,89 @@ ErrorWithText Image::readFromMemory(const char* buffer, size_t bufferSize, const
   return readFromStream(stream, readSettings);
 }
 
+ErrorWithText MappedImage::open(const std::filesystem::path& filename, const ReadSettings& readSettings)
+{
+  close();
+  if(!m_mapping.open(filename))
+  {
+    return "Could not open and map " + filename.string() + ".";
+  }
+  const char*  file     = static_cast<const char*>(m_mapping.data());
+  const size_t fileSize = m_mapping.size();
+
+  UNWRAP_ERROR(m_header.readHeaderFromMemory(file, fileSize, readSettings));
+  const Image::FileInfo& info = m_header.getFileInfo();
+  if(info.wasBitmasked || m_header.dxgiFormat == 0)
+  {
+    return "This DDS file stores bitmasked data, which must be decompressed; use Image::readFromFile() instead.";
+  }
+
+  const uint32_t mipsInFile = m_header.getNumMips();
+  const uint32_t numLayers  = m_header.getNumLayers();
+  const uint32_t numFaces   = m_header.getNumFaces();
+  m_numMips                 = readSettings.mips ? mipsInFile : 1;
+
+  size_t totalSubresources = 0;
+  if(!checked_math::mul3(m_numMips, numLayers, numFaces, totalSubresources))
+  {
+    return "Computing the number of subresources overflowed a size_t!";
+  }
+  UNWRAP_ERROR(resizeVectorOrError(m_subresources, totalSubresources));
+
+  // Same layout as readFromStream(): for each layer, for each face, all mips.
+  size_t offset = sizeof(uint32_t) + sizeof(DDSHeader) + (info.hadDx10Extension ? sizeof(DDSHeaderDX10) : 0);
+  for(uint32_t layer = 0; layer < numLayers; layer++)
+  {
+    for(uint32_t face = 0; face < numFaces; face++)
+    {
+      for(uint32_t mip = 0; mip < mipsInFile; mip++)
+      {
+        size_t texSize = 0;
+        if(!dxgiExportSize(m_header.getWidth(mip), m_header.getHeight(mip), m_header.getDepth(mip), m_header.dxgiFormat, texSize)
+           || texSize == 0)
+        {
+          return "Could not determine the number of bytes used by mip " + std::to_string(mip) + " with DXGI format "
+                 + std::to_string(m_header.dxgiFormat) + ".";
+        }
+        if(texSize > readSettings.maxSubresourceSizeBytes)
+        {
+          return "Mip " + std::to_string(mip) + " had more bytes (" + std::to_string(texSize)
+                 + ") than the maximum allowed in the DDS reader's parameters ("
+                 + std::to_string(readSettings.maxSubresourceSizeBytes) + ").";
+        }
+        if(offset > fileSize || texSize > fileSize - offset)
+        {
+          return "The DDS file is truncated: mip " + std::to_string(mip) + " of layer " + std::to_string(layer) + " face "
+                 + std::to_string(face) + " ends past the end of the " + std::to_string(fileSize) + " byte long file.";
+        }
+        if(mip < m_numMips)
+        {
+          m_subresources[(size_t(mip) * numLayers + layer) * numFaces + face] = {file + offset, texSize};
+        }
+        offset += texSize;
+      }
+    }
+  }
+  return {};
+}
+
+void MappedImage::close()
+{
+  m_subresources.clear();
+  m_numMips = 0;
+  m_header  = Image{};
+  m_mapping.close();
+}
+
+std::span<const char> MappedImage::subresource(uint32_t mip, uint32_t layer, uint32_t face) const
+{
+  if(mip >= m_numMips || layer >= m_header.getNumLayers() || face >= m_header.getNumFaces())
+  {
+    throw std::out_of_range("MappedImage::subresource() values were out of range");
+  }
+  return m_subresources[(size_t(mip) * m_header.getNumLayers() + layer) * m_header.getNumFaces() + face];
+}
+
 ErrorWithText Image::writeToStream(std::ostream& output, const WriteSettings& writeSettings)
 {
   //---------------------------------------------------------------------------
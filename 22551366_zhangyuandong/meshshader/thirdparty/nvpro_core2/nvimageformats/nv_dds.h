@@ -37,6 +37,13 @@ the corresponding API format.
 
 To write a DDS file, use `Image::writeToFile()`.
 
+To read a large DDS file without copying its data, use `MappedImage::open()`.
+It maps the file using nvutils::FileReadMapping, and its `subresource()`
+returns spans directly into the mapping.
+
+To block-compress RGBA8 images to BC1-BC7 before writing them, see
+`nv_bcn::compressDDSImage()` in nv_bcn.h.
+
 `Image` also provides functions to read and write streams. Each of these
 read and write functions supports various settings; see `ReadSettings`
 and `WriteSettings`.
@@ -74,11 +81,15 @@ absolutely necessary, consider using a library such as NVTT.)
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <filesystem>
 #include <iostream>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+#include <nvutils/file_mapping.hpp>
+
 namespace nv_dds {
 
 struct DDSPixelFormat
@@ -498,6 +509,36 @@ private:
   std::vector<Subresource> m_data;
 };
 
+// A read-only view of a DDS file through a memory mapping. Subresources are
+// spans directly into the mapped file, so no image data is copied.
+// Bitmasked (pre-DX10, non-FourCC) files must be decompressed and are
+// rejected; use Image::readFromFile() for those.
+// The mapping stays open until close() is called or the object is destroyed,
+// so subresource spans must not outlive it.
+struct MappedImage
+{
+public:
+  // Maps the file and parses its header; computes where each subresource is.
+  ErrorWithText open(const std::filesystem::path& filename, const ReadSettings& readSettings);
+
+  // Unmaps the file.
+  void close();
+
+  // Returns the data of the subresource at the given mip, layer, and face. If
+  // the given indices are out of range, throws an std::out_of_range exception.
+  std::span<const char> subresource(uint32_t mip = 0, uint32_t layer = 0, uint32_t face = 0) const;
+
+  // The properties of the file (dimensions, format, number of mips and so on).
+  // This Image has no subresources allocated.
+  const Image& getHeader() const { return m_header; }
+
+private:
+  nvutils::FileReadMapping           m_mapping;
+  Image                              m_header;
+  uint32_t                           m_numMips = 0;
+  std::vector<std::span<const char>> m_subresources;
+};
+
 //-----------------------------------------------------------------------------
 // These values are included for convenience, if you need to visualize the
 // contents of the DDS header.
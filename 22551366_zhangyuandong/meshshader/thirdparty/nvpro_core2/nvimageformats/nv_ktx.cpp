@@ -24,6 +24,7 @@
 #include <atomic>
 #include <cassert>  // Some functions produce assertion errors to assist with debugging when NDEBUG is false.
 #include <fstream>
+#include <future>
 #include <mutex>
 #include <sstream>
 #include <string.h>  // memcpy
@@ -45,6 +46,8 @@
 #include "third_party/khr_df/khr_df.h"
 #include "texture_formats.h"
 
+#include <nvutils/parallel_work.hpp>
+
 namespace nv_ktx {
 
 // Some sources for this code:
@@ -109,6 +112,11 @@ void KTXImage::clear()
 }
 
 std::vector<char>& KTXImage::subresource(uint32_t mip, uint32_t layer, uint32_t face)
+{
+  return const_cast<std::vector<char>&>(static_cast<const KTXImage*>(this)->subresource(mip, layer, face));
+}
+
+const std::vector<char>& KTXImage::subresource(uint32_t mip, uint32_t layer, uint32_t face) const
 {
   const uint32_t num_mips_clamped   = std::max(num_mips, 1U);
   const uint32_t num_layers_clamped = std::max(num_layers_possibly_0, 1U);
@@ -250,25 +258,19 @@ void SwapEndianGeneral(size_t dataSizeBytes, void* data, uint32_t typeSizeBytes)
 
 static_assert(CHAR_BIT == 8, "Things will probably go wrong in nv_ktx code with istream reads if chars aren't 8 bits.");
 
-ErrorWithText ReadKeyValueData(std::istream&                             input,
-                               uint32_t                                  kvdByteLength,
-                               bool                                      srcIsBigEndian,
-                               std::map<std::string, std::vector<char>>& outKeyValueData)
+// Parses a key/value data block that is already in memory.
+ErrorWithText ParseKeyValueData(const char*                               kvBlock,
+                                size_t                                    kvdByteLength,
+                                bool                                      srcIsBigEndian,
+                                std::map<std::string, std::vector<char>>& outKeyValueData)
 {
-  std::vector<char> kvBlock;
-  UNWRAP_ERROR(ResizeVectorOrError(kvBlock, kvdByteLength));
-  if(!input.read(kvBlock.data(), size_t(kvdByteLength)))
-  {
-    return "Unable to read " + std::to_string(kvdByteLength) + " bytes of KTX2 key/value data.";
-  }
-
   size_t byteIndex = 0;
   while(byteIndex < kvdByteLength)
   {
     // Read keyAndValueByteLength
     uint32_t keyAndValueByteLength = 0;
     // Check to make sure we don't read out of bounds
-    if(byteIndex + sizeof(keyAndValueByteLength) >= kvBlock.size())
+    if(byteIndex + sizeof(keyAndValueByteLength) >= kvdByteLength)
     {
       return "Key/value data starting at byte " + std::to_string(byteIndex)
              + "of the key/value data block did not have enough space to contain the 32-bit key/value size. Is the key/value data truncated?";
@@ -282,7 +284,7 @@ ErrorWithText ReadKeyValueData(std::istream&                             input,
 
     // If byteIndex + keyAndValueByteLength > the length of kvBlock, we read
     // byteIndex incorrectly; we'll treat this as a non-fatal error.
-    if(byteIndex + keyAndValueByteLength > kvBlock.size())
+    if(byteIndex + keyAndValueByteLength > kvdByteLength)
     {
       assert("Key/value data had byte length that was too long!");
       return {};
@@ -310,7 +312,7 @@ ErrorWithText ReadKeyValueData(std::istream&                             input,
 
     // Construct the key and value from ranges.
     std::string key(&kvBlock[byteIndex], keyLength);  // Don't include null character
-    std::vector<char> value(kvBlock.begin() + (byteIndex + keyLength + 1), kvBlock.begin() + (byteIndex + keyAndValueByteLength));
+    std::vector<char> value(kvBlock + (byteIndex + keyLength + 1), kvBlock + (byteIndex + keyAndValueByteLength));
     // Handle duplicate keys gracefully by using later keys. Note that KTX
     // requires that keys not be duplicated.
     outKeyValueData.insert_or_assign(key, value);
@@ -322,6 +324,62 @@ ErrorWithText ReadKeyValueData(std::istream&                             input,
   return {};
 }
 
+ErrorWithText ReadKeyValueData(std::istream&                             input,
+                               uint32_t                                  kvdByteLength,
+                               bool                                      srcIsBigEndian,
+                               std::map<std::string, std::vector<char>>& outKeyValueData)
+{
+  std::vector<char> kvBlock;
+  UNWRAP_ERROR(ResizeVectorOrError(kvBlock, kvdByteLength));
+  if(!input.read(kvBlock.data(), size_t(kvdByteLength)))
+  {
+    return "Unable to read " + std::to_string(kvdByteLength) + " bytes of KTX2 key/value data.";
+  }
+  return ParseKeyValueData(kvBlock.data(), kvBlock.size(), srcIsBigEndian, outKeyValueData);
+}
+
+// Returns the swizzle stored in the KTXswizzle key, or the identity swizzle
+// if the key doesn't exist.
+std::array<KTX_SWIZZLE, 4> ParseSwizzle(const KeyValueData& keyValueData)
+{
+  std::array<KTX_SWIZZLE, 4> swizzle = {KTX_SWIZZLE::R, KTX_SWIZZLE::G, KTX_SWIZZLE::B, KTX_SWIZZLE::A};
+  const auto                 kvpIt   = keyValueData.find("KTXswizzle");
+  if(kvpIt != keyValueData.end())
+  {
+    // Read up to 4 characters (slightly less constrained than the spec)
+    const std::vector<char>& value = kvpIt->second;
+    // Value should end with a NULL character, but if it doesn't that's OK
+    const size_t charsToRead = std::min(size_t(4), value.size());
+    for(size_t i = 0; i < charsToRead; i++)
+    {
+      switch(value[i])
+      {
+        case 'r':
+          swizzle[i] = KTX_SWIZZLE::R;
+          break;
+        case 'g':
+          swizzle[i] = KTX_SWIZZLE::G;
+          break;
+        case 'b':
+          swizzle[i] = KTX_SWIZZLE::B;
+          break;
+        case 'a':
+          swizzle[i] = KTX_SWIZZLE::A;
+          break;
+        case '0':
+          swizzle[i] = KTX_SWIZZLE::ZERO;
+          break;
+        case '1':
+          swizzle[i] = KTX_SWIZZLE::ONE;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  return swizzle;
+}
+
 // Computes the size of a subresource of size `width` x `height` x `depth`, encoded
 // using ASTC blocks of size `blockWidth` x `blockHeight` x `blockDepth`. Returns false
 // if the calculation would overflow, and returns true and stores the result in
@@ -1556,43 +1614,7 @@ ErrorWithText KTXImage::readFromKTX2Stream(std::istream& input, const ReadSettin
   UNWRAP_ERROR(ReadKeyValueData(input, header.kvdByteLength, false, key_value_data));
 
   // Parse the ktxSwizzle value if it exists.
-  {
-    swizzle          = {KTX_SWIZZLE::R, KTX_SWIZZLE::G, KTX_SWIZZLE::B, KTX_SWIZZLE::A};
-    const auto kvpIt = key_value_data.find("KTXswizzle");
-    if(kvpIt != key_value_data.end())
-    {
-      // Read up to 4 characters (slightly less constrained than the spec)
-      const std::vector<char> value = kvpIt->second;
-      // Value should end with a NULL character, but if it doesn't that's OK
-      const size_t charsToRead = std::min(size_t(4), value.size());
-      for(size_t i = 0; i < charsToRead; i++)
-      {
-        switch(value[i])
-        {
-          case 'r':
-            swizzle[i] = KTX_SWIZZLE::R;
-            break;
-          case 'g':
-            swizzle[i] = KTX_SWIZZLE::G;
-            break;
-          case 'b':
-            swizzle[i] = KTX_SWIZZLE::B;
-            break;
-          case 'a':
-            swizzle[i] = KTX_SWIZZLE::A;
-            break;
-          case '0':
-            swizzle[i] = KTX_SWIZZLE::ZERO;
-            break;
-          case '1':
-            swizzle[i] = KTX_SWIZZLE::ONE;
-            break;
-          default:
-            break;
-        }
-      }
-    }
-  }
+  swizzle = ParseSwizzle(key_value_data);
 
   //---------------------------------------------------------------------------
   // The align(8) sgdPadding.
@@ -3203,6 +3225,335 @@ ErrorWithText KTXImage::readFromFile(const char* filename, const ReadSettings& r
   return readFromStream(input_stream, readSettings);
 }
 
+//-----------------------------------------------------------------------------
+// MEMORY-MAPPED KTX2 READING
+//-----------------------------------------------------------------------------
+
+ErrorWithText KTXMappedImage::open(const std::filesystem::path& filename, const ReadSettings& readSettings)
+{
+  close();
+  if(!m_mapping.open(filename))
+  {
+    return "Could not open and map " + filename.string() + ".";
+  }
+  const char*  file     = static_cast<const char*>(m_mapping.data());
+  const size_t fileSize = m_mapping.size();
+
+  if(fileSize >= IDENTIFIER_LEN && memcmp(file, ktx1Identifier, IDENTIFIER_LEN) == 0)
+  {
+    return "KTX1 files can't be read through a mapping; use KTXImage::readFromFile() instead.";
+  }
+  if(fileSize < IDENTIFIER_LEN + sizeof(KTX2TopLevelHeader) || memcmp(file, ktx2Identifier, IDENTIFIER_LEN) != 0)
+  {
+    return "Not a KTX2 file (first 12 bytes weren't a valid identifier, or the file was truncated).";
+  }
+
+  KTX2TopLevelHeader header{};
+  memcpy(&header, file + IDENTIFIER_LEN, sizeof(header));
+
+  if(header.pixelWidth == 0)
+  {
+    return "KTX2 image width was 0 (i.e. the file contains no pixels).";
+  }
+  if(header.vkFormat == VK_FORMAT_UNDEFINED || header.supercompressionScheme == 1)
+  {
+    return "KTX2 file uses Basis Universal, which must be transcoded; use KTXImage::readFromFile() instead.";
+  }
+  if(header.supercompressionScheme > 3)
+  {
+    return "Does not know about supercompression scheme " + std::to_string(header.supercompressionScheme) + ".";
+  }
+#ifndef NVP_SUPPORTS_ZSTD
+  if(header.supercompressionScheme == 2)
+  {
+    return "KTX2 file uses Zstandard supercompression, but nv_ktx was built without Zstd.";
+  }
+#endif
+#ifndef NVP_SUPPORTS_GZLIB
+  if(header.supercompressionScheme == 3)
+  {
+    return "KTX2 file uses Zlib supercompression, but nv_ktx was built without Zlib.";
+  }
+#endif
+
+  // Same dimension handling as readFromKTX2Stream()
+  format                   = header.vkFormat;
+  mip_0_width              = header.pixelWidth;
+  mip_0_height             = header.pixelHeight;
+  mip_0_depth              = header.pixelDepth;
+  num_layers_possibly_0    = header.layerCount;
+  num_faces                = std::max(1u, header.faceCount);
+  app_should_generate_mips = (header.levelCount == 0);
+  m_supercompressionScheme = header.supercompressionScheme;
+
+  const uint32_t levelCount = std::max(1u, header.levelCount);
+  if(levelCount > 31)
+  {
+    return "KTX2 levelCount was too large (" + std::to_string(levelCount)
+           + ") - the maximum number of mips possible in a KTX2 file is 31.";
+  }
+  num_mips = (readSettings.mips ? levelCount : 1);
+
+  const size_t pixelHeight = std::max(1u, header.pixelHeight);
+  const size_t pixelDepth  = std::max(1u, header.pixelDepth);
+  const size_t layerCount  = std::max(1u, header.layerCount);
+
+  //---------------------------------------------------------------------------
+  // Level index
+  const size_t levelIndexOffset = IDENTIFIER_LEN + sizeof(KTX2TopLevelHeader);
+  if(levelIndexOffset + sizeof(LevelIndex) * levelCount > fileSize)
+  {
+    return "Unable to read Level Index from KTX2 file; the file is truncated.";
+  }
+  m_mips.resize(num_mips);
+  for(uint32_t mip = 0; mip < num_mips; mip++)
+  {
+    LevelIndex levelIndex{};
+    memcpy(&levelIndex, file + levelIndexOffset + sizeof(LevelIndex) * mip, sizeof(LevelIndex));
+    if(levelIndex.byteOffset > fileSize || levelIndex.byteLength > fileSize - levelIndex.byteOffset)
+    {
+      return "Mip level " + std::to_string(mip) + "'s data lies outside of the " + std::to_string(fileSize) + " byte long file.";
+    }
+    if(levelIndex.uncompressedByteLength > readSettings.max_resource_size_in_bytes)
+    {
+      return "Mip level " + std::to_string(mip) + "'s uncompressedByteLength ("
+             + std::to_string(levelIndex.uncompressedByteLength)
+             + ") was larger than ReadSettings::max_resource_size_in_bytes ("
+             + std::to_string(readSettings.max_resource_size_in_bytes) + ").";
+    }
+
+    MipLevel& level              = m_mips[mip];
+    level.byteOffset             = levelIndex.byteOffset;
+    level.byteLength             = levelIndex.byteLength;
+    level.uncompressedByteLength = levelIndex.uncompressedByteLength;
+    UNWRAP_ERROR(ExportSizeExtended(std::max(1u, header.pixelWidth >> mip), std::max(size_t(1), pixelHeight >> mip),
+                                    std::max(size_t(1), pixelDepth >> mip), format, level.faceSize,
+                                    readSettings.custom_size_callback));
+
+    size_t expectedBytes = 0;
+    if(!checked_math::mul3(level.faceSize, layerCount, size_t(num_faces), expectedBytes))
+    {
+      return "Computing the size of mip " + std::to_string(mip) + " overflowed a size_t!";
+    }
+    const uint64_t availableBytes = (m_supercompressionScheme == 0) ? level.byteLength : level.uncompressedByteLength;
+    if(expectedBytes > availableBytes)
+    {
+      return "Expected " + std::to_string(expectedBytes) + " bytes in mip " + std::to_string(mip) + ", but the level was only "
+             + std::to_string(availableBytes) + " bytes long.";
+    }
+    level.loaded = (m_supercompressionScheme == 0);
+  }
+
+  //---------------------------------------------------------------------------
+  // Data Format Descriptor; only the flags and the transfer function are
+  // needed since the format is always known here.
+  is_premultiplied = false;
+  is_srgb          = true;
+  if(uint64_t(header.dfdByteOffset) + header.dfdByteLength > fileSize)
+  {
+    return "KTX2 Data Format Descriptor lies outside of the file.";
+  }
+  if(header.dfdByteLength >= sizeof(uint32_t) + sizeof(BasicDataFormatDescriptor))
+  {
+    BasicDataFormatDescriptor basicDFD{};
+    memcpy(&basicDFD, file + header.dfdByteOffset + sizeof(uint32_t), sizeof(basicDFD));
+    is_premultiplied = (basicDFD.flags & KHR_DF_FLAG_ALPHA_PREMULTIPLIED) != 0;
+    if(basicDFD.transferFunction == KHR_DF_TRANSFER_LINEAR)
+    {
+      is_srgb = false;
+    }
+    else if(basicDFD.transferFunction != KHR_DF_TRANSFER_SRGB)
+    {
+      return "KTX2 Data Format Descriptor had an unhandled transferFunction (" + std::to_string(basicDFD.transferFunction) + ")";
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // Key/value data
+  if(uint64_t(header.kvdByteOffset) + header.kvdByteLength > fileSize)
+  {
+    return "KTX2 key/value data lies outside of the file.";
+  }
+  UNWRAP_ERROR(ParseKeyValueData(file + header.kvdByteOffset, header.kvdByteLength, false, key_value_data));
+  swizzle = ParseSwizzle(key_value_data);
+
+  return {};
+}
+
+void KTXMappedImage::close()
+{
+  m_mips.clear();
+  key_value_data.clear();
+  m_mapping.close();
+}
+
+ErrorWithText KTXMappedImage::loadMip(uint32_t mip)
+{
+  if(mip >= m_mips.size())
+  {
+    return "Mip " + std::to_string(mip) + " is out of range.";
+  }
+  MipLevel& level = m_mips[mip];
+  if(level.loaded)
+  {
+    return {};
+  }
+
+  UNWRAP_ERROR(ResizeVectorOrError(level.inflated, level.uncompressedByteLength));
+
+  if(m_supercompressionScheme == 2)
+  {
+#ifdef NVP_SUPPORTS_ZSTD
+    const char*  source     = static_cast<const char*>(m_mapping.data()) + level.byteOffset;
+    const size_t zstdResult = ZSTD_decompress(level.inflated.data(), level.inflated.size(), source, level.byteLength);
+    if(ZSTD_isError(zstdResult))
+    {
+      return "Mip " + std::to_string(mip) + " Zstandard inflation failed with the message '"
+             + std::string(ZSTD_getErrorName(zstdResult)) + "' (code " + std::to_string(zstdResult) + ").";
+    }
+    if(zstdResult != level.uncompressedByteLength)
+    {
+      return "Mip " + std::to_string(mip) + " Zstandard inflation produced " + std::to_string(zstdResult)
+             + " bytes, but the level index says " + std::to_string(level.uncompressedByteLength) + ".";
+    }
+#else
+    return "KTX2 file uses Zstandard supercompression, but nv_ktx was built without Zstd.";
+#endif
+  }
+  else if(m_supercompressionScheme == 3)
+  {
+#ifdef NVP_SUPPORTS_GZLIB
+    const char*       source = static_cast<const char*>(m_mapping.data()) + level.byteOffset;
+    ScopedZlibDStream zlibStream;
+    int               zlibError = zlibStream.Init();
+    if(zlibError != Z_OK)
+    {
+      return "Zlib initialization failed (error code " + std::to_string(zlibError) + ").";
+    }
+    if(level.byteLength > UINT_MAX || level.inflated.size() > UINT_MAX)
+    {
+      return "Zlib compressed or decompressed data for mip " + std::to_string(mip) + " was larger than 4 GB.";
+    }
+    zlibStream.stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(source));
+    zlibStream.stream.avail_in  = static_cast<uInt>(level.byteLength);
+    zlibStream.stream.next_out  = reinterpret_cast<Bytef*>(level.inflated.data());
+    zlibStream.stream.avail_out = static_cast<uInt>(level.inflated.size());
+    zlibError                   = inflate(&zlibStream.stream, Z_FINISH);
+    if(zlibError != Z_STREAM_END)
+    {
+      return "Zlib inflation of mip " + std::to_string(mip) + " did not reach the end of the stream (error code "
+             + std::to_string(zlibError) + ").";
+    }
+    if(zlibStream.stream.total_out != level.uncompressedByteLength)
+    {
+      return "Mip " + std::to_string(mip) + " Zlib inflation produced " + std::to_string(zlibStream.stream.total_out)
+             + " bytes, but the level index says " + std::to_string(level.uncompressedByteLength) + ".";
+    }
+#else
+    return "KTX2 file uses Zlib supercompression, but nv_ktx was built without Zlib.";
+#endif
+  }
+
+  level.loaded = true;
+  return {};
+}
+
+ErrorWithText KTXMappedImage::loadAllMips()
+{
+  std::vector<ErrorWithText> errors(m_mips.size());
+  nvutils::parallel_batches_pooled<1>(m_mips.size(), [&](uint64_t mip, uint32_t) { errors[mip] = loadMip(uint32_t(mip)); });
+  for(ErrorWithText& error : errors)
+  {
+    UNWRAP_ERROR(error);
+  }
+  return {};
+}
+
+ErrorWithText KTXMappedImage::streamMips(const std::function<bool(uint32_t mip)>& onMipReady)
+{
+  const uint32_t numLevels  = static_cast<uint32_t>(m_mips.size());
+  bool           keepCalling = true;
+
+  // Nothing to inflate, or we're already on a pool thread and must not wait
+  // on other pool tasks: load in order on this thread.
+  if(m_supercompressionScheme == 0 || BS::this_thread::get_index().has_value())
+  {
+    for(uint32_t mip = numLevels; mip-- > 0;)
+    {
+      UNWRAP_ERROR(loadMip(mip));
+      keepCalling = keepCalling && onMipReady(mip);
+    }
+    return {};
+  }
+
+  // Submit the smallest mips first; the pool runs tasks in submission order,
+  // so they also complete first.
+  BS::thread_pool&                        threadPool = nvutils::get_thread_pool();
+  std::vector<std::future<ErrorWithText>> futures(numLevels);
+  for(uint32_t mip = numLevels; mip-- > 0;)
+  {
+    futures[mip] = threadPool.submit_task([this, mip]() { return loadMip(mip); });
+  }
+
+  // Wait on every future, even after an error, since the tasks reference this object.
+  ErrorWithText result;
+  for(uint32_t mip = numLevels; mip-- > 0;)
+  {
+    ErrorWithText error = futures[mip].get();
+    if(error.has_value() && !result.has_value())
+    {
+      result = std::move(error);
+    }
+    if(!result.has_value() && keepCalling)
+    {
+      keepCalling = onMipReady(mip);
+    }
+  }
+  return result;
+}
+
+bool KTXMappedImage::isMipLoaded(uint32_t mip) const
+{
+  return mip < m_mips.size() && m_mips[mip].loaded;
+}
+
+std::span<const char> KTXMappedImage::subresource(uint32_t mip, uint32_t layer, uint32_t face) const
+{
+  const uint32_t num_layers_clamped = std::max(num_layers_possibly_0, 1U);
+  if(mip >= m_mips.size() || layer >= num_layers_clamped || face >= num_faces)
+  {
+    throw std::out_of_range("KTXMappedImage::subresource values were out of range");
+  }
+
+  const MipLevel& level = m_mips[mip];
+  if(!level.loaded)
+  {
+    return {};
+  }
+
+  // KTX2 stores each level's subresources contiguously, layer-major.
+  const size_t offset = (size_t(layer) * size_t(num_faces) + size_t(face)) * level.faceSize;
+  const char*  base = (m_supercompressionScheme == 0) ? static_cast<const char*>(m_mapping.data()) + level.byteOffset :
+                                                        level.inflated.data();
+  return {base + offset, level.faceSize};
+}
+
+VkImageType KTXMappedImage::getImageType() const
+{
+  if(mip_0_width == 0)
+  {
+    return VK_IMAGE_TYPE_1D;
+  }
+  else if(mip_0_depth == 0)
+  {
+    return VK_IMAGE_TYPE_2D;
+  }
+  else
+  {
+    return VK_IMAGE_TYPE_3D;
+  }
+}
+
 }  // namespace nv_ktx
 
 //-----------------------------------------------------------------------------
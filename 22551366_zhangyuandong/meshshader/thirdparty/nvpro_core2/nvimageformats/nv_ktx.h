@@ -27,6 +27,12 @@ Khronos Data Format.
 
 For example usage, please see usage_nv_ktx() at the end of nv_ktx.cpp.
 
+KTXMappedImage reads KTX2 files through an nvutils::FileReadMapping instead
+of a stream; see its documentation below.
+
+To block-compress RGBA8 images to BC1-BC7 before writing them, see
+`nv_bcn::compressKTXImage()` in nv_bcn.h.
+
 Define `NVP_SUPPORTS_ZSTD`, `NVP_SUPPORTS_GZLIB`, and `NVP_SUPPORTS_BASISU` to
 include the Zstd, Zlib, and Basis Universal headers respectively, and to
 enable reading these formats. This will also enable writing Zstd and
@@ -38,13 +44,18 @@ Basis Universal-compressed formats.
 #define __NV_KTX_H__
 
 #include <array>
+#include <filesystem>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+#include <nvutils/file_mapping.hpp>
+
 namespace nv_ktx {
 // These functions return an empty std::optional if they succeeded, and a
 // value with text describing the error if they failed.
@@ -198,7 +209,8 @@ public:
 
   // Mutably accesses the subresource at the given mip, layer, and face. If the
   // given indices are out of range, throws an std::out_of_range exception.
-  std::vector<char>& subresource(uint32_t mip = 0, uint32_t layer = 0, uint32_t face = 0);
+  std::vector<char>&       subresource(uint32_t mip = 0, uint32_t layer = 0, uint32_t face = 0);
+  const std::vector<char>& subresource(uint32_t mip = 0, uint32_t layer = 0, uint32_t face = 0) const;
 
   // Reads this structure from a KTX stream, advancing the stream as well.
   // Returns an optional error message if the read failed.
@@ -300,6 +312,89 @@ private:
   std::vector<std::vector<char>> data;
 };
 
+
+// A read-only view of a KTX2 file through a memory mapping, for loading large
+// textures without copying them.
+// - Subresources of levels without supercompression are spans directly into
+//   the mapped file; nothing is copied.
+// - Zstandard and Zlib supercompressed levels are inflated on demand into one
+//   buffer per mip. loadAllMips() inflates mips in parallel.
+// - streamMips() makes mips available from the smallest to the largest, so
+//   that a texture streaming system can show a low-resolution version
+//   immediately while the larger mips are still being inflated.
+// Basis Universal (UASTC and ETC1S) and KTX1 files need transcoding or
+// format conversion, so they are rejected here; use KTXImage for those.
+// The mapping stays open until close() is called or the object is destroyed,
+// so subresource spans must not outlive it.
+class KTXMappedImage
+{
+public:
+  // Maps the file and parses its header, level index, data format descriptor
+  // and key/value data. No image data is read yet.
+  ErrorWithText open(const std::filesystem::path& filename, const ReadSettings& readSettings);
+
+  // Releases inflated data and unmaps the file.
+  void close();
+
+  // Makes the subresources of the given mip accessible, inflating them if
+  // needed. Can be called concurrently for different mips.
+  ErrorWithText loadMip(uint32_t mip);
+
+  // Makes all mips accessible. Supercompressed mips are inflated in parallel
+  // using the nvutils thread pool.
+  ErrorWithText loadAllMips();
+
+  // Makes all mips accessible from the smallest (num_mips - 1) to the largest
+  // (0), and calls onMipReady(mip) on the calling thread as soon as each one
+  // is accessible. Larger mips keep inflating in the background while the
+  // callback runs. Returning false from the callback skips the remaining
+  // callbacks; the mips are still loaded.
+  ErrorWithText streamMips(const std::function<bool(uint32_t mip)>& onMipReady);
+
+  // Whether the given mip is accessible through subresource(). Mips without
+  // supercompression are accessible as soon as open() succeeds.
+  bool isMipLoaded(uint32_t mip) const;
+
+  // Returns the data of a subresource of a loaded mip, or an empty span if
+  // the mip isn't loaded yet. If the given indices are out of range, throws an
+  // std::out_of_range exception.
+  std::span<const char> subresource(uint32_t mip = 0, uint32_t layer = 0, uint32_t face = 0) const;
+
+  // Same as KTXImage::getImageType().
+  VkImageType getImageType() const;
+
+public:
+  // These members have the same meaning as the ones in KTXImage, and are
+  // read-only.
+  VkFormat                   format                   = VK_FORMAT_UNDEFINED;
+  uint32_t                   mip_0_width              = 1;
+  uint32_t                   mip_0_height             = 0;
+  uint32_t                   mip_0_depth              = 0;
+  uint32_t                   num_mips                 = 1;
+  uint32_t                   num_layers_possibly_0    = 0;
+  uint32_t                   num_faces                = 0;
+  KeyValueData               key_value_data{};
+  bool                       app_should_generate_mips = false;
+  bool                       is_premultiplied         = false;
+  bool                       is_srgb                  = true;
+  std::array<KTX_SWIZZLE, 4> swizzle = {KTX_SWIZZLE::R, KTX_SWIZZLE::G, KTX_SWIZZLE::B, KTX_SWIZZLE::A};
+
+private:
+  struct MipLevel
+  {
+    uint64_t          byteOffset             = 0;  // Of the level's data in the file
+    uint64_t          byteLength             = 0;  // Of the level's data in the file
+    uint64_t          uncompressedByteLength = 0;
+    size_t            faceSize               = 0;  // Size of each subresource
+    std::vector<char> inflated;                    // Only used with supercompression
+    bool              loaded = false;
+  };
+
+  nvutils::FileReadMapping m_mapping;
+  uint32_t                 m_supercompressionScheme = 0;
+  std::vector<MipLevel>    m_mips;
+};
+
 }  // namespace nv_ktx
 
 #endif
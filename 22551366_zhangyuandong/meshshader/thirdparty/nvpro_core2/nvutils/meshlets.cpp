@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2022-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <numeric>
+
+#include "meshlets.hpp"
+#include "bounding_box.hpp"
+#include "parallel_work.hpp"
+
+namespace nvutils {
+
+static_assert(sizeof(PrimitiveTriangle) == sizeof(uint32_t) * 3, "PrimitiveTriangle must be tightly packed");
+
+static constexpr uint16_t kNoLocalIndex = 0xFFFF;
+
+// Spreads the lower 10 bits of x so that there are two zero bits between each bit.
+static uint32_t mortonSpread(uint32_t x)
+{
+  x &= 0x3FF;
+  x = (x | (x << 16)) & 0x030000FF;
+  x = (x | (x << 8)) & 0x0300F00F;
+  x = (x | (x << 4)) & 0x030C30C3;
+  x = (x | (x << 2)) & 0x09249249;
+  return x;
+}
+
+// Returns the order in which triangles are used as seeds for new meshlets.
+// With `spatial`, triangles are sorted along a Morton curve through their centroids,
+// so that consecutive seeds, and therefore consecutive meshlets, are close in space.
+static std::vector<uint32_t> computeSeedOrder(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, bool spatial)
+{
+  const uint32_t        numTriangles = static_cast<uint32_t>(indices.size() / 3);
+  std::vector<uint32_t> order(numTriangles);
+  std::iota(order.begin(), order.end(), 0U);
+  if(!spatial || numTriangles == 0)
+  {
+    return order;
+  }
+
+  std::vector<glm::vec3> centroids(numTriangles);
+  Bbox                   bbox;
+  for(uint32_t t = 0; t < numTriangles; t++)
+  {
+    centroids[t] = (positions[indices[t * 3 + 0]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) / 3.0F;
+    bbox.insert(centroids[t]);
+  }
+
+  const glm::vec3       extent = glm::max(bbox.max() - bbox.min(), glm::vec3(1e-20F));
+  const glm::vec3       scale  = glm::vec3(1023.0F) / extent;
+  std::vector<uint32_t> codes(numTriangles);
+  for(uint32_t t = 0; t < numTriangles; t++)
+  {
+    const glm::uvec3 q = glm::uvec3(glm::clamp((centroids[t] - bbox.min()) * scale, glm::vec3(0.0F), glm::vec3(1023.0F)));
+    codes[t]           = mortonSpread(q.x) | (mortonSpread(q.y) << 1) | (mortonSpread(q.z) << 2);
+  }
+
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return codes[a] < codes[b]; });
+  return order;
+}
+
+MeshletBounds computeMeshletBounds(std::span<const glm::vec3> positions, std::span<const uint32_t> triangles)
+{
+  MeshletBounds bounds{};
+  bounds.coneAxis   = {0.0F, 0.0F, 1.0F};
+  bounds.coneCutoff = 1.0F;
+  if(triangles.empty())
+  {
+    return bounds;
+  }
+
+  // Ritter's bounding sphere: start from two far apart points, then grow to enclose the rest.
+  auto farthestFrom = [&](const glm::vec3& p) {
+    glm::vec3 best     = positions[triangles[0]];
+    float     bestDist = -1.0F;
+    for(uint32_t idx : triangles)
+    {
+      const float d = glm::dot(positions[idx] - p, positions[idx] - p);
+      if(d > bestDist)
+      {
+        bestDist = d;
+        best     = positions[idx];
+      }
+    }
+    return best;
+  };
+  const glm::vec3 a = farthestFrom(positions[triangles[0]]);
+  const glm::vec3 b = farthestFrom(a);
+  glm::vec3       center = (a + b) * 0.5F;
+  float           radius = glm::length(b - a) * 0.5F;
+  for(uint32_t idx : triangles)
+  {
+    const float d = glm::length(positions[idx] - center);
+    if(d > radius)
+    {
+      const float newRadius = (radius + d) * 0.5F;
+      center += (positions[idx] - center) * ((newRadius - radius) / d);
+      radius = newRadius;
+    }
+  }
+  bounds.center   = center;
+  bounds.radius   = radius;
+  bounds.coneApex = center;
+
+  // Normal cone: the axis is the average of the unit face normals, the spread is given
+  // by the face normal deviating the most from it.
+  const size_t           numTriangles = triangles.size() / 3;
+  std::array<glm::vec3, 256> normalsLocal;
+  std::vector<glm::vec3>     normalsHeap;
+  glm::vec3*                 normals = normalsLocal.data();
+  if(numTriangles > normalsLocal.size())
+  {
+    normalsHeap.resize(numTriangles);
+    normals = normalsHeap.data();
+  }
+
+  glm::vec3 axis{0.0F};
+  for(size_t t = 0; t < numTriangles; t++)
+  {
+    const glm::vec3& p0 = positions[triangles[t * 3 + 0]];
+    const glm::vec3& p1 = positions[triangles[t * 3 + 1]];
+    const glm::vec3& p2 = positions[triangles[t * 3 + 2]];
+    const glm::vec3  n  = glm::cross(p1 - p0, p2 - p0);
+    const float      l  = glm::length(n);
+    normals[t]          = (l > 0.0F) ? n / l : glm::vec3(0.0F);
+    axis += normals[t];
+  }
+
+  const float axisLength = glm::length(axis);
+  if(axisLength == 0.0F)
+  {
+    return bounds;
+  }
+  axis /= axisLength;
+
+  float minDot = 1.0F;
+  for(size_t t = 0; t < numTriangles; t++)
+  {
+    if(normals[t] != glm::vec3(0.0F))
+    {
+      minDot = std::min(minDot, glm::dot(normals[t], axis));
+    }
+  }
+  bounds.coneAxis = axis;
+
+  // A cone wider than ~84 degrees would cull almost nothing and makes the apex unstable
+  if(minDot <= 0.1F)
+  {
+    return bounds;
+  }
+
+  // Move the apex back along the axis until every triangle plane is in front of it
+  float maxT = 0.0F;
+  for(size_t t = 0; t < numTriangles; t++)
+  {
+    if(normals[t] == glm::vec3(0.0F))
+    {
+      continue;
+    }
+    const glm::vec3 toCenter = center - positions[triangles[t * 3]];
+    const float     dn       = glm::dot(normals[t], axis);
+    maxT                     = std::max(maxT, glm::dot(toCenter, normals[t]) / dn);
+  }
+  bounds.coneApex   = center - axis * maxT;
+  bounds.coneCutoff = std::sqrt(1.0F - minDot * minDot);
+  return bounds;
+}
+
+MeshletMesh buildMeshlets(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, const MeshletBuildConfig& config)
+{
+  assert(config.maxVertices >= 3 && config.maxVertices <= 256);
+  assert(config.maxTriangles >= 1 && config.maxTriangles <= 256);
+  assert(indices.size() % 3 == 0);
+
+  MeshletMesh    result;
+  const uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+  const uint32_t numVertices  = static_cast<uint32_t>(positions.size());
+  if(numTriangles == 0)
+  {
+    return result;
+  }
+
+  // Vertex to triangle adjacency, stored as offsets into a flat array
+  std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+  for(uint32_t idx : indices)
+  {
+    adjacencyOffsets[idx + 1]++;
+  }
+  std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+  std::vector<uint32_t> adjacency(indices.size());
+  {
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for(uint32_t t = 0; t < numTriangles; t++)
+    {
+      for(uint32_t c = 0; c < 3; c++)
+      {
+        adjacency[fill[indices[t * 3 + c]]++] = t;
+      }
+    }
+  }
+
+  const std::vector<uint32_t> seedOrder = computeSeedOrder(positions, indices, config.optimizeLocality);
+  std::vector<uint32_t>       seedRank(numTriangles);
+  for(uint32_t i = 0; i < numTriangles; i++)
+  {
+    seedRank[seedOrder[i]] = i;
+  }
+
+  std::vector<bool>     emitted(numTriangles, false);
+  std::vector<uint16_t> localIndex(numVertices, kNoLocalIndex);
+  Meshlet               current{};
+
+  result.meshlets.reserve(numTriangles / config.maxTriangles + 1);
+  result.packedTriangles.reserve(numTriangles);
+
+  auto newVertexCount = [&](uint32_t t) {
+    const uint32_t a = indices[t * 3 + 0];
+    const uint32_t b = indices[t * 3 + 1];
+    const uint32_t c = indices[t * 3 + 2];
+    uint32_t       n = (localIndex[a] == kNoLocalIndex) ? 1 : 0;
+    n += (localIndex[b] == kNoLocalIndex && b != a) ? 1 : 0;
+    n += (localIndex[c] == kNoLocalIndex && c != a && c != b) ? 1 : 0;
+    return n;
+  };
+
+  auto flush = [&]() {
+    if(current.triangleCount == 0)
+    {
+      return;
+    }
+    for(uint32_t v = 0; v < current.vertexCount; v++)
+    {
+      localIndex[result.vertices[current.vertexOffset + v]] = kNoLocalIndex;
+    }
+    result.meshlets.push_back(current);
+    current                = {};
+    current.vertexOffset   = static_cast<uint32_t>(result.vertices.size());
+    current.triangleOffset = static_cast<uint32_t>(result.packedTriangles.size());
+  };
+
+  auto appendTriangle = [&](uint32_t t) {
+    if(current.vertexCount + newVertexCount(t) > config.maxVertices || current.triangleCount >= config.maxTriangles)
+    {
+      flush();
+    }
+    uint32_t local[3];
+    for(uint32_t c = 0; c < 3; c++)
+    {
+      const uint32_t idx = indices[t * 3 + c];
+      if(localIndex[idx] == kNoLocalIndex)
+      {
+        localIndex[idx] = current.vertexCount++;
+        result.vertices.push_back(idx);
+      }
+      local[c] = localIndex[idx];
+    }
+    result.packedTriangles.push_back(packMeshletTriangle(local[0], local[1], local[2]));
+    current.triangleCount++;
+    emitted[t] = true;
+  };
+
+  uint32_t seedCursor = 0;
+  uint32_t remaining  = numTriangles;
+  while(remaining > 0)
+  {
+    // Greedily grow the meshlet with the connected triangle adding the fewest new vertices,
+    // ties broken by seed order to keep the growth compact.
+    uint32_t best    = ~0U;
+    uint32_t bestNew = 4;
+    for(uint32_t v = 0; v < current.vertexCount && bestNew > 0; v++)
+    {
+      const uint32_t vertex = result.vertices[current.vertexOffset + v];
+      for(uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+      {
+        const uint32_t t = adjacency[a];
+        if(emitted[t])
+        {
+          continue;
+        }
+        const uint32_t n = newVertexCount(t);
+        if(n < bestNew || (n == bestNew && seedRank[t] < seedRank[best]))
+        {
+          best    = t;
+          bestNew = n;
+        }
+      }
+    }
+
+    const bool fits = current.vertexCount + bestNew <= config.maxVertices && current.triangleCount < config.maxTriangles;
+    if(best == ~0U || !fits)
+    {
+      // Nothing connected fits anymore. Close the meshlet unless it is still mostly empty,
+      // in which case the next seed along the curve is spatially close enough to join it.
+      if(best != ~0U || current.triangleCount * 2 >= config.maxTriangles)
+      {
+        flush();
+      }
+      while(emitted[seedOrder[seedCursor]])
+      {
+        seedCursor++;
+      }
+      best = seedOrder[seedCursor];
+    }
+
+    appendTriangle(best);
+    remaining--;
+  }
+  flush();
+
+  // Bounds only depend on their own meshlet
+  result.bounds.resize(result.meshlets.size());
+  parallel_batches<64>(result.meshlets.size(), [&](uint64_t m) {
+    const Meshlet&                meshlet = result.meshlets[m];
+    std::array<uint32_t, 256 * 3> triangles;
+    for(uint32_t t = 0; t < meshlet.triangleCount; t++)
+    {
+      const glm::uvec3 local = unpackMeshletTriangle(result.packedTriangles[meshlet.triangleOffset + t]);
+      for(uint32_t c = 0; c < 3; c++)
+      {
+        triangles[t * 3 + c] = result.vertices[meshlet.vertexOffset + local[c]];
+      }
+    }
+    result.bounds[m] = computeMeshletBounds(positions, std::span<const uint32_t>(triangles.data(), meshlet.triangleCount * 3));
+  });
+
+  return result;
+}
+
+MeshletMesh buildMeshlets(const PrimitiveMesh& mesh, const MeshletBuildConfig& config)
+{
+  std::vector<glm::vec3> positions(mesh.vertices.size());
+  for(size_t i = 0; i < mesh.vertices.size(); i++)
+  {
+    positions[i] = mesh.vertices[i].pos;
+  }
+  const uint32_t* indices = mesh.triangles.empty() ? nullptr : &mesh.triangles[0].indices.x;
+  return buildMeshlets(positions, std::span<const uint32_t>(indices, mesh.triangles.size() * 3), config);
+}
+
+std::vector<MeshletMesh> buildMeshlets(std::span<const PrimitiveMesh> meshes, const MeshletBuildConfig& config)
+{
+  std::vector<MeshletMesh> results(meshes.size());
+  parallel_batches_pooled<1>(meshes.size(), [&](uint64_t i, uint32_t) { results[i] = buildMeshlets(meshes[i], config); });
+  return results;
+}
+
+}  // namespace nvutils
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022-2025, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2025, NVIDIA CORPORATION.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "primitives.hpp"
+
+/*-------------------------------------------------------------------------------------------------
+# struct `nvutils::MeshletMesh`
+  - Result of splitting an indexed triangle mesh into clusters (meshlets) that fit the
+    output limits of a mesh shader workgroup.
+  - `meshlets[i]` references `vertexCount` entries of `vertices`, starting at `vertexOffset`,
+    and `triangleCount` entries of `packedTriangles`, starting at `triangleOffset`.
+  - `vertices` maps meshlet-local vertex indices to indices of the source mesh.
+  - `packedTriangles` stores one triangle per 32-bit word: three 8-bit local vertex
+    indices in bits 0-7, 8-15 and 16-23. The word layout can be uploaded as-is and
+    decoded in a mesh shader with shifts and masks.
+  - `bounds[i]` holds the bounding sphere and normal cone of `meshlets[i]`, to be used
+    for frustum, occlusion and backface-cluster culling in a task shader.
+
+Usage:
+```cpp
+nvutils::PrimitiveMesh  mesh     = nvutils::createSphereMesh(1.0F, 5);
+nvutils::MeshletMesh    meshlets = nvutils::buildMeshlets(mesh);
+
+// glTF primitives or any other indexed source
+nvutils::MeshletMesh other = nvutils::buildMeshlets(positions, indices, {.maxVertices = 64, .maxTriangles = 64});
+
+// Several meshes at once, one thread per mesh
+std::vector<nvutils::MeshletMesh> all = nvutils::buildMeshlets(std::span(meshes));
+```
+
+Cone culling on the GPU (all triangles of the meshlet are backfacing when true):
+```cpp
+dot(normalize(bounds.coneApex - cameraPos), bounds.coneAxis) >= bounds.coneCutoff
+```
+-------------------------------------------------------------------------------------------------*/
+
+namespace nvutils {
+
+struct MeshletBuildConfig
+{
+  uint32_t maxVertices  = 64;   // Max unique vertices per meshlet, at most 256
+  uint32_t maxTriangles = 126;  // Max triangles per meshlet, at most 256
+  bool     optimizeLocality = true;  // Seed clusters in a spatial (Morton) order of the triangles
+};
+
+struct Meshlet
+{
+  uint32_t vertexOffset;    // First entry in MeshletMesh::vertices
+  uint32_t triangleOffset;  // First entry in MeshletMesh::packedTriangles
+  uint16_t vertexCount;
+  uint16_t triangleCount;
+};
+
+struct MeshletBounds
+{
+  glm::vec3 center;      // Bounding sphere
+  float     radius;      //
+  glm::vec3 coneAxis;    // Normal cone, unit length
+  float     coneCutoff;  // cos(cone half angle + 90deg), 1 when the cone cannot be used for culling
+  glm::vec3 coneApex;    //
+  float     _pad{0};
+};
+
+struct MeshletMesh
+{
+  std::vector<Meshlet>       meshlets;
+  std::vector<MeshletBounds> bounds;
+  std::vector<uint32_t>      vertices;         // Meshlet-local to source vertex index
+  std::vector<uint32_t>      packedTriangles;  // 3x 8-bit local indices per triangle
+};
+
+inline uint32_t packMeshletTriangle(uint32_t a, uint32_t b, uint32_t c)
+{
+  return a | (b << 8) | (c << 16);
+}
+
+inline glm::uvec3 unpackMeshletTriangle(uint32_t packed)
+{
+  return {packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF};
+}
+
+// Splits the triangle list `indices` (3 per triangle) referencing `positions` into meshlets
+// and computes their bounds.
+MeshletMesh buildMeshlets(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, const MeshletBuildConfig& config = {});
+MeshletMesh buildMeshlets(const PrimitiveMesh& mesh, const MeshletBuildConfig& config = {});
+
+// Builds the meshlets of each mesh in parallel using the nvutils thread pool.
+std::vector<MeshletMesh> buildMeshlets(std::span<const PrimitiveMesh> meshes, const MeshletBuildConfig& config = {});
+
+// Computes the bounding sphere and normal cone of a set of triangles.
+// `triangles` holds source vertex indices, 3 per triangle.
+MeshletBounds computeMeshletBounds(std::span<const glm::vec3> positions, std::span<const uint32_t> triangles);
+
+}  // namespace nvutils
@@ -0,0 +1,1265 @@
+/*
+fast_obj_loader.h - multithreaded Wavefront OBJ loader
+
+Single-header library. This is the only copy in the repository: the homework
+builds that load OBJ files add this directory to their include path instead
+of vendoring the header. Include it anywhere, and in exactly one .cpp file do
+
+    #define FAST_OBJ_LOADER_IMPLEMENTATION
+    #include "fast_obj_loader.h"
+
+How it works:
+  - the file is memory-mapped instead of read line by line through iostreams;
+  - the mapping is cut into chunks at line boundaries; a first parallel pass
+    counts the 'v'/'vt'/'vn' lines of every chunk, so that a second parallel
+    pass can write attributes straight to their final position and resolve
+    face indices (including negative, relative ones) to global indices;
+  - numbers are parsed by hand, without locale or stream overhead;
+  - polygons are fan-triangulated;
+  - WeldMesh() merges identical (v, vt, vn) triples into a single indexed
+    vertex buffer;
+  - OptimizeVertexCache() reorders triangles for the post-transform vertex
+    cache (Forsyth's linear-speed algorithm) and vertices for fetch
+    locality; PackIndices() stores indices as 16-bit whenever they fit;
+  - with load_options_t::use_cache, the parsed (or welded) mesh is stored in
+    a binary file next to the OBJ and reused as long as the OBJ's size and
+    modification time do not change. The cache is off by default; for assets
+    in a tracked or read-only directory, set cache_path to a build directory.
+
+Materials (.mtl files) are not parsed; their names are reported in
+material_libraries and group_t::material.
+
+Example:
+
+    fastobj::load_options_t options;
+    options.use_cache = true;
+    fastobj::indexed_mesh_t mesh;
+    std::string err;
+    if (!fastobj::LoadIndexedObj(&mesh, &err, "scan.obj", options)) {
+      std::cerr << err << std::endl;
+    }
+    // mesh.vertices / mesh.texcoords / mesh.normals are per welded vertex,
+    // mesh.indices has 3 entries per triangle
+
+This header only requires C++11.
+*/
+
+#ifndef FAST_OBJ_LOADER_H_
+#define FAST_OBJ_LOADER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace fastobj {
+
+// Indices are 0-based and already resolved; -1 when the face corner has no
+// texcoord or normal.
+struct index_t {
+  int vertex_index;
+  int texcoord_index;
+  int normal_index;
+};
+
+// A run of triangles sharing the same object/group name and material.
+struct group_t {
+  std::string name;           // latest 'o' or 'g' name
+  std::string material;       // latest 'usemtl' name
+  unsigned int index_offset;  // first entry in indices
+  unsigned int num_indices;   // 3 per triangle
+};
+
+// The OBJ as written: one attribute array per kind and 3 index_t per triangle.
+struct mesh_t {
+  std::vector<float> vertices;   // 'v', xyz
+  std::vector<float> texcoords;  // 'vt', uv
+  std::vector<float> normals;    // 'vn', xyz
+  std::vector<index_t> indices;  // 3 per triangle
+  std::vector<group_t> groups;
+  std::vector<std::string> material_libraries;
+  size_t num_faces;  // polygons before triangulation
+
+  mesh_t() : num_faces(0) {}
+};
+
+// One vertex per distinct (v, vt, vn) triple; all attribute arrays have the
+// same vertex count. texcoords/normals are empty when the file has none or
+// when they were excluded from welding; missing ones are written as zero.
+struct indexed_mesh_t {
+  std::vector<float> vertices;         // xyz
+  std::vector<float> texcoords;        // uv
+  std::vector<float> normals;          // xyz
+  std::vector<unsigned int> indices;   // 3 per triangle
+  std::vector<group_t> groups;
+  std::vector<std::string> material_libraries;
+
+  size_t num_vertices() const { return vertices.size() / 3; }
+};
+
+struct load_options_t {
+  unsigned int num_threads;  // 0: one per hardware thread
+  bool use_cache;            // read and write a binary cache of the result
+  std::string cache_path;    // default: "<filename>.fobj" (LoadObj) or
+                             // "<filename>.fobji" (LoadIndexedObj)
+
+  load_options_t() : num_threads(0), use_cache(false) {}
+};
+
+// Attributes that distinguish welded vertices. Excluding an attribute also
+// drops it from the output, e.g. positions only for a point-based scan.
+struct weld_options_t {
+  bool texcoords;
+  bool normals;
+  bool optimize_vertex_cache;  // run OptimizeVertexCache() on the result
+
+  weld_options_t()
+      : texcoords(true), normals(true), optimize_vertex_cache(false) {}
+};
+
+// Returns false and fills err on failure.
+bool LoadObj(mesh_t *mesh, std::string *err, const char *filename,
+             const load_options_t &options = load_options_t());
+bool LoadObjFromMemory(mesh_t *mesh, std::string *err, const char *data,
+                       size_t size, unsigned int num_threads = 0);
+
+void WeldMesh(const mesh_t &mesh, indexed_mesh_t *out,
+              const weld_options_t &options = weld_options_t());
+
+// LoadObj followed by WeldMesh; the cache stores the welded mesh.
+bool LoadIndexedObj(indexed_mesh_t *mesh, std::string *err,
+                    const char *filename,
+                    const load_options_t &options = load_options_t(),
+                    const weld_options_t &weld = weld_options_t());
+
+// Writes position (3), then texcoord (2) and normal (3) when present, for
+// each vertex.
+void InterleaveMesh(const indexed_mesh_t &mesh, std::vector<float> *out);
+
+// Reorders the triangles of every group so that consecutive triangles reuse
+// vertices still in a post-transform cache of cache_size entries, then
+// renumbers vertices in order of first use. Groups keep their index ranges.
+void OptimizeVertexCache(indexed_mesh_t *mesh, unsigned int cache_size = 32);
+
+// Vertex shader invocations per triangle for a FIFO cache of cache_size
+// entries; 3.0 for unindexed triangles, about 0.6-0.7 for a well ordered
+// closed mesh.
+float AverageCacheMissRatio(const std::vector<unsigned int> &indices,
+                            size_t num_vertices, unsigned int cache_size = 32);
+
+// Copies mesh.indices as 16-bit values when every vertex fits, 32-bit
+// otherwise, and returns the size of one index (2 or 4).
+unsigned int PackIndices(const indexed_mesh_t &mesh,
+                         std::vector<unsigned char> *out);
+
+}  // namespace fastobj
+
+#endif  // FAST_OBJ_LOADER_H_
+
+#ifdef FAST_OBJ_LOADER_IMPLEMENTATION
+#ifndef FAST_OBJ_LOADER_IMPLEMENTED_
+#define FAST_OBJ_LOADER_IMPLEMENTED_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fastobj {
+namespace detail {
+
+// --------------------------------------------------------------------------
+// Memory-mapped input
+
+class mapped_file {
+ public:
+  mapped_file() : data_(NULL), size_(0) {
+#ifdef _WIN32
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = NULL;
+#else
+    fd_ = -1;
+#endif
+  }
+  ~mapped_file() { close(); }
+
+  bool open(const char *filename) {
+    close();
+#ifdef _WIN32
+    file_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) return false;
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0) return true;
+    mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_ == NULL) return false;
+    data_ = static_cast<const char *>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    return data_ != NULL;
+#else
+    fd_ = ::open(filename, O_RDONLY);
+    if (fd_ < 0) return false;
+    struct stat st;
+    if (fstat(fd_, &st) != 0) return false;
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) return true;
+    void *p = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) return false;
+    data_ = static_cast<const char *>(p);
+#if defined(MADV_SEQUENTIAL)
+    madvise(p, size_, MADV_SEQUENTIAL);
+#endif
+    return true;
+#endif
+  }
+
+  void close() {
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    file_ = INVALID_HANDLE_VALUE;
+    mapping_ = NULL;
+#else
+    if (data_) munmap(const_cast<char *>(data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = NULL;
+    size_ = 0;
+  }
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  mapped_file(const mapped_file &);
+  mapped_file &operator=(const mapped_file &);
+
+  const char *data_;
+  size_t size_;
+#ifdef _WIN32
+  HANDLE file_;
+  HANDLE mapping_;
+#else
+  int fd_;
+#endif
+};
+
+struct file_stamp_t {
+  unsigned long long size;
+  long long mtime;
+};
+
+inline bool get_file_stamp(const char *filename, file_stamp_t *stamp) {
+#ifdef _WIN32
+  struct _stat64 st;
+  if (_stat64(filename, &st) != 0) return false;
+#else
+  struct stat st;
+  if (stat(filename, &st) != 0) return false;
+#endif
+  stamp->size = static_cast<unsigned long long>(st.st_size);
+  stamp->mtime = static_cast<long long>(st.st_mtime);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+// Threading
+
+inline unsigned int resolve_thread_count(unsigned int num_threads) {
+  if (num_threads) return num_threads;
+  unsigned int hw = std::thread::hardware_concurrency();
+  return hw ? hw : 1;
+}
+
+// Calls func(i) for i in [0, count), on up to num_threads threads including
+// the calling one.
+template <typename Func>
+void parallel_for(size_t count, unsigned int num_threads, const Func &func) {
+  size_t threads = (std::min)(static_cast<size_t>(num_threads), count);
+  if (threads <= 1) {
+    for (size_t i = 0; i < count; ++i) func(i);
+    return;
+  }
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) func(i);
+  };
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (size_t t = 1; t < threads; ++t) pool.emplace_back(worker);
+  worker();
+  for (size_t t = 0; t < pool.size(); ++t) pool[t].join();
+}
+
+// --------------------------------------------------------------------------
+// Number parsing
+
+inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline bool is_digit(char c) { return static_cast<unsigned>(c - '0') < 10u; }
+
+inline const char *skip_blanks(const char *p, const char *end) {
+  while (p < end && is_blank(*p)) ++p;
+  return p;
+}
+
+// Parses a decimal float; returns NULL when there is no number at p.
+inline const char *parse_float(const char *p, const char *end, float *out) {
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                  1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+  unsigned long long mantissa = 0;
+  int significant = 0;  // digits kept in mantissa, at most 19
+  int exponent = 0;
+  bool any_digit = false;
+  for (; p < end && is_digit(*p); ++p) {
+    any_digit = true;
+    if (significant < 19) {
+      mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+      if (mantissa) ++significant;
+    } else {
+      ++exponent;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && is_digit(*p); ++p) {
+      any_digit = true;
+      if (significant < 19) {
+        mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+        if (mantissa) ++significant;
+        --exponent;
+      }
+    }
+  }
+  if (!any_digit) {
+    // nan, inf and other spellings are rare enough for strtod
+    char buffer[64];
+    size_t n = 0;
+    for (const char *q = start; q < end && !is_blank(*q) && *q != '/' &&
+                                *q != '\n' && n + 1 < sizeof(buffer);
+         ++q)
+      buffer[n++] = *q;
+    buffer[n] = '\0';
+    char *stop = NULL;
+    double value = strtod(buffer, &stop);
+    if (stop == buffer) return NULL;
+    *out = static_cast<float>(value);
+    return start + (stop - buffer);
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char *q = p + 1;
+    bool negative_exponent = false;
+    if (q < end && (*q == '-' || *q == '+')) negative_exponent = (*q++ == '-');
+    if (q < end && is_digit(*q)) {
+      int e = 0;
+      for (; q < end && is_digit(*q); ++q)
+        if (e < 10000) e = e * 10 + (*q - '0');
+      exponent += negative_exponent ? -e : e;
+      p = q;
+    }
+  }
+
+  double value = static_cast<double>(mantissa);
+  if (mantissa != 0) {
+    if (exponent >= -22 && exponent <= 22)
+      value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+    else
+      value *= std::pow(10.0, exponent);
+  }
+  *out = static_cast<float>(negative ? -value : value);
+  return p;
+}
+
+// Parses a decimal integer; returns NULL when there is no number at p.
+inline const char *parse_int(const char *p, const char *end, long long *out) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+  if (p >= end || !is_digit(*p)) return NULL;
+  long long value = 0;
+  for (; p < end && is_digit(*p); ++p)
+    if (value < (1LL << 40)) value = value * 10 + (*p - '0');
+  *out = negative ? -value : value;
+  return p;
+}
+
+// --------------------------------------------------------------------------
+// Chunked parsing
+
+enum { kEventName = 0, kEventMaterial = 1 };
+
+struct event_t {
+  int type;
+  std::string value;
+  size_t index_offset;  // within the chunk's indices
+};
+
+struct chunk_t {
+  const char *begin;
+  const char *end;
+  size_t num_v, num_vt, num_vn;     // first pass
+  size_t base_v, base_vt, base_vn;  // prefix sums of the counts
+  std::vector<index_t> indices;
+  std::vector<event_t> events;
+  std::vector<std::string> material_libraries;
+  size_t num_faces;
+  std::string error;
+
+  chunk_t()
+      : begin(NULL), end(NULL), num_v(0), num_vt(0), num_vn(0), base_v(0),
+        base_vt(0), base_vn(0), num_faces(0) {}
+};
+
+inline const char *line_end(const char *p, const char *end) {
+  const void *nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+  return nl ? static_cast<const char *>(nl) : end;
+}
+
+inline bool starts_keyword(const char *p, const char *end, const char *keyword,
+                           size_t length) {
+  return static_cast<size_t>(end - p) > length &&
+         std::memcmp(p, keyword, length) == 0 && is_blank(p[length]);
+}
+
+inline std::string rest_of_line(const char *p, const char *end) {
+  p = skip_blanks(p, end);
+  while (end > p && is_blank(end[-1])) --end;
+  return std::string(p, end);
+}
+
+inline void count_attributes(chunk_t *chunk) {
+  for (const char *p = chunk->begin; p < chunk->end;) {
+    const char *eol = line_end(p, chunk->end);
+    p = skip_blanks(p, eol);
+    if (eol - p > 1 && p[0] == 'v') {
+      if (is_blank(p[1]))
+        ++chunk->num_v;
+      else if (eol - p > 2 && is_blank(p[2])) {
+        if (p[1] == 't')
+          ++chunk->num_vt;
+        else if (p[1] == 'n')
+          ++chunk->num_vn;
+      }
+    }
+    p = eol < chunk->end ? eol + 1 : chunk->end;
+  }
+}
+
+// Resolves a 1-based or negative OBJ index to a 0-based one; -1 if invalid.
+inline int resolve_index(long long value, size_t seen, size_t total) {
+  long long index = value > 0 ? value - 1 : static_cast<long long>(seen) + value;
+  if (value == 0 || index < 0 || index >= static_cast<long long>(total))
+    return -1;
+  return static_cast<int>(index);
+}
+
+inline void parse_chunk(chunk_t *chunk, const char *file_begin,
+                        size_t total_v, size_t total_vt, size_t total_vn,
+                        mesh_t *mesh) {
+  size_t v = chunk->base_v, vt = chunk->base_vt, vn = chunk->base_vn;
+  std::vector<index_t> corners;
+  float values[3];
+
+  for (const char *p = chunk->begin; p < chunk->end;) {
+    const char *eol = line_end(p, chunk->end);
+    const char *line = skip_blanks(p, eol);
+    p = eol < chunk->end ? eol + 1 : chunk->end;
+    if (line >= eol) continue;
+
+    switch (line[0]) {
+      case 'v': {
+        if (eol - line < 2) break;
+        int kind;  // 0: v, 1: vt, 2: vn
+        const char *q;
+        if (is_blank(line[1])) {
+          kind = 0;
+          q = line + 1;
+        } else if (eol - line > 2 && is_blank(line[2]) &&
+                   (line[1] == 't' || line[1] == 'n')) {
+          kind = line[1] == 't' ? 1 : 2;
+          q = line + 2;
+        } else {
+          break;
+        }
+        int count = kind == 1 ? 2 : 3;
+        for (int i = 0; i < count; ++i) {
+          values[i] = 0.0f;
+          q = skip_blanks(q, eol);
+          const char *next = parse_float(q, eol, &values[i]);
+          if (next) q = next;
+        }
+        if (kind == 0) {
+          std::memcpy(&mesh->vertices[3 * v++], values, 3 * sizeof(float));
+        } else if (kind == 1) {
+          std::memcpy(&mesh->texcoords[2 * vt++], values, 2 * sizeof(float));
+        } else {
+          std::memcpy(&mesh->normals[3 * vn++], values, 3 * sizeof(float));
+        }
+        break;
+      }
+      case 'f': {
+        if (eol - line < 2 || !is_blank(line[1])) break;
+        corners.clear();
+        const char *q = line + 1;
+        bool valid = true;
+        for (;;) {
+          q = skip_blanks(q, eol);
+          if (q >= eol || *q == '#') break;
+          long long value;
+          index_t corner = {-1, -1, -1};
+          q = parse_int(q, eol, &value);
+          if (!q) {
+            valid = false;
+            break;
+          }
+          corner.vertex_index = resolve_index(value, v, total_v);
+          valid = valid && corner.vertex_index >= 0;
+          if (q < eol && *q == '/') {
+            ++q;
+            if (q < eol && *q != '/' && !is_blank(*q)) {
+              q = parse_int(q, eol, &value);
+              if (!q) {
+                valid = false;
+                break;
+              }
+              corner.texcoord_index = resolve_index(value, vt, total_vt);
+              valid = valid && corner.texcoord_index >= 0;
+            }
+            if (q < eol && *q == '/') {
+              ++q;
+              q = parse_int(q, eol, &value);
+              if (!q) {
+                valid = false;
+                break;
+              }
+              corner.normal_index = resolve_index(value, vn, total_vn);
+              valid = valid && corner.normal_index >= 0;
+            }
+          }
+          corners.push_back(corner);
+        }
+        if (!valid) {
+          if (chunk->error.empty()) {
+            char message[96];
+            snprintf(message, sizeof(message),
+                     "invalid face at byte offset %llu",
+                     static_cast<unsigned long long>(line - file_begin));
+            chunk->error = message;
+          }
+          break;
+        }
+        if (corners.size() < 3) break;
+        ++chunk->num_faces;
+        for (size_t i = 1; i + 1 < corners.size(); ++i) {
+          chunk->indices.push_back(corners[0]);
+          chunk->indices.push_back(corners[i]);
+          chunk->indices.push_back(corners[i + 1]);
+        }
+        break;
+      }
+      case 'o':
+      case 'g':
+        if (eol - line > 1 && is_blank(line[1])) {
+          event_t event = {kEventName, rest_of_line(line + 1, eol),
+                           chunk->indices.size()};
+          chunk->events.push_back(event);
+        }
+        break;
+      case 'u':
+        if (starts_keyword(line, eol, "usemtl", 6)) {
+          event_t event = {kEventMaterial, rest_of_line(line + 6, eol),
+                           chunk->indices.size()};
+          chunk->events.push_back(event);
+        }
+        break;
+      case 'm':
+        if (starts_keyword(line, eol, "mtllib", 6))
+          chunk->material_libraries.push_back(rest_of_line(line + 6, eol));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+// Binary cache
+
+const unsigned int kCacheMagic = 0x4A424F46;  // "FOBJ"
+const unsigned int kCacheVersion = 1;
+enum { kCacheRaw = 0, kCacheIndexed = 1 };
+
+struct cache_header_t {
+  unsigned int magic;
+  unsigned int version;
+  unsigned int kind;
+  unsigned int weld_flags;
+  unsigned long long source_size;
+  long long source_mtime;
+};
+
+class cache_writer {
+ public:
+  explicit cache_writer(FILE *file) : file_(file), ok_(true) {}
+  void bytes(const void *data, size_t size) {
+    if (ok_ && size) ok_ = fwrite(data, 1, size, file_) == size;
+  }
+  template <typename T>
+  void value(const T &v) {
+    bytes(&v, sizeof(T));
+  }
+  template <typename T>
+  void array(const std::vector<T> &v) {
+    unsigned long long count = v.size();
+    value(count);
+    if (!v.empty()) bytes(&v[0], v.size() * sizeof(T));
+  }
+  void string(const std::string &s) {
+    unsigned long long length = s.size();
+    value(length);
+    bytes(s.data(), s.size());
+  }
+  template <typename T>
+  void resize(std::vector<T> &, unsigned long long) {}
+  bool ok() const { return ok_; }
+
+ private:
+  FILE *file_;
+  bool ok_;
+};
+
+class cache_reader {
+ public:
+  cache_reader(FILE *file, unsigned long long remaining)
+      : file_(file), remaining_(remaining), ok_(true) {}
+  void bytes(void *data, size_t size) {
+    if (!ok_ || !size) return;
+    ok_ = size <= remaining_ && fread(data, 1, size, file_) == size;
+    remaining_ -= ok_ ? size : 0;
+  }
+  template <typename T>
+  void value(T &v) {
+    bytes(&v, sizeof(T));
+  }
+  template <typename T>
+  void array(std::vector<T> &v) {
+    unsigned long long count = 0;
+    value(count);
+    if (!ok_ || count > remaining_ / sizeof(T)) {
+      ok_ = false;
+      return;
+    }
+    v.resize(static_cast<size_t>(count));
+    if (count) bytes(&v[0], static_cast<size_t>(count) * sizeof(T));
+  }
+  void string(std::string &s) {
+    unsigned long long length = 0;
+    value(length);
+    if (!ok_ || length > remaining_) {
+      ok_ = false;
+      return;
+    }
+    s.resize(static_cast<size_t>(length));
+    if (length) bytes(&s[0], static_cast<size_t>(length));
+  }
+  template <typename T>
+  void resize(std::vector<T> &v, unsigned long long count) {
+    if (ok_ && count > remaining_) ok_ = false;
+    if (ok_) v.resize(static_cast<size_t>(count));
+  }
+  bool ok() const { return ok_; }
+
+ private:
+  FILE *file_;
+  unsigned long long remaining_;
+  bool ok_;
+};
+
+template <typename IO, typename Group>
+void serialize_groups(IO &io, Group &groups) {
+  unsigned long long count = groups.size();
+  io.value(count);
+  io.resize(groups, count);
+  if (!io.ok()) return;
+  for (size_t i = 0; i < groups.size(); ++i) {
+    io.string(groups[i].name);
+    io.string(groups[i].material);
+    io.value(groups[i].index_offset);
+    io.value(groups[i].num_indices);
+  }
+}
+
+template <typename IO, typename Strings>
+void serialize_strings(IO &io, Strings &strings) {
+  unsigned long long count = strings.size();
+  io.value(count);
+  io.resize(strings, count);
+  if (!io.ok()) return;
+  for (size_t i = 0; i < strings.size(); ++i) io.string(strings[i]);
+}
+
+// Both directions share one field list. The writer never modifies the mesh,
+// it is only taken by non-const reference to share the code.
+template <typename IO, typename Mesh>
+void serialize_common(IO &io, Mesh &mesh) {
+  io.array(mesh.vertices);
+  io.array(mesh.texcoords);
+  io.array(mesh.normals);
+  io.array(mesh.indices);
+  serialize_groups(io, mesh.groups);
+  serialize_strings(io, mesh.material_libraries);
+}
+
+inline void serialize(cache_writer &io, const mesh_t &mesh) {
+  serialize_common(io, const_cast<mesh_t &>(mesh));
+  unsigned long long num_faces = mesh.num_faces;
+  io.value(num_faces);
+}
+inline void serialize(cache_reader &io, mesh_t &mesh) {
+  serialize_common(io, mesh);
+  unsigned long long num_faces = 0;
+  io.value(num_faces);
+  mesh.num_faces = static_cast<size_t>(num_faces);
+}
+inline void serialize(cache_writer &io, const indexed_mesh_t &mesh) {
+  serialize_common(io, const_cast<indexed_mesh_t &>(mesh));
+}
+inline void serialize(cache_reader &io, indexed_mesh_t &mesh) {
+  serialize_common(io, mesh);
+}
+
+template <typename Mesh>
+bool read_cache(const std::string &path, const file_stamp_t &stamp,
+                unsigned int kind, unsigned int weld_flags, Mesh *mesh) {
+  file_stamp_t cache_stamp;
+  if (!get_file_stamp(path.c_str(), &cache_stamp)) return false;
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) return false;
+
+  cache_reader io(file, cache_stamp.size);
+  cache_header_t header;
+  io.value(header);
+  bool ok = io.ok() && header.magic == kCacheMagic &&
+            header.version == kCacheVersion && header.kind == kind &&
+            header.weld_flags == weld_flags &&
+            header.source_size == stamp.size &&
+            header.source_mtime == stamp.mtime;
+  Mesh result;
+  if (ok) {
+    serialize(io, result);
+    ok = io.ok();
+  }
+  fclose(file);
+  if (ok) {
+    std::swap(*mesh, result);
+  }
+  return ok;
+}
+
+template <typename Mesh>
+void write_cache(const std::string &path, const file_stamp_t &stamp,
+                 unsigned int kind, unsigned int weld_flags,
+                 const Mesh &mesh) {
+  // write next to the destination and rename, so readers never see a
+  // partial file
+  std::string temp_path = path + ".tmp";
+  FILE *file = fopen(temp_path.c_str(), "wb");
+  if (!file) return;
+  cache_writer io(file);
+  cache_header_t header = {kCacheMagic,  kCacheVersion, kind,
+                           weld_flags,   stamp.size,    stamp.mtime};
+  io.value(header);
+  serialize(io, mesh);
+  bool ok = io.ok();
+  ok = (fclose(file) == 0) && ok;
+  if (ok) {
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    ok = std::rename(temp_path.c_str(), path.c_str()) == 0;
+  }
+  if (!ok) std::remove(temp_path.c_str());
+}
+
+// --------------------------------------------------------------------------
+// Vertex cache optimization (Tom Forsyth, "Linear-Speed Vertex Cache
+// Optimisation"). Vertices are scored by their position in a simulated LRU
+// cache and by how many triangles still use them; the next triangle is the
+// best scored one among those touching the cache, so the search stays local.
+
+class vertex_cache_optimizer {
+ public:
+  explicit vertex_cache_optimizer(unsigned int cache_size)
+      : cache_size_((std::max)(cache_size, 4u)) {
+    position_score_.resize(cache_size_);
+    for (unsigned int i = 0; i < cache_size_; ++i) {
+      // the last triangle's vertices get a flat score so that the strip-like
+      // order does not depend on their exact position
+      position_score_[i] =
+          i < 3 ? 0.75f
+                : std::pow(1.0f - static_cast<float>(i - 3) /
+                                      static_cast<float>(cache_size_ - 3),
+                           1.5f);
+    }
+    valence_score_.resize(kValenceTable);
+    for (unsigned int i = 1; i < kValenceTable; ++i)
+      valence_score_[i] = 2.0f / std::sqrt(static_cast<float>(i));
+  }
+
+  // Reorders the triangles of indices[0, count) in place; vertex ids must be
+  // below num_vertices.
+  void run(unsigned int *indices, size_t count, size_t num_vertices) {
+    const size_t num_triangles = count / 3;
+    if (num_triangles < 2) return;
+
+    // triangles per vertex, compacted as they are emitted
+    first_.assign(num_vertices + 1, 0);
+    live_.assign(num_vertices, 0);
+    for (size_t i = 0; i < num_triangles * 3; ++i) ++live_[indices[i]];
+    for (size_t v = 0; v < num_vertices; ++v)
+      first_[v + 1] = first_[v] + live_[v];
+    adjacency_.resize(num_triangles * 3);
+    std::vector<unsigned int> fill(first_.begin(), first_.end() - 1);
+    for (size_t t = 0; t < num_triangles; ++t)
+      for (int k = 0; k < 3; ++k)
+        adjacency_[fill[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+
+    vertex_score_.resize(num_vertices);
+    for (size_t v = 0; v < num_vertices; ++v)
+      vertex_score_[v] = score(-1, live_[v]);
+    triangle_score_.resize(num_triangles);
+    for (size_t t = 0; t < num_triangles; ++t)
+      triangle_score_[t] = vertex_score_[indices[3 * t]] +
+                           vertex_score_[indices[3 * t + 1]] +
+                           vertex_score_[indices[3 * t + 2]];
+    emitted_.assign(num_triangles, 0);
+
+    std::vector<unsigned int> output(num_triangles * 3);
+    std::vector<unsigned int> cache, next_cache;
+    cache.reserve(cache_size_ + 3);
+    next_cache.reserve(cache_size_ + 3);
+
+    size_t best = 0;
+    for (size_t t = 1; t < num_triangles; ++t)
+      if (triangle_score_[t] > triangle_score_[best]) best = t;
+    size_t scan = 0;
+
+    for (size_t emitted = 0; emitted < num_triangles; ++emitted) {
+      if (best == kNone) {
+        // nothing in the cache has work left; resume a linear scan
+        while (emitted_[scan]) ++scan;
+        best = scan;
+      }
+      const unsigned int *tri = &indices[3 * best];
+      std::memcpy(&output[3 * emitted], tri, 3 * sizeof(unsigned int));
+      emitted_[best] = 1;
+      for (int k = 0; k < 3; ++k) remove_triangle(tri[k], best);
+
+      // the triangle's vertices move to the front, the rest shift back
+      next_cache.clear();
+      for (int k = 0; k < 3; ++k)
+        if (std::find(next_cache.begin(), next_cache.end(), tri[k]) ==
+            next_cache.end())
+          next_cache.push_back(tri[k]);
+      for (size_t i = 0; i < cache.size(); ++i)
+        if (std::find(next_cache.begin(), next_cache.end(), cache[i]) ==
+            next_cache.end())
+          next_cache.push_back(cache[i]);
+
+      float best_score = -1.0f;
+      best = kNone;
+      for (size_t i = 0; i < next_cache.size(); ++i) {
+        unsigned int v = next_cache[i];
+        int position = i < cache_size_ ? static_cast<int>(i) : -1;
+        float updated = score(position, live_[v]);
+        float delta = updated - vertex_score_[v];
+        vertex_score_[v] = updated;
+        for (unsigned int a = first_[v]; a < first_[v] + live_[v]; ++a) {
+          unsigned int t = adjacency_[a];
+          triangle_score_[t] += delta;
+          if (triangle_score_[t] > best_score) {
+            best_score = triangle_score_[t];
+            best = t;
+          }
+        }
+      }
+      if (next_cache.size() > cache_size_) next_cache.resize(cache_size_);
+      cache.swap(next_cache);
+    }
+    std::memcpy(indices, &output[0], output.size() * sizeof(unsigned int));
+  }
+
+ private:
+  static const size_t kNone = static_cast<size_t>(-1);
+  static const unsigned int kValenceTable = 64;
+
+  float score(int position, unsigned int live) const {
+    if (live == 0) return -1.0f;  // no triangles left, never pick it
+    float s = position >= 0 ? position_score_[position] : 0.0f;
+    return s + (live < kValenceTable
+                    ? valence_score_[live]
+                    : 2.0f / std::sqrt(static_cast<float>(live)));
+  }
+
+  void remove_triangle(unsigned int v, size_t t) {
+    unsigned int *begin = &adjacency_[first_[v]];
+    unsigned int *end = begin + live_[v];
+    unsigned int *it = std::find(begin, end, static_cast<unsigned int>(t));
+    std::swap(*it, *(end - 1));
+    --live_[v];
+  }
+
+  unsigned int cache_size_;
+  std::vector<float> position_score_;
+  std::vector<float> valence_score_;
+  std::vector<unsigned int> first_;
+  std::vector<unsigned int> live_;
+  std::vector<unsigned int> adjacency_;
+  std::vector<float> vertex_score_;
+  std::vector<float> triangle_score_;
+  std::vector<unsigned char> emitted_;
+};
+
+}  // namespace detail
+
+// ----------------------------------------------------------------------------
+
+bool LoadObjFromMemory(mesh_t *mesh, std::string *err, const char *data,
+                       size_t size, unsigned int num_threads) {
+  *mesh = mesh_t();
+  if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+    data += 3;
+    size -= 3;
+  }
+  if (size == 0) return true;
+  num_threads = detail::resolve_thread_count(num_threads);
+
+  // cut into chunks at line boundaries, a few per thread for load balancing
+  const size_t min_chunk_size = 256 * 1024;
+  size_t chunk_size = (std::max)(size / (num_threads * 4), min_chunk_size);
+  std::vector<detail::chunk_t> chunks;
+  const char *end = data + size;
+  for (const char *p = data; p < end;) {
+    detail::chunk_t chunk;
+    chunk.begin = p;
+    if (static_cast<size_t>(end - p) <= chunk_size) {
+      chunk.end = end;
+    } else {
+      const char *eol = detail::line_end(p + chunk_size, end);
+      chunk.end = eol < end ? eol + 1 : end;
+    }
+    p = chunk.end;
+    chunks.push_back(chunk);
+  }
+
+  detail::parallel_for(chunks.size(), num_threads, [&](size_t i) {
+    detail::count_attributes(&chunks[i]);
+  });
+
+  size_t total_v = 0, total_vt = 0, total_vn = 0;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    chunks[i].base_v = total_v;
+    chunks[i].base_vt = total_vt;
+    chunks[i].base_vn = total_vn;
+    total_v += chunks[i].num_v;
+    total_vt += chunks[i].num_vt;
+    total_vn += chunks[i].num_vn;
+  }
+  if (total_v > 0x7FFFFFFF || total_vt > 0x7FFFFFFF || total_vn > 0x7FFFFFFF) {
+    if (err) *err = "too many vertices";
+    return false;
+  }
+  mesh->vertices.resize(3 * total_v);
+  mesh->texcoords.resize(2 * total_vt);
+  mesh->normals.resize(3 * total_vn);
+
+  detail::parallel_for(chunks.size(), num_threads, [&](size_t i) {
+    detail::parse_chunk(&chunks[i], data, total_v, total_vt, total_vn, mesh);
+  });
+
+  size_t total_indices = 0;
+  std::vector<size_t> index_bases(chunks.size());
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    if (!chunks[i].error.empty()) {
+      if (err) *err = chunks[i].error;
+      *mesh = mesh_t();
+      return false;
+    }
+    index_bases[i] = total_indices;
+    total_indices += chunks[i].indices.size();
+    mesh->num_faces += chunks[i].num_faces;
+  }
+  if (total_indices > 0xFFFFFFFFu) {
+    if (err) *err = "too many triangles";
+    *mesh = mesh_t();
+    return false;
+  }
+
+  mesh->indices.resize(total_indices);
+  detail::parallel_for(chunks.size(), num_threads, [&](size_t i) {
+    std::vector<index_t> &indices = chunks[i].indices;
+    if (!indices.empty())
+      std::memcpy(&mesh->indices[index_bases[i]], &indices[0],
+                  indices.size() * sizeof(index_t));
+    std::vector<index_t>().swap(indices);
+  });
+
+  // replay name/material changes in file order to build the groups
+  group_t current;
+  current.index_offset = 0;
+  current.num_indices = 0;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    for (size_t e = 0; e < chunks[i].events.size(); ++e) {
+      const detail::event_t &event = chunks[i].events[e];
+      unsigned int offset =
+          static_cast<unsigned int>(index_bases[i] + event.index_offset);
+      current.num_indices = offset - current.index_offset;
+      if (current.num_indices) mesh->groups.push_back(current);
+      if (event.type == detail::kEventName)
+        current.name = event.value;
+      else
+        current.material = event.value;
+      current.index_offset = offset;
+    }
+    mesh->material_libraries.insert(mesh->material_libraries.end(),
+                                    chunks[i].material_libraries.begin(),
+                                    chunks[i].material_libraries.end());
+  }
+  current.num_indices =
+      static_cast<unsigned int>(total_indices) - current.index_offset;
+  if (current.num_indices) mesh->groups.push_back(current);
+  return true;
+}
+
+bool LoadObj(mesh_t *mesh, std::string *err, const char *filename,
+             const load_options_t &options) {
+  std::string cache_path = options.cache_path.empty()
+                               ? std::string(filename) + ".fobj"
+                               : options.cache_path;
+  detail::file_stamp_t stamp;
+  bool use_cache =
+      options.use_cache && detail::get_file_stamp(filename, &stamp);
+  if (use_cache && detail::read_cache(cache_path, stamp, detail::kCacheRaw, 0,
+                                      mesh))
+    return true;
+
+  detail::mapped_file file;
+  if (!file.open(filename)) {
+    if (err) *err = std::string("cannot open ") + filename;
+    return false;
+  }
+  if (!LoadObjFromMemory(mesh, err, file.data(), file.size(),
+                         options.num_threads))
+    return false;
+
+  if (use_cache)
+    detail::write_cache(cache_path, stamp, detail::kCacheRaw, 0, *mesh);
+  return true;
+}
+
+void WeldMesh(const mesh_t &mesh, indexed_mesh_t *out,
+              const weld_options_t &options) {
+  const bool use_texcoords = options.texcoords && !mesh.texcoords.empty();
+  const bool use_normals = options.normals && !mesh.normals.empty();
+  const unsigned int none = 0xFFFFFFFFu;
+
+  // Welded vertices sharing a position are chained from head[position], so
+  // a lookup only compares the (usually one to four) vertices at that
+  // position. Vertices are numbered in order of first use.
+  std::vector<unsigned int> head(mesh.vertices.size() / 3, none);
+  std::vector<unsigned int> next;
+  std::vector<index_t> unique;
+  next.reserve(head.size());
+  unique.reserve(head.size());
+
+  out->indices.resize(mesh.indices.size());
+  for (size_t i = 0; i < mesh.indices.size(); ++i) {
+    index_t key = mesh.indices[i];
+    if (!use_texcoords) key.texcoord_index = -1;
+    if (!use_normals) key.normal_index = -1;
+
+    unsigned int id = head[key.vertex_index];
+    while (id != none && (unique[id].texcoord_index != key.texcoord_index ||
+                          unique[id].normal_index != key.normal_index))
+      id = next[id];
+    if (id == none) {
+      id = static_cast<unsigned int>(unique.size());
+      unique.push_back(key);
+      next.push_back(head[key.vertex_index]);
+      head[key.vertex_index] = id;
+    }
+    out->indices[i] = id;
+  }
+
+  const size_t count = unique.size();
+  out->vertices.resize(3 * count);
+  out->texcoords.assign(use_texcoords ? 2 * count : 0, 0.0f);
+  out->normals.assign(use_normals ? 3 * count : 0, 0.0f);
+  for (size_t i = 0; i < count; ++i) {
+    const index_t &key = unique[i];
+    std::memcpy(&out->vertices[3 * i], &mesh.vertices[3 * key.vertex_index],
+                3 * sizeof(float));
+    if (use_texcoords && key.texcoord_index >= 0)
+      std::memcpy(&out->texcoords[2 * i],
+                  &mesh.texcoords[2 * key.texcoord_index], 2 * sizeof(float));
+    if (use_normals && key.normal_index >= 0)
+      std::memcpy(&out->normals[3 * i], &mesh.normals[3 * key.normal_index],
+                  3 * sizeof(float));
+  }
+  out->groups = mesh.groups;
+  out->material_libraries = mesh.material_libraries;
+}
+
+bool LoadIndexedObj(indexed_mesh_t *mesh, std::string *err,
+                    const char *filename, const load_options_t &options,
+                    const weld_options_t &weld) {
+  std::string cache_path = options.cache_path.empty()
+                               ? std::string(filename) + ".fobji"
+                               : options.cache_path;
+  unsigned int weld_flags = (weld.texcoords ? 1u : 0u) |
+                            (weld.normals ? 2u : 0u) |
+                            (weld.optimize_vertex_cache ? 4u : 0u);
+  detail::file_stamp_t stamp;
+  bool use_cache =
+      options.use_cache && detail::get_file_stamp(filename, &stamp);
+  if (use_cache && detail::read_cache(cache_path, stamp,
+                                      detail::kCacheIndexed, weld_flags, mesh))
+    return true;
+
+  mesh_t raw;
+  load_options_t raw_options;
+  raw_options.num_threads = options.num_threads;
+  if (!LoadObj(&raw, err, filename, raw_options)) return false;
+  WeldMesh(raw, mesh, weld);
+  if (weld.optimize_vertex_cache) OptimizeVertexCache(mesh);
+
+  if (use_cache)
+    detail::write_cache(cache_path, stamp, detail::kCacheIndexed, weld_flags,
+                        *mesh);
+  return true;
+}
+
+void InterleaveMesh(const indexed_mesh_t &mesh, std::vector<float> *out) {
+  const size_t count = mesh.num_vertices();
+  const bool has_texcoords = !mesh.texcoords.empty();
+  const bool has_normals = !mesh.normals.empty();
+  const size_t stride = 3 + (has_texcoords ? 2 : 0) + (has_normals ? 3 : 0);
+  out->resize(count * stride);
+  for (size_t i = 0; i < count; ++i) {
+    float *dst = &(*out)[i * stride];
+    std::memcpy(dst, &mesh.vertices[3 * i], 3 * sizeof(float));
+    dst += 3;
+    if (has_texcoords) {
+      std::memcpy(dst, &mesh.texcoords[2 * i], 2 * sizeof(float));
+      dst += 2;
+    }
+    if (has_normals) std::memcpy(dst, &mesh.normals[3 * i], 3 * sizeof(float));
+  }
+}
+
+void OptimizeVertexCache(indexed_mesh_t *mesh, unsigned int cache_size) {
+  const size_t num_vertices = mesh->num_vertices();
+  std::vector<unsigned int> &indices = mesh->indices;
+  if (indices.empty()) return;
+
+  // triangles never move across groups, so materials keep their ranges
+  detail::vertex_cache_optimizer optimizer(cache_size);
+  if (mesh->groups.empty()) {
+    optimizer.run(&indices[0], indices.size(), num_vertices);
+  } else {
+    for (size_t g = 0; g < mesh->groups.size(); ++g) {
+      const group_t &group = mesh->groups[g];
+      if (group.num_indices)
+        optimizer.run(&indices[group.index_offset], group.num_indices,
+                      num_vertices);
+    }
+  }
+
+  // renumber vertices in order of first use
+  const unsigned int none = 0xFFFFFFFFu;
+  std::vector<unsigned int> remap(num_vertices, none);
+  unsigned int next = 0;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    unsigned int &id = remap[indices[i]];
+    if (id == none) id = next++;
+    indices[i] = id;
+  }
+  for (size_t v = 0; v < num_vertices; ++v)
+    if (remap[v] == none) remap[v] = next++;  // unreferenced, keep at the end
+
+  std::vector<float> reordered;
+  const size_t widths[3] = {3, 2, 3};
+  std::vector<float> *arrays[3] = {&mesh->vertices, &mesh->texcoords,
+                                   &mesh->normals};
+  for (int a = 0; a < 3; ++a) {
+    std::vector<float> &src = *arrays[a];
+    const size_t width = widths[a];
+    if (src.empty()) continue;
+    reordered.resize(src.size());
+    for (size_t v = 0; v < num_vertices; ++v)
+      std::memcpy(&reordered[width * remap[v]], &src[width * v],
+                  width * sizeof(float));
+    src.swap(reordered);
+  }
+}
+
+float AverageCacheMissRatio(const std::vector<unsigned int> &indices,
+                            size_t num_vertices, unsigned int cache_size) {
+  if (indices.size() < 3) return 0.0f;
+  // timestamp[v] is the miss counter value when v entered the FIFO; it is
+  // still cached while fewer than cache_size misses happened since
+  std::vector<size_t> timestamp(num_vertices, 0);
+  size_t misses = 0;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    size_t &stamp = timestamp[indices[i]];
+    if (stamp == 0 || misses - stamp >= cache_size) stamp = ++misses;
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+unsigned int PackIndices(const indexed_mesh_t &mesh,
+                         std::vector<unsigned char> *out) {
+  const std::vector<unsigned int> &indices = mesh.indices;
+  if (mesh.num_vertices() <= 0x10000u) {
+    out->resize(indices.size() * 2);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      unsigned short value = static_cast<unsigned short>(indices[i]);
+      std::memcpy(&(*out)[2 * i], &value, 2);
+    }
+    return 2;
+  }
+  out->resize(indices.size() * 4);
+  if (!indices.empty())
+    std::memcpy(&(*out)[0], &indices[0], indices.size() * 4);
+  return 4;
+}
+
+}  // namespace fastobj
+
+#endif  // FAST_OBJ_LOADER_IMPLEMENTED_
+#endif  // FAST_OBJ_LOADER_IMPLEMENTATION
@@ -0,0 +1,510 @@
+/*
+gl_program_cache.h - persistent OpenGL program binary cache
+
+Single-header library. Include it after the GL loader header (glad), and in
+exactly one .cpp file do
+
+    #define GL_PROGRAM_CACHE_IMPLEMENTATION
+    #include "gl_program_cache.h"
+
+How it works:
+  - every program is keyed by a 64-bit FNV-1a hash of its stage types and
+    sources, plus the GL vendor/renderer/version strings, so a driver update
+    never feeds a stale binary to glProgramBinary;
+  - on a miss the stages are compiled and linked from source with
+    GL_PROGRAM_BINARY_RETRIEVABLE_HINT set, and the linked program is written
+    to "<cache_dir>/<key>.glbin" with glGetProgramBinary;
+  - on a hit the blob is handed to glProgramBinary; if the driver rejects it
+    the file is dropped and the program is compiled from source instead;
+  - Request() only submits work. With GL_KHR_parallel_shader_compile (or the
+    ARB variant) Poll() asks GL_COMPLETION_STATUS_KHR and never blocks, so
+    the driver compiles on its own threads while the application keeps
+    loading assets; without it the first Poll() waits for the driver;
+  - compile and link status are always checked and the info logs reported.
+
+Program binaries need GL 4.1 or GL_ARB_get_program_binary and at least one
+binary format. The entry points are fetched through the loader passed to
+Init(), so a glad generated for GL 3.3 works; without them the cache still
+compiles, checks status and polls, but nothing is stored on disk.
+
+Example:
+
+    glcache::ProgramCache programs;
+    programs.Init((glcache::load_proc_t)glfwGetProcAddress, "shader_cache");
+    int scene = programs.Request(sceneVS, sceneFS);
+    // ... load meshes and textures ...
+    std::string err;
+    GLuint program = programs.Wait(scene, &err);  // 0 on failure
+
+This header only requires C++11.
+*/
+
+#ifndef GL_PROGRAM_CACHE_H_
+#define GL_PROGRAM_CACHE_H_
+
+#include <string>
+#include <vector>
+
+namespace glcache {
+
+typedef void *(*load_proc_t)(const char *name);
+
+enum status_t {
+  STATUS_PENDING,  // compiling or linking in the driver
+  STATUS_READY,    // Program() is a linked program
+  STATUS_FAILED    // Error() holds the compile or link log
+};
+
+struct stage_t {
+  GLenum type;  // GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, ...
+  std::string source;
+};
+
+struct stats_t {
+  unsigned int binary_hits;     // loaded with glProgramBinary
+  unsigned int binary_misses;   // no usable file, compiled from source
+  unsigned int binary_rejects;  // file found but refused by the driver
+  unsigned int binaries_written;
+
+  stats_t()
+      : binary_hits(0), binary_misses(0), binary_rejects(0),
+        binaries_written(0) {}
+};
+
+class ProgramCache {
+ public:
+  ProgramCache();
+
+  // Needs a current context. An empty cache_dir disables the disk cache.
+  void Init(load_proc_t load, const std::string &cache_dir);
+
+  // Starts building a program and returns its handle. Identical stages
+  // requested twice share one handle.
+  int Request(const std::vector<stage_t> &stages);
+  int Request(const char *vertex_source, const char *fragment_source);
+
+  // Finishes the program if the driver is done with it; never blocks when
+  // parallel_compile() is true.
+  status_t Poll(int handle);
+  // Polls until done; returns the program, or 0 and fills err on failure.
+  GLuint Wait(int handle, std::string *err = NULL);
+
+  status_t Status(int handle) const;
+  GLuint Program(int handle) const;  // 0 unless STATUS_READY
+  const std::string &Error(int handle) const;
+
+  // Request() followed by Wait().
+  GLuint Get(const char *vertex_source, const char *fragment_source,
+             std::string *err = NULL);
+
+  // Deletes every program; call before the context is destroyed.
+  void Release();
+
+  bool binary_supported() const { return binary_supported_; }
+  bool parallel_compile() const { return parallel_compile_; }
+  const stats_t &stats() const { return stats_; }
+
+ private:
+  struct entry_t {
+    unsigned long long key;
+    GLuint program;
+    std::vector<GLuint> shaders;
+    status_t status;
+    std::string error;
+  };
+
+  typedef void(APIENTRYP get_program_binary_t)(GLuint, GLsizei, GLsizei *,
+                                               GLenum *, void *);
+  typedef void(APIENTRYP program_binary_t)(GLuint, GLenum, const void *,
+                                           GLsizei);
+  typedef void(APIENTRYP program_parameteri_t)(GLuint, GLenum, GLint);
+  typedef void(APIENTRYP max_compiler_threads_t)(GLuint);
+
+  std::string CachePath(unsigned long long key) const;
+  bool LoadBinary(entry_t *e);
+  void StoreBinary(const entry_t &e);
+  void Finish(entry_t *e);
+
+  std::vector<entry_t> entries_;
+  std::string cache_dir_;
+  unsigned long long driver_hash_;
+  bool binary_supported_;
+  bool parallel_compile_;
+  stats_t stats_;
+
+  get_program_binary_t get_program_binary_;
+  program_binary_t program_binary_;
+  program_parameteri_t program_parameteri_;
+};
+
+}  // namespace glcache
+
+#endif  // GL_PROGRAM_CACHE_H_
+
+#ifdef GL_PROGRAM_CACHE_IMPLEMENTATION
+#ifndef GL_PROGRAM_CACHE_IMPLEMENTED_
+#define GL_PROGRAM_CACHE_IMPLEMENTED_
+
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+// GL 4.1 / ARB_get_program_binary and KHR_parallel_shader_compile enums, for
+// loaders generated without them.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace glcache {
+namespace detail {
+
+const unsigned int kMagic = 0x42504c47u;  // "GLPB"
+const unsigned int kFormatVersion = 1;
+
+struct file_header_t {
+  unsigned int magic;
+  unsigned int version;
+  unsigned long long key;
+  unsigned int binary_format;
+  unsigned int binary_length;
+};
+
+inline unsigned long long fnv1a(const void *data, size_t size,
+                                unsigned long long h) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+inline unsigned long long fnv1a(const char *s, unsigned long long h) {
+  return s ? fnv1a(s, strlen(s), h) : h;
+}
+
+inline bool make_dir(const std::string &path) {
+#ifdef _WIN32
+  if (_mkdir(path.c_str()) == 0) return true;
+#else
+  if (mkdir(path.c_str(), 0755) == 0) return true;
+#endif
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFDIR);
+}
+
+inline std::string shader_log(GLuint shader) {
+  GLint length = 0;
+  glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+  std::string log(length > 1 ? length : 1, '\0');
+  glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), NULL, &log[0]);
+  log.resize(strlen(log.c_str()));
+  return log;
+}
+
+inline std::string program_log(GLuint program) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+  std::string log(length > 1 ? length : 1, '\0');
+  glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), NULL,
+                      &log[0]);
+  log.resize(strlen(log.c_str()));
+  return log;
+}
+
+inline const char *stage_name(GLenum type) {
+  switch (type) {
+    case GL_VERTEX_SHADER: return "vertex";
+    case GL_FRAGMENT_SHADER: return "fragment";
+    case GL_GEOMETRY_SHADER: return "geometry";
+    default: return "shader";
+  }
+}
+
+inline bool has_extension(const char *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    const char *ext =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    if (ext && strcmp(ext, name) == 0) return true;
+  }
+  return false;
+}
+
+}  // namespace detail
+
+ProgramCache::ProgramCache()
+    : driver_hash_(14695981039346656037ull),
+      binary_supported_(false),
+      parallel_compile_(false),
+      get_program_binary_(NULL),
+      program_binary_(NULL),
+      program_parameteri_(NULL) {}
+
+void ProgramCache::Init(load_proc_t load, const std::string &cache_dir) {
+  cache_dir_ = cache_dir;
+
+  unsigned long long h = 14695981039346656037ull;
+  h = detail::fnv1a(reinterpret_cast<const char *>(glGetString(GL_VENDOR)), h);
+  h = detail::fnv1a(reinterpret_cast<const char *>(glGetString(GL_RENDERER)),
+                    h);
+  h = detail::fnv1a(reinterpret_cast<const char *>(glGetString(GL_VERSION)), h);
+  driver_hash_ = h;
+
+  get_program_binary_ =
+      reinterpret_cast<get_program_binary_t>(load("glGetProgramBinary"));
+  program_binary_ = reinterpret_cast<program_binary_t>(load("glProgramBinary"));
+  program_parameteri_ =
+      reinterpret_cast<program_parameteri_t>(load("glProgramParameteri"));
+  GLint formats = 0;
+  if (get_program_binary_ && program_binary_ && program_parameteri_)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  binary_supported_ = formats > 0 && !cache_dir_.empty() &&
+                      detail::make_dir(cache_dir_);
+  while (glGetError() != GL_NO_ERROR) {
+  }
+
+  max_compiler_threads_t max_threads = NULL;
+  if (detail::has_extension("GL_KHR_parallel_shader_compile"))
+    max_threads = reinterpret_cast<max_compiler_threads_t>(
+        load("glMaxShaderCompilerThreadsKHR"));
+  else if (detail::has_extension("GL_ARB_parallel_shader_compile"))
+    max_threads = reinterpret_cast<max_compiler_threads_t>(
+        load("glMaxShaderCompilerThreadsARB"));
+  parallel_compile_ = max_threads != NULL;
+  if (max_threads) max_threads(0xFFFFFFFFu);  // let the driver choose
+}
+
+int ProgramCache::Request(const std::vector<stage_t> &stages) {
+  unsigned long long key = driver_hash_;
+  for (size_t i = 0; i < stages.size(); ++i) {
+    unsigned long long size = stages[i].source.size();
+    key = detail::fnv1a(&stages[i].type, sizeof(stages[i].type), key);
+    key = detail::fnv1a(&size, sizeof(size), key);
+    key = detail::fnv1a(stages[i].source.data(), stages[i].source.size(), key);
+  }
+  for (size_t i = 0; i < entries_.size(); ++i)
+    if (entries_[i].key == key && entries_[i].status != STATUS_FAILED)
+      return static_cast<int>(i);
+
+  entry_t e;
+  e.key = key;
+  e.program = 0;
+  e.status = STATUS_PENDING;
+
+  if (binary_supported_) {
+    if (LoadBinary(&e)) {
+      ++stats_.binary_hits;
+      entries_.push_back(e);
+      return static_cast<int>(entries_.size() - 1);
+    }
+    ++stats_.binary_misses;
+  }
+
+  // Submit everything without querying status, so the driver can overlap
+  // the work with whatever the application does before Poll().
+  e.program = glCreateProgram();
+  if (binary_supported_)
+    program_parameteri_(e.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  for (size_t i = 0; i < stages.size(); ++i) {
+    GLuint shader = glCreateShader(stages[i].type);
+    const char *src = stages[i].source.c_str();
+    glShaderSource(shader, 1, &src, NULL);
+    glCompileShader(shader);
+    glAttachShader(e.program, shader);
+    e.shaders.push_back(shader);
+  }
+  glLinkProgram(e.program);
+
+  entries_.push_back(e);
+  return static_cast<int>(entries_.size() - 1);
+}
+
+int ProgramCache::Request(const char *vertex_source,
+                          const char *fragment_source) {
+  std::vector<stage_t> stages(2);
+  stages[0].type = GL_VERTEX_SHADER;
+  stages[0].source = vertex_source;
+  stages[1].type = GL_FRAGMENT_SHADER;
+  stages[1].source = fragment_source;
+  return Request(stages);
+}
+
+status_t ProgramCache::Poll(int handle) {
+  entry_t &e = entries_[handle];
+  if (e.status != STATUS_PENDING) return e.status;
+  if (parallel_compile_) {
+    GLint done = GL_FALSE;
+    glGetProgramiv(e.program, GL_COMPLETION_STATUS_KHR, &done);
+    if (!done) return STATUS_PENDING;
+  }
+  Finish(&e);
+  return e.status;
+}
+
+GLuint ProgramCache::Wait(int handle, std::string *err) {
+  entry_t &e = entries_[handle];
+  if (e.status == STATUS_PENDING) Finish(&e);
+  if (e.status == STATUS_FAILED && err) *err = e.error;
+  return e.program;
+}
+
+status_t ProgramCache::Status(int handle) const {
+  return entries_[handle].status;
+}
+
+GLuint ProgramCache::Program(int handle) const {
+  return entries_[handle].status == STATUS_READY ? entries_[handle].program
+                                                 : 0;
+}
+
+const std::string &ProgramCache::Error(int handle) const {
+  return entries_[handle].error;
+}
+
+GLuint ProgramCache::Get(const char *vertex_source,
+                         const char *fragment_source, std::string *err) {
+  return Wait(Request(vertex_source, fragment_source), err);
+}
+
+void ProgramCache::Release() {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    for (size_t s = 0; s < entries_[i].shaders.size(); ++s)
+      glDeleteShader(entries_[i].shaders[s]);
+    if (entries_[i].program) glDeleteProgram(entries_[i].program);
+  }
+  entries_.clear();
+}
+
+std::string ProgramCache::CachePath(unsigned long long key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.glbin", key);
+  return cache_dir_ + "/" + name;
+}
+
+// Link status of a binary is known as soon as glProgramBinary returns.
+bool ProgramCache::LoadBinary(entry_t *e) {
+  std::string path = CachePath(e->key);
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+
+  detail::file_header_t header;
+  std::vector<char> blob;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+            header.magic == detail::kMagic &&
+            header.version == detail::kFormatVersion && header.key == e->key &&
+            header.binary_length > 0;
+  if (ok) {
+    blob.resize(header.binary_length);
+    ok = fread(&blob[0], 1, blob.size(), f) == blob.size();
+  }
+  fclose(f);
+
+  if (ok) {
+    GLuint program = glCreateProgram();
+    program_binary_(program, header.binary_format, &blob[0],
+                    static_cast<GLsizei>(blob.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked) {
+      e->program = program;
+      e->status = STATUS_READY;
+      return true;
+    }
+    glDeleteProgram(program);
+    while (glGetError() != GL_NO_ERROR) {
+    }
+  }
+  ++stats_.binary_rejects;
+  remove(path.c_str());
+  return false;
+}
+
+void ProgramCache::StoreBinary(const entry_t &e) {
+  GLint length = 0;
+  glGetProgramiv(e.program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) return;
+
+  std::vector<char> blob(length);
+  GLenum format = 0;
+  get_program_binary_(e.program, length, &length, &format, &blob[0]);
+  if (length <= 0) return;
+
+  detail::file_header_t header;
+  memset(&header, 0, sizeof(header));
+  header.magic = detail::kMagic;
+  header.version = detail::kFormatVersion;
+  header.key = e.key;
+  header.binary_format = format;
+  header.binary_length = static_cast<unsigned int>(length);
+
+  // Write next to the final name and rename, so a crash never leaves a
+  // truncated blob behind.
+  std::string path = CachePath(e.key);
+  std::string tmp = path + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "wb");
+  if (!f) return;
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+            fwrite(&blob[0], 1, length, f) == static_cast<size_t>(length);
+  ok = fclose(f) == 0 && ok;
+  remove(path.c_str());
+  if (ok && rename(tmp.c_str(), path.c_str()) == 0)
+    ++stats_.binaries_written;
+  else
+    remove(tmp.c_str());
+}
+
+void ProgramCache::Finish(entry_t *e) {
+  GLint linked = GL_FALSE;
+  glGetProgramiv(e->program, GL_LINK_STATUS, &linked);
+  if (!linked) {
+    for (size_t i = 0; i < e->shaders.size(); ++i) {
+      GLint compiled = GL_FALSE;
+      glGetShaderiv(e->shaders[i], GL_COMPILE_STATUS, &compiled);
+      if (compiled) continue;
+      GLint type = 0;
+      glGetShaderiv(e->shaders[i], GL_SHADER_TYPE, &type);
+      e->error += std::string(detail::stage_name(type)) +
+                  " shader compilation failed:\n" +
+                  detail::shader_log(e->shaders[i]);
+    }
+    if (e->error.empty())
+      e->error = "program linking failed:\n" + detail::program_log(e->program);
+  }
+
+  for (size_t i = 0; i < e->shaders.size(); ++i) {
+    glDetachShader(e->program, e->shaders[i]);
+    glDeleteShader(e->shaders[i]);
+  }
+  e->shaders.clear();
+
+  if (!linked) {
+    glDeleteProgram(e->program);
+    e->program = 0;
+    e->status = STATUS_FAILED;
+    return;
+  }
+  e->status = STATUS_READY;
+  if (binary_supported_) StoreBinary(*e);
+}
+
+}  // namespace glcache
+
+#endif  // GL_PROGRAM_CACHE_IMPLEMENTED_
+#endif  // GL_PROGRAM_CACHE_IMPLEMENTATION